@@ -0,0 +1,313 @@
+/*
+ *	This is a prototype file, not meant to be compiled directly.
+ *	The including source file must define the following:
+ *
+ *		TYPE_ARRAY -- the base (scalar) type of all argument arrays
+ *		FUNC_1D -- the name of the 1-dimensional transform function
+ *		FUNC_1D_BUF -- the name of the 1-dimensional transform function which
+ *			takes caller supplied scratch space
+ *		FUNC_ND -- the name of the N-dimensional transform function
+ *
+ *	and may define:
+ *
+ *		IS_INTEGRAL -- TYPE_ARRAY is an integer type so every lifting step
+ *			is rounded regardless of the caller's isInt argument
+ */
+
+/* multidimensional transforms support a maximum of this many dimensions */
+#define MXN_D 32
+
+/* a transform of n dimensions of size 2^k has at most k levels */
+#define MXN_LEVEL 32
+
+#ifdef IS_INTEGRAL
+#define LIFT_IS_INT(isInt)	TRUE
+#else
+#define LIFT_IS_INT(isInt)	(isInt)
+#endif
+
+/*
+ *	Lifting steps of the CDF 9/7 factorization.
+ *
+ *	Source: Daubechies and Sweldens, "Factoring Wavelet Transforms into
+ *	  Lifting Steps", J. Fourier Anal. Appl., v. 4, no. 3, 247-269
+ */
+#define CDF97_ALPHA	-1.586134342059924
+#define CDF97_BETA	-0.052980118572961
+#define CDF97_GAMMA	 0.882911075530934
+#define CDF97_DELTA	 0.443506852043971
+#define CDF97_K		 1.149604398860241
+
+static void wlift_step _PROTO((TYPE_ARRAY *a, int incA, int n, int iFirst,
+		double c, bool isInt, bool isFwd));
+static void wlift_level _PROTO((TYPE_ARRAY *aTmp1D, TYPE_ARRAY *a, int incA, int n,
+		bool isFwd, int scheme, bool isInt));
+
+/*
+ *	wlift_step -- apply one symmetric lifting step in-place
+ *
+ *	Every other sample starting at iFirst is updated from its two neighbours:
+ *
+ *		a[i] += c * (a[i-1] + a[i+1])
+ *
+ *	with whole sample symmetric extension at the ends.  When isInt is TRUE
+ *	the update is rounded as floor(c * sum + 1/2), which keeps integer
+ *	samples integral and for 5/3 matches the JPEG 2000 rounding.  Since the
+ *	inverse subtracts exactly the same rounded quantity the step is bit-exact
+ *	reversible for any c.
+ */
+static void wlift_step(a, incA, n, iFirst, c, isInt, isFwd)
+	TYPE_ARRAY *a;		/* in/out: interleaved samples */
+	int incA;			/* in: spacing of elements in a[] */
+	int n;				/* in: number of samples (even) */
+	int iFirst;			/* in: 1 <=> predict (odd) step, 0 <=> update (even) step */
+	double c;			/* in: lifting coefficient */
+	bool isInt;			/* in: TRUE <=> round the update to an integer */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+{
+	int i, iLeft, iRight;
+	double delta;
+
+	for (i = iFirst; i < n; i += 2) {
+		iLeft = (i > 0) ? i - 1 : 1;
+		iRight = (i < n - 1) ? i + 1 : n - 2;
+		delta = c * ((double) a[incA * iLeft] + (double) a[incA * iRight]);
+		if (isInt)
+			delta = floor(delta + 0.5);
+		if (isFwd)
+			a[incA * i] = (TYPE_ARRAY) (a[incA * i] + delta);
+		else
+			a[incA * i] = (TYPE_ARRAY) (a[incA * i] - delta);
+	}
+	return;
+}
+
+/*
+ *	wlift_level -- perform one level of a lifting wavelet transform
+ *
+ *	The forward transform lifts the interleaved samples in-place and then
+ *	splits them so the smooth components end up in a[0..n/2-1] and the detail
+ *	components in a[n/2..n-1], which is the same layout wxfrm produces.  The
+ *	inverse merges and then undoes the steps in reverse order.
+ */
+static void wlift_level(aTmp1D, a, incA, n, isFwd, scheme, isInt)
+	TYPE_ARRAY *aTmp1D;	/* in: scratch space of at least n elements */
+	TYPE_ARRAY *a;		/* in/out: data (modified in-place) */
+	int incA;			/* in: spacing of elements in a[] */
+	int n;				/* in: size of a (even) */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+	int scheme;			/* in: WLIFT_5_3 or WLIFT_9_7 */
+	bool isInt;			/* in: TRUE <=> integer to integer transform */
+{
+	int nDiv2 = n / 2;
+	int i;
+
+	if (isFwd) {
+		if (scheme == WLIFT_9_7) {
+			wlift_step(a, incA, n, 1, CDF97_ALPHA, isInt, TRUE);
+			wlift_step(a, incA, n, 0, CDF97_BETA, isInt, TRUE);
+			wlift_step(a, incA, n, 1, CDF97_GAMMA, isInt, TRUE);
+			wlift_step(a, incA, n, 0, CDF97_DELTA, isInt, TRUE);
+		} else {
+			/* the reversible 5/3 of JPEG 2000 Part 1 */
+			wlift_step(a, incA, n, 1, -0.5, isInt, TRUE);
+			wlift_step(a, incA, n, 0, 0.25, isInt, TRUE);
+		}
+		for (i = 0; i < nDiv2; i++) {
+			aTmp1D[i] = a[incA * 2 * i];
+			aTmp1D[nDiv2 + i] = a[incA * (2 * i + 1)];
+		}
+		/* scaling is not integer reversible so integer transforms skip it */
+		if (scheme == WLIFT_9_7 && !isInt) {
+			for (i = 0; i < nDiv2; i++) {
+				aTmp1D[i] = (TYPE_ARRAY) (aTmp1D[i] * CDF97_K);
+				aTmp1D[nDiv2 + i] = (TYPE_ARRAY) (aTmp1D[nDiv2 + i] / CDF97_K);
+			}
+		}
+		for (i = 0; i < n; i++)
+			a[incA * i] = aTmp1D[i];
+	} else {
+		for (i = 0; i < nDiv2; i++) {
+			aTmp1D[2 * i] = a[incA * i];
+			aTmp1D[2 * i + 1] = a[incA * (nDiv2 + i)];
+		}
+		if (scheme == WLIFT_9_7 && !isInt) {
+			for (i = 0; i < nDiv2; i++) {
+				aTmp1D[2 * i] = (TYPE_ARRAY) (aTmp1D[2 * i] / CDF97_K);
+				aTmp1D[2 * i + 1] = (TYPE_ARRAY) (aTmp1D[2 * i + 1] * CDF97_K);
+			}
+		}
+		for (i = 0; i < n; i++)
+			a[incA * i] = aTmp1D[i];
+		if (scheme == WLIFT_9_7) {
+			wlift_step(a, incA, n, 0, CDF97_DELTA, isInt, FALSE);
+			wlift_step(a, incA, n, 1, CDF97_GAMMA, isInt, FALSE);
+			wlift_step(a, incA, n, 0, CDF97_BETA, isInt, FALSE);
+			wlift_step(a, incA, n, 1, CDF97_ALPHA, isInt, FALSE);
+		} else {
+			wlift_step(a, incA, n, 0, 0.25, isInt, FALSE);
+			wlift_step(a, incA, n, 1, -0.5, isInt, FALSE);
+		}
+	}
+	return;
+}
+
+/* wlift_[idf]a1d -- 1-dimensional lifting wavelet transform */
+void FUNC_1D(a, nA, isFwd, scheme, isInt, aXf)
+	TYPE_ARRAY *a;		/* in: original array */
+	int nA;				/* in: size of a (must be power of 2) */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+	int scheme;			/* in: WLIFT_5_3 or WLIFT_9_7 */
+	bool isInt;			/* in: TRUE <=> integer to integer transform */
+	TYPE_ARRAY *aXf;	/* out: transformed array (OK if == a) */
+{
+	TYPE_ARRAY *aTmp1D = NULL;
+
+	(void) MALLOC_LINTOK(aTmp1D, nA, TYPE_ARRAY);
+	FUNC_1D_BUF(a, nA, isFwd, scheme, isInt, aTmp1D, aXf);
+	FREE_LINTOK(aTmp1D);
+
+	return;
+}
+
+/*
+ *	wlift_[idf]a1d_buf -- 1-dimensional lifting wavelet transform using
+ *	caller supplied scratch space
+ */
+void FUNC_1D_BUF(a, nA, isFwd, scheme, isInt, aTmp1D, aXf)
+	TYPE_ARRAY *a;		/* in: original array */
+	int nA;				/* in: size of a (must be power of 2) */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+	int scheme;			/* in: WLIFT_5_3 or WLIFT_9_7 */
+	bool isInt;			/* in: TRUE <=> integer to integer transform */
+	TYPE_ARRAY *aTmp1D;	/* in: scratch space of at least nA elements */
+	TYPE_ARRAY *aXf;	/* out: transformed array (OK if == a) */
+{
+	int iA;
+
+	isInt = LIFT_IS_INT(isInt);
+	if (aXf != a) {
+		for (iA = 0; iA < nA; iA++)
+			aXf[iA] = a[iA];
+	}
+	if (nA < 2)
+		return;
+
+	if (isFwd) {
+		for (iA = nA; iA >= 2; iA /= 2)
+			wlift_level(aTmp1D, aXf, 1, iA, TRUE, scheme, isInt);
+	} else {
+		for (iA = 2; iA <= nA; iA *= 2)
+			wlift_level(aTmp1D, aXf, 1, iA, FALSE, scheme, isInt);
+	}
+
+	return;
+}
+
+/*
+ *	wlift_[idf]and -- n-dimensional nonstandard lifting wavelet transform
+ *
+ *	Each level lifts every dimension of the current smooth submatrix which is
+ *	still longer than 1, then halves those dimensions.  This is the same
+ *	decomposition as a nonstandard wxfrm_[fd]and() on hypercubic grids.
+ */
+void FUNC_ND(aIn, nA, nD, isFwd, scheme, isInt, aXf)
+	TYPE_ARRAY *aIn;	/* in: original data */
+	int nA[];			/* in: size of each dimension of a (must be powers of 2) */
+	int nD;				/* in: number of dimensions (size of nA[]) */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+	int scheme;			/* in: WLIFT_5_3 or WLIFT_9_7 */
+	bool isInt;			/* in: TRUE <=> integer to integer transform */
+	TYPE_ARRAY *aXf;	/* out: transformed data (ok if == a) */
+{
+	TYPE_ARRAY *aTmp1D = NULL;
+	int nBOfLevel[MXN_LEVEL][MXN_D];
+	int nARev[MXN_D], nB[MXN_D], incA[MXN_D];
+	int k, d, d0, nDMax, nATot, nBTot, nConv, iConv, iConvDecoded, iA;
+	int nLevel, iLevel;
+	int lg2nA;
+
+	if (nD < 1 || MXN_D < nD) {
+		(void) fprintf(stderr,
+				"number of dimensions must be between 1 and %d -- exiting\n",
+				MXN_D);
+		exit(1);
+	}
+
+	for (d = 0; d < nD; d++) {
+		for (lg2nA = 0; (1 << lg2nA) < nA[d]; lg2nA++)
+			continue;
+		if ((1 << lg2nA) != nA[d]) {
+			(void) fprintf(stderr,
+					"size of dimension #%d (= %d) is not a power of 2 -- exiting\n", d, nA[d]);
+			exit(1);
+		}
+	}
+
+	isInt = LIFT_IS_INT(isInt);
+
+	/* see wxfrm_nd_nonstd() for why the dimensions are reversed */
+	nDMax = 1;
+	nATot = 1;
+	for (d = 0; d < nD; d++) {
+		nARev[d] = nA[nD - 1 - d];
+		incA[d] = nATot;
+		nATot *= nARev[d];
+		if (nARev[d] > nDMax)
+			nDMax = nARev[d];
+	}
+
+	if (aIn != aXf) {
+		for (k = 0; k < nATot; k++)
+			aXf[k] = aIn[k];
+	}
+
+	/* record the submatrix size at each level so the inverse can retrace them */
+	nLevel = 0;
+	for (d = 0; d < nD; d++)
+		nB[d] = nARev[d];
+	for (nBTot = nATot; nBTot > 1; nLevel++) {
+		nBTot = 1;
+		for (d = 0; d < nD; d++) {
+			nBOfLevel[nLevel][d] = nB[d];
+			if (nB[d] > 1)
+				nB[d] /= 2;
+			nBTot *= nB[d];
+		}
+	}
+
+	(void) MALLOC_LINTOK(aTmp1D, nDMax, TYPE_ARRAY);
+
+	for (iLevel = 0; iLevel < nLevel; iLevel++) {
+		int *nBLevel = nBOfLevel[isFwd ? iLevel : nLevel - 1 - iLevel];
+
+		nBTot = 1;
+		for (d = 0; d < nD; d++)
+			nBTot *= nBLevel[d];
+
+		for (k = 0; k < nD; k++) {
+			/* the inverse undoes the dimensions in reverse order */
+			d0 = isFwd ? k : nD - 1 - k;
+			if (nBLevel[d0] <= 1)
+				continue;
+			nConv = nBTot / nBLevel[d0];
+			for (iConv = 0; iConv < nConv; iConv++) {
+				iA = 0;
+				iConvDecoded = iConv;
+				for (d = 0; d < nD; d++) {
+					if (d != d0) {
+						iA += incA[d] * (iConvDecoded % nBLevel[d]);
+						iConvDecoded /= nBLevel[d];
+					}
+				}
+				wlift_level(aTmp1D, &aXf[iA], incA[d0], nBLevel[d0], isFwd, scheme, isInt);
+			}
+		}
+	}
+
+	FREE_LINTOK(aTmp1D);
+
+	return;
+}
+
+#undef LIFT_IS_INT
@@ -0,0 +1,13 @@
+#include "local.h"
+
+/*
+ *	This file instantiates the lifting transform template to work on double
+ *	arrays.
+ */
+
+#define TYPE_ARRAY double
+#define FUNC_1D wlift_da1d
+#define FUNC_1D_BUF wlift_da1d_buf
+#define FUNC_ND wlift_dand
+
+#include "wlift_t.c"
@@ -0,0 +1,13 @@
+#include "local.h"
+
+/*
+ *	This file instantiates the lifting transform template to work on float
+ *	arrays.
+ */
+
+#define TYPE_ARRAY float
+#define FUNC_1D wlift_fa1d
+#define FUNC_1D_BUF wlift_fa1d_buf
+#define FUNC_ND wlift_fand
+
+#include "wlift_t.c"
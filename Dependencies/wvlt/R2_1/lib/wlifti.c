@@ -0,0 +1,14 @@
+#include "local.h"
+
+/*
+ *	This file instantiates the lifting transform template to work on int
+ *	arrays.
+ */
+
+#define TYPE_ARRAY int
+#define FUNC_1D wlift_ia1d
+#define FUNC_1D_BUF wlift_ia1d_buf
+#define FUNC_ND wlift_iand
+#define IS_INTEGRAL
+
+#include "wlift_t.c"
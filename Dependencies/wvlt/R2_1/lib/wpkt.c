@@ -0,0 +1,205 @@
+#include "local.h"
+
+/*
+ *	This file contains wavelet packet decomposition and Coifman-Wickerhauser
+ *	best basis selection.
+ *
+ *	Source: Coifman and Wickerhauser, "Entropy-Based Algorithms for Best
+ *	  Basis Selection", IEEE Trans. Inf. Theory, v. 38, no. 2, 713-718
+ *
+ *	The nodes of a packet tree with nLevel levels are numbered as a heap:
+ *	node k of level j (0 <= k < 2^j) is number 2^j - 1 + k and its children
+ *	are 2n + 1 (smooth) and 2n + 2 (detail).  Node k of level j covers
+ *	elements [k * nA / 2^j, (k + 1) * nA / 2^j) of its level.
+ */
+
+static bool wpkt_is_split _PROTO((int *isBasis, int iNode));
+
+/* wpkt_node_count -- number of nodes in a packet tree */
+int wpkt_node_count(nLevel)
+	int nLevel;			/* in: number of decomposition levels */
+{
+	return (1 << (nLevel + 1)) - 1;
+}
+
+/*
+ *	wpkt_da1d -- full 1-dimensional wavelet packet decomposition
+ *
+ *	Row j of aTree[] (elements [j * nA, (j + 1) * nA)) holds all the nodes of
+ *	level j.  Row 0 is a copy of a[].
+ */
+void wpkt_da1d(a, nA, nLevel, wfltr, aTree)
+	double *a;			/* in: original array */
+	int nA;				/* in: size of a (must be power of 2) */
+	int nLevel;			/* in: number of levels (2^nLevel <= nA) */
+	waveletfilter *wfltr;	/* in: wavelet filter to use */
+	double *aTree;		/* out: (nLevel + 1) * nA packet coefficients */
+{
+	double *aTmp1D = NULL;
+	double *aRow;
+	int i, j, k, nNode;
+
+	for (i = 0; i < nA; i++)
+		aTree[i] = a[i];
+
+	(void) MALLOC_LINTOK(aTmp1D, nA, double);
+	for (j = 1; j <= nLevel; j++) {
+		aRow = aTree + j * nA;
+		for (i = 0; i < nA; i++)
+			aRow[i] = aRow[i - nA];
+		/* split each node of the previous level */
+		nNode = nA >> (j - 1);
+		for (k = 0; k < (1 << (j - 1)); k++)
+			wxfrm_da1d_step(aRow + k * nNode, nNode, TRUE, wfltr, aTmp1D,
+					aRow + k * nNode);
+	}
+	FREE_LINTOK(aTmp1D);
+
+	return;
+}
+
+/*
+ *	wpkt_dcost -- additive cost of every node of a packet tree
+ *
+ *	WPKT_ENTROPY is the Shannon entropy of the coefficient energies
+ *	normalized by the energy of the signal, so signals of different
+ *	brightness contribute equally when costs are summed over many signals.
+ *	WPKT_LOG_ENERGY is the sum of log(x^2) over the non-zero coefficients.
+ */
+void wpkt_dcost(aTree, nA, nLevel, costType, cost)
+	double *aTree;		/* in: packet tree from wpkt_da1d() */
+	int nA;				/* in: size of each level */
+	int nLevel;			/* in: number of levels */
+	int costType;		/* in: WPKT_ENTROPY or WPKT_LOG_ENERGY */
+	double *cost;		/* out: wpkt_node_count(nLevel) node costs */
+{
+	double energy = 0.0;
+	double sum, x2, p;
+	double *aNode;
+	int i, j, k, n, iNode;
+
+	for (i = 0; i < nA; i++)
+		energy += aTree[i] * aTree[i];
+
+	for (j = 0; j <= nLevel; j++) {
+		n = nA >> j;
+		for (k = 0; k < (1 << j); k++) {
+			iNode = (1 << j) - 1 + k;
+			aNode = aTree + j * nA + k * n;
+			sum = 0.0;
+			for (i = 0; i < n; i++) {
+				x2 = aNode[i] * aNode[i];
+				if (x2 <= 0.0)
+					continue;
+				if (costType == WPKT_LOG_ENERGY) {
+					sum += log(x2);
+				} else if (energy > 0.0) {
+					p = x2 / energy;
+					sum -= p * log(p);
+				}
+			}
+			cost[iNode] = sum;
+		}
+	}
+
+	return;
+}
+
+/*
+ *	wpkt_best -- Coifman-Wickerhauser best basis search
+ *
+ *	Working up from the finest level, a node is kept if its cost is no more
+ *	than the best cost of its children.  On return isBasis[] is TRUE for
+ *	exactly the nodes of the best basis and cost[] holds the best cost of
+ *	each subtree.  The number of nodes in the basis is returned.
+ */
+int wpkt_best(cost, nLevel, isBasis)
+	double *cost;		/* in/out: node costs, replaced by best subtree costs */
+	int nLevel;			/* in: number of levels */
+	int *isBasis;		/* out: wpkt_node_count(nLevel) basis flags */
+{
+	int *isCovered = NULL;
+	int j, k, iNode, nNodes, nBasis;
+	double childCost;
+
+	nNodes = wpkt_node_count(nLevel);
+	for (iNode = (1 << nLevel) - 1; iNode < nNodes; iNode++)
+		isBasis[iNode] = TRUE;
+
+	for (j = nLevel - 1; j >= 0; j--) {
+		for (k = 0; k < (1 << j); k++) {
+			iNode = (1 << j) - 1 + k;
+			childCost = cost[2 * iNode + 1] + cost[2 * iNode + 2];
+			if (cost[iNode] <= childCost) {
+				isBasis[iNode] = TRUE;
+			} else {
+				isBasis[iNode] = FALSE;
+				cost[iNode] = childCost;
+			}
+		}
+	}
+
+	/* nodes below a basis node are not part of the basis */
+	(void) MALLOC_LINTOK(isCovered, nNodes, int);
+	isCovered[0] = FALSE;
+	nBasis = isBasis[0] ? 1 : 0;
+	for (iNode = 1; iNode < nNodes; iNode++) {
+		k = (iNode - 1) / 2;
+		isCovered[iNode] = isCovered[k] || isBasis[k];
+		if (isCovered[iNode])
+			isBasis[iNode] = FALSE;
+		else if (isBasis[iNode])
+			nBasis++;
+	}
+	FREE_LINTOK(isCovered);
+
+	return nBasis;
+}
+
+/* wpkt_is_split -- is a node decomposed in the basis? */
+static bool wpkt_is_split(isBasis, iNode)
+	int *isBasis;		/* in: basis flags from wpkt_best() */
+	int iNode;			/* in: node number */
+{
+	for (;;) {
+		if (isBasis[iNode])
+			return FALSE;
+		if (iNode == 0)
+			return TRUE;
+		iNode = (iNode - 1) / 2;
+	}
+}
+
+/*
+ *	wpkt_da1d_basis -- expand a signal in a wavelet packet basis
+ *
+ *	Only the nodes above the basis are decomposed, so this is much cheaper
+ *	than a full packet decomposition.  The coefficients of each basis node
+ *	are left where wpkt_da1d() would put them in the node's level.
+ */
+void wpkt_da1d_basis(a, nA, nLevel, wfltr, isBasis, aTmp1D, aXf)
+	double *a;			/* in: original array */
+	int nA;				/* in: size of a (must be power of 2) */
+	int nLevel;			/* in: number of levels */
+	waveletfilter *wfltr;	/* in: wavelet filter to use */
+	int *isBasis;		/* in: basis flags from wpkt_best() */
+	double *aTmp1D;		/* in: scratch space of at least nA elements */
+	double *aXf;		/* out: nA basis coefficients (OK if == a) */
+{
+	int i, j, k, n;
+
+	if (aXf != a) {
+		for (i = 0; i < nA; i++)
+			aXf[i] = a[i];
+	}
+
+	for (j = 0; j < nLevel; j++) {
+		n = nA >> j;
+		for (k = 0; k < (1 << j); k++) {
+			if (wpkt_is_split(isBasis, (1 << j) - 1 + k))
+				wxfrm_da1d_step(aXf + k * n, n, TRUE, wfltr, aTmp1D, aXf + k * n);
+		}
+	}
+
+	return;
+}
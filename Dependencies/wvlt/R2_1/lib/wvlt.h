@@ -43,13 +43,63 @@ extern void wrefine_da1d _PROTO((double *a, int nA, int nNew,
 /* in "wxfrmf" */
 extern void wxfrm_fa1d _PROTO((float *a, int nA, bool isFwd,
 		waveletfilter *wfltr, float *aXf));
+extern void wxfrm_fa1d_buf _PROTO((float *a, int nA, bool isFwd,
+		waveletfilter *wfltr, float *aTmp1D, float *aXf));
+extern void wxfrm_fa1d_step _PROTO((float *a, int nA, bool isFwd,
+		waveletfilter *wfltr, float *aTmp1D, float *aXf));
 extern void wxfrm_fand _PROTO((float *a, int nAOfIDim[],
 		int nD, bool isFwd, bool isStd, waveletfilter *wfltr, float *aXf));
 
 /* in "wxfrmd" */
 extern void wxfrm_da1d _PROTO((double *a, int nA, bool isFwd,
 		waveletfilter *wfltr, double *aXf));
+extern void wxfrm_da1d_buf _PROTO((double *a, int nA, bool isFwd,
+		waveletfilter *wfltr, double *aTmp1D, double *aXf));
+extern void wxfrm_da1d_step _PROTO((double *a, int nA, bool isFwd,
+		waveletfilter *wfltr, double *aTmp1D, double *aXf));
 extern void wxfrm_dand _PROTO((double *a, int nA[],
 		int nD, bool isFwd, bool isStd, waveletfilter *wfltr, double *aXf));
 
+/* lifting schemes for "wlift" */
+#define WLIFT_5_3 0
+#define WLIFT_9_7 1
+
+/* in "wlifti" */
+extern void wlift_ia1d _PROTO((int *a, int nA, bool isFwd, int scheme,
+		bool isInt, int *aXf));
+extern void wlift_ia1d_buf _PROTO((int *a, int nA, bool isFwd, int scheme,
+		bool isInt, int *aTmp1D, int *aXf));
+extern void wlift_iand _PROTO((int *a, int nA[], int nD, bool isFwd,
+		int scheme, bool isInt, int *aXf));
+
+/* in "wliftf" */
+extern void wlift_fa1d _PROTO((float *a, int nA, bool isFwd, int scheme,
+		bool isInt, float *aXf));
+extern void wlift_fa1d_buf _PROTO((float *a, int nA, bool isFwd, int scheme,
+		bool isInt, float *aTmp1D, float *aXf));
+extern void wlift_fand _PROTO((float *a, int nA[], int nD, bool isFwd,
+		int scheme, bool isInt, float *aXf));
+
+/* in "wliftd" */
+extern void wlift_da1d _PROTO((double *a, int nA, bool isFwd, int scheme,
+		bool isInt, double *aXf));
+extern void wlift_da1d_buf _PROTO((double *a, int nA, bool isFwd, int scheme,
+		bool isInt, double *aTmp1D, double *aXf));
+extern void wlift_dand _PROTO((double *a, int nA[], int nD, bool isFwd,
+		int scheme, bool isInt, double *aXf));
+
+/* cost functions for "wpkt" best basis selection */
+#define WPKT_ENTROPY 0
+#define WPKT_LOG_ENERGY 1
+
+/* in "wpkt" */
+extern int wpkt_node_count _PROTO((int nLevel));
+extern void wpkt_da1d _PROTO((double *a, int nA, int nLevel,
+		waveletfilter *wfltr, double *aTree));
+extern void wpkt_dcost _PROTO((double *aTree, int nA, int nLevel,
+		int costType, double *cost));
+extern int wpkt_best _PROTO((double *cost, int nLevel, int *isBasis));
+extern void wpkt_da1d_basis _PROTO((double *a, int nA, int nLevel,
+		waveletfilter *wfltr, int *isBasis, double *aTmp1D, double *aXf));
+
 #endif /* _INCLUDED_WVLT */
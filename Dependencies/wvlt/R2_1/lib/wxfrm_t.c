@@ -4,6 +4,10 @@
  *
  *		TYPE_ARRAY -- the base (scalar) type of all argument arrays
  *		FUNC_1D -- the name of the 1-dimensional transform function
+ *		FUNC_1D_BUF -- the name of the 1-dimensional transform function which
+ *			takes caller supplied scratch space
+ *		FUNC_1D_STEP -- the name of the function which performs a single level
+ *			of the 1-dimensional transform
  *		FUNC_ND -- the name of the N-dimensional transform function
  */
 
@@ -205,12 +209,53 @@ void FUNC_1D(a, nA, isFwd, wfltr, aXf)
           TYPE_ARRAY* aTmp1D = NULL;
 
 	(void) MALLOC_LINTOK(aTmp1D, nA, TYPE_ARRAY);
-	wxfrm_1d_varstep(aTmp1D, a, 1, nA, isFwd, wfltr, aXf);
+	FUNC_1D_BUF(a, nA, isFwd, wfltr, aTmp1D, aXf);
 	FREE_LINTOK(aTmp1D);
 
 	return;
 }
 
+/*
+ *	wxfrm_[fd]a1d_buf -- 1-dimensional discrete wavelet transform using
+ *	caller supplied scratch space
+ *
+ *	Callers transforming many short signals can allocate the scratch space
+ *	once instead of once per transform.
+ */
+void FUNC_1D_BUF(a, nA, isFwd, wfltr, aTmp1D, aXf)
+	TYPE_ARRAY *a;		/* in: original array */
+	int nA;				/* in: size of a (must be power of 2) */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+	waveletfilter *wfltr;	/* in: wavelet filter to use */
+	TYPE_ARRAY *aTmp1D;	/* in: scratch space of at least nA elements */
+	TYPE_ARRAY *aXf;	/* out: transformed array */
+{
+	wxfrm_1d_varstep(aTmp1D, a, 1, nA, isFwd, wfltr, aXf);
+
+	return;
+}
+
+/*
+ *	wxfrm_[fd]a1d_step -- a single level of the 1-dimensional discrete wavelet
+ *	transform
+ *
+ *	The forward step leaves the smooth components in aXf[0..nA/2-1] and the
+ *	detail components in aXf[nA/2..nA-1].  Wavelet packets are built from
+ *	repeated steps on both halves.
+ */
+void FUNC_1D_STEP(a, nA, isFwd, wfltr, aTmp1D, aXf)
+	TYPE_ARRAY *a;		/* in: original array */
+	int nA;				/* in: size of a (must be even) */
+	bool isFwd;			/* in: TRUE <=> forward transform */
+	waveletfilter *wfltr;	/* in: wavelet filter to use */
+	TYPE_ARRAY *aTmp1D;	/* in: scratch space of at least nA elements */
+	TYPE_ARRAY *aXf;	/* out: transformed array (OK if == a) */
+{
+	wfltr_convolve(aTmp1D, wfltr, isFwd, a, 1, nA, aXf);
+
+	return;
+}
+
 /* wxfrm_[fd]and -- n-dimensional discrete wavelet transform */
 void FUNC_ND(aIn, nA, nD, isFwd, isStd, wfltr, aXf)
 	TYPE_ARRAY *aIn;	/* in: original data */
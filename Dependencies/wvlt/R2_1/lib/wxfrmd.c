@@ -7,6 +7,8 @@
 
 #define TYPE_ARRAY double
 #define FUNC_1D wxfrm_da1d
+#define FUNC_1D_BUF wxfrm_da1d_buf
+#define FUNC_1D_STEP wxfrm_da1d_step
 #define FUNC_ND wxfrm_dand
 
 #include "wxfrm_t.c"
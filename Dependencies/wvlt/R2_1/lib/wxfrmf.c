@@ -7,6 +7,8 @@
 
 #define TYPE_ARRAY float
 #define FUNC_1D wxfrm_fa1d
+#define FUNC_1D_BUF wxfrm_fa1d_buf
+#define FUNC_1D_STEP wxfrm_fa1d_step
 #define FUNC_ND wxfrm_fand
 
 #include "wxfrm_t.c"
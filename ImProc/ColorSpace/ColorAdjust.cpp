@@ -0,0 +1,517 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "ColorAdjust.h"
+#include "ColorAdjustDialog.h"
+#include "ColorSpaceMath.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ImProcVersion.h"
+#include "LayerList.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "Statistics.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+
+#include <algorithm>
+#include <float.h>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(ColorSpace, ColorAdjust);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(ColorModel)
+ADD_ENUM_MAPPING(HSV_MODEL, "HSV", "hsv")
+ADD_ENUM_MAPPING(HLS_MODEL, "HLS", "hls")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   const unsigned int sCurveSize = 1024;
+
+   double applyCurve(const std::vector<double>& table, double value)
+   {
+      if (table.empty())
+      {
+         return value;
+      }
+      double position = std::max(0.0, std::min(1.0, value)) * (sCurveSize - 1);
+      unsigned int low = static_cast<unsigned int>(position);
+      unsigned int high = std::min(low + 1, sCurveSize - 1);
+      return table[low] + (position - low) * (table[high] - table[low]);
+   }
+}
+
+ColorAdjust::ColorAdjust() :
+   mAbortFlag(false)
+{
+   setName("ColorAdjust");
+   setDescription("Adjust hue, saturation and value or lightness of RGB data.");
+   setDescriptorId("{155A9078-2B22-4322-A291-33DEB20763E2}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Colorspace Conversion/Adjust Color");
+}
+
+ColorAdjust::~ColorAdjust()
+{
+}
+
+bool ColorAdjust::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<SpatialDataView>(ViewArg(), NULL,
+      "If the data element is displayed in RGB mode in this view, the displayed bands are adjusted."));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   std::string modelHelp = "Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<ColorModel>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<ColorModel>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      modelHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Color Model", StringUtilities::toXmlString<ColorModel>(HSV_MODEL), modelHelp));
+   VERIFY(pInArgList->addArg<double>("Hue Shift", mInput.mHueShift, "Degrees added to the hue."));
+   VERIFY(pInArgList->addArg<double>("Saturation Scale", mInput.mSaturationScale,
+      "Factor applied to the saturation after the saturation curve."));
+   VERIFY(pInArgList->addArg<double>("Value Scale", mInput.mValueScale,
+      "Factor applied to the value or lightness after the value curve."));
+   VERIFY(pInArgList->addArg<std::vector<double> >("Saturation Curve", std::vector<double>(),
+      "Input and output pairs in [0,1] with increasing inputs, interpolated linearly. Empty for no curve."));
+   VERIFY(pInArgList->addArg<std::vector<double> >("Value Curve", std::vector<double>(),
+      "Input and output pairs in [0,1] for the value or lightness, as for the saturation curve."));
+   VERIFY(pInArgList->addArg<unsigned int>("Red Band", 0, "The active red band number when there is no RGB view."));
+   VERIFY(pInArgList->addArg<unsigned int>("Green Band", 1, "The active green band number when there is no RGB view."));
+   VERIFY(pInArgList->addArg<unsigned int>("Blue Band", 2, "The active blue band number when there is no RGB view."));
+   return true;
+}
+
+bool ColorAdjust::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool ColorAdjust::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin color adjustment.", 1, NORMAL);
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), 3,
+      mInput.mpDescriptor->getDataType(), BIP, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpAbortFlag = &mAbortFlag;
+   ColorAdjustThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Adjusting", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<ColorAdjustThreadInput, ColorAdjustThreadOutput, ColorAdjustThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Color adjustment complete.", 100, NORMAL);
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Color adjustment aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Color adjustment failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool ColorAdjust::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{077641F0-C3A2-46B9-9014-3CFFBACAA75C}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+   switch (mInput.mpDescriptor->getDataType())
+   {
+   case INT1SBYTE:
+      mInput.mMinValue = -128.0;
+      mInput.mMaxValue = 127.0;
+      break;
+   case INT1UBYTE:
+      mInput.mMinValue = 0.0;
+      mInput.mMaxValue = 255.0;
+      break;
+   case INT2SBYTES:
+      mInput.mMinValue = -32768.0;
+      mInput.mMaxValue = 32767.0;
+      break;
+   case INT2UBYTES:
+      mInput.mMinValue = 0.0;
+      mInput.mMaxValue = 65535.0;
+      break;
+   case INT4SBYTES:
+      mInput.mMinValue = -2147483648.0;
+      mInput.mMaxValue = 2147483647.0;
+      break;
+   case INT4UBYTES:
+      mInput.mMinValue = 0.0;
+      mInput.mMaxValue = 4294967295.0;
+      break;
+   case FLT4BYTES:
+      mInput.mMinValue = -FLT_MAX;
+      mInput.mMaxValue = FLT_MAX;
+      break;
+   case FLT8BYTES:
+      mInput.mMinValue = -DBL_MAX;
+      mInput.mMaxValue = DBL_MAX;
+      break;
+   default:
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mRound = (mInput.mpDescriptor->getDataType() != FLT4BYTES &&
+      mInput.mpDescriptor->getDataType() != FLT8BYTES);
+
+   pInArgList->getPlugInArgValue("Red Band", mInput.mRedBand);
+   pInArgList->getPlugInArgValue("Green Band", mInput.mGreenBand);
+   pInArgList->getPlugInArgValue("Blue Band", mInput.mBlueBand);
+   SpatialDataView* pView = pInArgList->getPlugInArgValue<SpatialDataView>(ViewArg());
+   RasterLayer* pLayer = (pView == NULL) ? NULL :
+      static_cast<RasterLayer*>(pView->getLayerList()->getLayer(RASTER, mInput.mpRaster));
+   if (pLayer != NULL && pLayer->getDisplayMode() == RGB_MODE)
+   {
+      mInput.mRedBand = pLayer->getDisplayedBand(RED).getActiveNumber();
+      mInput.mGreenBand = pLayer->getDisplayedBand(GREEN).getActiveNumber();
+      mInput.mBlueBand = pLayer->getDisplayedBand(BLUE).getActiveNumber();
+   }
+   unsigned int bandCount = mInput.mpDescriptor->getBandCount();
+   if (mInput.mRedBand >= bandCount || mInput.mGreenBand >= bandCount || mInput.mBlueBand >= bandCount)
+   {
+      mProgress.report("Invalid red, green or blue band.", 0, ERRORS, true);
+      return false;
+   }
+
+   std::string model;
+   pInArgList->getPlugInArgValue("Color Model", model);
+   mInput.mModel = StringUtilities::fromXmlString<ColorModel>(model);
+   pInArgList->getPlugInArgValue("Hue Shift", mInput.mHueShift);
+   pInArgList->getPlugInArgValue("Saturation Scale", mInput.mSaturationScale);
+   pInArgList->getPlugInArgValue("Value Scale", mInput.mValueScale);
+   std::vector<double> saturationPoints;
+   std::vector<double> valuePoints;
+   pInArgList->getPlugInArgValue("Saturation Curve", saturationPoints);
+   pInArgList->getPlugInArgValue("Value Curve", valuePoints);
+   if (!buildCurve(saturationPoints, mInput.mSaturationCurve) || !buildCurve(valuePoints, mInput.mValueCurve))
+   {
+      mProgress.report("A curve needs input and output pairs with increasing inputs.", 0, ERRORS, true);
+      return false;
+   }
+
+   if (!isBatch())
+   {
+      ColorAdjustDialog dlg;
+      dlg.setModel(mInput.mModel);
+      dlg.setHueShift(mInput.mHueShift);
+      dlg.setSaturationScale(mInput.mSaturationScale);
+      dlg.setValueScale(mInput.mValueScale);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mInput.mModel = dlg.getModel();
+      mInput.mHueShift = dlg.getHueShift();
+      mInput.mSaturationScale = dlg.getSaturationScale();
+      mInput.mValueScale = dlg.getValueScale();
+   }
+   if (!mInput.mModel.isValid())
+   {
+      mProgress.report("Invalid color model.", 0, ERRORS, true);
+      return false;
+   }
+
+   // normalize the data to (0.0,1.0) as the conversion plug-ins do
+   mInput.mMaxScale = std::max(std::max(
+      mInput.mpRaster->getStatistics(mInput.mpDescriptor->getActiveBand(mInput.mRedBand))->getMax(),
+      mInput.mpRaster->getStatistics(mInput.mpDescriptor->getActiveBand(mInput.mGreenBand))->getMax()),
+      mInput.mpRaster->getStatistics(mInput.mpDescriptor->getActiveBand(mInput.mBlueBand))->getMax());
+   if (mInput.mMaxScale <= 0.0)
+   {
+      mInput.mMaxScale = 1.0;
+   }
+
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+   return true;
+}
+
+bool ColorAdjust::buildCurve(const std::vector<double>& points, std::vector<double>& table)
+{
+   table.clear();
+   if (points.empty())
+   {
+      return true;
+   }
+   if (points.size() % 2 != 0)
+   {
+      return false;
+   }
+   for (unsigned int idx = 2; idx < points.size(); idx += 2)
+   {
+      if (points[idx] <= points[idx - 2])
+      {
+         return false;
+      }
+   }
+   table.resize(sCurveSize);
+   unsigned int segment = 0;
+   for (unsigned int idx = 0; idx < sCurveSize; idx++)
+   {
+      double input = static_cast<double>(idx) / (sCurveSize - 1);
+      while (segment + 3 < points.size() && points[segment + 2] < input)
+      {
+         segment += 2;
+      }
+      if (points.size() == 2 || input <= points[0])
+      {
+         table[idx] = points[1];
+      }
+      else if (input >= points[points.size() - 2])
+      {
+         table[idx] = points[points.size() - 1];
+      }
+      else
+      {
+         double weight = (input - points[segment]) / (points[segment + 2] - points[segment]);
+         table[idx] = points[segment + 1] + weight * (points[segment + 3] - points[segment + 1]);
+      }
+   }
+   return true;
+}
+
+bool ColorAdjust::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   pLayer->setDisplayedBand(RED, pDesc->getActiveBand(0));
+   pLayer->setDisplayedBand(GREEN, pDesc->getActiveBand(1));
+   pLayer->setDisplayedBand(BLUE, pDesc->getActiveBand(2));
+   pLayer->setDisplayMode(RGB_MODE);
+
+   return true;
+}
+
+ColorAdjust::ColorAdjustThread::ColorAdjustThread(
+   const ColorAdjustThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpDescriptor->getRowCount()))
+{
+}
+
+void ColorAdjust::ColorAdjustThread::run()
+{
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   int numCols = mInput.mpDescriptor->getColumnCount();
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   const RasterDataDescriptor* pResultDescriptor = static_cast<const RasterDataDescriptor*>(
+      mInput.mpResult->getDataDescriptor());
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setInterleaveFormat(BIP);
+   pResultRequest->setRows(pResultDescriptor->getActiveRow(mRowRange.mFirst),
+      pResultDescriptor->getActiveRow(mRowRange.mLast));
+   pResultRequest->setColumns(pResultDescriptor->getActiveColumn(0),
+      pResultDescriptor->getActiveColumn(numCols - 1));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   pRequest->setRows(mInput.mpDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpDescriptor->getActiveRow(mRowRange.mLast));
+   pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0), mInput.mpDescriptor->getActiveColumn(numCols - 1));
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+   int oldPercentDone = 0;
+   for (int row_index = mRowRange.mFirst; row_index <= mRowRange.mLast; row_index++)
+   {
+      int percentDone = mRowRange.computePercent(row_index);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         getReporter().reportProgress(getThreadIndex(), 100);
+         break;
+      }
+      if (!accessor.isValid() || !resultAccessor.isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+
+      switchOnEncoding(encoding, adjustRow, accessor->getRow(), resultAccessor->getRow(), numCols, numBands);
+
+      accessor->nextRow();
+      resultAccessor->nextRow();
+   }
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+template<typename T>
+void ColorAdjust::ColorAdjustThread::adjustRow(const T* pData, void* pResult, unsigned int columns, unsigned int bands)
+{
+   T* pResultData = reinterpret_cast<T*>(pResult);
+   bool hsv = (mInput.mModel == HSV_MODEL);
+   for (unsigned int col = 0; col < columns; col++)
+   {
+      const T* pPixel = pData + col * bands;
+      double pRgb[3];
+      double pColor[3];
+      pRgb[0] = pPixel[mInput.mRedBand] / mInput.mMaxScale;
+      pRgb[1] = pPixel[mInput.mGreenBand] / mInput.mMaxScale;
+      pRgb[2] = pPixel[mInput.mBlueBand] / mInput.mMaxScale;
+      double maxComponent = std::max(std::max(pRgb[0], pRgb[1]), pRgb[2]);
+      double minComponent = std::min(std::min(pRgb[0], pRgb[1]), pRgb[2]);
+
+      // HSV is hue, saturation, value and HLS is hue, lightness, saturation
+      unsigned int saturation = hsv ? 1 : 2;
+      unsigned int value = hsv ? 2 : 1;
+      if (hsv)
+      {
+         ColorSpaceMath::rgbToHsv(pColor, pRgb, maxComponent, minComponent);
+      }
+      else
+      {
+         ColorSpaceMath::rgbToHls(pColor, pRgb, maxComponent, minComponent);
+      }
+      pColor[0] = fmod(pColor[0] + mInput.mHueShift, 360.0);
+      if (pColor[0] < 0.0)
+      {
+         pColor[0] += 360.0;
+      }
+      pColor[saturation] = std::max(0.0, std::min(1.0,
+         applyCurve(mInput.mSaturationCurve, pColor[saturation]) * mInput.mSaturationScale));
+      pColor[value] = std::max(0.0, applyCurve(mInput.mValueCurve, pColor[value]) * mInput.mValueScale);
+      if (hsv)
+      {
+         ColorSpaceMath::hsvToRgb(pRgb, pColor);
+      }
+      else
+      {
+         // lightness above 1 has no HLS meaning
+         pColor[value] = std::min(1.0, pColor[value]);
+         ColorSpaceMath::hlsToRgb(pRgb, pColor);
+      }
+
+      T* pOut = pResultData + col * 3;
+      for (unsigned int idx = 0; idx < 3; idx++)
+      {
+         double result = pRgb[idx] * mInput.mMaxScale;
+         if (mInput.mRound)
+         {
+            result = floor(result + 0.5);
+         }
+         pOut[idx] = static_cast<T>(std::max(mInput.mMinValue, std::min(mInput.mMaxValue, result)));
+      }
+   }
+}
+
+bool ColorAdjust::ColorAdjustThreadOutput::compileOverallResults(const std::vector<ColorAdjustThread*>& threads)
+{
+   return true;
+}
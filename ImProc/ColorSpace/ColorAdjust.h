@@ -0,0 +1,109 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef COLORADJUST_H__
+#define COLORADJUST_H__
+
+#include "AlgorithmShell.h"
+#include "EnumWrapper.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+
+#include <string>
+#include <vector>
+
+class RasterDataDescriptor;
+class RasterElement;
+
+enum ColorModelEnum { HSV_MODEL, HLS_MODEL };
+typedef EnumWrapper<ColorModelEnum> ColorModel;
+
+/**
+ * Adjust hue, saturation and value or lightness of RGB bands in one pass.
+ *
+ * Each pixel is converted to HSV or HLS with the math in ColorSpaceMath, the hue is shifted,
+ * the saturation and value or lightness go through a curve and a scale, and the pixel is
+ * converted back. The result is RGB in the source encoding so no intermediate cube is created.
+ */
+class ColorAdjust : public AlgorithmShell
+{
+public:
+   ColorAdjust();
+   virtual ~ColorAdjust();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Build a lookup table over [0,1] from curve control points.
+    *
+    * @param points
+    *        Input and output pairs with increasing inputs. Empty for the identity.
+    * @param table
+    *        Set to the lookup table.
+    */
+   static bool buildCurve(const std::vector<double>& points, std::vector<double>& table);
+
+   struct ColorAdjustThreadInput
+   {
+      ColorAdjustThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResult(NULL), mRedBand(0), mGreenBand(1),
+         mBlueBand(2), mMaxScale(1.0), mModel(HSV_MODEL), mHueShift(0.0), mSaturationScale(1.0), mValueScale(1.0),
+         mMinValue(0.0), mMaxValue(0.0), mRound(false), mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      RasterElement* mpResult;
+      unsigned int mRedBand;
+      unsigned int mGreenBand;
+      unsigned int mBlueBand;
+      double mMaxScale;
+      ColorModel mModel;
+      double mHueShift;
+      double mSaturationScale;
+      double mValueScale;
+      std::vector<double> mSaturationCurve;
+      std::vector<double> mValueCurve;
+      double mMinValue; // the range of the source encoding
+      double mMaxValue;
+      bool mRound;
+      const bool* mpAbortFlag;
+   };
+
+   class ColorAdjustThread : public mta::AlgorithmThread
+   {
+   public:
+      ColorAdjustThread(const ColorAdjustThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      template<typename T> void adjustRow(const T* pData, void* pResult, unsigned int columns, unsigned int bands);
+      const ColorAdjustThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct ColorAdjustThreadOutput
+   {
+      bool compileOverallResults(const std::vector<ColorAdjustThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   ColorAdjustThreadInput mInput;
+   std::string mResultName;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ColorAdjustDialog.h"
+#include "StringUtilities.h"
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+
+ColorAdjustDialog::ColorAdjustDialog(QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pModelLabel = new QLabel("Color Model:", this);
+   mpModel = new QComboBox(this);
+   mpModel->setEditable(false);
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<ColorModel>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      mpModel->addItem(QString::fromStdString(*val));
+   }
+   QLabel* pHueLabel = new QLabel("Hue Shift:", this);
+   mpHueShift = new QDoubleSpinBox(this);
+   mpHueShift->setRange(-180.0, 180.0);
+   mpHueShift->setSuffix(" deg");
+   QLabel* pSaturationLabel = new QLabel("Saturation Scale:", this);
+   mpSaturationScale = new QDoubleSpinBox(this);
+   mpSaturationScale->setRange(0.0, 10.0);
+   mpSaturationScale->setSingleStep(0.1);
+   QLabel* pValueLabel = new QLabel("Value/Lightness Scale:", this);
+   mpValueScale = new QDoubleSpinBox(this);
+   mpValueScale->setRange(0.0, 10.0);
+   mpValueScale->setSingleStep(0.1);
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pModelLabel, 0, 0);
+   pTopLevel->addWidget(mpModel, 0, 1);
+   pTopLevel->addWidget(pHueLabel, 1, 0);
+   pTopLevel->addWidget(mpHueShift, 1, 1);
+   pTopLevel->addWidget(pSaturationLabel, 2, 0);
+   pTopLevel->addWidget(mpSaturationScale, 2, 1);
+   pTopLevel->addWidget(pValueLabel, 3, 0);
+   pTopLevel->addWidget(mpValueScale, 3, 1);
+   pTopLevel->addWidget(pButtons, 4, 0, 1, 2);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+ColorAdjustDialog::~ColorAdjustDialog()
+{
+}
+
+ColorModel ColorAdjustDialog::getModel() const
+{
+   return StringUtilities::fromDisplayString<ColorModel>(mpModel->currentText().toStdString());
+}
+
+double ColorAdjustDialog::getHueShift() const
+{
+   return mpHueShift->value();
+}
+
+double ColorAdjustDialog::getSaturationScale() const
+{
+   return mpSaturationScale->value();
+}
+
+double ColorAdjustDialog::getValueScale() const
+{
+   return mpValueScale->value();
+}
+
+void ColorAdjustDialog::setModel(ColorModel model)
+{
+   QString val = QString::fromStdString(StringUtilities::toDisplayString(model));
+   mpModel->setCurrentIndex(mpModel->findText(val));
+}
+
+void ColorAdjustDialog::setHueShift(double shift)
+{
+   mpHueShift->setValue(shift);
+}
+
+void ColorAdjustDialog::setSaturationScale(double scale)
+{
+   mpSaturationScale->setValue(scale);
+}
+
+void ColorAdjustDialog::setValueScale(double scale)
+{
+   mpValueScale->setValue(scale);
+}
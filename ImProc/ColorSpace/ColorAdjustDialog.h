@@ -0,0 +1,42 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef COLORADJUSTDIALOG_H
+#define COLORADJUSTDIALOG_H
+
+#include "ColorAdjust.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QDoubleSpinBox;
+
+class ColorAdjustDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   ColorAdjustDialog(QWidget* pParent=NULL);
+   virtual ~ColorAdjustDialog();
+
+   ColorModel getModel() const;
+   double getHueShift() const;
+   double getSaturationScale() const;
+   double getValueScale() const;
+   void setModel(ColorModel model);
+   void setHueShift(double shift);
+   void setSaturationScale(double scale);
+   void setValueScale(double scale);
+
+private:
+   QComboBox* mpModel;
+   QDoubleSpinBox* mpHueShift;
+   QDoubleSpinBox* mpSaturationScale;
+   QDoubleSpinBox* mpValueScale;
+};
+
+#endif
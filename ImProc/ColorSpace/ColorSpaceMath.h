@@ -0,0 +1,179 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef COLORSPACEMATH_H__
+#define COLORSPACEMATH_H__
+
+#include <math.h>
+
+/**
+ * Per pixel color space conversions shared by the conversion plug-ins and ColorAdjust.
+ *
+ * RGB components are normalized to [0,1] and hue is in degrees. The max and min components
+ * of the RGB input are passed in since callers already have them. Hue is not normalized so
+ * it may be negative.
+ */
+namespace ColorSpaceMath
+{
+   const double sEpsilon = 0.000001;
+
+   inline double rgbToHue(const double pInput[3], double maxComponent, double minComponent)
+   {
+      double red = pInput[0];
+      double green = pInput[1];
+      double blue = pInput[2];
+      if (fabs(maxComponent - minComponent) < sEpsilon)
+      {
+         return 0.0;
+      }
+      else if (fabs(maxComponent - red) < sEpsilon)
+      {
+         return fmod(60 * (green - blue) / (maxComponent - minComponent), 360);
+      }
+      else if (fabs(maxComponent - green) < sEpsilon)
+      {
+         return 60 * (blue - red) / (maxComponent - minComponent) + 120;
+      }
+      else if (fabs(maxComponent - blue) < sEpsilon)
+      {
+         return 60 * (red - green) / (maxComponent - minComponent) + 240;
+      }
+      return 0.0;
+   }
+
+   inline void rgbToHsv(double pOutput[3], const double pInput[3], double maxComponent, double minComponent)
+   {
+      if (fabs(maxComponent) < sEpsilon)
+      {
+         pOutput[0] = pOutput[1] = pOutput[2] = 0.0;
+         return;
+      }
+      pOutput[0] = rgbToHue(pInput, maxComponent, minComponent);
+      pOutput[1] = 1.0 - (minComponent / maxComponent);
+      pOutput[2] = maxComponent;
+   }
+
+   inline void hsvToRgb(double pOutput[3], const double pInput[3])
+   {
+      double h = pInput[0];
+      double s = pInput[1];
+      double v = pInput[2];
+
+      double h_60 = h / 60.0;
+      double h_60_floor = floor(h_60);
+      int h_i = static_cast<int>(fmod(h_60_floor, 6.0));
+      double f = h_60 - h_60_floor;
+      double p = v * (1 - s);
+      double q = v * (1 - f * s);
+      double t = v * (1 - (1 - f) * s);
+
+      switch(h_i)
+      {
+      case 0:
+         pOutput[0] = v;
+         pOutput[1] = t;
+         pOutput[2] = p;
+         break;
+      case 1:
+         pOutput[0] = q;
+         pOutput[1] = v;
+         pOutput[2] = p;
+         break;
+      case 2:
+         pOutput[0] = p;
+         pOutput[1] = v;
+         pOutput[2] = t;
+         break;
+      case 3:
+         pOutput[0] = p;
+         pOutput[1] = q;
+         pOutput[2] = v;
+         break;
+      case 4:
+         pOutput[0] = t;
+         pOutput[1] = p;
+         pOutput[2] = v;
+         break;
+      case 5:
+         pOutput[0] = v;
+         pOutput[1] = p;
+         pOutput[2] = q;
+         break;
+      default:
+         pOutput[0] = pOutput[1] = pOutput[2] = 0.0;
+         break;
+      }
+   }
+
+   inline void rgbToHls(double pOutput[3], const double pInput[3], double maxComponent, double minComponent)
+   {
+      if (fabs(maxComponent) < sEpsilon)
+      {
+         pOutput[0] = pOutput[1] = pOutput[2] = 0.0;
+         return;
+      }
+      double l = (maxComponent + minComponent) / 2.0;
+      pOutput[0] = rgbToHue(pInput, maxComponent, minComponent);
+      pOutput[1] = l;
+      if (l < 0.5)
+      {
+         pOutput[2] = (maxComponent - minComponent) / (maxComponent + minComponent);
+      }
+      else
+      {
+         pOutput[2] = (maxComponent - minComponent) / (2 - maxComponent - minComponent);
+      }
+   }
+
+   inline double hlsComponent(double t_C, double p, double q)
+   {
+      if (t_C < 0.0)
+      {
+         t_C += 1.0;
+      }
+      if (t_C > 1.0)
+      {
+         t_C -= 1.0;
+      }
+      if (t_C < 0.166667)
+      {
+         return p + ((q - p) * 6 * t_C);
+      }
+      else if (t_C < 0.5)
+      {
+         return q;
+      }
+      else if (t_C < 0.666667)
+      {
+         return p + ((q - p) * 6 * (0.666667 - t_C));
+      }
+      return p;
+   }
+
+   inline void hlsToRgb(double pOutput[3], const double pInput[3])
+   {
+      double h = pInput[0];
+      double l = pInput[1];
+      double s = pInput[2];
+
+      if (s == 0)
+      {
+         pOutput[0] = pOutput[1] = pOutput[2] = l;
+         return;
+      }
+
+      double q = (l < 0.5) ? (l * (1 + s)) : (l + s - (l * s));
+      double p = 2 * l - q;
+      double h_k = h / 360.0;
+      pOutput[0] = hlsComponent(h_k + 0.33333333, p, q);
+      pOutput[1] = hlsComponent(h_k, p, q);
+      pOutput[2] = hlsComponent(h_k - 0.33333333, p, q);
+   }
+}
+
+#endif
@@ -0,0 +1,651 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ImProcVersion.h"
+#include "LayerList.h"
+#include "PanSharpen.h"
+#include "PanSharpenDialog.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+
+#include <algorithm>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(ColorSpace, PanSharpen);
+
+#define EPSILON 0.000001
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(PanSharpenMethod)
+ADD_ENUM_MAPPING(IHS_SHARPEN, "IHS", "ihs")
+ADD_ENUM_MAPPING(BROVEY_SHARPEN, "Brovey", "brovey")
+ADD_ENUM_MAPPING(GRAM_SCHMIDT_SHARPEN, "Gram-Schmidt", "gramschmidt")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   const int sBlockRows = 64;
+
+   template<typename T>
+   void loadValues(const T* pData, double* pBuffer, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pBuffer[idx] = static_cast<double>(pData[idx]);
+      }
+   }
+
+   /**
+    * Locate the two multispectral samples around a pan sample, aligning pixel centers.
+    */
+   void locate(int idx, double scale, int count, int& low, int& high, double& weight)
+   {
+      double position = (idx + 0.5) * scale - 0.5;
+      low = static_cast<int>(floor(position));
+      weight = position - low;
+      if (low < 0)
+      {
+         low = 0;
+         weight = 0.0;
+      }
+      high = low + 1;
+      if (high >= count)
+      {
+         low = high = count - 1;
+         weight = 0.0;
+      }
+   }
+}
+
+PanSharpen::PanSharpen() :
+   mAbortFlag(false)
+{
+   setName("PanSharpen");
+   setDescription("Pan-sharpen a multispectral data set with a panchromatic data set.");
+   setDescriptorId("{C33E885A-6042-4664-B868-45DDA4C7970E}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Pan-sharpen");
+}
+
+PanSharpen::~PanSharpen()
+{
+}
+
+bool PanSharpen::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg(), NULL, "The multispectral data element."));
+   VERIFY(pInArgList->addArg<SpatialDataView>(ViewArg(), NULL,
+      "If the data element is displayed in RGB mode in this view, the displayed bands are sharpened by IHS and Brovey."));
+   VERIFY(pInArgList->addArg<RasterElement>("Pan Element", NULL,
+      "The panchromatic data element. The first band is used."));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   std::string methodHelp = "Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<PanSharpenMethod>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<PanSharpenMethod>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      methodHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Method",
+      StringUtilities::toXmlString<PanSharpenMethod>(IHS_SHARPEN), methodHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Red Band", 0, "The active red band number when there is no RGB view."));
+   VERIFY(pInArgList->addArg<unsigned int>("Green Band", 1, "The active green band number when there is no RGB view."));
+   VERIFY(pInArgList->addArg<unsigned int>("Blue Band", 2, "The active blue band number when there is no RGB view."));
+   return true;
+}
+
+bool PanSharpen::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool PanSharpen::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Computing intensity statistics.", 1, NORMAL);
+   if (!computeStatistics())
+   {
+      return false;
+   }
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mInput.mpPanDescriptor->getRowCount(), mInput.mpPanDescriptor->getColumnCount(), mInput.mBands.size(),
+      FLT4BYTES, BIP, mInput.mpPanDescriptor->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpAbortFlag = &mAbortFlag;
+   PanSharpenThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Pan-sharpening", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<PanSharpenThreadInput, PanSharpenThreadOutput, PanSharpenThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Pan-sharpening complete.", 100, NORMAL);
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Pan-sharpening aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Pan-sharpening failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool PanSharpen::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{905D4D26-8836-4898-B927-027904B00791}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+
+   std::string method;
+   pInArgList->getPlugInArgValue("Method", method);
+   mInput.mMethod = StringUtilities::fromXmlString<PanSharpenMethod>(method);
+   mInput.mpPan = pInArgList->getPlugInArgValue<RasterElement>("Pan Element");
+   unsigned int redBand = 0;
+   unsigned int greenBand = 1;
+   unsigned int blueBand = 2;
+   pInArgList->getPlugInArgValue("Red Band", redBand);
+   pInArgList->getPlugInArgValue("Green Band", greenBand);
+   pInArgList->getPlugInArgValue("Blue Band", blueBand);
+   SpatialDataView* pView = pInArgList->getPlugInArgValue<SpatialDataView>(ViewArg());
+   RasterLayer* pLayer = (pView == NULL) ? NULL :
+      static_cast<RasterLayer*>(pView->getLayerList()->getLayer(RASTER, mInput.mpRaster));
+   if (pLayer != NULL && pLayer->getDisplayMode() == RGB_MODE)
+   {
+      redBand = pLayer->getDisplayedBand(RED).getActiveNumber();
+      greenBand = pLayer->getDisplayedBand(GREEN).getActiveNumber();
+      blueBand = pLayer->getDisplayedBand(BLUE).getActiveNumber();
+   }
+
+   if (!isBatch())
+   {
+      PanSharpenDialog dlg(mInput.mpRaster);
+      dlg.setPanElement(const_cast<RasterElement*>(mInput.mpPan));
+      dlg.setMethod(mInput.mMethod);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mInput.mpPan = dlg.getPanElement();
+      mInput.mMethod = dlg.getMethod();
+   }
+   if (mInput.mpPan == NULL)
+   {
+      mProgress.report("No pan element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpPanDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpPan->getDataDescriptor());
+   if (!checkFootprints())
+   {
+      return false;
+   }
+   if (!mInput.mMethod.isValid())
+   {
+      mProgress.report("Invalid pan-sharpening method.", 0, ERRORS, true);
+      return false;
+   }
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   EncodingType panEncoding = mInput.mpPanDescriptor->getDataType();
+   if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX || panEncoding == INT4SCOMPLEX || panEncoding == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   unsigned int bandCount = mInput.mpDescriptor->getBandCount();
+   mInput.mBands.clear();
+   if (mInput.mMethod == GRAM_SCHMIDT_SHARPEN)
+   {
+      for (unsigned int band = 0; band < bandCount; band++)
+      {
+         mInput.mBands.push_back(band);
+      }
+   }
+   else
+   {
+      if (redBand >= bandCount || greenBand >= bandCount || blueBand >= bandCount)
+      {
+         mProgress.report("IHS and Brovey need valid red, green and blue bands.", 0, ERRORS, true);
+         return false;
+      }
+      mInput.mBands.push_back(redBand);
+      mInput.mBands.push_back(greenBand);
+      mInput.mBands.push_back(blueBand);
+   }
+
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+   return true;
+}
+
+bool PanSharpen::checkFootprints()
+{
+   // the upsampling scale is the ratio of the element sizes so they must cover the same ground
+   double msRows = mInput.mpDescriptor->getRowCount();
+   double msCols = mInput.mpDescriptor->getColumnCount();
+   double panRows = mInput.mpPanDescriptor->getRowCount();
+   double panCols = mInput.mpPanDescriptor->getColumnCount();
+   if (fabs(panCols * msRows / panRows - msCols) > 1.0)
+   {
+      mProgress.report("The pan and multispectral elements have different aspect ratios.", 0, ERRORS, true);
+      return false;
+   }
+   if (mInput.mpRaster->isGeoreferenced() && mInput.mpPan->isGeoreferenced())
+   {
+      // each pan corner must land within a multispectral pixel of where the size ratio puts it
+      LocationType corners[] = { LocationType(0.0, 0.0), LocationType(panCols, 0.0),
+         LocationType(0.0, panRows), LocationType(panCols, panRows) };
+      for (unsigned int idx = 0; idx < sizeof(corners) / sizeof(corners[0]); idx++)
+      {
+         LocationType msPixel = mInput.mpRaster->convertGeocoordToPixel(
+            mInput.mpPan->convertPixelToGeocoord(corners[idx]));
+         if (fabs(msPixel.mX - corners[idx].mX * msCols / panCols) > 1.0 ||
+             fabs(msPixel.mY - corners[idx].mY * msRows / panRows) > 1.0)
+         {
+            mProgress.report("The pan and multispectral elements do not cover the same ground.", 0, ERRORS, true);
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+bool PanSharpen::computeStatistics()
+{
+   unsigned int rows = mInput.mpDescriptor->getRowCount();
+   unsigned int cols = mInput.mpDescriptor->getColumnCount();
+   unsigned int bandCount = mInput.mpDescriptor->getBandCount();
+   unsigned int sharpenedCount = mInput.mBands.size();
+   unsigned int panRows = mInput.mpPanDescriptor->getRowCount();
+   unsigned int panCols = mInput.mpPanDescriptor->getColumnCount();
+
+   // one pass over both elements, reading the pan rows that fall in each multispectral row with it
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+   FactoryResource<DataRequest> pPanRequest;
+   pPanRequest->setBands(mInput.mpPanDescriptor->getActiveBand(0), mInput.mpPanDescriptor->getActiveBand(0));
+   pPanRequest->setInterleaveFormat(BSQ);
+   DataAccessor panAccessor = mInput.mpPan->getDataAccessor(pPanRequest.release());
+   std::vector<double> pixels(cols * bandCount);
+   std::vector<double> panPixels(panCols);
+   double sum = 0.0;
+   double sumSquares = 0.0;
+   double panSum = 0.0;
+   double panSumSquares = 0.0;
+   std::vector<double> bandSums(sharpenedCount, 0.0);
+   std::vector<double> crossSums(sharpenedCount, 0.0);
+   unsigned int panRow = 0;
+   for (unsigned int row = 0; row < rows; row++)
+   {
+      if (mAbortFlag)
+      {
+         mProgress.report("Pan-sharpening aborted.", 0, ABORT, true);
+         return false;
+      }
+      if (!accessor.isValid())
+      {
+         mProgress.report("Unable to access the multispectral data.", 0, ERRORS, true);
+         return false;
+      }
+      switchOnEncoding(mInput.mpDescriptor->getDataType(), loadValues, accessor->getRow(), &pixels.front(),
+         cols * bandCount);
+      for (unsigned int col = 0; col < cols; col++)
+      {
+         const double* pPixel = &pixels[col * bandCount];
+         double intensity = 0.0;
+         for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+         {
+            intensity += pPixel[mInput.mBands[idx]];
+         }
+         intensity /= sharpenedCount;
+         sum += intensity;
+         sumSquares += intensity * intensity;
+         for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+         {
+            bandSums[idx] += pPixel[mInput.mBands[idx]];
+            crossSums[idx] += pPixel[mInput.mBands[idx]] * intensity;
+         }
+      }
+      accessor->nextRow();
+
+      // pan row p falls in multispectral row p * rows / panRows
+      for (; panRow < panRows && static_cast<double>(panRow) * rows < static_cast<double>(row + 1) * panRows;
+         panRow++)
+      {
+         if (!panAccessor.isValid())
+         {
+            mProgress.report("Unable to access the pan data.", 0, ERRORS, true);
+            return false;
+         }
+         switchOnEncoding(mInput.mpPanDescriptor->getDataType(), loadValues, panAccessor->getRow(),
+            &panPixels.front(), panCols);
+         for (unsigned int col = 0; col < panCols; col++)
+         {
+            panSum += panPixels[col];
+            panSumSquares += panPixels[col] * panPixels[col];
+         }
+         panAccessor->nextRow();
+      }
+   }
+
+   double count = static_cast<double>(rows) * cols;
+   double mean = sum / count;
+   double variance = sumSquares / count - mean * mean;
+   mInput.mGains.assign(sharpenedCount, 1.0);
+   if (mInput.mMethod == GRAM_SCHMIDT_SHARPEN && variance > EPSILON)
+   {
+      for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+      {
+         mInput.mGains[idx] = (crossSums[idx] / count - bandSums[idx] / count * mean) / variance;
+      }
+   }
+
+   double panCount = static_cast<double>(panRows) * panCols;
+   double panMean = panSum / panCount;
+   double panDeviation = sqrt(std::max(panSumSquares / panCount - panMean * panMean, 0.0));
+   mInput.mPanGain = (panDeviation > EPSILON) ? sqrt(std::max(variance, 0.0)) / panDeviation : 1.0;
+   mInput.mPanOffset = mean - mInput.mPanGain * panMean;
+   return true;
+}
+
+bool PanSharpen::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   if (mInput.mBands.size() == 3)
+   {
+      const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+      pLayer->setDisplayedBand(RED, pDesc->getActiveBand(0));
+      pLayer->setDisplayedBand(GREEN, pDesc->getActiveBand(1));
+      pLayer->setDisplayedBand(BLUE, pDesc->getActiveBand(2));
+      pLayer->setDisplayMode(RGB_MODE);
+   }
+
+   return true;
+}
+
+PanSharpen::PanSharpenThread::PanSharpenThread(
+   const PanSharpenThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpPanDescriptor->getRowCount()))
+{
+}
+
+void PanSharpen::PanSharpenThread::run()
+{
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   int panRows = mInput.mpPanDescriptor->getRowCount();
+   int panCols = mInput.mpPanDescriptor->getColumnCount();
+   int msRows = mInput.mpDescriptor->getRowCount();
+   int msCols = mInput.mpDescriptor->getColumnCount();
+   unsigned int bandCount = mInput.mpDescriptor->getBandCount();
+   unsigned int sharpenedCount = mInput.mBands.size();
+   double rowScale = static_cast<double>(msRows) / panRows;
+   double colScale = static_cast<double>(msCols) / panCols;
+
+   std::vector<int> lowCols(panCols);
+   std::vector<int> highCols(panCols);
+   std::vector<double> colWeights(panCols);
+   for (int col = 0; col < panCols; col++)
+   {
+      locate(col, colScale, msCols, lowCols[col], highCols[col], colWeights[col]);
+   }
+
+   int firstMsRow = 0;
+   int lastMsRow = 0;
+   double weight = 0.0;
+   int unused = 0;
+   locate(mRowRange.mFirst, rowScale, msRows, firstMsRow, unused, weight);
+   locate(mRowRange.mLast, rowScale, msRows, unused, lastMsRow, weight);
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setRows(mInput.mpDescriptor->getActiveRow(firstMsRow), mInput.mpDescriptor->getActiveRow(lastMsRow));
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+   FactoryResource<DataRequest> pPanRequest;
+   pPanRequest->setRows(mInput.mpPanDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpPanDescriptor->getActiveRow(mRowRange.mLast));
+   pPanRequest->setBands(mInput.mpPanDescriptor->getActiveBand(0), mInput.mpPanDescriptor->getActiveBand(0));
+   pPanRequest->setInterleaveFormat(BSQ);
+   DataAccessor panAccessor = mInput.mpPan->getDataAccessor(pPanRequest.release());
+
+   const RasterDataDescriptor* pResultDescriptor =
+      static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setRows(pResultDescriptor->getActiveRow(mRowRange.mFirst),
+      pResultDescriptor->getActiveRow(mRowRange.mLast));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+
+   // multispectral rows for one block of output rows, keeping only the sharpened bands
+   int maxMsBlockRows = static_cast<int>(ceil(sBlockRows * rowScale)) + 2;
+   std::vector<double> msBlock(maxMsBlockRows * msCols * sharpenedCount);
+   std::vector<double> msRow(msCols * bandCount);
+   std::vector<double> panRow(panCols);
+   std::vector<double> upsampled(sharpenedCount);
+
+   int oldPercentDone = 0;
+   bool aborted = false;
+   for (int blockRow = mRowRange.mFirst; blockRow <= mRowRange.mLast && !aborted; blockRow += sBlockRows)
+   {
+      int blockEnd = std::min(blockRow + sBlockRows - 1, mRowRange.mLast);
+      int blockFirstMsRow = 0;
+      int blockLastMsRow = 0;
+      locate(blockRow, rowScale, msRows, blockFirstMsRow, unused, weight);
+      locate(blockEnd, rowScale, msRows, unused, blockLastMsRow, weight);
+      for (int row = blockFirstMsRow; row <= blockLastMsRow; row++)
+      {
+         accessor->toPixel(row, 0);
+         if (!accessor.isValid())
+         {
+            getReporter().reportError("Invalid data access.");
+            return;
+         }
+         switchOnEncoding(mInput.mpDescriptor->getDataType(), loadValues, accessor->getRow(), &msRow.front(),
+            msCols * bandCount);
+         double* pBlock = &msBlock[(row - blockFirstMsRow) * msCols * sharpenedCount];
+         for (int col = 0; col < msCols; col++)
+         {
+            for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+            {
+               pBlock[col * sharpenedCount + idx] = msRow[col * bandCount + mInput.mBands[idx]];
+            }
+         }
+      }
+
+      for (int row = blockRow; row <= blockEnd; row++)
+      {
+         int percentDone = mRowRange.computePercent(row);
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
+         if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+         {
+            getReporter().reportProgress(getThreadIndex(), 100);
+            aborted = true;
+            break;
+         }
+         if (!panAccessor.isValid() || !resultAccessor.isValid())
+         {
+            getReporter().reportError("Invalid data access.");
+            return;
+         }
+
+         int lowRow = 0;
+         int highRow = 0;
+         double rowWeight = 0.0;
+         locate(row, rowScale, msRows, lowRow, highRow, rowWeight);
+         const double* pLow = &msBlock[(lowRow - blockFirstMsRow) * msCols * sharpenedCount];
+         const double* pHigh = &msBlock[(highRow - blockFirstMsRow) * msCols * sharpenedCount];
+         switchOnEncoding(mInput.mpPanDescriptor->getDataType(), loadValues, panAccessor->getRow(), &panRow.front(),
+            panCols);
+         float* pResult = reinterpret_cast<float*>(resultAccessor->getRow());
+
+         for (int col = 0; col < panCols; col++)
+         {
+            unsigned int left = lowCols[col] * sharpenedCount;
+            unsigned int right = highCols[col] * sharpenedCount;
+            double colWeight = colWeights[col];
+            double intensity = 0.0;
+            for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+            {
+               double top = pLow[left + idx] + colWeight * (pLow[right + idx] - pLow[left + idx]);
+               double bottom = pHigh[left + idx] + colWeight * (pHigh[right + idx] - pHigh[left + idx]);
+               upsampled[idx] = top + rowWeight * (bottom - top);
+               intensity += upsampled[idx];
+            }
+            intensity /= sharpenedCount;
+            double pan = mInput.mPanOffset + mInput.mPanGain * panRow[col];
+            float* pPixel = pResult + col * sharpenedCount;
+
+            switch (mInput.mMethod)
+            {
+            case IHS_SHARPEN:
+            {
+               // forward IHS as in RgbToIhs; hue and saturation are the polar form of v1 and v2
+               // and are unchanged by the substitution so the trigonometry is skipped
+               double v1 = -0.5 * upsampled[0] + -0.5 * upsampled[1] + upsampled[2];
+               double v2 = 0.866025 * upsampled[0] + -0.866025 * upsampled[1];
+               // inverse IHS as in IhsToRgb with the matched pan as the intensity
+               pPixel[0] = static_cast<float>(pan + (-0.333333 * v1) + (0.577350 * v2));
+               pPixel[1] = static_cast<float>(pan + (-0.333333 * v1) + (-0.577350 * v2));
+               pPixel[2] = static_cast<float>(pan + (0.666667 * v1));
+               break;
+            }
+            case BROVEY_SHARPEN:
+            {
+               double ratio = (fabs(intensity) > EPSILON) ? pan / intensity : 1.0;
+               for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+               {
+                  pPixel[idx] = static_cast<float>(upsampled[idx] * ratio);
+               }
+               break;
+            }
+            default:
+            {
+               double detail = pan - intensity;
+               for (unsigned int idx = 0; idx < sharpenedCount; idx++)
+               {
+                  pPixel[idx] = static_cast<float>(upsampled[idx] + mInput.mGains[idx] * detail);
+               }
+               break;
+            }
+            }
+         }
+         panAccessor->nextRow();
+         resultAccessor->nextRow();
+      }
+   }
+
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+bool PanSharpen::PanSharpenThreadOutput::compileOverallResults(const std::vector<PanSharpenThread*>& threads)
+{
+   return true;
+}
@@ -0,0 +1,106 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef PANSHARPEN_H__
+#define PANSHARPEN_H__
+
+#include "AlgorithmShell.h"
+#include "EnumWrapper.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+
+#include <vector>
+
+class RasterDataDescriptor;
+class RasterElement;
+
+enum PanSharpenMethodEnum { IHS_SHARPEN, BROVEY_SHARPEN, GRAM_SCHMIDT_SHARPEN };
+typedef EnumWrapper<PanSharpenMethodEnum> PanSharpenMethod;
+
+/**
+ * Pan-sharpen a multispectral element with a higher resolution panchromatic element in one pass.
+ *
+ * Both elements must cover the same ground, which is checked against the georeferencing when
+ * both have it. Each block of output rows bilinearly upsamples the multispectral rows it needs,
+ * matches the mean and standard deviation of the pan band to the intensity and substitutes it,
+ * so no full resolution intermediates are created.
+ *
+ * IHS and Brovey sharpen the red, green and blue bands. Gram-Schmidt sharpens every band using
+ * the equivalent component substitution form where each band gets the intensity detail scaled
+ * by its covariance with the intensity.
+ */
+class PanSharpen : public AlgorithmShell
+{
+public:
+   PanSharpen();
+   virtual ~PanSharpen();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Verify the pan and multispectral elements cover the same ground.
+    */
+   bool checkFootprints();
+
+   /**
+    * Compute the intensity statistics and band gains from the multispectral element
+    * and the pan statistics in the same pass.
+    */
+   bool computeStatistics();
+
+   struct PanSharpenThreadInput
+   {
+      PanSharpenThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpPan(NULL), mpPanDescriptor(NULL),
+         mpResult(NULL), mMethod(IHS_SHARPEN), mPanOffset(0.0), mPanGain(1.0), mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      const RasterElement* mpPan;
+      const RasterDataDescriptor* mpPanDescriptor;
+      RasterElement* mpResult;
+      PanSharpenMethod mMethod;
+      std::vector<unsigned int> mBands; // the sharpened multispectral bands
+      std::vector<double> mGains; // detail gain for each sharpened band
+      double mPanOffset; // histogram matched pan = mPanOffset + mPanGain * pan
+      double mPanGain;
+      const bool* mpAbortFlag;
+   };
+
+   class PanSharpenThread : public mta::AlgorithmThread
+   {
+   public:
+      PanSharpenThread(const PanSharpenThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      const PanSharpenThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct PanSharpenThreadOutput
+   {
+      bool compileOverallResults(const std::vector<PanSharpenThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   PanSharpenThreadInput mInput;
+   std::string mResultName;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ModelServices.h"
+#include "PanSharpenDialog.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "TypeConverter.h"
+#include <QtCore/QVariant>
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+
+PanSharpenDialog::PanSharpenDialog(const RasterElement* pRaster, QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pPanLabel = new QLabel("Pan Element:", this);
+   mpPan = new QComboBox(this);
+   mpPan->setEditable(false);
+   std::vector<DataElement*> rasters = Service<ModelServices>()->getElements(TypeConverter::toString<RasterElement>());
+   for (std::vector<DataElement*>::iterator raster = rasters.begin(); raster != rasters.end(); ++raster)
+   {
+      RasterElement* pPan = static_cast<RasterElement*>(*raster);
+      if (pPan != pRaster)
+      {
+         mpPan->addItem(QString::fromStdString(pPan->getName()), reinterpret_cast<qulonglong>(pPan));
+      }
+   }
+   mpPan->setToolTip("The first band of this element is the panchromatic band.");
+   QLabel* pMethodLabel = new QLabel("Method:", this);
+   mpMethod = new QComboBox(this);
+   mpMethod->setEditable(false);
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<PanSharpenMethod>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      mpMethod->addItem(QString::fromStdString(*val));
+   }
+   mpMethod->setToolTip("IHS and Brovey sharpen the displayed RGB bands. Gram-Schmidt sharpens every band.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pPanLabel, 0, 0);
+   pTopLevel->addWidget(mpPan, 0, 1);
+   pTopLevel->addWidget(pMethodLabel, 1, 0);
+   pTopLevel->addWidget(mpMethod, 1, 1);
+   pTopLevel->addWidget(pButtons, 2, 0, 1, 2);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+PanSharpenDialog::~PanSharpenDialog()
+{
+}
+
+RasterElement* PanSharpenDialog::getPanElement() const
+{
+   if (mpPan->currentIndex() < 0)
+   {
+      return NULL;
+   }
+   return reinterpret_cast<RasterElement*>(mpPan->itemData(mpPan->currentIndex()).toULongLong());
+}
+
+PanSharpenMethod PanSharpenDialog::getMethod() const
+{
+   return StringUtilities::fromDisplayString<PanSharpenMethod>(mpMethod->currentText().toStdString());
+}
+
+void PanSharpenDialog::setPanElement(RasterElement* pPan)
+{
+   int idx = mpPan->findData(reinterpret_cast<qulonglong>(pPan));
+   if (idx >= 0)
+   {
+      mpPan->setCurrentIndex(idx);
+   }
+}
+
+void PanSharpenDialog::setMethod(PanSharpenMethod method)
+{
+   QString val = QString::fromStdString(StringUtilities::toDisplayString(method));
+   mpMethod->setCurrentIndex(mpMethod->findText(val));
+}
@@ -0,0 +1,35 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef PANSHARPENDIALOG_H
+#define PANSHARPENDIALOG_H
+
+#include "PanSharpen.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+
+class PanSharpenDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   PanSharpenDialog(const RasterElement* pRaster, QWidget* pParent=NULL);
+   virtual ~PanSharpenDialog();
+
+   RasterElement* getPanElement() const;
+   PanSharpenMethod getMethod() const;
+   void setPanElement(RasterElement* pPan);
+   void setMethod(PanSharpenMethod method);
+
+private:
+   QComboBox* mpPan;
+   QComboBox* mpMethod;
+};
+
+#endif
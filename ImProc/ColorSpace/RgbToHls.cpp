@@ -7,6 +7,7 @@
  */
 
 #include "AppVerify.h"
+#include "ColorSpaceMath.h"
 #include "ImProcVersion.h"
 #include "PlugInArgList.h"
 #include "PlugInRegistration.h"
@@ -51,54 +52,9 @@ bool RgbToHls::extractInputArgs(PlugInArgList* pInArgList)
 
 void RgbToHls::colorspaceConvert(double pOutput[3], double pInput[3], double maxComponent, double minComponent)
 {
-   double red = pInput[0];
-   double green = pInput[1];
-   double blue = pInput[2];
-   double h = 0.0;
-   double l = 0.0;
-   double s = 0.0;
-   if (fabs(maxComponent) < EPSILON)
+   ColorSpaceMath::rgbToHls(pOutput, pInput, maxComponent, minComponent);
+   if (mNormalizeHue && pOutput[0] < 0.0)
    {
-      pOutput[0] = pOutput[1] = pOutput[2] = 0.0;
-      return;
+      pOutput[0] += 360.0;
    }
-
-   // hue
-   if (fabs(maxComponent - minComponent) < EPSILON)
-   {
-      h = 0;
-   }
-   else if (fabs(maxComponent - red) < EPSILON)
-   {
-      h = fmod(60 * (green - blue) / (maxComponent - minComponent), 360);
-   }
-   else if (fabs(maxComponent - green) < EPSILON)
-   {
-      h = 60 * (blue - red) / (maxComponent - minComponent) + 120;
-   }
-   else if (fabs(maxComponent - blue) < EPSILON)
-   {
-      h = 60 * (red - green) / (maxComponent - minComponent) + 240;
-   }
-
-   // lightness
-   l = (maxComponent + minComponent) / 2.0;
-
-   // saturation
-   if (l < 0.5)
-   {
-      s = (maxComponent - minComponent) / (maxComponent + minComponent);
-   }
-   else
-   {
-      s = (maxComponent - minComponent) / (2 - maxComponent - minComponent);
-   }
-
-   if (mNormalizeHue && h < 0.0)
-   {
-      h += 360.0;
-   }
-   pOutput[0] = h;
-   pOutput[1] = l;
-   pOutput[2] = s;
 }
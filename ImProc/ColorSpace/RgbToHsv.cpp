@@ -7,6 +7,7 @@
  */
 
 #include "AppVerify.h"
+#include "ColorSpaceMath.h"
 #include "ImProcVersion.h"
 #include "PlugInArgList.h"
 #include "PlugInRegistration.h"
@@ -51,47 +52,9 @@ bool RgbToHsv::extractInputArgs(PlugInArgList* pInArgList)
 
 void RgbToHsv::colorspaceConvert(double pOutput[3], double pInput[3], double maxComponent, double minComponent)
 {
-   double red = pInput[0];
-   double green = pInput[1];
-   double blue = pInput[2];
-   double h = 0.0;
-   double s = 0.0;
-   double v = 0.0;
-   if (fabs(maxComponent) < EPSILON)
+   ColorSpaceMath::rgbToHsv(pOutput, pInput, maxComponent, minComponent);
+   if (mNormalizeHue && pOutput[0] < 0.0)
    {
-      pOutput[0] = pOutput[1] = pOutput[2] = 0.0;
-      return;
+      pOutput[0] += 360.0;
    }
-
-   // hue
-   if (fabs(maxComponent - minComponent) < EPSILON)
-   {
-      h = 0;
-   }
-   else if (fabs(maxComponent - red) < EPSILON)
-   {
-      h = fmod(60 * (green - blue) / (maxComponent - minComponent), 360);
-   }
-   else if (fabs(maxComponent - green) < EPSILON)
-   {
-      h = 60 * (blue - red) / (maxComponent - minComponent) + 120;
-   }
-   else if (fabs(maxComponent - blue) < EPSILON)
-   {
-      h = 60 * (red - green) / (maxComponent - minComponent) + 240;
-   }
-
-   // saturation
-   s = 1.0 - (minComponent / maxComponent);
-
-   // value
-   v = maxComponent;
-
-   if (mNormalizeHue && h < 0.0)
-   {
-      h += 360.0;
-   }
-   pOutput[0] = h;
-   pOutput[1] = s;
-   pOutput[2] = v;
 }
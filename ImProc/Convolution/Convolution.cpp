@@ -0,0 +1,576 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "Convolution.h"
+#include "ConvolutionDialog.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+
+#include <algorithm>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(ConvolutionModule, Convolution);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(KernelShape)
+ADD_ENUM_MAPPING(BOX_KERNEL, "Box", "box")
+ADD_ENUM_MAPPING(GAUSSIAN_KERNEL, "Gaussian", "gaussian")
+ADD_ENUM_MAPPING(DISK_KERNEL, "Disk", "disk")
+END_ENUM_MAPPING()
+
+BEGIN_ENUM_MAPPING(ConvolutionOperation)
+ADD_ENUM_MAPPING(CONVOLUTION, "Convolution", "convolution")
+ADD_ENUM_MAPPING(CORRELATION, "Correlation", "correlation")
+END_ENUM_MAPPING()
+
+BEGIN_ENUM_MAPPING(ConvolutionMethod)
+ADD_ENUM_MAPPING(AUTOMATIC_METHOD, "Automatic", "auto")
+ADD_ENUM_MAPPING(DIRECT_METHOD, "Direct", "direct")
+ADD_ENUM_MAPPING(FFT_METHOD, "FFT", "fft")
+END_ENUM_MAPPING()
+
+BEGIN_ENUM_MAPPING(EdgeMode)
+ADD_ENUM_MAPPING(REFLECT_EDGE, "Reflect", "reflect")
+ADD_ENUM_MAPPING(ZERO_EDGE, "Zero", "zero")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   template<typename T>
+   void loadValues(const T* pData, double* pBuffer, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pBuffer[idx] = static_cast<double>(pData[idx]);
+      }
+   }
+
+   template<typename T>
+   void storeValues(T* pData, const double* pValues, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pData[idx] = static_cast<T>(pValues[idx]);
+      }
+   }
+
+   /**
+    * Map a row or column index outside [0, count) back inside, or to -1 for a zero edge.
+    */
+   int mapIndex(int idx, int count, EdgeMode edge)
+   {
+      if (idx >= 0 && idx < count)
+      {
+         return idx;
+      }
+      if (edge == ZERO_EDGE)
+      {
+         return -1;
+      }
+      // symmetric reflection repeating the edge sample, periodic for kernels larger than the image
+      int period = 2 * count;
+      idx %= period;
+      if (idx < 0)
+      {
+         idx += period;
+      }
+      return (idx < count) ? idx : period - 1 - idx;
+   }
+}
+
+Convolution::Convolution() :
+   mpKernelElement(NULL),
+   mShape(GAUSSIAN_KERNEL),
+   mKernelSize(0),
+   mSigma(0.0),
+   mOperation(CONVOLUTION),
+   mMethod(AUTOMATIC_METHOD),
+   mKernelRows(0),
+   mKernelColumns(0),
+   mAbortFlag(false)
+{
+   setName("Convolution");
+   setDescription("Convolve or correlate each band with a kernel.");
+   setDescriptorId("{48DD6F61-C698-495A-A8D2-EEF39D638B37}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Convolution");
+}
+
+Convolution::~Convolution()
+{
+}
+
+bool Convolution::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<std::string>("Result Name", std::string(),
+      "The name of the result data element. The default is derived from the data element name."));
+   VERIFY(pInArgList->addArg<RasterElement>("Kernel", NULL,
+      "The first band of this element is used as the kernel. If not set, a kernel is generated."));
+
+   std::string shapeHelp = "The shape of a generated kernel. Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<KernelShape>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<KernelShape>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      shapeHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Kernel Shape",
+      StringUtilities::toXmlString<KernelShape>(GAUSSIAN_KERNEL), shapeHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Kernel Size", 31,
+      "The width and height of a generated kernel. Even sizes are increased by 1."));
+   VERIFY(pInArgList->addArg<double>("Sigma", 0.0,
+      "The standard deviation of a generated Gaussian kernel in pixels. 0 uses a sixth of the kernel size."));
+
+   std::string operationHelp = "Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<ConvolutionOperation>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<ConvolutionOperation>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      operationHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Operation",
+      StringUtilities::toXmlString<ConvolutionOperation>(CONVOLUTION), operationHelp));
+
+   std::string methodHelp = "How the kernel is applied. Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<ConvolutionMethod>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<ConvolutionMethod>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      methodHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Method",
+      StringUtilities::toXmlString<ConvolutionMethod>(AUTOMATIC_METHOD), methodHelp));
+
+   std::string edgeHelp = "How pixels beyond the edge of the data are filled. Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<EdgeMode>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<EdgeMode>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      edgeHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Edge Mode", StringUtilities::toXmlString<EdgeMode>(REFLECT_EDGE), edgeHelp));
+   return true;
+}
+
+bool Convolution::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool Convolution::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+   if (!createKernel())
+   {
+      return false;
+   }
+
+   bool useFft = (mMethod == FFT_METHOD) ||
+      (mMethod == AUTOMATIC_METHOD && ConvolutionFilter::isFftFaster(mKernel, mKernelRows, mKernelColumns));
+   mpFilter.reset(new ConvolutionFilter(mKernel, mKernelRows, mKernelColumns, useFft));
+   mInput.mpFilter = mpFilter.get();
+   mProgress.report(std::string("Applying a ") + StringUtilities::toDisplayString(mKernelRows) + "x" +
+      StringUtilities::toDisplayString(mKernelColumns) + (useFft ? " kernel with FFTs." : " kernel directly."), 1, NORMAL);
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   bool singlePrecision = !(encoding == FLT8BYTES || encoding == INT4SBYTES || encoding == INT4UBYTES);
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), mInput.mpDescriptor->getBandCount(),
+      singlePrecision ? FLT4BYTES : FLT8BYTES, BSQ, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+
+   mInput.mpAbortFlag = &mAbortFlag;
+   ConvolutionThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Convolving", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<ConvolutionThreadInput, ConvolutionThreadOutput, ConvolutionThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Convolution complete.", 100, NORMAL);
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Convolution aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Convolution failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool Convolution::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{E29E20B7-B592-4248-AE98-0D12CDCCBE80}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+   if (mInput.mpDescriptor->getDataType() == INT4SCOMPLEX || mInput.mpDescriptor->getDataType() == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+   mpKernelElement = pInArgList->getPlugInArgValue<RasterElement>("Kernel");
+   std::string str;
+   pInArgList->getPlugInArgValue("Kernel Shape", str);
+   mShape = StringUtilities::fromXmlString<KernelShape>(str);
+   pInArgList->getPlugInArgValue("Kernel Size", mKernelSize);
+   pInArgList->getPlugInArgValue("Sigma", mSigma);
+   pInArgList->getPlugInArgValue("Operation", str);
+   mOperation = StringUtilities::fromXmlString<ConvolutionOperation>(str);
+   pInArgList->getPlugInArgValue("Method", str);
+   mMethod = StringUtilities::fromXmlString<ConvolutionMethod>(str);
+   pInArgList->getPlugInArgValue("Edge Mode", str);
+   mInput.mEdge = StringUtilities::fromXmlString<EdgeMode>(str);
+   if (!isBatch())
+   {
+      ConvolutionDialog dlg(mInput.mpRaster);
+      dlg.setKernelElement(mpKernelElement);
+      dlg.setShape(mShape);
+      dlg.setKernelSize(mKernelSize);
+      dlg.setSigma(mSigma);
+      dlg.setOperation(mOperation);
+      dlg.setMethod(mMethod);
+      dlg.setEdgeMode(mInput.mEdge);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mpKernelElement = dlg.getKernelElement();
+      mShape = dlg.getShape();
+      mKernelSize = dlg.getKernelSize();
+      mSigma = dlg.getSigma();
+      mOperation = dlg.getOperation();
+      mMethod = dlg.getMethod();
+      mInput.mEdge = dlg.getEdgeMode();
+   }
+   if (!mOperation.isValid() || !mMethod.isValid() || !mInput.mEdge.isValid() ||
+      (mpKernelElement == NULL && !mShape.isValid()))
+   {
+      mProgress.report("Invalid kernel, operation, method or edge mode.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+bool Convolution::createKernel()
+{
+   if (mpKernelElement != NULL)
+   {
+      const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(mpKernelElement->getDataDescriptor());
+      mKernelRows = pDesc->getRowCount();
+      mKernelColumns = pDesc->getColumnCount();
+      mKernel.resize(mKernelRows * mKernelColumns);
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setBands(pDesc->getActiveBand(0), pDesc->getActiveBand(0));
+      pRequest->setInterleaveFormat(BSQ);
+      DataAccessor accessor = mpKernelElement->getDataAccessor(pRequest.release());
+      for (unsigned int row = 0; row < mKernelRows; row++)
+      {
+         if (!accessor.isValid())
+         {
+            mProgress.report("Unable to read the kernel.", 0, ERRORS, true);
+            return false;
+         }
+         switchOnEncoding(pDesc->getDataType(), loadValues, accessor->getRow(), &mKernel[row * mKernelColumns],
+            mKernelColumns);
+         accessor->nextRow();
+      }
+   }
+   else
+   {
+      mKernelSize |= 1;
+      mKernelRows = mKernelColumns = mKernelSize;
+      mKernel.assign(mKernelSize * mKernelSize, 0.0);
+      double center = mKernelSize / 2;
+      double sigma = (mSigma > 0.0) ? mSigma : mKernelSize / 6.0;
+      double sum = 0.0;
+      for (unsigned int row = 0; row < mKernelSize; row++)
+      {
+         for (unsigned int col = 0; col < mKernelSize; col++)
+         {
+            double dy = row - center;
+            double dx = col - center;
+            double weight = 1.0;
+            if (mShape == GAUSSIAN_KERNEL)
+            {
+               weight = exp(-(dx * dx + dy * dy) / (2.0 * sigma * sigma));
+            }
+            else if (mShape == DISK_KERNEL)
+            {
+               weight = (dx * dx + dy * dy <= (center + 0.5) * (center + 0.5)) ? 1.0 : 0.0;
+            }
+            mKernel[row * mKernelSize + col] = weight;
+            sum += weight;
+         }
+      }
+      for (std::vector<double>::iterator weight = mKernel.begin(); weight != mKernel.end(); ++weight)
+      {
+         *weight /= sum;
+      }
+   }
+   if (mKernel.empty())
+   {
+      mProgress.report("The kernel is empty.", 0, ERRORS, true);
+      return false;
+   }
+
+   // the filter correlates so a convolution kernel is flipped, which moves the anchor
+   if (mOperation == CONVOLUTION)
+   {
+      std::reverse(mKernel.begin(), mKernel.end());
+      mInput.mAnchorRow = mKernelRows - 1 - mKernelRows / 2;
+      mInput.mAnchorColumn = mKernelColumns - 1 - mKernelColumns / 2;
+   }
+   else
+   {
+      mInput.mAnchorRow = mKernelRows / 2;
+      mInput.mAnchorColumn = mKernelColumns / 2;
+   }
+   return true;
+}
+
+bool Convolution::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+Convolution::ConvolutionThread::ConvolutionThread(
+   const ConvolutionThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void Convolution::ConvolutionThread::run()
+{
+   if (mInput.mpResult == NULL || mInput.mpFilter == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   const ConvolutionFilter& filter = *mInput.mpFilter;
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   EncodingType resultEncoding = mInput.mpResultDescriptor->getDataType();
+   int numRows = mInput.mpDescriptor->getRowCount();
+   int numCols = mInput.mpDescriptor->getColumnCount();
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+   int kernelRows = filter.getKernelRows();
+   int kernelColumns = filter.getKernelColumns();
+   int anchorRow = mInput.mAnchorRow;
+   int anchorColumn = mInput.mAnchorColumn;
+   unsigned int stripRows = filter.getStripRows();
+   unsigned int stride = numCols + kernelColumns - 1;
+
+   // the rows this thread reads, including the kernel margin and any reflected rows
+   int firstInputRow = numRows - 1;
+   int lastInputRow = 0;
+   for (int row = mRowRange.mFirst - anchorRow; row <= mRowRange.mLast + kernelRows - 1 - anchorRow; row++)
+   {
+      int sourceRow = mapIndex(row, numRows, mInput.mEdge);
+      if (sourceRow >= 0)
+      {
+         firstInputRow = std::min(firstInputRow, sourceRow);
+         lastInputRow = std::max(lastInputRow, sourceRow);
+      }
+   }
+
+   // per-thread buffers so the strip loop does no allocation
+   std::vector<double> input((stripRows + kernelRows - 1) * stride);
+   std::vector<double> output(stripRows * numCols);
+   std::vector<Fft::Complex> scratch;
+
+   int oldPercentDone = 0;
+   int rangeRows = mRowRange.mLast - mRowRange.mFirst + 1;
+   bool aborted = false;
+   for (unsigned int band = 0; band < numBands && !aborted; band++)
+   {
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setRows(mInput.mpDescriptor->getActiveRow(firstInputRow), mInput.mpDescriptor->getActiveRow(lastInputRow));
+      pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0), mInput.mpDescriptor->getActiveColumn(numCols - 1));
+      pRequest->setBands(mInput.mpDescriptor->getActiveBand(band), mInput.mpDescriptor->getActiveBand(band));
+      pRequest->setInterleaveFormat(BSQ);
+      DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+      FactoryResource<DataRequest> pResultRequest;
+      pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+         mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast));
+      pResultRequest->setColumns(mInput.mpResultDescriptor->getActiveColumn(0),
+         mInput.mpResultDescriptor->getActiveColumn(numCols - 1));
+      pResultRequest->setBands(mInput.mpResultDescriptor->getActiveBand(band),
+         mInput.mpResultDescriptor->getActiveBand(band));
+      pResultRequest->setWritable(true);
+      DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+
+      for (int stripRow = mRowRange.mFirst; stripRow <= mRowRange.mLast; stripRow += stripRows)
+      {
+         int percentDone = static_cast<int>(100.0 * (band * rangeRows + stripRow - mRowRange.mFirst) /
+            (numBands * rangeRows));
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            getReporter().reportProgress(getThreadIndex(), percentDone);
+         }
+         if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+         {
+            getReporter().reportProgress(getThreadIndex(), 100);
+            aborted = true;
+            break;
+         }
+
+         // build the padded input strip
+         unsigned int rows = std::min<unsigned int>(stripRows, mRowRange.mLast - stripRow + 1);
+         for (unsigned int inputRow = 0; inputRow < rows + kernelRows - 1; inputRow++)
+         {
+            double* pRow = &input[inputRow * stride];
+            int sourceRow = mapIndex(stripRow - anchorRow + static_cast<int>(inputRow), numRows, mInput.mEdge);
+            if (sourceRow < 0)
+            {
+               std::fill(pRow, pRow + stride, 0.0);
+               continue;
+            }
+            accessor->toPixel(sourceRow, 0);
+            if (!accessor.isValid())
+            {
+               getReporter().reportError("Invalid data access.");
+               return;
+            }
+            switchOnEncoding(encoding, loadValues, accessor->getRow(), pRow + anchorColumn, numCols);
+            for (int col = 0; col < anchorColumn; col++)
+            {
+               int sourceCol = mapIndex(col - anchorColumn, numCols, mInput.mEdge);
+               pRow[col] = (sourceCol < 0) ? 0.0 : pRow[anchorColumn + sourceCol];
+            }
+            for (int col = anchorColumn + numCols; col < static_cast<int>(stride); col++)
+            {
+               int sourceCol = mapIndex(col - anchorColumn, numCols, mInput.mEdge);
+               pRow[col] = (sourceCol < 0) ? 0.0 : pRow[anchorColumn + sourceCol];
+            }
+         }
+
+         filter.filter(&input.front(), stride, rows, numCols, &output.front(), scratch);
+
+         for (unsigned int row = 0; row < rows; row++)
+         {
+            if (!resultAccessor.isValid())
+            {
+               getReporter().reportError("Invalid data access.");
+               return;
+            }
+            switchOnEncoding(resultEncoding, storeValues, resultAccessor->getRow(), &output[row * numCols], numCols);
+            resultAccessor->nextRow();
+         }
+      }
+   }
+
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+bool Convolution::ConvolutionThreadOutput::compileOverallResults(const std::vector<ConvolutionThread*>& threads)
+{
+   return true;
+}
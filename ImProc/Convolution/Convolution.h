@@ -0,0 +1,115 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CONVOLUTION_H__
+#define CONVOLUTION_H__
+
+#include "AlgorithmShell.h"
+#include "ConvolutionFilter.h"
+#include "EnumWrapper.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class RasterDataDescriptor;
+class RasterElement;
+
+enum KernelShapeEnum { BOX_KERNEL, GAUSSIAN_KERNEL, DISK_KERNEL };
+typedef EnumWrapper<KernelShapeEnum> KernelShape;
+
+enum ConvolutionOperationEnum { CONVOLUTION, CORRELATION };
+typedef EnumWrapper<ConvolutionOperationEnum> ConvolutionOperation;
+
+enum ConvolutionMethodEnum { AUTOMATIC_METHOD, DIRECT_METHOD, FFT_METHOD };
+typedef EnumWrapper<ConvolutionMethodEnum> ConvolutionMethod;
+
+enum EdgeModeEnum { REFLECT_EDGE, ZERO_EDGE };
+typedef EnumWrapper<EdgeModeEnum> EdgeMode;
+
+/**
+ * 2-D convolution or correlation of every band with a kernel.
+ *
+ * The kernel is either the first band of a raster element, which is what matched filtering
+ * needs, or a generated box, Gaussian or disk. Small kernels are applied directly and large
+ * kernels with FFT overlap-save; the automatic choice uses the cost model in ConvolutionFilter.
+ */
+class Convolution : public AlgorithmShell
+{
+public:
+   Convolution();
+   virtual ~Convolution();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Build the correlation kernel and its anchor from the kernel arguments.
+    */
+   bool createKernel();
+
+   struct ConvolutionThreadInput
+   {
+      ConvolutionThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL),
+         mpFilter(NULL), mAnchorRow(0), mAnchorColumn(0), mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      const ConvolutionFilter* mpFilter;
+      unsigned int mAnchorRow;
+      unsigned int mAnchorColumn;
+      EdgeMode mEdge;
+      const bool* mpAbortFlag;
+   };
+
+   class ConvolutionThread : public mta::AlgorithmThread
+   {
+   public:
+      ConvolutionThread(const ConvolutionThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      const ConvolutionThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct ConvolutionThreadOutput
+   {
+      bool compileOverallResults(const std::vector<ConvolutionThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   ConvolutionThreadInput mInput;
+   std::string mResultName;
+   RasterElement* mpKernelElement;
+   KernelShape mShape;
+   unsigned int mKernelSize;
+   double mSigma;
+   ConvolutionOperation mOperation;
+   ConvolutionMethod mMethod;
+   std::vector<double> mKernel;
+   unsigned int mKernelRows;
+   unsigned int mKernelColumns;
+   std::auto_ptr<ConvolutionFilter> mpFilter;
+   bool mAbortFlag;
+};
+
+#endif
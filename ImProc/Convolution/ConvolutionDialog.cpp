@@ -0,0 +1,194 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ConvolutionDialog.h"
+#include "ModelServices.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "TypeConverter.h"
+#include <QtCore/QVariant>
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QSpinBox>
+
+namespace
+{
+   template<typename T>
+   void addEnumItems(QComboBox* pCombo)
+   {
+      std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<T>();
+      for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+      {
+         pCombo->addItem(QString::fromStdString(*val));
+      }
+   }
+
+   template<typename T>
+   void setEnumItem(QComboBox* pCombo, T value)
+   {
+      pCombo->setCurrentIndex(pCombo->findText(QString::fromStdString(StringUtilities::toDisplayString(value))));
+   }
+}
+
+ConvolutionDialog::ConvolutionDialog(const RasterElement* pRaster, QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pKernelLabel = new QLabel("Kernel:", this);
+   mpKernel = new QComboBox(this);
+   mpKernel->setEditable(false);
+   mpKernel->addItem("Generated", qulonglong(0));
+   std::vector<DataElement*> rasters = Service<ModelServices>()->getElements(TypeConverter::toString<RasterElement>());
+   for (std::vector<DataElement*>::iterator raster = rasters.begin(); raster != rasters.end(); ++raster)
+   {
+      RasterElement* pKernel = static_cast<RasterElement*>(*raster);
+      if (pKernel != pRaster)
+      {
+         mpKernel->addItem(QString::fromStdString(pKernel->getName()), reinterpret_cast<qulonglong>(pKernel));
+      }
+   }
+   mpKernel->setToolTip("A raster element whose first band is the kernel, or a generated kernel.");
+   QLabel* pShapeLabel = new QLabel("Kernel Shape:", this);
+   mpShape = new QComboBox(this);
+   mpShape->setEditable(false);
+   addEnumItems<KernelShape>(mpShape);
+   QLabel* pSizeLabel = new QLabel("Kernel Size:", this);
+   mpSize = new QSpinBox(this);
+   mpSize->setRange(1, 1023);
+   mpSize->setSingleStep(2);
+   mpSize->setToolTip("Width and height of the generated kernel. Even sizes are increased by 1.");
+   QLabel* pSigmaLabel = new QLabel("Sigma:", this);
+   mpSigma = new QDoubleSpinBox(this);
+   mpSigma->setRange(0.0, 1000.0);
+   mpSigma->setDecimals(2);
+   mpSigma->setSpecialValueText("Automatic");
+   mpSigma->setToolTip("Standard deviation of the Gaussian kernel in pixels.");
+   QLabel* pOperationLabel = new QLabel("Operation:", this);
+   mpOperation = new QComboBox(this);
+   mpOperation->setEditable(false);
+   addEnumItems<ConvolutionOperation>(mpOperation);
+   QLabel* pMethodLabel = new QLabel("Method:", this);
+   mpMethod = new QComboBox(this);
+   mpMethod->setEditable(false);
+   addEnumItems<ConvolutionMethod>(mpMethod);
+   mpMethod->setToolTip("Automatic applies small kernels directly and large kernels with FFTs.");
+   QLabel* pEdgeLabel = new QLabel("Edge Mode:", this);
+   mpEdge = new QComboBox(this);
+   mpEdge->setEditable(false);
+   addEnumItems<EdgeMode>(mpEdge);
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pKernelLabel, 0, 0);
+   pTopLevel->addWidget(mpKernel, 0, 1);
+   pTopLevel->addWidget(pShapeLabel, 1, 0);
+   pTopLevel->addWidget(mpShape, 1, 1);
+   pTopLevel->addWidget(pSizeLabel, 2, 0);
+   pTopLevel->addWidget(mpSize, 2, 1);
+   pTopLevel->addWidget(pSigmaLabel, 3, 0);
+   pTopLevel->addWidget(mpSigma, 3, 1);
+   pTopLevel->addWidget(pOperationLabel, 4, 0);
+   pTopLevel->addWidget(mpOperation, 4, 1);
+   pTopLevel->addWidget(pMethodLabel, 5, 0);
+   pTopLevel->addWidget(mpMethod, 5, 1);
+   pTopLevel->addWidget(pEdgeLabel, 6, 0);
+   pTopLevel->addWidget(mpEdge, 6, 1);
+   pTopLevel->addWidget(pButtons, 7, 0, 1, 2);
+
+   connect(mpKernel, SIGNAL(currentIndexChanged(int)), this, SLOT(updateKernelControls()));
+   connect(mpShape, SIGNAL(currentIndexChanged(int)), this, SLOT(updateKernelControls()));
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+   updateKernelControls();
+}
+
+ConvolutionDialog::~ConvolutionDialog()
+{
+}
+
+RasterElement* ConvolutionDialog::getKernelElement() const
+{
+   return reinterpret_cast<RasterElement*>(mpKernel->itemData(mpKernel->currentIndex()).toULongLong());
+}
+
+KernelShape ConvolutionDialog::getShape() const
+{
+   return StringUtilities::fromDisplayString<KernelShape>(mpShape->currentText().toStdString());
+}
+
+unsigned int ConvolutionDialog::getKernelSize() const
+{
+   return static_cast<unsigned int>(mpSize->value());
+}
+
+double ConvolutionDialog::getSigma() const
+{
+   return mpSigma->value();
+}
+
+ConvolutionOperation ConvolutionDialog::getOperation() const
+{
+   return StringUtilities::fromDisplayString<ConvolutionOperation>(mpOperation->currentText().toStdString());
+}
+
+ConvolutionMethod ConvolutionDialog::getMethod() const
+{
+   return StringUtilities::fromDisplayString<ConvolutionMethod>(mpMethod->currentText().toStdString());
+}
+
+EdgeMode ConvolutionDialog::getEdgeMode() const
+{
+   return StringUtilities::fromDisplayString<EdgeMode>(mpEdge->currentText().toStdString());
+}
+
+void ConvolutionDialog::setKernelElement(RasterElement* pKernel)
+{
+   int idx = mpKernel->findData(reinterpret_cast<qulonglong>(pKernel));
+   mpKernel->setCurrentIndex(idx < 0 ? 0 : idx);
+}
+
+void ConvolutionDialog::setShape(KernelShape shape)
+{
+   setEnumItem(mpShape, shape);
+}
+
+void ConvolutionDialog::setKernelSize(unsigned int size)
+{
+   mpSize->setValue(static_cast<int>(size));
+}
+
+void ConvolutionDialog::setSigma(double sigma)
+{
+   mpSigma->setValue(sigma);
+}
+
+void ConvolutionDialog::setOperation(ConvolutionOperation operation)
+{
+   setEnumItem(mpOperation, operation);
+}
+
+void ConvolutionDialog::setMethod(ConvolutionMethod method)
+{
+   setEnumItem(mpMethod, method);
+}
+
+void ConvolutionDialog::setEdgeMode(EdgeMode edge)
+{
+   setEnumItem(mpEdge, edge);
+}
+
+void ConvolutionDialog::updateKernelControls()
+{
+   bool generated = getKernelElement() == NULL;
+   mpShape->setEnabled(generated);
+   mpSize->setEnabled(generated);
+   mpSigma->setEnabled(generated && getShape() == GAUSSIAN_KERNEL);
+}
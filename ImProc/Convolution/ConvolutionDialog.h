@@ -0,0 +1,55 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CONVOLUTIONDIALOG_H
+#define CONVOLUTIONDIALOG_H
+
+#include "Convolution.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+class ConvolutionDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   ConvolutionDialog(const RasterElement* pRaster, QWidget* pParent=NULL);
+   virtual ~ConvolutionDialog();
+
+   RasterElement* getKernelElement() const;
+   KernelShape getShape() const;
+   unsigned int getKernelSize() const;
+   double getSigma() const;
+   ConvolutionOperation getOperation() const;
+   ConvolutionMethod getMethod() const;
+   EdgeMode getEdgeMode() const;
+   void setKernelElement(RasterElement* pKernel);
+   void setShape(KernelShape shape);
+   void setKernelSize(unsigned int size);
+   void setSigma(double sigma);
+   void setOperation(ConvolutionOperation operation);
+   void setMethod(ConvolutionMethod method);
+   void setEdgeMode(EdgeMode edge);
+
+private slots:
+   void updateKernelControls();
+
+private:
+   QComboBox* mpKernel;
+   QComboBox* mpShape;
+   QSpinBox* mpSize;
+   QDoubleSpinBox* mpSigma;
+   QComboBox* mpOperation;
+   QComboBox* mpMethod;
+   QComboBox* mpEdge;
+};
+
+#endif
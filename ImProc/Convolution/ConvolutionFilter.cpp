@@ -0,0 +1,205 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ConvolutionFilter.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+   // measured costs in nanoseconds, see getFftCost()
+   const double sMultiplyAddCost = 0.45;
+   const double sButterflyCost = 4.0;
+   const double sTilePointCost = 10.0;
+
+   const unsigned int sDirectStripRows = 64;
+   const unsigned int sMaxTileSize = 512; // larger tiles fall out of cache
+}
+
+ConvolutionFilter::ConvolutionFilter(const std::vector<double>& kernel, unsigned int rows, unsigned int columns,
+                                     bool useFft) :
+   mKernel(kernel),
+   mRows(rows),
+   mColumns(columns)
+{
+   if (!useFft)
+   {
+      return;
+   }
+   unsigned int size = 0;
+   getFftCost(rows, columns, size);
+   mpFft.reset(new Fft(size));
+   mSpectrum.assign(size * size, Fft::Complex());
+   for (unsigned int row = 0; row < rows; row++)
+   {
+      for (unsigned int col = 0; col < columns; col++)
+      {
+         mSpectrum[row * size + col] = mKernel[row * columns + col];
+      }
+   }
+   mpFft->transform2d(&mSpectrum.front(), false);
+   double scale = 1.0 / (static_cast<double>(size) * size);
+   for (std::vector<Fft::Complex>::iterator value = mSpectrum.begin(); value != mSpectrum.end(); ++value)
+   {
+      *value = std::conj(*value) * scale;
+   }
+}
+
+bool ConvolutionFilter::isFftFaster(const std::vector<double>& kernel, unsigned int rows, unsigned int columns)
+{
+   unsigned int tileSize = 0;
+   return getFftCost(rows, columns, tileSize) < getDirectCost(kernel);
+}
+
+double ConvolutionFilter::getDirectCost(const std::vector<double>& kernel)
+{
+   return sMultiplyAddCost * (kernel.size() - std::count(kernel.begin(), kernel.end(), 0.0));
+}
+
+double ConvolutionFilter::getFftCost(unsigned int rows, unsigned int columns, unsigned int& tileSize)
+{
+   // A tile of size N yields two (N - rows + 1) x (N - columns + 1) output blocks for a forward and an inverse
+   // transform of N^2 log2(N) butterflies each plus filling, multiplying and extracting N^2 points.
+   // The constants were measured by timing both paths over square kernels; with a dense kernel the
+   // crossover is between 9x9 and 11x11.
+   unsigned int minSize = 2;
+   while (minSize < std::max(rows, columns))
+   {
+      minSize *= 2;
+   }
+   double bestCost = -1.0;
+   tileSize = minSize;
+   for (unsigned int size = minSize; size <= std::max(minSize, sMaxTileSize); size *= 2)
+   {
+      double log2Size = 0.0;
+      for (unsigned int bits = size; bits > 1; bits /= 2)
+      {
+         log2Size += 1.0;
+      }
+      double points = static_cast<double>(size) * size;
+      double outputs = 2.0 * (size - rows + 1) * (size - columns + 1);
+      double cost = (2.0 * sButterflyCost * points * log2Size + sTilePointCost * points) / outputs;
+      if (bestCost < 0.0 || cost < bestCost)
+      {
+         bestCost = cost;
+         tileSize = size;
+      }
+   }
+   return bestCost;
+}
+
+unsigned int ConvolutionFilter::getStripRows() const
+{
+   if (isFft())
+   {
+      return mpFft->getSize() - mRows + 1;
+   }
+   return sDirectStripRows;
+}
+
+void ConvolutionFilter::filter(const double* pInput, unsigned int stride, unsigned int rows, unsigned int columns,
+                               double* pOutput, std::vector<Fft::Complex>& scratch) const
+{
+   if (isFft())
+   {
+      filterFft(pInput, stride, rows, columns, pOutput, scratch);
+   }
+   else
+   {
+      filterDirect(pInput, stride, rows, columns, pOutput);
+   }
+}
+
+void ConvolutionFilter::filterDirect(const double* pInput, unsigned int stride, unsigned int rows,
+                                     unsigned int columns, double* pOutput) const
+{
+   for (unsigned int row = 0; row < rows; row++)
+   {
+      double* pOut = pOutput + row * columns;
+      std::fill(pOut, pOut + columns, 0.0);
+      for (unsigned int kernelRow = 0; kernelRow < mRows; kernelRow++)
+      {
+         const double* pRow = pInput + (row + kernelRow) * stride;
+         for (unsigned int kernelCol = 0; kernelCol < mColumns; kernelCol++)
+         {
+            double weight = mKernel[kernelRow * mColumns + kernelCol];
+            if (weight == 0.0)
+            {
+               continue;
+            }
+            const double* pSource = pRow + kernelCol;
+            for (unsigned int col = 0; col < columns; col++)
+            {
+               pOut[col] += weight * pSource[col];
+            }
+         }
+      }
+   }
+}
+
+void ConvolutionFilter::filterFft(const double* pInput, unsigned int stride, unsigned int rows, unsigned int columns,
+                                  double* pOutput, std::vector<Fft::Complex>& scratch) const
+{
+   unsigned int size = mpFft->getSize();
+   unsigned int blockColumns = size - mColumns + 1;
+   unsigned int inputRows = rows + mRows - 1;
+   unsigned int inputColumns = columns + mColumns - 1;
+   scratch.resize(size * size);
+
+   // two output blocks per transform, the first in the real part and the second in the imaginary part
+   for (unsigned int firstColumn = 0; firstColumn < columns; firstColumn += 2 * blockColumns)
+   {
+      unsigned int secondColumn = firstColumn + blockColumns;
+      std::fill(scratch.begin(), scratch.end(), Fft::Complex());
+      for (unsigned int row = 0; row < inputRows; row++)
+      {
+         const double* pRow = pInput + row * stride;
+         Fft::Complex* pTile = &scratch[row * size];
+         unsigned int realCount = std::min(size, inputColumns - firstColumn);
+         for (unsigned int col = 0; col < realCount; col++)
+         {
+            pTile[col] = pRow[firstColumn + col];
+         }
+         if (secondColumn < columns)
+         {
+            unsigned int imaginaryCount = std::min(size, inputColumns - secondColumn);
+            for (unsigned int col = 0; col < imaginaryCount; col++)
+            {
+               pTile[col] = Fft::Complex(pTile[col].real(), pRow[secondColumn + col]);
+            }
+         }
+      }
+
+      mpFft->transform2d(&scratch.front(), false);
+      for (unsigned int idx = 0; idx < size * size; idx++)
+      {
+         const Fft::Complex& value = scratch[idx];
+         const Fft::Complex& weight = mSpectrum[idx];
+         scratch[idx] = Fft::Complex(value.real() * weight.real() - value.imag() * weight.imag(),
+            value.real() * weight.imag() + value.imag() * weight.real());
+      }
+      mpFft->transform2d(&scratch.front(), true);
+
+      unsigned int realColumns = std::min(blockColumns, columns - firstColumn);
+      unsigned int imaginaryColumns = (secondColumn < columns) ? std::min(blockColumns, columns - secondColumn) : 0;
+      for (unsigned int row = 0; row < rows; row++)
+      {
+         const Fft::Complex* pTile = &scratch[row * size];
+         double* pOut = pOutput + row * columns;
+         for (unsigned int col = 0; col < realColumns; col++)
+         {
+            pOut[firstColumn + col] = pTile[col].real();
+         }
+         for (unsigned int col = 0; col < imaginaryColumns; col++)
+         {
+            pOut[secondColumn + col] = pTile[col].imag();
+         }
+      }
+   }
+}
@@ -0,0 +1,119 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CONVOLUTIONFILTER_H__
+#define CONVOLUTIONFILTER_H__
+
+#include "Fft.h"
+
+#include <memory>
+#include <vector>
+
+/**
+ * Valid region 2-D correlation of a strip of rows with a fixed kernel.
+ *
+ * Output pixel (r, c) is the sum of kernel(i, j) * input(r + i, c + j) so the caller positions the
+ * kernel anchor and handles the image edges when it builds the input strip. Convolution is
+ * correlation with a flipped kernel.
+ *
+ * The direct path is a multiply-add per non-zero kernel value per pixel. The FFT path uses overlap-save
+ * on square power of 2 tiles. The kernel spectrum is computed once and, since the kernel is real,
+ * two neighboring tiles are filtered by one complex transform, one in the real part and one in the
+ * imaginary part. A filter is immutable after construction and may be shared between threads.
+ */
+class ConvolutionFilter
+{
+public:
+   /**
+    * Create a filter.
+    *
+    * @param kernel
+    *        The kernel in row major order.
+    * @param rows
+    *        The number of kernel rows.
+    * @param columns
+    *        The number of kernel columns.
+    * @param useFft
+    *        True to use the FFT path and false for the direct path.
+    */
+   ConvolutionFilter(const std::vector<double>& kernel, unsigned int rows, unsigned int columns, bool useFft);
+
+   /**
+    * Decide whether the FFT path is expected to be faster than the direct path for a kernel.
+    */
+   static bool isFftFaster(const std::vector<double>& kernel, unsigned int rows, unsigned int columns);
+
+   /**
+    * The estimated cost per output pixel of the direct path, in nanoseconds.
+    */
+   static double getDirectCost(const std::vector<double>& kernel);
+
+   /**
+    * The estimated cost per output pixel of the FFT path with the best tile size, in nanoseconds.
+    *
+    * @param tileSize
+    *        Set to the best tile size.
+    */
+   static double getFftCost(unsigned int rows, unsigned int columns, unsigned int& tileSize);
+
+   bool isFft() const
+   {
+      return mpFft.get() != NULL;
+   }
+
+   /**
+    * The maximum number of output rows filter() produces in one call.
+    */
+   unsigned int getStripRows() const;
+
+   unsigned int getKernelRows() const
+   {
+      return mRows;
+   }
+
+   unsigned int getKernelColumns() const
+   {
+      return mColumns;
+   }
+
+   /**
+    * Filter a strip.
+    *
+    * @param pInput
+    *        rows + getKernelRows() - 1 input rows of columns + getKernelColumns() - 1 values.
+    * @param stride
+    *        The distance between input rows.
+    * @param rows
+    *        The number of output rows. No more than getStripRows().
+    * @param columns
+    *        The number of output columns.
+    * @param pOutput
+    *        rows * columns output values.
+    * @param scratch
+    *        Working storage which is resized as needed. Reuse it between calls to avoid allocation.
+    */
+   void filter(const double* pInput, unsigned int stride, unsigned int rows, unsigned int columns,
+      double* pOutput, std::vector<Fft::Complex>& scratch) const;
+
+private:
+   ConvolutionFilter(const ConvolutionFilter& other);
+   ConvolutionFilter& operator=(const ConvolutionFilter& other);
+
+   void filterDirect(const double* pInput, unsigned int stride, unsigned int rows, unsigned int columns,
+      double* pOutput) const;
+   void filterFft(const double* pInput, unsigned int stride, unsigned int rows, unsigned int columns,
+      double* pOutput, std::vector<Fft::Complex>& scratch) const;
+
+   std::vector<double> mKernel;
+   unsigned int mRows;
+   unsigned int mColumns;
+   std::auto_ptr<Fft> mpFft;
+   std::vector<Fft::Complex> mSpectrum; // conjugate kernel spectrum scaled for the inverse transform
+};
+
+#endif
@@ -0,0 +1,252 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+/**
+ * Calibrate the ConvolutionFilter cost model and check the direct/FFT crossover.
+ *
+ * The first part measures the three constants at the top of ConvolutionFilter.cpp. The second part
+ * times both paths over square dense kernels, checks that they agree and compares the measured
+ * crossover with the one isFftFaster() predicts. This is not part of the plug-in build. See the
+ * Makefile in this directory.
+ */
+
+#include "ConvolutionFilter.h"
+#include "Fft.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+namespace
+{
+const unsigned int sImageRows = 512;
+const unsigned int sImageColumns = 512;
+const unsigned int sBatches = 9;
+const double sBatchSeconds = 0.05; // repeat each call for at least this long per batch
+
+double randomValue()
+{
+   return static_cast<double>(rand()) / RAND_MAX - 0.5;
+}
+
+/**
+ * Filter a whole image strip by strip the way Convolution does.
+ */
+class ImageRun
+{
+public:
+   ImageRun(const ConvolutionFilter& filter, const std::vector<double>& input, std::vector<double>& output) :
+      mFilter(filter),
+      mInput(input),
+      mOutput(output)
+   {
+   }
+
+   void operator()()
+   {
+      unsigned int stride = sImageColumns + mFilter.getKernelColumns() - 1;
+      unsigned int stripRows = mFilter.getStripRows();
+      for (unsigned int row = 0; row < sImageRows; row += stripRows)
+      {
+         unsigned int rows = std::min(stripRows, sImageRows - row);
+         mFilter.filter(&mInput[row * stride], stride, rows, sImageColumns, &mOutput[row * sImageColumns],
+            mScratch);
+      }
+   }
+
+private:
+   const ConvolutionFilter& mFilter;
+   const std::vector<double>& mInput;
+   std::vector<double>& mOutput;
+   std::vector<Fft::Complex> mScratch;
+};
+
+class TransformRun
+{
+public:
+   TransformRun(const Fft& fft, std::vector<Fft::Complex>& data) : mFft(fft), mData(data) {}
+
+   void operator()()
+   {
+      mFft.transform2d(&mData.front(), false);
+      mFft.transform2d(&mData.front(), true);
+   }
+
+private:
+   const Fft& mFft;
+   std::vector<Fft::Complex>& mData;
+};
+
+/**
+ * @return The time of one call in nanoseconds. This is the best average of several batches so
+ *         other load on the machine inflates it as little as possible.
+ */
+template<typename T>
+double timeCalls(T run)
+{
+   run(); // warm the caches and scratch buffers
+   double best = -1.0;
+   for (unsigned int batch = 0; batch < sBatches; batch++)
+   {
+      unsigned int calls = 0;
+      clock_t start = clock();
+      clock_t stop = start;
+      do
+      {
+         run();
+         calls++;
+         stop = clock();
+      }
+      while (static_cast<double>(stop - start) / CLOCKS_PER_SEC < sBatchSeconds);
+      double time = 1e9 * static_cast<double>(stop - start) / CLOCKS_PER_SEC / calls;
+      if (best < 0.0 || time < best)
+      {
+         best = time;
+      }
+   }
+   return best;
+}
+
+std::vector<double> makeKernel(unsigned int size)
+{
+   std::vector<double> kernel(size * size);
+   for (unsigned int idx = 0; idx < kernel.size(); idx++)
+   {
+      kernel[idx] = randomValue();
+   }
+   return kernel;
+}
+
+std::vector<double> makeInput(unsigned int kernelSize)
+{
+   std::vector<double> input((sImageRows + kernelSize - 1) * (sImageColumns + kernelSize - 1));
+   for (unsigned int idx = 0; idx < input.size(); idx++)
+   {
+      input[idx] = 255.0 * (randomValue() + 0.5);
+   }
+   return input;
+}
+
+void calibrate()
+{
+   printf("Cost model calibration, %ux%u image\n", sImageRows, sImageColumns);
+
+   // direct: ns per output pixel per kernel value
+   const unsigned int directSize = 9;
+   std::vector<double> kernel = makeKernel(directSize);
+   std::vector<double> input = makeInput(directSize);
+   std::vector<double> output(sImageRows * sImageColumns);
+   ConvolutionFilter direct(kernel, directSize, directSize, false);
+   double directTime = timeCalls(ImageRun(direct, input, output));
+   double multiplyAdd = directTime / (static_cast<double>(sImageRows) * sImageColumns * kernel.size());
+   printf("   sMultiplyAddCost %6.2f ns (%ux%u kernel)\n", multiplyAdd, directSize, directSize);
+
+   // Each kernel size selects a tile size. Time the two transforms of a tile for the butterfly cost
+   // and whatever else the FFT path spends per tile for the tile point cost. Small tiles are used
+   // since the per point work is the largest share of their time.
+   double butterflySum = 0.0;
+   double tilePointSum = 0.0;
+   unsigned int sizes = 0;
+   for (unsigned int kernelSize = 3; kernelSize <= 9; kernelSize += 2, sizes++)
+   {
+      unsigned int tileSize = 0;
+      ConvolutionFilter::getFftCost(kernelSize, kernelSize, tileSize);
+      Fft fft(tileSize);
+      std::vector<Fft::Complex> data(tileSize * tileSize);
+      for (unsigned int idx = 0; idx < data.size(); idx++)
+      {
+         data[idx] = Fft::Complex(randomValue(), randomValue());
+      }
+      double log2Size = log(static_cast<double>(tileSize)) / log(2.0);
+      double points = static_cast<double>(tileSize) * tileSize;
+      double transformTime = timeCalls(TransformRun(fft, data));
+      double butterfly = transformTime / (2.0 * points * log2Size);
+
+      std::vector<double> tileKernel = makeKernel(kernelSize);
+      std::vector<double> tileInput = makeInput(kernelSize);
+      ConvolutionFilter fftFilter(tileKernel, kernelSize, kernelSize, true);
+      unsigned int blockSize = tileSize - kernelSize + 1;
+      double tiles = ceil(static_cast<double>(sImageRows) / blockSize) *
+         ceil(static_cast<double>(sImageColumns) / (2.0 * blockSize));
+      double tileTime = timeCalls(ImageRun(fftFilter, tileInput, output)) / tiles;
+      double tilePoint = (tileTime - transformTime) / points;
+
+      printf("   N=%3u  sButterflyCost %6.2f ns, sTilePointCost %6.2f ns (%ux%u kernel)\n",
+         tileSize, butterfly, tilePoint, kernelSize, kernelSize);
+      butterflySum += butterfly;
+      tilePointSum += tilePoint;
+   }
+   printf("   mean sButterflyCost %.2f ns, sTilePointCost %.2f ns\n\n", butterflySum / sizes,
+      tilePointSum / sizes);
+}
+
+bool crossover()
+{
+   printf("Direct against FFT, %ux%u image, dense square kernels\n", sImageRows, sImageColumns);
+   printf("   kernel   direct ns/px   fft ns/px   tile   model direct/fft   max rel error\n");
+   unsigned int measured = 0;
+   unsigned int predicted = 0;
+   double worstError = 0.0;
+   for (unsigned int size = 3; size <= 21; size += 2)
+   {
+      std::vector<double> kernel = makeKernel(size);
+      std::vector<double> input = makeInput(size);
+      std::vector<double> directOutput(sImageRows * sImageColumns);
+      std::vector<double> fftOutput(sImageRows * sImageColumns);
+      ConvolutionFilter direct(kernel, size, size, false);
+      ConvolutionFilter fft(kernel, size, size, true);
+      double pixels = static_cast<double>(sImageRows) * sImageColumns;
+      double directTime = timeCalls(ImageRun(direct, input, directOutput)) / pixels;
+      double fftTime = timeCalls(ImageRun(fft, input, fftOutput)) / pixels;
+
+      double largest = 0.0;
+      double error = 0.0;
+      for (unsigned int idx = 0; idx < directOutput.size(); idx++)
+      {
+         largest = std::max(largest, fabs(directOutput[idx]));
+         error = std::max(error, fabs(directOutput[idx] - fftOutput[idx]));
+      }
+      error /= std::max(largest, 1e-300);
+      worstError = std::max(worstError, error);
+
+      unsigned int tileSize = 0;
+      double modelDirect = ConvolutionFilter::getDirectCost(kernel);
+      double modelFft = ConvolutionFilter::getFftCost(size, size, tileSize);
+      printf("   %2ux%-2u   %12.2f   %9.2f   %4u   %7.2f/%-7.2f   %13.2e\n", size, size, directTime, fftTime,
+         tileSize, modelDirect, modelFft, error);
+      if (measured == 0 && fftTime < directTime)
+      {
+         measured = size;
+      }
+      if (predicted == 0 && ConvolutionFilter::isFftFaster(kernel, size, size))
+      {
+         predicted = size;
+      }
+   }
+   printf("   FFT first faster at %ux%u measured, %ux%u predicted\n", measured, measured, predicted, predicted);
+   printf("   worst FFT error %.2e of the largest output\n", worstError);
+   return worstError < 1e-6;
+}
+}
+
+int main(int argc, char** argv)
+{
+   srand(1);
+   bool calibrateOnly = argc > 1 && argv[1][0] == 'c';
+   bool crossoverOnly = argc > 1 && argv[1][0] == 'x';
+   if (!crossoverOnly)
+   {
+      calibrate();
+   }
+   bool success = calibrateOnly || crossover();
+   printf(success ? "PASSED\n" : "FAILED\n");
+   return success ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "Fft.h"
+
+#include <algorithm>
+#include <math.h>
+
+Fft::Fft(unsigned int size) : mSize(size), mReverse(size), mTwiddles(size / 2)
+{
+   unsigned int bits = 0;
+   while ((1U << bits) < size)
+   {
+      bits++;
+   }
+   for (unsigned int idx = 0; idx < size; idx++)
+   {
+      unsigned int reversed = 0;
+      for (unsigned int bit = 0; bit < bits; bit++)
+      {
+         reversed |= ((idx >> bit) & 1) << (bits - 1 - bit);
+      }
+      mReverse[idx] = reversed;
+   }
+   const double pi = 3.14159265358979323846;
+   for (unsigned int idx = 0; idx < size / 2; idx++)
+   {
+      double angle = -2.0 * pi * idx / size;
+      mTwiddles[idx] = Complex(cos(angle), sin(angle));
+   }
+}
+
+void Fft::transform(Complex* pData, bool inverse) const
+{
+   for (unsigned int idx = 0; idx < mSize; idx++)
+   {
+      if (idx < mReverse[idx])
+      {
+         std::swap(pData[idx], pData[mReverse[idx]]);
+      }
+   }
+   for (unsigned int half = 1; half < mSize; half *= 2)
+   {
+      unsigned int step = mSize / (2 * half);
+      for (unsigned int start = 0; start < mSize; start += 2 * half)
+      {
+         Complex* pLow = pData + start;
+         Complex* pHigh = pLow + half;
+         for (unsigned int idx = 0; idx < half; idx++)
+         {
+            // written out since std::complex multiplication checks for infinities
+            double twiddleReal = mTwiddles[idx * step].real();
+            double twiddleImag = inverse ? -mTwiddles[idx * step].imag() : mTwiddles[idx * step].imag();
+            double productReal = pHigh[idx].real() * twiddleReal - pHigh[idx].imag() * twiddleImag;
+            double productImag = pHigh[idx].real() * twiddleImag + pHigh[idx].imag() * twiddleReal;
+            pHigh[idx] = Complex(pLow[idx].real() - productReal, pLow[idx].imag() - productImag);
+            pLow[idx] = Complex(pLow[idx].real() + productReal, pLow[idx].imag() + productImag);
+         }
+      }
+   }
+}
+
+void Fft::transform2d(Complex* pData, bool inverse) const
+{
+   // transposing keeps the column pass on contiguous memory
+   for (int pass = 0; pass < 2; pass++)
+   {
+      for (unsigned int row = 0; row < mSize; row++)
+      {
+         transform(pData + row * mSize, inverse);
+      }
+      transpose(pData);
+   }
+}
+
+void Fft::transpose(Complex* pData) const
+{
+   for (unsigned int row = 0; row < mSize; row++)
+   {
+      for (unsigned int col = row + 1; col < mSize; col++)
+      {
+         std::swap(pData[row * mSize + col], pData[col * mSize + row]);
+      }
+   }
+}
@@ -0,0 +1,58 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef FFT_H__
+#define FFT_H__
+
+#include <complex>
+#include <vector>
+
+/**
+ * A square power of 2 complex FFT.
+ *
+ * This is a plain iterative radix 2 transform with precomputed twiddle factors. It is small enough
+ * to carry with the plug-in so there is no external FFT dependency. A plan is immutable after
+ * construction and may be shared between threads.
+ */
+class Fft
+{
+public:
+   typedef std::complex<double> Complex;
+
+   /**
+    * Create a plan.
+    *
+    * @param size
+    *        The length of a side. Must be a power of 2.
+    */
+   explicit Fft(unsigned int size);
+
+   unsigned int getSize() const
+   {
+      return mSize;
+   }
+
+   /**
+    * Transform one row of getSize() values in place. The inverse is not scaled.
+    */
+   void transform(Complex* pData, bool inverse) const;
+
+   /**
+    * Transform a getSize() x getSize() row major array in place. The inverse is not scaled.
+    */
+   void transform2d(Complex* pData, bool inverse) const;
+
+private:
+   void transpose(Complex* pData) const;
+
+   unsigned int mSize;
+   std::vector<unsigned int> mReverse; // bit reversed index for each index
+   std::vector<Complex> mTwiddles; // exp(-2 pi i k / size) for k < size / 2
+};
+
+#endif
@@ -0,0 +1,10 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "PlugInRegistration.h"
+REGISTER_MODULE(ConvolutionModule);
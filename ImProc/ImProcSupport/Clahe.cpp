@@ -0,0 +1,551 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "Clahe.h"
+#include "ClaheDialog.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilities.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+
+#include <algorithm>
+#include <string.h>
+
+REGISTER_PLUGIN_BASIC(ImProcSupport, Clahe);
+
+namespace
+{
+   template<typename T>
+   void accumulateValues(const T* pData, unsigned int first, unsigned int last, unsigned int maxValue,
+                         unsigned int* pHistogram)
+   {
+      for (unsigned int col = first; col < last; col++)
+      {
+         unsigned int value = static_cast<unsigned int>(pData[col]);
+         pHistogram[std::min(value, maxValue)]++;
+      }
+   }
+
+   /**
+    * Clip a tile histogram, redistribute the excess and turn it into an equalization mapping.
+    */
+   void computeMapping(unsigned int* pHistogram, unsigned int bins, unsigned int pixelCount, double clipLimit,
+                       unsigned short* pMapping)
+   {
+      if (pixelCount == 0)
+      {
+         for (unsigned int bin = 0; bin < bins; bin++)
+         {
+            pMapping[bin] = static_cast<unsigned short>(bin);
+         }
+         return;
+      }
+      if (clipLimit > 0.0)
+      {
+         // the limit is a multiple of the mean bin count
+         unsigned int limit = std::max(1U, static_cast<unsigned int>(clipLimit * pixelCount / bins));
+         unsigned int excess = 0;
+         for (unsigned int bin = 0; bin < bins; bin++)
+         {
+            if (pHistogram[bin] > limit)
+            {
+               excess += pHistogram[bin] - limit;
+               pHistogram[bin] = limit;
+            }
+         }
+         unsigned int increment = excess / bins;
+         unsigned int remainder = excess % bins;
+         for (unsigned int bin = 0; bin < bins; bin++)
+         {
+            pHistogram[bin] += increment;
+         }
+         if (remainder > 0)
+         {
+            unsigned int step = bins / remainder;
+            for (unsigned int bin = 0; bin < bins && remainder > 0; bin += step, remainder--)
+            {
+               pHistogram[bin]++;
+            }
+         }
+      }
+      double scale = static_cast<double>(bins - 1) / pixelCount;
+      unsigned int sum = 0;
+      for (unsigned int bin = 0; bin < bins; bin++)
+      {
+         sum += pHistogram[bin];
+         pMapping[bin] = static_cast<unsigned short>(std::min(bins - 1.0, sum * scale + 0.5));
+      }
+   }
+
+   /**
+    * Locate a pixel between tile centers.
+    */
+   void locate(unsigned int idx, const std::vector<double>& centers, unsigned int& low, unsigned int& high,
+               float& weight)
+   {
+      high = 0;
+      while (high < centers.size() && centers[high] <= idx)
+      {
+         high++;
+      }
+      if (high == 0 || high == centers.size())
+      {
+         // outside the outermost tile centers a single mapping is used
+         low = high = std::min<unsigned int>(high, centers.size() - 1);
+         weight = 0.0f;
+         return;
+      }
+      low = high - 1;
+      weight = static_cast<float>((idx - centers[low]) / (centers[high] - centers[low]));
+   }
+
+   std::vector<double> getTileCenters(unsigned int tileCount, unsigned int size)
+   {
+      std::vector<double> centers(tileCount);
+      for (unsigned int tile = 0; tile < tileCount; tile++)
+      {
+         unsigned int start = static_cast<unsigned int>(static_cast<unsigned long long>(tile) * size / tileCount);
+         unsigned int end = static_cast<unsigned int>(static_cast<unsigned long long>(tile + 1) * size / tileCount);
+         centers[tile] = (start + end - 1) / 2.0;
+      }
+      return centers;
+   }
+
+   /**
+    * Replace a row of values in place with the interpolated mappings.
+    */
+   template<typename T>
+   void equalizeValues(T* pData, unsigned int columns, unsigned int maxValue, const unsigned short* pTop,
+                       const unsigned short* pBottom, float rowWeight, const std::vector<unsigned int>& lowTiles,
+                       const std::vector<unsigned int>& highTiles, const std::vector<float>& columnWeights,
+                       unsigned int bins)
+   {
+      for (unsigned int col = 0; col < columns; col++)
+      {
+         unsigned int value = std::min(static_cast<unsigned int>(pData[col]), maxValue);
+         unsigned int low = lowTiles[col] * bins + value;
+         unsigned int high = highTiles[col] * bins + value;
+         float weight = columnWeights[col];
+         float top = pTop[low] + weight * (pTop[high] - pTop[low]);
+         float bottom = pBottom[low] + weight * (pBottom[high] - pBottom[low]);
+         pData[col] = static_cast<T>(top + rowWeight * (bottom - top) + 0.5f);
+      }
+   }
+}
+
+Clahe::Clahe() :
+   mAbortFlag(false)
+{
+   setName("Clahe");
+   setDescription("Contrast limited adaptive histogram equalization.");
+   setDescriptorId("{3C6B2958-44E3-42D1-9981-543E56D9ECCD}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Adaptive Histogram Equalization");
+}
+
+Clahe::~Clahe()
+{
+}
+
+bool Clahe::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   VERIFY(pInArgList->addArg<unsigned int>("Tile Rows", mInput.mTileRows, "The number of rows of tiles."));
+   VERIFY(pInArgList->addArg<unsigned int>("Tile Columns", mInput.mTileColumns, "The number of columns of tiles."));
+   VERIFY(pInArgList->addArg<double>("Clip Limit", mInput.mClipLimit,
+      "The maximum histogram bin count as a multiple of the mean bin count. 0 disables clipping."));
+   VERIFY(pInArgList->addArg<unsigned int>("Bit Depth", mInput.mBitDepth,
+      "The number of significant bits: 8, 12 or 16. 0 uses the size of the data type."));
+   return true;
+}
+
+bool Clahe::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool Clahe::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin adaptive histogram equalization.", 1, NORMAL);
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), mInput.mpDescriptor->getBandCount(),
+      mInput.mpDescriptor->getDataType(), BSQ, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   mInput.mpAbortFlag = &mAbortFlag;
+   mMappings.resize(mInput.mTileRows * mInput.mTileColumns * (1 << mInput.mBitDepth));
+   mInput.mpMappings = &mMappings;
+
+   for (mInput.mBand = 0; mInput.mBand < mInput.mpDescriptor->getBandCount(); mInput.mBand++)
+   {
+      std::string bandText = " band " + StringUtilities::toDisplayString(mInput.mBand + 1);
+      HistogramThreadOutput histogramData;
+      mta::ProgressObjectReporter histogramReporter("Building tile histograms for" + bandText,
+         mProgress.getCurrentProgress());
+      mta::MultiThreadedAlgorithm<ClaheThreadInput, HistogramThreadOutput, HistogramThread>
+            histogramAlg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, histogramData,
+            &histogramReporter);
+      switch(histogramAlg.run())
+      {
+      case mta::SUCCESS:
+         if (!mAbortFlag)
+         {
+            break;
+         }
+         // fall through
+      case mta::ABORT:
+         mProgress.report("Adaptive histogram equalization aborted.", 0, ABORT, true);
+         return false;
+      case mta::FAILURE:
+         mProgress.report("Adaptive histogram equalization failed.", 0, ERRORS, true);
+         return false;
+      }
+
+      MappingThreadOutput mappingData;
+      mta::ProgressObjectReporter mappingReporter("Equalizing" + bandText, mProgress.getCurrentProgress());
+      mta::MultiThreadedAlgorithm<ClaheThreadInput, MappingThreadOutput, MappingThread>
+            mappingAlg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, mappingData,
+            &mappingReporter);
+      switch(mappingAlg.run())
+      {
+      case mta::SUCCESS:
+         if (!mAbortFlag)
+         {
+            break;
+         }
+         // fall through
+      case mta::ABORT:
+         mProgress.report("Adaptive histogram equalization aborted.", 0, ABORT, true);
+         return false;
+      case mta::FAILURE:
+         mProgress.report("Adaptive histogram equalization failed.", 0, ERRORS, true);
+         return false;
+      }
+   }
+
+   mProgress.report("Adaptive histogram equalization complete.", 100, NORMAL);
+   if (!displayResult())
+   {
+      return false;
+   }
+   pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+   pResult.release();
+   mProgress.upALevel();
+   return true;
+}
+
+bool Clahe::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{CD979617-00AE-4C00-8EA0-660E25B3936E}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   if (encoding != INT1UBYTE && encoding != INT2UBYTES)
+   {
+      mProgress.report("Only unsigned 8 and 16 bit data is supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+   pInArgList->getPlugInArgValue("Tile Rows", mInput.mTileRows);
+   pInArgList->getPlugInArgValue("Tile Columns", mInput.mTileColumns);
+   pInArgList->getPlugInArgValue("Clip Limit", mInput.mClipLimit);
+   pInArgList->getPlugInArgValue("Bit Depth", mInput.mBitDepth);
+   if (mInput.mBitDepth == 0)
+   {
+      mInput.mBitDepth = (encoding == INT1UBYTE) ? 8 : 16;
+   }
+   if (!isBatch())
+   {
+      ClaheDialog dlg(encoding == INT2UBYTES);
+      dlg.setTileRows(mInput.mTileRows);
+      dlg.setTileColumns(mInput.mTileColumns);
+      dlg.setClipLimit(mInput.mClipLimit);
+      dlg.setBitDepth(mInput.mBitDepth);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mInput.mTileRows = dlg.getTileRows();
+      mInput.mTileColumns = dlg.getTileColumns();
+      mInput.mClipLimit = dlg.getClipLimit();
+      mInput.mBitDepth = dlg.getBitDepth();
+   }
+
+   if ((encoding == INT1UBYTE && mInput.mBitDepth != 8) ||
+      (encoding == INT2UBYTES && mInput.mBitDepth != 12 && mInput.mBitDepth != 16))
+   {
+      mProgress.report("The bit depth must be 8 for 8 bit data and 12 or 16 for 16 bit data.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mTileRows = std::max(1U, std::min(mInput.mTileRows, mInput.mpDescriptor->getRowCount()));
+   mInput.mTileColumns = std::max(1U, std::min(mInput.mTileColumns, mInput.mpDescriptor->getColumnCount()));
+
+   return true;
+}
+
+bool Clahe::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+Clahe::HistogramThread::HistogramThread(
+   const ClaheThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mTileRowRange(getThreadRange(threadCount, input.mTileRows))
+{
+}
+
+void Clahe::HistogramThread::run()
+{
+   if (mInput.mpMappings == NULL)
+   {
+      getReporter().reportError("No mapping storage.");
+      return;
+   }
+
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   unsigned int numRows = mInput.mpDescriptor->getRowCount();
+   unsigned int numCols = mInput.mpDescriptor->getColumnCount();
+   unsigned int bins = 1 << mInput.mBitDepth;
+   std::vector<unsigned int> histograms(mInput.mTileColumns * bins);
+   std::vector<unsigned int> columnStarts(mInput.mTileColumns + 1);
+   for (unsigned int tileCol = 0; tileCol <= mInput.mTileColumns; tileCol++)
+   {
+      columnStarts[tileCol] = ClaheThreadInput::getTileStart(tileCol, mInput.mTileColumns, numCols);
+   }
+
+   int oldPercentDone = 0;
+   for (int tileRow = mTileRowRange.mFirst; tileRow <= mTileRowRange.mLast; tileRow++)
+   {
+      int percentDone = mTileRowRange.computePercent(tileRow);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         getReporter().reportProgress(getThreadIndex(), 100);
+         break;
+      }
+
+      unsigned int firstRow = ClaheThreadInput::getTileStart(tileRow, mInput.mTileRows, numRows);
+      unsigned int endRow = ClaheThreadInput::getTileStart(tileRow + 1, mInput.mTileRows, numRows);
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setRows(mInput.mpDescriptor->getActiveRow(firstRow), mInput.mpDescriptor->getActiveRow(endRow - 1));
+      pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0), mInput.mpDescriptor->getActiveColumn(numCols - 1));
+      pRequest->setBands(mInput.mpDescriptor->getActiveBand(mInput.mBand),
+         mInput.mpDescriptor->getActiveBand(mInput.mBand));
+      pRequest->setInterleaveFormat(BSQ);
+      DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+      std::fill(histograms.begin(), histograms.end(), 0);
+      for (unsigned int row = firstRow; row < endRow; row++)
+      {
+         if (!accessor.isValid())
+         {
+            getReporter().reportError("Invalid data access.");
+            return;
+         }
+         for (unsigned int tileCol = 0; tileCol < mInput.mTileColumns; tileCol++)
+         {
+            switchOnEncoding(encoding, accumulateValues, accessor->getRow(), columnStarts[tileCol],
+               columnStarts[tileCol + 1], bins - 1, &histograms[tileCol * bins]);
+         }
+         accessor->nextRow();
+      }
+      for (unsigned int tileCol = 0; tileCol < mInput.mTileColumns; tileCol++)
+      {
+         unsigned int pixelCount = (endRow - firstRow) * (columnStarts[tileCol + 1] - columnStarts[tileCol]);
+         computeMapping(&histograms[tileCol * bins], bins, pixelCount, mInput.mClipLimit,
+            &(*mInput.mpMappings)[(tileRow * mInput.mTileColumns + tileCol) * bins]);
+      }
+   }
+
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+bool Clahe::HistogramThreadOutput::compileOverallResults(const std::vector<HistogramThread*>& threads)
+{
+   return true;
+}
+
+Clahe::MappingThread::MappingThread(
+   const ClaheThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void Clahe::MappingThread::run()
+{
+   if (mInput.mpResult == NULL || mInput.mpMappings == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   EncodingType encoding = mInput.mpResultDescriptor->getDataType();
+   unsigned int numRows = mInput.mpDescriptor->getRowCount();
+   unsigned int numCols = mInput.mpDescriptor->getColumnCount();
+   unsigned int rowBytes = numCols * mInput.mpDescriptor->getBytesPerElement();
+   unsigned int bins = 1 << mInput.mBitDepth;
+   const unsigned short* pMappings = &mInput.mpMappings->front();
+
+   std::vector<double> rowCenters = getTileCenters(mInput.mTileRows, numRows);
+   std::vector<double> columnCenters = getTileCenters(mInput.mTileColumns, numCols);
+   std::vector<unsigned int> lowTiles(numCols);
+   std::vector<unsigned int> highTiles(numCols);
+   std::vector<float> columnWeights(numCols);
+   for (unsigned int col = 0; col < numCols; col++)
+   {
+      locate(col, columnCenters, lowTiles[col], highTiles[col], columnWeights[col]);
+   }
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setRows(mInput.mpDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpDescriptor->getActiveRow(mRowRange.mLast));
+   pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0), mInput.mpDescriptor->getActiveColumn(numCols - 1));
+   pRequest->setBands(mInput.mpDescriptor->getActiveBand(mInput.mBand), mInput.mpDescriptor->getActiveBand(mInput.mBand));
+   pRequest->setInterleaveFormat(BSQ);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast));
+   pResultRequest->setColumns(mInput.mpResultDescriptor->getActiveColumn(0),
+      mInput.mpResultDescriptor->getActiveColumn(numCols - 1));
+   pResultRequest->setBands(mInput.mpResultDescriptor->getActiveBand(mInput.mBand),
+      mInput.mpResultDescriptor->getActiveBand(mInput.mBand));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+
+   int oldPercentDone = 0;
+   for (int row = mRowRange.mFirst; row <= mRowRange.mLast; row++)
+   {
+      int percentDone = mRowRange.computePercent(row);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         getReporter().reportProgress(getThreadIndex(), 100);
+         break;
+      }
+      if (!accessor.isValid() || !resultAccessor.isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+
+      unsigned int topTile = 0;
+      unsigned int bottomTile = 0;
+      float rowWeight = 0.0f;
+      locate(row, rowCenters, topTile, bottomTile, rowWeight);
+      memcpy(resultAccessor->getRow(), accessor->getRow(), rowBytes);
+      switchOnEncoding(encoding, equalizeValues, resultAccessor->getRow(), numCols, bins - 1,
+         pMappings + topTile * mInput.mTileColumns * bins, pMappings + bottomTile * mInput.mTileColumns * bins,
+         rowWeight, lowTiles, highTiles, columnWeights, bins);
+      accessor->nextRow();
+      resultAccessor->nextRow();
+   }
+
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+bool Clahe::MappingThreadOutput::compileOverallResults(const std::vector<MappingThread*>& threads)
+{
+   return true;
+}
@@ -0,0 +1,118 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CLAHE_H__
+#define CLAHE_H__
+
+#include "AlgorithmShell.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+
+#include <vector>
+
+/**
+ * Contrast limited adaptive histogram equalization.
+ *
+ * The image is divided into a grid of tiles. The first pass builds a clipped histogram and
+ * an equalization mapping for each tile, with threads splitting the rows of tiles. The second
+ * pass streams the rows and bilinearly interpolates between the mappings of the four nearest
+ * tile centers. Bands are processed one at a time so only one band of mappings is held.
+ *
+ * Unsigned 8 and 16 bit data is processed natively with one histogram bin per value; 12 bit
+ * data stored in 16 bits uses 4096 bins. The result has the input data type.
+ */
+class Clahe : public AlgorithmShell
+{
+public:
+   Clahe();
+   virtual ~Clahe();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   struct ClaheThreadInput
+   {
+      ClaheThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL),
+         mBand(0), mTileRows(8), mTileColumns(8), mClipLimit(2.0), mBitDepth(0), mpMappings(NULL),
+         mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      unsigned int mBand;
+      unsigned int mTileRows;
+      unsigned int mTileColumns;
+      double mClipLimit;
+      unsigned int mBitDepth;
+
+      /**
+       * The mappings of the current band for each tile row, tile column and value in that order.
+       * The histogram pass writes disjoint ranges and the mapping pass reads them.
+       */
+      std::vector<unsigned short>* mpMappings;
+      const bool* mpAbortFlag;
+
+      /**
+       * The first image row or column of a tile; tile + 1 gives the end.
+       */
+      static unsigned int getTileStart(unsigned int tile, unsigned int tileCount, unsigned int size)
+      {
+         return static_cast<unsigned int>(static_cast<unsigned long long>(tile) * size / tileCount);
+      }
+   };
+
+   class HistogramThread : public mta::AlgorithmThread
+   {
+   public:
+      HistogramThread(const ClaheThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      const ClaheThreadInput &mInput;
+      mta::AlgorithmThread::Range mTileRowRange;
+   };
+
+   struct HistogramThreadOutput
+   {
+      bool compileOverallResults(const std::vector<HistogramThread*> &threads);
+   };
+
+   class MappingThread : public mta::AlgorithmThread
+   {
+   public:
+      MappingThread(const ClaheThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      const ClaheThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct MappingThreadOutput
+   {
+      bool compileOverallResults(const std::vector<MappingThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   ClaheThreadInput mInput;
+   std::string mResultName;
+   std::vector<unsigned short> mMappings;
+   bool mAbortFlag;
+};
+
+#endif
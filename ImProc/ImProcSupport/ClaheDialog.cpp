@@ -0,0 +1,108 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ClaheDialog.h"
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QSpinBox>
+
+ClaheDialog::ClaheDialog(bool sixteenBit, QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pTileRowsLabel = new QLabel("Tile Rows:", this);
+   mpTileRows = new QSpinBox(this);
+   mpTileRows->setRange(1, 256);
+   QLabel* pTileColumnsLabel = new QLabel("Tile Columns:", this);
+   mpTileColumns = new QSpinBox(this);
+   mpTileColumns->setRange(1, 256);
+   QLabel* pClipLimitLabel = new QLabel("Clip Limit:", this);
+   mpClipLimit = new QDoubleSpinBox(this);
+   mpClipLimit->setRange(0.0, 1000.0);
+   mpClipLimit->setDecimals(2);
+   mpClipLimit->setSingleStep(0.5);
+   mpClipLimit->setSpecialValueText("No clipping");
+   mpClipLimit->setToolTip("Maximum histogram bin count as a multiple of the mean bin count.");
+   QLabel* pBitDepthLabel = new QLabel("Bit Depth:", this);
+   mpBitDepth = new QComboBox(this);
+   mpBitDepth->setEditable(false);
+   if (sixteenBit)
+   {
+      mpBitDepth->addItem("12", 12);
+      mpBitDepth->addItem("16", 16);
+   }
+   else
+   {
+      mpBitDepth->addItem("8", 8);
+   }
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pTileRowsLabel, 0, 0);
+   pTopLevel->addWidget(mpTileRows, 0, 1);
+   pTopLevel->addWidget(pTileColumnsLabel, 1, 0);
+   pTopLevel->addWidget(mpTileColumns, 1, 1);
+   pTopLevel->addWidget(pClipLimitLabel, 2, 0);
+   pTopLevel->addWidget(mpClipLimit, 2, 1);
+   pTopLevel->addWidget(pBitDepthLabel, 3, 0);
+   pTopLevel->addWidget(mpBitDepth, 3, 1);
+   pTopLevel->addWidget(pButtons, 4, 0, 1, 2);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+ClaheDialog::~ClaheDialog()
+{
+}
+
+unsigned int ClaheDialog::getTileRows() const
+{
+   return static_cast<unsigned int>(mpTileRows->value());
+}
+
+unsigned int ClaheDialog::getTileColumns() const
+{
+   return static_cast<unsigned int>(mpTileColumns->value());
+}
+
+double ClaheDialog::getClipLimit() const
+{
+   return mpClipLimit->value();
+}
+
+unsigned int ClaheDialog::getBitDepth() const
+{
+   return mpBitDepth->itemData(mpBitDepth->currentIndex()).toUInt();
+}
+
+void ClaheDialog::setTileRows(unsigned int rows)
+{
+   mpTileRows->setValue(static_cast<int>(rows));
+}
+
+void ClaheDialog::setTileColumns(unsigned int columns)
+{
+   mpTileColumns->setValue(static_cast<int>(columns));
+}
+
+void ClaheDialog::setClipLimit(double limit)
+{
+   mpClipLimit->setValue(limit);
+}
+
+void ClaheDialog::setBitDepth(unsigned int bits)
+{
+   int idx = mpBitDepth->findData(bits);
+   if (idx >= 0)
+   {
+      mpBitDepth->setCurrentIndex(idx);
+   }
+}
@@ -0,0 +1,42 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef CLAHEDIALOG_H
+#define CLAHEDIALOG_H
+
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+class ClaheDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   ClaheDialog(bool sixteenBit, QWidget* pParent=NULL);
+   virtual ~ClaheDialog();
+
+   unsigned int getTileRows() const;
+   unsigned int getTileColumns() const;
+   double getClipLimit() const;
+   unsigned int getBitDepth() const;
+   void setTileRows(unsigned int rows);
+   void setTileColumns(unsigned int columns);
+   void setClipLimit(double limit);
+   void setBitDepth(unsigned int bits);
+
+private:
+   QSpinBox* mpTileRows;
+   QSpinBox* mpTileColumns;
+   QDoubleSpinBox* mpClipLimit;
+   QComboBox* mpBitDepth;
+};
+
+#endif
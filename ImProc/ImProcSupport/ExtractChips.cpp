@@ -0,0 +1,464 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AoiElement.h"
+#include "AppVerify.h"
+#include "BitMask.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "DimensionDescriptor.h"
+#include "Endian.h"
+#include "ExtractChips.h"
+#include "ExtractChipsDialog.h"
+#include "Filename.h"
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "switchOnEncoding.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(ImProcSupport, ExtractChips);
+
+ExtractChips::ExtractChips() :
+   mpRaster(NULL),
+   mpDescriptor(NULL),
+   mChipSize(128),
+   mDecimation(1),
+   mStride(0),
+   mAbortFlag(false)
+{
+   setName("ExtractChips");
+   setDescription("Extract chips around a list of pixels or inside an AOI into a single file.");
+   setDescriptorId("{D2750E4B-8A16-4C3F-B0E9-7F5A41C9263D}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Extract Chips");
+}
+
+ExtractChips::~ExtractChips()
+{
+}
+
+bool ExtractChips::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<Filename>("Output File", NULL,
+      "The chip file. The ENVI header and CSV index are written next to it with .hdr and .csv appended."));
+   VERIFY(pInArgList->addArg<std::vector<unsigned int> >("Chip Centers", std::vector<unsigned int>(),
+      "Row and column pairs of active pixel numbers. Used instead of the AOI when not empty."));
+   VERIFY(pInArgList->addArg<AoiElement>("AOI", NULL, "Chips are centered on the AOI pixels in a grid with the chip stride."));
+   VERIFY(pInArgList->addArg<std::vector<unsigned int> >("Bands", std::vector<unsigned int>(),
+      "Active band numbers to extract. Empty for every band."));
+   VERIFY(pInArgList->addArg<unsigned int>("Chip Size", mChipSize, "Chip width and height in output pixels."));
+   VERIFY(pInArgList->addArg<unsigned int>("Decimation", mDecimation,
+      "Each chip pixel is the mean of a block of this many source pixels on a side."));
+   VERIFY(pInArgList->addArg<unsigned int>("Chip Stride", mStride,
+      "Source pixels between AOI chip centers. 0 places the chips edge to edge."));
+   return true;
+}
+
+bool ExtractChips::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<unsigned int>("Chip Count", "The number of chips written."));
+   return true;
+}
+
+bool ExtractChips::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin chip extraction.", 1, NORMAL);
+   QFile file(QString::fromStdString(mFilename));
+   if (!file.open(QFile::WriteOnly | QFile::Truncate))
+   {
+      mProgress.report("Unable to open " + mFilename + " for writing.", 0, ERRORS, true);
+      return false;
+   }
+   if (!sweep(file))
+   {
+      file.remove();
+      return false;
+   }
+   file.close();
+   if (!writeHeader(mFilename + ".hdr") || !writeIndex(mFilename + ".csv"))
+   {
+      return false;
+   }
+
+   unsigned int chipCount = mChips.size();
+   pOutArgList->setPlugInArgValue("Chip Count", &chipCount);
+   mProgress.report("Extracted " + StringUtilities::toDisplayString(chipCount) + " chips.", 100, NORMAL);
+   mProgress.upALevel();
+   return true;
+}
+
+bool ExtractChips::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{6F83C1A0-2B7D-4E59-A4C6-0D9E8B3F5172}");
+   if ((mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mpDescriptor = static_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   EncodingType encoding = mpDescriptor->getDataType();
+   if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   Filename* pFilename = pInArgList->getPlugInArgValue<Filename>("Output File");
+   if (pFilename != NULL)
+   {
+      mFilename = pFilename->getFullPathAndName();
+   }
+   std::vector<unsigned int> centers;
+   pInArgList->getPlugInArgValue("Chip Centers", centers);
+   AoiElement* pAoi = pInArgList->getPlugInArgValue<AoiElement>("AOI");
+   pInArgList->getPlugInArgValue("Bands", mBands);
+   pInArgList->getPlugInArgValue("Chip Size", mChipSize);
+   pInArgList->getPlugInArgValue("Decimation", mDecimation);
+   pInArgList->getPlugInArgValue("Chip Stride", mStride);
+
+   if (!isBatch())
+   {
+      ExtractChipsDialog dlg(mpRaster);
+      dlg.setFilename(mFilename);
+      dlg.setAoi(pAoi);
+      dlg.setChipSize(mChipSize);
+      dlg.setDecimation(mDecimation);
+      dlg.setStride(mStride);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mFilename = dlg.getFilename();
+      pAoi = dlg.getAoi();
+      mChipSize = dlg.getChipSize();
+      mDecimation = dlg.getDecimation();
+      mStride = dlg.getStride();
+   }
+   if (mFilename.empty())
+   {
+      mProgress.report("No output file.", 0, ERRORS, true);
+      return false;
+   }
+   if (mChipSize == 0 || mDecimation == 0)
+   {
+      mProgress.report("The chip size and decimation must be at least 1.", 0, ERRORS, true);
+      return false;
+   }
+   if (mBands.empty())
+   {
+      for (unsigned int band = 0; band < mpDescriptor->getBandCount(); band++)
+      {
+         mBands.push_back(band);
+      }
+   }
+   for (std::vector<unsigned int>::const_iterator band = mBands.begin(); band != mBands.end(); ++band)
+   {
+      if (*band >= mpDescriptor->getBandCount())
+      {
+         mProgress.report("Invalid band " + StringUtilities::toDisplayString(*band) + ".", 0, ERRORS, true);
+         return false;
+      }
+   }
+   return createChips(centers, pAoi);
+}
+
+bool ExtractChips::createChips(const std::vector<unsigned int>& centers, AoiElement* pAoi)
+{
+   unsigned int rows = mpDescriptor->getRowCount();
+   unsigned int columns = mpDescriptor->getColumnCount();
+   std::vector<std::pair<unsigned int, unsigned int> > locations;
+   if (!centers.empty())
+   {
+      if (centers.size() % 2 != 0)
+      {
+         mProgress.report("Chip centers must be row and column pairs.", 0, ERRORS, true);
+         return false;
+      }
+      for (unsigned int idx = 0; idx < centers.size(); idx += 2)
+      {
+         locations.push_back(std::make_pair(centers[idx], centers[idx + 1]));
+      }
+   }
+   else
+   {
+      const BitMask* pMask = (pAoi == NULL) ? NULL : pAoi->getSelectedPoints();
+      if (pMask == NULL)
+      {
+         mProgress.report("No chip centers or AOI.", 0, ERRORS, true);
+         return false;
+      }
+      int x1 = 0;
+      int y1 = 0;
+      int x2 = columns - 1;
+      int y2 = rows - 1;
+      if (!pMask->isOutsideSelected())
+      {
+         pMask->getBoundingBox(x1, y1, x2, y2);
+      }
+      unsigned int stride = (mStride == 0) ? mChipSize * mDecimation : mStride;
+      for (int y = std::max(y1, 0); y <= std::min(y2, static_cast<int>(rows) - 1); y += stride)
+      {
+         for (int x = std::max(x1, 0); x <= std::min(x2, static_cast<int>(columns) - 1); x += stride)
+         {
+            if (pMask->getPixel(x, y))
+            {
+               locations.push_back(std::make_pair(static_cast<unsigned int>(y), static_cast<unsigned int>(x)));
+            }
+         }
+      }
+   }
+
+   unsigned int footprint = mChipSize * mDecimation;
+   unsigned int dropped = 0;
+   mChips.clear();
+   for (std::vector<std::pair<unsigned int, unsigned int> >::const_iterator location = locations.begin();
+      location != locations.end(); ++location)
+   {
+      Chip chip;
+      chip.mCenterRow = location->first;
+      chip.mCenterColumn = location->second;
+      if (chip.mCenterRow < footprint / 2 || chip.mCenterColumn < footprint / 2 ||
+          chip.mCenterRow - footprint / 2 + footprint > rows || chip.mCenterColumn - footprint / 2 + footprint > columns)
+      {
+         dropped++;
+         continue;
+      }
+      chip.mFirstRow = chip.mCenterRow - footprint / 2;
+      chip.mFirstColumn = chip.mCenterColumn - footprint / 2;
+      mChips.push_back(chip);
+   }
+   if (dropped > 0)
+   {
+      mProgress.report(StringUtilities::toDisplayString(dropped) + " chips extend past the scene and were skipped.",
+         1, WARNING, true);
+   }
+   if (mChips.empty())
+   {
+      mProgress.report("No chips fit in the scene.", 0, ERRORS, true);
+      return false;
+   }
+
+   // sorting by row turns the reads into one sweep and, with a common footprint, puts the chips in completion order
+   std::stable_sort(mChips.begin(), mChips.end());
+   return true;
+}
+
+bool ExtractChips::sweep(QFile& file)
+{
+   EncodingType encoding = mpDescriptor->getDataType();
+   unsigned int footprint = mChipSize * mDecimation;
+   unsigned int firstRow = mChips.front().mFirstRow;
+   unsigned int lastRow = mChips.back().mFirstRow + footprint - 1;
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   pRequest->setRows(mpDescriptor->getActiveRow(firstRow), mpDescriptor->getActiveRow(lastRow));
+   DataAccessor accessor = mpRaster->getDataAccessor(pRequest.release());
+   if (!accessor.isValid())
+   {
+      mProgress.report("Unable to access the data.", 0, ERRORS, true);
+      return false;
+   }
+
+   std::vector<char> chipBuffer(mChipSize * mChipSize * mBands.size() * mpDescriptor->getBytesPerElement());
+   void* pChipBuffer = &chipBuffer.front();
+   unsigned int nextChip = 0; // chips before this one have been started
+   unsigned int doneChip = 0; // chips before this one have been written
+   unsigned int row = firstRow;
+   int oldPercentDone = 0;
+   while (doneChip < mChips.size())
+   {
+      if (mAbortFlag)
+      {
+         mProgress.report("Chip extraction aborted.", 0, ABORT, true);
+         return false;
+      }
+      if (doneChip == nextChip && row < mChips[nextChip].mFirstRow)
+      {
+         // skip the rows between chips
+         row = mChips[nextChip].mFirstRow;
+         accessor->toPixel(row, 0);
+      }
+      if (!accessor.isValid())
+      {
+         mProgress.report("Unable to access the data.", 0, ERRORS, true);
+         return false;
+      }
+      while (nextChip < mChips.size() && mChips[nextChip].mFirstRow <= row)
+      {
+         mChips[nextChip++].mSums.assign(mChipSize * mChipSize * mBands.size(), 0.0);
+      }
+      for (unsigned int chip = doneChip; chip < nextChip; chip++)
+      {
+         switchOnEncoding(encoding, accumulateRow, accessor->getRow(), mChips[chip], row);
+      }
+      while (doneChip < nextChip && mChips[doneChip].mFirstRow + footprint - 1 == row)
+      {
+         switchOnEncoding(encoding, storeChip, pChipBuffer, mChips[doneChip]);
+         std::vector<double>().swap(mChips[doneChip].mSums);
+         if (file.write(&chipBuffer.front(), chipBuffer.size()) != static_cast<qint64>(chipBuffer.size()))
+         {
+            mProgress.report("Unable to write " + mFilename + ".", 0, ERRORS, true);
+            return false;
+         }
+         doneChip++;
+      }
+      int percentDone = 1 + 98 * (row - firstRow) / (lastRow - firstRow + 1);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         mProgress.report("Extracting chips", percentDone, NORMAL);
+      }
+      accessor->nextRow();
+      row++;
+   }
+   return true;
+}
+
+template<typename T>
+void ExtractChips::accumulateRow(const T* pRow, Chip& chip, unsigned int row)
+{
+   unsigned int bandCount = mpDescriptor->getBandCount();
+   unsigned int chipBands = mBands.size();
+   double* pSums = &chip.mSums[(row - chip.mFirstRow) / mDecimation * mChipSize * chipBands];
+   const T* pPixel = pRow + chip.mFirstColumn * bandCount;
+   for (unsigned int column = 0; column < mChipSize; column++)
+   {
+      for (unsigned int block = 0; block < mDecimation; block++)
+      {
+         for (unsigned int band = 0; band < chipBands; band++)
+         {
+            pSums[band] += pPixel[mBands[band]];
+         }
+         pPixel += bandCount;
+      }
+      pSums += chipBands;
+   }
+}
+
+template<typename T>
+void ExtractChips::storeChip(T* pChip, const Chip& chip)
+{
+   double scale = 1.0 / (mDecimation * mDecimation);
+   for (unsigned int idx = 0; idx < chip.mSums.size(); idx++)
+   {
+      double value = chip.mSums[idx] * scale;
+      if (std::numeric_limits<T>::is_integer)
+      {
+         value = floor(value + 0.5);
+      }
+      pChip[idx] = static_cast<T>(value);
+   }
+}
+
+bool ExtractChips::writeHeader(const std::string& filename)
+{
+   int dataType = 0;
+   switch (mpDescriptor->getDataType())
+   {
+   case INT1UBYTE:
+      dataType = 1;
+      break;
+   case INT2SBYTES:
+      dataType = 2;
+      break;
+   case INT4SBYTES:
+      dataType = 3;
+      break;
+   case FLT4BYTES:
+      dataType = 4;
+      break;
+   case FLT8BYTES:
+      dataType = 5;
+      break;
+   case INT2UBYTES:
+      dataType = 12;
+      break;
+   case INT4UBYTES:
+      dataType = 13;
+      break;
+   default:
+      mProgress.report("ENVI has no data type for the encoding so no header was written.", 99, WARNING, true);
+      return true;
+   }
+
+   QFile file(QString::fromStdString(filename));
+   if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+   {
+      mProgress.report("Unable to open " + filename + " for writing.", 0, ERRORS, true);
+      return false;
+   }
+   QTextStream header(&file);
+   header << "ENVI\n";
+   header << "description = {" << mChips.size() << " chips of " << mChipSize << " x " << mChipSize
+          << " pixels stacked vertically from " << QString::fromStdString(mpRaster->getName()) << "}\n";
+   header << "samples = " << mChipSize << "\n";
+   header << "lines = " << mChipSize * mChips.size() << "\n";
+   header << "bands = " << mBands.size() << "\n";
+   header << "header offset = 0\n";
+   header << "file type = ENVI Standard\n";
+   header << "data type = " << dataType << "\n";
+   header << "interleave = bip\n";
+   header << "byte order = " << (Endian::getSystemEndian() == BIG_ENDIAN_ORDER ? 1 : 0) << "\n";
+   header << "band names = {";
+   for (unsigned int band = 0; band < mBands.size(); band++)
+   {
+      DimensionDescriptor bandDescriptor = mpDescriptor->getActiveBand(mBands[band]);
+      header << (band == 0 ? "" : ", ") << "Band " << bandDescriptor.getOriginalNumber() + 1;
+   }
+   header << "}\n";
+   return header.status() == QTextStream::Ok;
+}
+
+bool ExtractChips::writeIndex(const std::string& filename)
+{
+   QFile file(QString::fromStdString(filename));
+   if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+   {
+      mProgress.report("Unable to open " + filename + " for writing.", 0, ERRORS, true);
+      return false;
+   }
+   QTextStream index(&file);
+   index << "chip,center row,center column,first row,first column\n";
+   for (unsigned int chip = 0; chip < mChips.size(); chip++)
+   {
+      index << chip << "," << mChips[chip].mCenterRow << "," << mChips[chip].mCenterColumn << ","
+            << mChips[chip].mFirstRow << "," << mChips[chip].mFirstColumn << "\n";
+   }
+   return index.status() == QTextStream::Ok;
+}
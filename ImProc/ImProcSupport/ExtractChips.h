@@ -0,0 +1,94 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef EXTRACTCHIPS_H__
+#define EXTRACTCHIPS_H__
+
+#include "AlgorithmShell.h"
+#include "ProgressTracker.h"
+
+#include <string>
+#include <vector>
+
+class AoiElement;
+class QFile;
+class RasterDataDescriptor;
+class RasterElement;
+
+/**
+ * Extract square chips from a raster element into a single file.
+ *
+ * Chips are centered on a list of pixels or on a grid of pixels inside an AOI. Each chip pixel is the
+ * mean of a decimation x decimation block of source pixels over a subset of the bands. The chips are
+ * sorted by row so the source is read in one sequential sweep, and each chip is written as soon as
+ * its last source row has been read. Only the chips which overlap the current row are held in memory.
+ *
+ * The chips are written back to back in BIP order with an ENVI header which describes them as one
+ * image with the chips stacked vertically. A CSV index gives the center of each chip.
+ */
+class ExtractChips : public AlgorithmShell
+{
+public:
+   ExtractChips();
+   virtual ~ExtractChips();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+
+   struct Chip
+   {
+      Chip() : mCenterRow(0), mCenterColumn(0), mFirstRow(0), mFirstColumn(0) {}
+      bool operator<(const Chip& other) const
+      {
+         return mFirstRow < other.mFirstRow || (mFirstRow == other.mFirstRow && mFirstColumn < other.mFirstColumn);
+      }
+      unsigned int mCenterRow;
+      unsigned int mCenterColumn;
+      unsigned int mFirstRow;
+      unsigned int mFirstColumn;
+      std::vector<double> mSums;
+   };
+
+   /**
+    * Build the sorted chip list from the centers or the AOI, dropping chips which leave the scene.
+    */
+   bool createChips(const std::vector<unsigned int>& centers, AoiElement* pAoi);
+
+   /**
+    * Read the source in one sweep and write the chips.
+    */
+   bool sweep(QFile& file);
+
+   bool writeHeader(const std::string& filename);
+   bool writeIndex(const std::string& filename);
+
+   template<typename T> void accumulateRow(const T* pRow, Chip& chip, unsigned int row);
+   template<typename T> void storeChip(T* pChip, const Chip& chip);
+
+   ProgressTracker mProgress;
+   RasterElement* mpRaster;
+   const RasterDataDescriptor* mpDescriptor;
+   std::vector<unsigned int> mBands;
+   unsigned int mChipSize;
+   unsigned int mDecimation;
+   unsigned int mStride;
+   std::vector<Chip> mChips;
+   std::string mFilename;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AoiElement.h"
+#include "ExtractChipsDialog.h"
+#include "ModelServices.h"
+#include "RasterElement.h"
+#include "TypeConverter.h"
+#include <QtCore/QVariant>
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QFileDialog>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QLineEdit>
+#include <QtGui/QPushButton>
+#include <QtGui/QSpinBox>
+
+ExtractChipsDialog::ExtractChipsDialog(const RasterElement* pRaster, QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pFilenameLabel = new QLabel("Output File:", this);
+   mpFilename = new QLineEdit(this);
+   QPushButton* pBrowse = new QPushButton("Browse...", this);
+   QLabel* pAoiLabel = new QLabel("AOI:", this);
+   mpAoi = new QComboBox(this);
+   mpAoi->setEditable(false);
+   std::vector<DataElement*> aois = Service<ModelServices>()->getElements(pRaster, TypeConverter::toString<AoiElement>());
+   for (std::vector<DataElement*>::iterator aoi = aois.begin(); aoi != aois.end(); ++aoi)
+   {
+      mpAoi->addItem(QString::fromStdString((*aoi)->getName()), reinterpret_cast<qulonglong>(*aoi));
+   }
+   mpAoi->setToolTip("Chips are centered on AOI pixels spaced by the chip stride.");
+   QLabel* pChipSizeLabel = new QLabel("Chip Size:", this);
+   mpChipSize = new QSpinBox(this);
+   mpChipSize->setRange(1, 8192);
+   QLabel* pDecimationLabel = new QLabel("Decimation:", this);
+   mpDecimation = new QSpinBox(this);
+   mpDecimation->setRange(1, 64);
+   mpDecimation->setToolTip("Each chip pixel is the mean of a block of this many source pixels on a side.");
+   QLabel* pStrideLabel = new QLabel("Chip Stride:", this);
+   mpStride = new QSpinBox(this);
+   mpStride->setRange(0, 65536);
+   mpStride->setSpecialValueText("Edge to edge");
+   mpStride->setToolTip("Source pixels between chip centers.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pFilenameLabel, 0, 0);
+   pTopLevel->addWidget(mpFilename, 0, 1);
+   pTopLevel->addWidget(pBrowse, 0, 2);
+   pTopLevel->addWidget(pAoiLabel, 1, 0);
+   pTopLevel->addWidget(mpAoi, 1, 1, 1, 2);
+   pTopLevel->addWidget(pChipSizeLabel, 2, 0);
+   pTopLevel->addWidget(mpChipSize, 2, 1, 1, 2);
+   pTopLevel->addWidget(pDecimationLabel, 3, 0);
+   pTopLevel->addWidget(mpDecimation, 3, 1, 1, 2);
+   pTopLevel->addWidget(pStrideLabel, 4, 0);
+   pTopLevel->addWidget(mpStride, 4, 1, 1, 2);
+   pTopLevel->addWidget(pButtons, 5, 0, 1, 3);
+
+   connect(pBrowse, SIGNAL(clicked()), this, SLOT(browse()));
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+ExtractChipsDialog::~ExtractChipsDialog()
+{
+}
+
+std::string ExtractChipsDialog::getFilename() const
+{
+   return mpFilename->text().toStdString();
+}
+
+AoiElement* ExtractChipsDialog::getAoi() const
+{
+   if (mpAoi->currentIndex() < 0)
+   {
+      return NULL;
+   }
+   return reinterpret_cast<AoiElement*>(mpAoi->itemData(mpAoi->currentIndex()).toULongLong());
+}
+
+unsigned int ExtractChipsDialog::getChipSize() const
+{
+   return static_cast<unsigned int>(mpChipSize->value());
+}
+
+unsigned int ExtractChipsDialog::getDecimation() const
+{
+   return static_cast<unsigned int>(mpDecimation->value());
+}
+
+unsigned int ExtractChipsDialog::getStride() const
+{
+   return static_cast<unsigned int>(mpStride->value());
+}
+
+void ExtractChipsDialog::setFilename(const std::string& filename)
+{
+   mpFilename->setText(QString::fromStdString(filename));
+}
+
+void ExtractChipsDialog::setAoi(AoiElement* pAoi)
+{
+   int idx = mpAoi->findData(reinterpret_cast<qulonglong>(pAoi));
+   if (idx >= 0)
+   {
+      mpAoi->setCurrentIndex(idx);
+   }
+}
+
+void ExtractChipsDialog::setChipSize(unsigned int size)
+{
+   mpChipSize->setValue(static_cast<int>(size));
+}
+
+void ExtractChipsDialog::setDecimation(unsigned int decimation)
+{
+   mpDecimation->setValue(static_cast<int>(decimation));
+}
+
+void ExtractChipsDialog::setStride(unsigned int stride)
+{
+   mpStride->setValue(static_cast<int>(stride));
+}
+
+void ExtractChipsDialog::browse()
+{
+   QString filename = QFileDialog::getSaveFileName(this, "Chip File", mpFilename->text(), "Chip Files (*.dat);;All Files (*)");
+   if (!filename.isEmpty())
+   {
+      mpFilename->setText(filename);
+   }
+}
@@ -0,0 +1,51 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef EXTRACTCHIPSDIALOG_H
+#define EXTRACTCHIPSDIALOG_H
+
+#include <QtGui/QDialog>
+#include <string>
+
+class AoiElement;
+class QComboBox;
+class QLineEdit;
+class QSpinBox;
+class RasterElement;
+
+class ExtractChipsDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   ExtractChipsDialog(const RasterElement* pRaster, QWidget* pParent=NULL);
+   virtual ~ExtractChipsDialog();
+
+   std::string getFilename() const;
+   AoiElement* getAoi() const;
+   unsigned int getChipSize() const;
+   unsigned int getDecimation() const;
+   unsigned int getStride() const;
+   void setFilename(const std::string& filename);
+   void setAoi(AoiElement* pAoi);
+   void setChipSize(unsigned int size);
+   void setDecimation(unsigned int decimation);
+   void setStride(unsigned int stride);
+
+private slots:
+   void browse();
+
+private:
+   QLineEdit* mpFilename;
+   QComboBox* mpAoi;
+   QSpinBox* mpChipSize;
+   QSpinBox* mpDecimation;
+   QSpinBox* mpStride;
+};
+
+#endif
@@ -0,0 +1,493 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ImageQuality.h"
+#include "ImageQualityDialog.h"
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+
+#include <algorithm>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(ImProcSupport, ImageQuality);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(NoiseEstimator)
+ADD_ENUM_MAPPING(LOCAL_VARIANCE_ESTIMATOR, "Homogeneous Local Variance", "localvariance")
+ADD_ENUM_MAPPING(LAPLACIAN_MAD_ESTIMATOR, "Laplacian MAD", "laplacian")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   // the percentile and Laplacian samples kept per band, the rest are skipped with a stride
+   const unsigned int sMaxValues = 65536;
+   const unsigned int sBlockSize = 4;
+   const unsigned int sHistogramBins = 150;
+
+   /**
+    * A small xorshift generator so a seed reproduces the sample without touching the C library state.
+    */
+   class Random
+   {
+   public:
+      Random(unsigned int seed) : mState(seed * 2654435761U + 0x9E3779B9U)
+      {
+         if (mState == 0)
+         {
+            mState = 1;
+         }
+      }
+
+      // uniform in [0, limit)
+      unsigned int next(unsigned int limit)
+      {
+         mState ^= mState << 13;
+         mState ^= mState >> 17;
+         mState ^= mState << 5;
+         return (limit == 0) ? 0 : mState % limit;
+      }
+
+   private:
+      unsigned int mState;
+   };
+
+   double encodingMaximum(EncodingType encoding)
+   {
+      switch (encoding)
+      {
+      case INT1UBYTE:
+         return 255.0;
+      case INT1SBYTE:
+         return 127.0;
+      case INT2UBYTES:
+         return 65535.0;
+      case INT2SBYTES:
+         return 32767.0;
+      case INT4UBYTES:
+         return 4294967295.0;
+      case INT4SBYTES:
+         return 2147483647.0;
+      default:
+         return 0.0;
+      }
+   }
+
+   double percentile(std::vector<double>& values, double fraction)
+   {
+      if (values.empty())
+      {
+         return 0.0;
+      }
+      std::vector<double>::iterator nth = values.begin() + static_cast<unsigned int>(fraction * (values.size() - 1) + 0.5);
+      std::nth_element(values.begin(), nth, values.end());
+      return *nth;
+   }
+
+   // the mode of the local standard deviations, after Gao (1993)
+   double localVarianceNoise(const std::vector<double>& deviations)
+   {
+      if (deviations.empty())
+      {
+         return 0.0;
+      }
+      double minimum = *std::min_element(deviations.begin(), deviations.end());
+      double mean = 0.0;
+      for (std::vector<double>::const_iterator deviation = deviations.begin(); deviation != deviations.end(); ++deviation)
+      {
+         mean += *deviation;
+      }
+      mean /= deviations.size();
+      // edges and texture make a long tail, the noise mode lies well below the mean
+      double binWidth = (1.2 * mean - minimum) / sHistogramBins;
+      if (!(binWidth > 0.0))
+      {
+         return minimum;
+      }
+      std::vector<unsigned int> histogram(sHistogramBins, 0);
+      for (std::vector<double>::const_iterator deviation = deviations.begin(); deviation != deviations.end(); ++deviation)
+      {
+         unsigned int bin = static_cast<unsigned int>((*deviation - minimum) / binWidth);
+         if (bin < sHistogramBins)
+         {
+            histogram[bin]++;
+         }
+      }
+      unsigned int mode = std::max_element(histogram.begin(), histogram.end()) - histogram.begin();
+      return minimum + (mode + 0.5) * binWidth;
+   }
+
+   // the scaled median absolute deviation of the Laplacian difference, after Immerkaer (1996)
+   double laplacianNoise(std::vector<double>& responses)
+   {
+      if (responses.empty())
+      {
+         return 0.0;
+      }
+      double median = percentile(responses, 0.5);
+      for (std::vector<double>::iterator response = responses.begin(); response != responses.end(); ++response)
+      {
+         *response = fabs(*response - median);
+      }
+      // 1.4826 scales a MAD to a Gaussian sigma and the filter has a gain of 6 on white noise
+      return 1.4826 * percentile(responses, 0.5) / 6.0;
+   }
+}
+
+ImageQuality::ImageQuality() :
+   mpRaster(NULL),
+   mpDescriptor(NULL),
+   mEstimator(LOCAL_VARIANCE_ESTIMATOR),
+   mSampleBudget(1000000),
+   mTileSize(64),
+   mSeed(0),
+   mSaturationValue(0.0),
+   mStride(1),
+   mAbortFlag(false)
+{
+   setName("ImageQuality");
+   setDescription("Estimate noise, saturation and dynamic range from a sample of the data.");
+   setDescriptorId("{3B8E5F12-9A47-4D6C-B1F0-C28D7E4A6935}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Image Quality");
+}
+
+ImageQuality::~ImageQuality()
+{
+}
+
+bool ImageQuality::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   std::string estimatorHelp = "Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<NoiseEstimator>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<NoiseEstimator>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      estimatorHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Noise Estimator",
+      StringUtilities::toXmlString<NoiseEstimator>(mEstimator), estimatorHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Sample Budget", mSampleBudget,
+      "The number of pixels to read. The whole scene is read when it is smaller."));
+   VERIFY(pInArgList->addArg<unsigned int>("Tile Size", mTileSize, "The width and height of the sampled tiles."));
+   VERIFY(pInArgList->addArg<unsigned int>("Seed", mSeed, "Seed for the tile placement. Equal seeds sample equal tiles."));
+   VERIFY(pInArgList->addArg<double>("Saturation Value", mSaturationValue,
+      "Values at or above this are saturated. 0 uses the encoding maximum, or the sample maximum for floating point data."));
+   return true;
+}
+
+bool ImageQuality::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<std::vector<double> >("Noise", "The noise standard deviation of each band in data units."));
+   VERIFY(pOutArgList->addArg<std::vector<double> >("Saturation Fraction", "The fraction of saturated samples in each band."));
+   VERIFY(pOutArgList->addArg<std::vector<double> >("Dynamic Range", "The bits of signal above the noise in each band."));
+   VERIFY(pOutArgList->addArg<unsigned int>("Sampled Pixels", "The number of pixels read."));
+   return true;
+}
+
+bool ImageQuality::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin image quality estimation.", 1, NORMAL);
+   std::vector<std::pair<unsigned int, unsigned int> > tiles;
+   createTiles(tiles);
+   unsigned int tileRows = std::min(mTileSize, mpDescriptor->getRowCount());
+   unsigned int tileColumns = std::min(mTileSize, mpDescriptor->getColumnCount());
+   unsigned int bands = mpDescriptor->getBandCount();
+   mStride = std::max(1U, static_cast<unsigned int>(tiles.size()) * tileRows * tileColumns / sMaxValues);
+   mSamples.assign(bands, BandSample());
+   mTile.resize(tileRows * tileColumns * bands);
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mpRaster->getDataAccessor(pRequest.release());
+   if (!accessor.isValid())
+   {
+      mProgress.report("Unable to access the data.", 0, ERRORS, true);
+      return false;
+   }
+   EncodingType encoding = mpDescriptor->getDataType();
+   for (unsigned int idx = 0; idx < tiles.size(); idx++)
+   {
+      if (mAbortFlag)
+      {
+         mProgress.report("Image quality estimation aborted.", 0, ABORT, true);
+         return false;
+      }
+      switchOnEncoding(encoding, readTile, NULL, accessor, tiles[idx].first, tiles[idx].second, tileRows, tileColumns);
+      if (!accessor.isValid())
+      {
+         mProgress.report("Unable to access the data.", 0, ERRORS, true);
+         return false;
+      }
+      sampleTile(tileRows, tileColumns);
+      mProgress.report("Sampling tiles", 1 + 98 * (idx + 1) / tiles.size(), NORMAL);
+   }
+
+   bool quantized = (encodingMaximum(encoding) > 0.0);
+   std::vector<double> noise;
+   std::vector<double> saturation;
+   std::vector<double> dynamicRange;
+   std::string summary;
+   for (unsigned int band = 0; band < bands; band++)
+   {
+      BandSample& sample = mSamples[band];
+      double sigma = (mEstimator == LOCAL_VARIANCE_ESTIMATOR) ?
+         localVarianceNoise(sample.mNoise) : laplacianNoise(sample.mNoise);
+      if (quantized)
+      {
+         // integer data has at least the quantization noise of a uniform error over one count
+         sigma = std::max(sigma, 1.0 / sqrt(12.0));
+      }
+      double spread = percentile(sample.mValues, 0.995) - percentile(sample.mValues, 0.005);
+      unsigned int saturated = (mSaturationValue > 0.0) ? sample.mSaturated : sample.mAtMaximum;
+      noise.push_back(sigma);
+      saturation.push_back(sample.mCount == 0 ? 0.0 : static_cast<double>(saturated) / sample.mCount);
+      dynamicRange.push_back(sigma > 0.0 ? log(1.0 + spread / sigma) / log(2.0) : 0.0);
+      summary += "\nBand " + StringUtilities::toDisplayString(band + 1) +
+         ": noise " + StringUtilities::toDisplayString(noise.back()) +
+         ", saturated " + StringUtilities::toDisplayString(100.0 * saturation.back()) + "%" +
+         ", dynamic range " + StringUtilities::toDisplayString(dynamicRange.back()) + " bits";
+   }
+   unsigned int sampledPixels = tiles.size() * tileRows * tileColumns;
+   pOutArgList->setPlugInArgValue("Noise", &noise);
+   pOutArgList->setPlugInArgValue("Saturation Fraction", &saturation);
+   pOutArgList->setPlugInArgValue("Dynamic Range", &dynamicRange);
+   pOutArgList->setPlugInArgValue("Sampled Pixels", &sampledPixels);
+   mProgress.report("Sampled " + StringUtilities::toDisplayString(sampledPixels) + " pixels." + summary, 100, NORMAL);
+   mProgress.upALevel();
+   return true;
+}
+
+bool ImageQuality::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{7D21C6A9-4F3B-4E85-9C0D-A6E1B8523F47}");
+   if ((mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mpDescriptor = static_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   EncodingType encoding = mpDescriptor->getDataType();
+   if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+   std::string estimator;
+   pInArgList->getPlugInArgValue("Noise Estimator", estimator);
+   mEstimator = StringUtilities::fromXmlString<NoiseEstimator>(estimator);
+   pInArgList->getPlugInArgValue("Sample Budget", mSampleBudget);
+   pInArgList->getPlugInArgValue("Tile Size", mTileSize);
+   pInArgList->getPlugInArgValue("Seed", mSeed);
+   pInArgList->getPlugInArgValue("Saturation Value", mSaturationValue);
+
+   if (!isBatch())
+   {
+      ImageQualityDialog dlg;
+      dlg.setEstimator(mEstimator);
+      dlg.setSampleBudget(mSampleBudget);
+      dlg.setTileSize(mTileSize);
+      dlg.setSeed(mSeed);
+      dlg.setSaturationValue(mSaturationValue);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mEstimator = dlg.getEstimator();
+      mSampleBudget = dlg.getSampleBudget();
+      mTileSize = dlg.getTileSize();
+      mSeed = dlg.getSeed();
+      mSaturationValue = dlg.getSaturationValue();
+   }
+   if (!mEstimator.isValid())
+   {
+      mProgress.report("Invalid noise estimator.", 0, ERRORS, true);
+      return false;
+   }
+   if (mTileSize < 2 * sBlockSize || mSampleBudget == 0)
+   {
+      mProgress.report("The tile size must be at least " + StringUtilities::toDisplayString(2 * sBlockSize) +
+         " and the sample budget at least 1.", 0, ERRORS, true);
+      return false;
+   }
+   if (mSaturationValue == 0.0)
+   {
+      mSaturationValue = encodingMaximum(encoding);
+   }
+   return true;
+}
+
+void ImageQuality::createTiles(std::vector<std::pair<unsigned int, unsigned int> >& tiles) const
+{
+   unsigned int rows = mpDescriptor->getRowCount();
+   unsigned int columns = mpDescriptor->getColumnCount();
+   unsigned int tileRows = std::min(mTileSize, rows);
+   unsigned int tileColumns = std::min(mTileSize, columns);
+   unsigned int gridRows = rows / tileRows;
+   unsigned int gridColumns = columns / tileColumns;
+   unsigned int wanted = std::max(1U, mSampleBudget / (tileRows * tileColumns));
+   tiles.clear();
+   if (wanted >= gridRows * gridColumns)
+   {
+      for (unsigned int row = 0; row < gridRows; row++)
+      {
+         for (unsigned int column = 0; column < gridColumns; column++)
+         {
+            tiles.push_back(std::make_pair(row * tileRows, column * tileColumns));
+         }
+      }
+      return;
+   }
+
+   // strata as close to square as the scene allows
+   unsigned int strataColumns = static_cast<unsigned int>(sqrt(static_cast<double>(wanted) * columns / rows) + 0.5);
+   strataColumns = std::max(1U, std::min(gridColumns, strataColumns));
+   unsigned int strataRows = std::max(1U, std::min(gridRows, wanted / strataColumns));
+   double stratumHeight = static_cast<double>(rows) / strataRows;
+   double stratumWidth = static_cast<double>(columns) / strataColumns;
+   Random random(mSeed);
+   for (unsigned int stratumRow = 0; stratumRow < strataRows; stratumRow++)
+   {
+      unsigned int top = static_cast<unsigned int>(stratumRow * stratumHeight);
+      unsigned int bottom = std::min(rows, static_cast<unsigned int>((stratumRow + 1) * stratumHeight));
+      for (unsigned int stratumColumn = 0; stratumColumn < strataColumns; stratumColumn++)
+      {
+         unsigned int left = static_cast<unsigned int>(stratumColumn * stratumWidth);
+         unsigned int right = std::min(columns, static_cast<unsigned int>((stratumColumn + 1) * stratumWidth));
+         // each stratum holds at least one tile since there are no more strata than grid cells
+         unsigned int row = top + random.next(bottom - top - tileRows + 1);
+         unsigned int column = left + random.next(right - left - tileColumns + 1);
+         tiles.push_back(std::make_pair(std::min(row, rows - tileRows), std::min(column, columns - tileColumns)));
+      }
+   }
+}
+
+template<typename T>
+void ImageQuality::readTile(T* pUnused, DataAccessor& accessor, unsigned int firstRow, unsigned int firstColumn,
+                            unsigned int rows, unsigned int columns)
+{
+   unsigned int rowSize = columns * mpDescriptor->getBandCount();
+   for (unsigned int row = 0; row < rows; row++)
+   {
+      accessor->toPixel(firstRow + row, firstColumn);
+      if (!accessor.isValid())
+      {
+         return;
+      }
+      const T* pData = reinterpret_cast<const T*>(accessor->getColumn());
+      std::copy(pData, pData + rowSize, mTile.begin() + row * rowSize);
+   }
+}
+
+void ImageQuality::sampleTile(unsigned int rows, unsigned int columns)
+{
+   unsigned int bands = mSamples.size();
+   for (unsigned int band = 0; band < bands; band++)
+   {
+      BandSample& sample = mSamples[band];
+      const double* pBand = &mTile[band];
+      for (unsigned int pixel = 0; pixel < rows * columns; pixel++)
+      {
+         double value = pBand[pixel * bands];
+         if (sample.mCount == 0 || value > sample.mMaximum)
+         {
+            sample.mMaximum = value;
+            sample.mAtMaximum = 0;
+         }
+         if (value == sample.mMaximum)
+         {
+            sample.mAtMaximum++;
+         }
+         if (mSaturationValue > 0.0 && value >= mSaturationValue)
+         {
+            sample.mSaturated++;
+         }
+         if (sample.mCount++ % mStride == 0)
+         {
+            sample.mValues.push_back(value);
+         }
+      }
+
+      if (mEstimator == LOCAL_VARIANCE_ESTIMATOR)
+      {
+         const double count = sBlockSize * sBlockSize;
+         for (unsigned int blockRow = 0; blockRow + sBlockSize <= rows; blockRow += sBlockSize)
+         {
+            for (unsigned int blockColumn = 0; blockColumn + sBlockSize <= columns; blockColumn += sBlockSize)
+            {
+               double sum = 0.0;
+               double sumSquares = 0.0;
+               for (unsigned int row = blockRow; row < blockRow + sBlockSize; row++)
+               {
+                  for (unsigned int column = blockColumn; column < blockColumn + sBlockSize; column++)
+                  {
+                     double value = pBand[(row * columns + column) * bands];
+                     sum += value;
+                     sumSquares += value * value;
+                  }
+               }
+               double variance = std::max(0.0, (sumSquares - sum * sum / count) / (count - 1.0));
+               sample.mNoise.push_back(sqrt(variance));
+            }
+         }
+      }
+      else
+      {
+         unsigned int position = 0;
+         for (unsigned int row = 1; row + 1 < rows; row++)
+         {
+            for (unsigned int column = 1; column + 1 < columns; column++)
+            {
+               if (position++ % mStride != 0)
+               {
+                  continue;
+               }
+               const double* pAbove = pBand + ((row - 1) * columns + column) * bands;
+               const double* pCenter = pAbove + columns * bands;
+               const double* pBelow = pCenter + columns * bands;
+               // [1 -2 1; -2 4 -2; 1 -2 1] removes the signal up to a plane
+               double response = pAbove[-static_cast<int>(bands)] - 2.0 * pAbove[0] + pAbove[bands]
+                  - 2.0 * pCenter[-static_cast<int>(bands)] + 4.0 * pCenter[0] - 2.0 * pCenter[bands]
+                  + pBelow[-static_cast<int>(bands)] - 2.0 * pBelow[0] + pBelow[bands];
+               sample.mNoise.push_back(response);
+            }
+         }
+      }
+   }
+}
@@ -0,0 +1,101 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef IMAGEQUALITY_H__
+#define IMAGEQUALITY_H__
+
+#include "AlgorithmShell.h"
+#include "EnumWrapper.h"
+#include "ProgressTracker.h"
+
+#include <string>
+#include <vector>
+
+class DataAccessor;
+class RasterDataDescriptor;
+class RasterElement;
+
+enum NoiseEstimatorEnum { LOCAL_VARIANCE_ESTIMATOR, LAPLACIAN_MAD_ESTIMATOR };
+typedef EnumWrapper<NoiseEstimatorEnum> NoiseEstimator;
+
+/**
+ * Estimate per band noise, saturation and dynamic range from a sample of tiles.
+ *
+ * The scene is divided into a grid of strata with one tile of the sample budget in each and the tile
+ * is placed at a random offset within its stratum. Only the sampled tiles are read so the cost
+ * depends on the sample budget and not on the scene size, and the full statistics are never computed.
+ *
+ * The noise is the standard deviation of the noise in data units. The local variance estimator is the
+ * mode of the local standard deviations of 4x4 blocks, which is dominated by homogeneous areas. The
+ * Laplacian estimator is the scaled median absolute deviation of a Laplacian difference filter, which
+ * cancels planar trends. The dynamic range is log2 of the 0.5 to 99.5 percentile spread over the noise,
+ * the number of bits above the noise floor.
+ */
+class ImageQuality : public AlgorithmShell
+{
+public:
+   ImageQuality();
+   virtual ~ImageQuality();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+
+   /**
+    * The sampled values of one band.
+    */
+   struct BandSample
+   {
+      BandSample() : mCount(0), mSaturated(0), mMaximum(0.0), mAtMaximum(0) {}
+      std::vector<double> mValues; // every mStride'th value for the percentiles
+      std::vector<double> mNoise; // local standard deviations or Laplacian responses
+      unsigned int mCount;
+      unsigned int mSaturated; // values at or above the saturation value
+      double mMaximum;
+      unsigned int mAtMaximum; // values equal to the maximum for data without a saturation value
+   };
+
+   /**
+    * Choose the tile origins, one per stratum, sorted by row.
+    */
+   void createTiles(std::vector<std::pair<unsigned int, unsigned int> >& tiles) const;
+
+   /**
+    * Read a tile into mTile as double BIP values.
+    */
+   template<typename T> void readTile(T* pUnused, DataAccessor& accessor, unsigned int firstRow,
+      unsigned int firstColumn, unsigned int rows, unsigned int columns);
+
+   /**
+    * Add the tile in mTile to the band samples.
+    */
+   void sampleTile(unsigned int rows, unsigned int columns);
+
+   ProgressTracker mProgress;
+   RasterElement* mpRaster;
+   const RasterDataDescriptor* mpDescriptor;
+   NoiseEstimator mEstimator;
+   unsigned int mSampleBudget; // in pixels
+   unsigned int mTileSize;
+   unsigned int mSeed;
+   double mSaturationValue;
+   unsigned int mStride;
+   std::vector<double> mTile;
+   std::vector<BandSample> mSamples;
+   bool mAbortFlag;
+};
+
+#endif
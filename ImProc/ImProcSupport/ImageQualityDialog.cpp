@@ -0,0 +1,122 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ImageQualityDialog.h"
+#include "StringUtilities.h"
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QSpinBox>
+
+#include <algorithm>
+
+ImageQualityDialog::ImageQualityDialog(QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pEstimatorLabel = new QLabel("Noise Estimator:", this);
+   mpEstimator = new QComboBox(this);
+   mpEstimator->setEditable(false);
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<NoiseEstimator>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      mpEstimator->addItem(QString::fromStdString(*val));
+   }
+   mpEstimator->setToolTip("Local variance suits scenes with flat areas. "
+      "The Laplacian suits busy scenes since it ignores smooth gradients.");
+   QLabel* pSampleBudgetLabel = new QLabel("Sample Budget:", this);
+   mpSampleBudget = new QSpinBox(this);
+   mpSampleBudget->setRange(1, 1000000000);
+   mpSampleBudget->setSingleStep(100000);
+   mpSampleBudget->setSuffix(" px");
+   mpSampleBudget->setToolTip("The run time depends on this and not on the scene size.");
+   QLabel* pTileSizeLabel = new QLabel("Tile Size:", this);
+   mpTileSize = new QSpinBox(this);
+   mpTileSize->setRange(8, 4096);
+   QLabel* pSeedLabel = new QLabel("Seed:", this);
+   mpSeed = new QSpinBox(this);
+   mpSeed->setRange(0, 1000000000);
+   QLabel* pSaturationValueLabel = new QLabel("Saturation Value:", this);
+   mpSaturationValue = new QDoubleSpinBox(this);
+   mpSaturationValue->setRange(0.0, 1.0e10);
+   mpSaturationValue->setDecimals(4);
+   mpSaturationValue->setSpecialValueText("Automatic");
+   mpSaturationValue->setToolTip("Automatic uses the encoding maximum, or the sample maximum for floating point data.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pEstimatorLabel, 0, 0);
+   pTopLevel->addWidget(mpEstimator, 0, 1);
+   pTopLevel->addWidget(pSampleBudgetLabel, 1, 0);
+   pTopLevel->addWidget(mpSampleBudget, 1, 1);
+   pTopLevel->addWidget(pTileSizeLabel, 2, 0);
+   pTopLevel->addWidget(mpTileSize, 2, 1);
+   pTopLevel->addWidget(pSeedLabel, 3, 0);
+   pTopLevel->addWidget(mpSeed, 3, 1);
+   pTopLevel->addWidget(pSaturationValueLabel, 4, 0);
+   pTopLevel->addWidget(mpSaturationValue, 4, 1);
+   pTopLevel->addWidget(pButtons, 5, 0, 1, 2);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+ImageQualityDialog::~ImageQualityDialog()
+{
+}
+
+NoiseEstimator ImageQualityDialog::getEstimator() const
+{
+   return StringUtilities::fromDisplayString<NoiseEstimator>(mpEstimator->currentText().toStdString());
+}
+
+unsigned int ImageQualityDialog::getSampleBudget() const
+{
+   return static_cast<unsigned int>(mpSampleBudget->value());
+}
+
+unsigned int ImageQualityDialog::getTileSize() const
+{
+   return static_cast<unsigned int>(mpTileSize->value());
+}
+
+unsigned int ImageQualityDialog::getSeed() const
+{
+   return static_cast<unsigned int>(mpSeed->value());
+}
+
+double ImageQualityDialog::getSaturationValue() const
+{
+   return mpSaturationValue->value();
+}
+
+void ImageQualityDialog::setEstimator(NoiseEstimator estimator)
+{
+   mpEstimator->setCurrentIndex(mpEstimator->findText(QString::fromStdString(StringUtilities::toDisplayString(estimator))));
+}
+
+void ImageQualityDialog::setSampleBudget(unsigned int budget)
+{
+   mpSampleBudget->setValue(static_cast<int>(std::min(budget, 1000000000U)));
+}
+
+void ImageQualityDialog::setTileSize(unsigned int size)
+{
+   mpTileSize->setValue(static_cast<int>(std::min(size, 4096U)));
+}
+
+void ImageQualityDialog::setSeed(unsigned int seed)
+{
+   mpSeed->setValue(static_cast<int>(std::min(seed, 1000000000U)));
+}
+
+void ImageQualityDialog::setSaturationValue(double value)
+{
+   mpSaturationValue->setValue(value);
+}
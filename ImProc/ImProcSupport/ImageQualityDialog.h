@@ -0,0 +1,46 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef IMAGEQUALITYDIALOG_H
+#define IMAGEQUALITYDIALOG_H
+
+#include "ImageQuality.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+class ImageQualityDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   ImageQualityDialog(QWidget* pParent=NULL);
+   virtual ~ImageQualityDialog();
+
+   NoiseEstimator getEstimator() const;
+   unsigned int getSampleBudget() const;
+   unsigned int getTileSize() const;
+   unsigned int getSeed() const;
+   double getSaturationValue() const;
+   void setEstimator(NoiseEstimator estimator);
+   void setSampleBudget(unsigned int budget);
+   void setTileSize(unsigned int size);
+   void setSeed(unsigned int seed);
+   void setSaturationValue(double value);
+
+private:
+   QComboBox* mpEstimator;
+   QSpinBox* mpSampleBudget;
+   QSpinBox* mpTileSize;
+   QSpinBox* mpSeed;
+   QDoubleSpinBox* mpSaturationValue;
+};
+
+#endif
@@ -0,0 +1,289 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "GcpTransform.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+   // the thin plate spline radial basis, written in terms of the squared distance
+   double radialBasis(double squaredDistance)
+   {
+      return (squaredDistance <= 0.0) ? 0.0 : squaredDistance * log(squaredDistance);
+   }
+}
+
+GcpTransform::GcpTransform() : mCenter(0.0, 0.0), mScale(1.0)
+{
+}
+
+GcpTransform::~GcpTransform()
+{
+}
+
+double GcpTransform::getRmsError(const std::vector<LocationType>& from, const std::vector<LocationType>& to) const
+{
+   if (from.empty() || from.size() != to.size())
+   {
+      return 0.0;
+   }
+   double sum = 0.0;
+   for (unsigned int idx = 0; idx < from.size(); idx++)
+   {
+      LocationType mapped = transform(from[idx]);
+      sum += (mapped.mX - to[idx].mX) * (mapped.mX - to[idx].mX) + (mapped.mY - to[idx].mY) * (mapped.mY - to[idx].mY);
+   }
+   return sqrt(sum / from.size());
+}
+
+void GcpTransform::setNormalization(const std::vector<LocationType>& from)
+{
+   mCenter = LocationType(0.0, 0.0);
+   mScale = 1.0;
+   if (from.empty())
+   {
+      return;
+   }
+   for (std::vector<LocationType>::const_iterator point = from.begin(); point != from.end(); ++point)
+   {
+      mCenter.mX += point->mX;
+      mCenter.mY += point->mY;
+   }
+   mCenter.mX /= from.size();
+   mCenter.mY /= from.size();
+   double spread = 0.0;
+   for (std::vector<LocationType>::const_iterator point = from.begin(); point != from.end(); ++point)
+   {
+      spread = std::max(spread, std::max(fabs(point->mX - mCenter.mX), fabs(point->mY - mCenter.mY)));
+   }
+   if (spread > 0.0)
+   {
+      mScale = 1.0 / spread;
+   }
+}
+
+LocationType GcpTransform::normalize(const LocationType& point) const
+{
+   return LocationType((point.mX - mCenter.mX) * mScale, (point.mY - mCenter.mY) * mScale);
+}
+
+bool GcpTransform::solve(std::vector<double>& matrix, std::vector<double>& rhs, unsigned int size, unsigned int count)
+{
+   for (unsigned int col = 0; col < size; col++)
+   {
+      unsigned int pivot = col;
+      for (unsigned int row = col + 1; row < size; row++)
+      {
+         if (fabs(matrix[row * size + col]) > fabs(matrix[pivot * size + col]))
+         {
+            pivot = row;
+         }
+      }
+      if (fabs(matrix[pivot * size + col]) < 1e-12)
+      {
+         return false;
+      }
+      if (pivot != col)
+      {
+         for (unsigned int idx = 0; idx < size; idx++)
+         {
+            std::swap(matrix[pivot * size + idx], matrix[col * size + idx]);
+         }
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            std::swap(rhs[pivot * count + idx], rhs[col * count + idx]);
+         }
+      }
+      for (unsigned int row = col + 1; row < size; row++)
+      {
+         double factor = matrix[row * size + col] / matrix[col * size + col];
+         if (factor == 0.0)
+         {
+            continue;
+         }
+         for (unsigned int idx = col; idx < size; idx++)
+         {
+            matrix[row * size + idx] -= factor * matrix[col * size + idx];
+         }
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            rhs[row * count + idx] -= factor * rhs[col * count + idx];
+         }
+      }
+   }
+   for (int row = static_cast<int>(size) - 1; row >= 0; row--)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         double value = rhs[row * count + idx];
+         for (unsigned int col = row + 1; col < size; col++)
+         {
+            value -= matrix[row * size + col] * rhs[col * count + idx];
+         }
+         rhs[row * count + idx] = value / matrix[row * size + row];
+      }
+   }
+   return true;
+}
+
+PolynomialTransform::PolynomialTransform() : mOrder(1)
+{
+}
+
+unsigned int PolynomialTransform::getTermCount(unsigned int order)
+{
+   return (order + 1) * (order + 2) / 2;
+}
+
+void PolynomialTransform::evaluateTerms(const LocationType& point, std::vector<double>& terms) const
+{
+   LocationType normalized = normalize(point);
+   terms.resize(getTermCount(mOrder));
+   unsigned int term = 0;
+   for (unsigned int degree = 0; degree <= mOrder; degree++)
+   {
+      for (unsigned int yPower = 0; yPower <= degree; yPower++)
+      {
+         terms[term++] = pow(normalized.mX, static_cast<int>(degree - yPower)) * pow(normalized.mY, static_cast<int>(yPower));
+      }
+   }
+}
+
+bool PolynomialTransform::fit(const std::vector<LocationType>& from, const std::vector<LocationType>& to,
+                              unsigned int order, std::string& errorMessage)
+{
+   if (order < 1 || order > 3)
+   {
+      errorMessage = "The polynomial order must be 1, 2 or 3.";
+      return false;
+   }
+   mOrder = order;
+   unsigned int termCount = getTermCount(mOrder);
+   if (from.size() != to.size() || from.size() < termCount)
+   {
+      errorMessage = "Too few control points for the polynomial order.";
+      return false;
+   }
+   setNormalization(from);
+
+   // least squares through the normal equations
+   std::vector<double> matrix(termCount * termCount, 0.0);
+   std::vector<double> rhs(termCount * 2, 0.0);
+   std::vector<double> terms;
+   for (unsigned int point = 0; point < from.size(); point++)
+   {
+      evaluateTerms(from[point], terms);
+      for (unsigned int row = 0; row < termCount; row++)
+      {
+         for (unsigned int col = 0; col < termCount; col++)
+         {
+            matrix[row * termCount + col] += terms[row] * terms[col];
+         }
+         rhs[row * 2] += terms[row] * to[point].mX;
+         rhs[row * 2 + 1] += terms[row] * to[point].mY;
+      }
+   }
+   if (!solve(matrix, rhs, termCount, 2))
+   {
+      errorMessage = "The control points are degenerate for the polynomial order.";
+      return false;
+   }
+   mCoefficientsX.resize(termCount);
+   mCoefficientsY.resize(termCount);
+   for (unsigned int term = 0; term < termCount; term++)
+   {
+      mCoefficientsX[term] = rhs[term * 2];
+      mCoefficientsY[term] = rhs[term * 2 + 1];
+   }
+   return true;
+}
+
+LocationType PolynomialTransform::transform(const LocationType& point) const
+{
+   std::vector<double> terms;
+   evaluateTerms(point, terms);
+   LocationType result(0.0, 0.0);
+   for (unsigned int term = 0; term < terms.size(); term++)
+   {
+      result.mX += mCoefficientsX[term] * terms[term];
+      result.mY += mCoefficientsY[term] * terms[term];
+   }
+   return result;
+}
+
+ThinPlateSplineTransform::ThinPlateSplineTransform()
+{
+}
+
+bool ThinPlateSplineTransform::fit(const std::vector<LocationType>& from, const std::vector<LocationType>& to,
+                                   std::string& errorMessage)
+{
+   if (from.size() != to.size() || from.size() < 3)
+   {
+      errorMessage = "A thin plate spline needs at least 3 control points.";
+      return false;
+   }
+   setNormalization(from);
+   unsigned int count = from.size();
+   unsigned int size = count + 3;
+   mControlPoints.resize(count);
+   for (unsigned int idx = 0; idx < count; idx++)
+   {
+      mControlPoints[idx] = normalize(from[idx]);
+   }
+
+   // [K P; P' 0] [w; a] = [v; 0] where K holds the radial basis and P the affine terms
+   std::vector<double> matrix(size * size, 0.0);
+   std::vector<double> rhs(size * 2, 0.0);
+   for (unsigned int row = 0; row < count; row++)
+   {
+      for (unsigned int col = 0; col < count; col++)
+      {
+         double dx = mControlPoints[row].mX - mControlPoints[col].mX;
+         double dy = mControlPoints[row].mY - mControlPoints[col].mY;
+         matrix[row * size + col] = radialBasis(dx * dx + dy * dy);
+      }
+      matrix[row * size + count] = matrix[count * size + row] = 1.0;
+      matrix[row * size + count + 1] = matrix[(count + 1) * size + row] = mControlPoints[row].mX;
+      matrix[row * size + count + 2] = matrix[(count + 2) * size + row] = mControlPoints[row].mY;
+      rhs[row * 2] = to[row].mX;
+      rhs[row * 2 + 1] = to[row].mY;
+   }
+   if (!solve(matrix, rhs, size, 2))
+   {
+      errorMessage = "The control points are collinear or repeated.";
+      return false;
+   }
+   mWeightsX.resize(size);
+   mWeightsY.resize(size);
+   for (unsigned int idx = 0; idx < size; idx++)
+   {
+      mWeightsX[idx] = rhs[idx * 2];
+      mWeightsY[idx] = rhs[idx * 2 + 1];
+   }
+   return true;
+}
+
+LocationType ThinPlateSplineTransform::transform(const LocationType& point) const
+{
+   LocationType normalized = normalize(point);
+   unsigned int count = mControlPoints.size();
+   LocationType result(mWeightsX[count] + mWeightsX[count + 1] * normalized.mX + mWeightsX[count + 2] * normalized.mY,
+      mWeightsY[count] + mWeightsY[count + 1] * normalized.mX + mWeightsY[count + 2] * normalized.mY);
+   for (unsigned int idx = 0; idx < count; idx++)
+   {
+      double dx = normalized.mX - mControlPoints[idx].mX;
+      double dy = normalized.mY - mControlPoints[idx].mY;
+      double basis = radialBasis(dx * dx + dy * dy);
+      result.mX += mWeightsX[idx] * basis;
+      result.mY += mWeightsY[idx] * basis;
+   }
+   return result;
+}
@@ -0,0 +1,120 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef GCPTRANSFORM_H__
+#define GCPTRANSFORM_H__
+
+#include "LocationType.h"
+
+#include <string>
+#include <vector>
+
+/**
+ * A 2-D transform fit to control point pairs.
+ *
+ * Points are centered and scaled before fitting so the normal equations stay well conditioned for
+ * geographic or map coordinates. A transform is immutable after fitting and may be shared between threads.
+ */
+class GcpTransform
+{
+public:
+   virtual ~GcpTransform();
+
+   /**
+    * Map a point.
+    */
+   virtual LocationType transform(const LocationType& point) const = 0;
+
+   /**
+    * The root mean square distance between the mapped control points and their targets.
+    */
+   double getRmsError(const std::vector<LocationType>& from, const std::vector<LocationType>& to) const;
+
+protected:
+   GcpTransform();
+
+   /**
+    * Compute the centering and scaling of the control points.
+    */
+   void setNormalization(const std::vector<LocationType>& from);
+   LocationType normalize(const LocationType& point) const;
+
+   /**
+    * Solve a dense linear system in place with partial pivoting.
+    *
+    * @param matrix
+    *        The size x size system matrix in row major order. Destroyed on return.
+    * @param rhs
+    *        The size x count right hand sides in row major order. Set to the solutions.
+    * @return False if the system is singular.
+    */
+   static bool solve(std::vector<double>& matrix, std::vector<double>& rhs, unsigned int size, unsigned int count);
+
+private:
+   LocationType mCenter;
+   double mScale;
+};
+
+/**
+ * A least squares polynomial of order 1 to 3 in each output coordinate.
+ */
+class PolynomialTransform : public GcpTransform
+{
+public:
+   PolynomialTransform();
+
+   /**
+    * Fit the polynomial.
+    *
+    * @return False if there are too few points for the order or the points are degenerate.
+    */
+   bool fit(const std::vector<LocationType>& from, const std::vector<LocationType>& to, unsigned int order,
+      std::string& errorMessage);
+
+   /**
+    * The number of control points needed for an order.
+    */
+   static unsigned int getTermCount(unsigned int order);
+
+   virtual LocationType transform(const LocationType& point) const;
+
+private:
+   void evaluateTerms(const LocationType& point, std::vector<double>& terms) const;
+
+   unsigned int mOrder;
+   std::vector<double> mCoefficientsX;
+   std::vector<double> mCoefficientsY;
+};
+
+/**
+ * A thin plate spline which passes exactly through the control points.
+ *
+ * Evaluation costs one logarithm per control point, which is why the warp evaluates it on a coarse
+ * grid and interpolates between grid nodes.
+ */
+class ThinPlateSplineTransform : public GcpTransform
+{
+public:
+   ThinPlateSplineTransform();
+
+   /**
+    * Fit the spline.
+    *
+    * @return False if there are fewer than 3 points or the points are collinear or repeated.
+    */
+   bool fit(const std::vector<LocationType>& from, const std::vector<LocationType>& to, std::string& errorMessage);
+
+   virtual LocationType transform(const LocationType& point) const;
+
+private:
+   std::vector<LocationType> mControlPoints; // normalized
+   std::vector<double> mWeightsX;
+   std::vector<double> mWeightsY;
+};
+
+#endif
@@ -0,0 +1,501 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "GcpLayer.h"
+#include "GcpList.h"
+#include "GcpWarp.h"
+#include "GcpWarpDialog.h"
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilities.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+#include "WarpTile.h"
+
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <math.h>
+#include <string.h>
+
+REGISTER_PLUGIN_BASIC(Warp, GcpWarp);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(WarpTransformType)
+ADD_ENUM_MAPPING(POLYNOMIAL_TRANSFORM, "Polynomial", "polynomial")
+ADD_ENUM_MAPPING(THIN_PLATE_SPLINE_TRANSFORM, "Thin Plate Spline", "tps")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   /**
+    * Maps grid coordinates to source pixels with the inverse transform.
+    */
+   class InverseMapping
+   {
+   public:
+      InverseMapping(const GcpTransform& inverse) : mInverse(inverse) {}
+
+      LocationType operator()(const LocationType& coordinate) const
+      {
+         return mInverse.transform(coordinate);
+      }
+
+   private:
+      const GcpTransform& mInverse;
+   };
+
+   /**
+    * Stores resampled pixels in a BIP tile.
+    */
+   template<typename T>
+   class TileWriter
+   {
+   public:
+      TileWriter(T* pTile, unsigned int bands) : mpTile(pTile), mBands(bands) {}
+
+      void operator()(unsigned int pixel, const double* pValues)
+      {
+         T* pOut = mpTile + pixel * mBands;
+         for (unsigned int band = 0; band < mBands; band++)
+         {
+            pOut[band] = WarpTile::toEncoding<T>(pValues[band]);
+         }
+      }
+
+   private:
+      T* mpTile;
+      unsigned int mBands;
+   };
+}
+
+GcpWarp::GcpWarp() :
+   mpGcpList(NULL),
+   mTransformType(POLYNOMIAL_TRANSFORM),
+   mOrder(1),
+   mResultRows(0),
+   mResultColumns(0),
+   mAbortFlag(false)
+{
+   setName("GcpWarp");
+   setDescription("Warp a data set to a latitude/longitude grid using its GCPs.");
+   setDescriptorId("{4E0B2C77-58D1-4F1A-9B3E-6A2F0D8C1E95}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Warp/GCP Warp");
+}
+
+GcpWarp::~GcpWarp()
+{
+}
+
+bool GcpWarp::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<GcpList>("GCP List", NULL,
+      "The control points. If not specified, the first GCP list of the data element is used."));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   std::string transformHelp = "Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<WarpTransformType>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<WarpTransformType>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      transformHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Transform",
+      StringUtilities::toXmlString<WarpTransformType>(POLYNOMIAL_TRANSFORM), transformHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Polynomial Order", mOrder, "The polynomial order, 1 to 3."));
+   std::string kernelHelp = "Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<ResamplingKernel>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<ResamplingKernel>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      kernelHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Resampling",
+      StringUtilities::toXmlString<ResamplingKernel>(BILINEAR_KERNEL), kernelHelp));
+   VERIFY(pInArgList->addArg<double>("Pixel Size", 0.0,
+      "The output pixel size in degrees. 0 matches the source resolution at the scene center."));
+   VERIFY(pInArgList->addArg<unsigned int>("Grid Spacing", mInput.mGridSpacing,
+      "Output pixels between the nodes where the transform is evaluated exactly. 1 evaluates every pixel."));
+   VERIFY(pInArgList->addArg<double>("Fill Value", mInput.mFillValue, "The value of output pixels outside the source."));
+   return true;
+}
+
+bool GcpWarp::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool GcpWarp::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList) || !createTransforms())
+   {
+      return false;
+   }
+
+   mProgress.report("Begin warp.", 1, NORMAL);
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mResultRows, mResultColumns, mInput.mpDescriptor->getBandCount(), mInput.mpDescriptor->getDataType(),
+      BIP, false));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   mInput.mpAbortFlag = &mAbortFlag;
+   GcpWarpThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Warping", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<GcpWarpThreadInput, GcpWarpThreadOutput, GcpWarpThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Warp complete.", 100, NORMAL);
+         if (!WarpTile::addCornerCoordinates(mInput.mpResult, mInput.mNorth, mInput.mWest, mInput.mPixelSize))
+         {
+            mProgress.report("Unable to create corner coordinates.", 0, WARNING, true);
+         }
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Warp aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Warp failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool GcpWarp::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{A81F6D3B-0C2E-4B97-8E54-19D7C3F2A06B}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   mpGcpList = pInArgList->getPlugInArgValue<GcpList>("GCP List");
+   if (mpGcpList == NULL)
+   {
+      std::vector<DataElement*> lists = Service<ModelServices>()->getElements(mInput.mpRaster,
+         TypeConverter::toString<GcpList>());
+      if (!lists.empty())
+      {
+         mpGcpList = static_cast<GcpList*>(lists.front());
+      }
+   }
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+   std::string transformType;
+   pInArgList->getPlugInArgValue("Transform", transformType);
+   mTransformType = StringUtilities::fromXmlString<WarpTransformType>(transformType);
+   pInArgList->getPlugInArgValue("Polynomial Order", mOrder);
+   std::string kernel;
+   pInArgList->getPlugInArgValue("Resampling", kernel);
+   mInput.mKernel = StringUtilities::fromXmlString<ResamplingKernel>(kernel);
+   pInArgList->getPlugInArgValue("Pixel Size", mInput.mPixelSize);
+   pInArgList->getPlugInArgValue("Grid Spacing", mInput.mGridSpacing);
+   pInArgList->getPlugInArgValue("Fill Value", mInput.mFillValue);
+
+   if (!isBatch())
+   {
+      GcpWarpDialog dlg(mInput.mpRaster);
+      dlg.setGcpList(mpGcpList);
+      dlg.setTransformType(mTransformType);
+      dlg.setOrder(mOrder);
+      dlg.setKernel(mInput.mKernel);
+      dlg.setPixelSize(mInput.mPixelSize);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mpGcpList = dlg.getGcpList();
+      mTransformType = dlg.getTransformType();
+      mOrder = dlg.getOrder();
+      mInput.mKernel = dlg.getKernel();
+      mInput.mPixelSize = dlg.getPixelSize();
+   }
+   if (mpGcpList == NULL)
+   {
+      mProgress.report("No GCP list.", 0, ERRORS, true);
+      return false;
+   }
+   if (!mTransformType.isValid())
+   {
+      mProgress.report("Invalid transform.", 0, ERRORS, true);
+      return false;
+   }
+   if (!mInput.mKernel.isValid())
+   {
+      mProgress.report("Invalid resampling kernel.", 0, ERRORS, true);
+      return false;
+   }
+   if (mInput.mPixelSize < 0.0)
+   {
+      mProgress.report("The pixel size can not be negative.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mGridSpacing = std::max(1U, std::min(WarpTile::sTileSize, mInput.mGridSpacing));
+   return true;
+}
+
+bool GcpWarp::createTransforms()
+{
+   // GCP pixel locations put the first pixel center at (0.5, 0.5) and coordinates are (latitude, longitude)
+   const std::list<GcpPoint>& points = mpGcpList->getSelectedPoints();
+   std::vector<LocationType> pixels;
+   std::vector<LocationType> coordinates;
+   for (std::list<GcpPoint>::const_iterator point = points.begin(); point != points.end(); ++point)
+   {
+      pixels.push_back(point->mPixel);
+      coordinates.push_back(point->mCoordinate);
+   }
+
+   std::string errorMessage;
+   std::auto_ptr<GcpTransform> pForward;
+   if (mTransformType == POLYNOMIAL_TRANSFORM)
+   {
+      std::auto_ptr<PolynomialTransform> pPolyForward(new PolynomialTransform);
+      std::auto_ptr<PolynomialTransform> pPolyInverse(new PolynomialTransform);
+      if (!pPolyForward->fit(pixels, coordinates, mOrder, errorMessage) ||
+          !pPolyInverse->fit(coordinates, pixels, mOrder, errorMessage))
+      {
+         mProgress.report(errorMessage, 0, ERRORS, true);
+         return false;
+      }
+      pForward.reset(pPolyForward.release());
+      mpInverse.reset(pPolyInverse.release());
+   }
+   else
+   {
+      std::auto_ptr<ThinPlateSplineTransform> pSplineForward(new ThinPlateSplineTransform);
+      std::auto_ptr<ThinPlateSplineTransform> pSplineInverse(new ThinPlateSplineTransform);
+      if (!pSplineForward->fit(pixels, coordinates, errorMessage) ||
+          !pSplineInverse->fit(coordinates, pixels, errorMessage))
+      {
+         mProgress.report(errorMessage, 0, ERRORS, true);
+         return false;
+      }
+      pForward.reset(pSplineForward.release());
+      mpInverse.reset(pSplineInverse.release());
+   }
+   mInput.mpInverse = mpInverse.get();
+   mProgress.report("GCP residual is " + StringUtilities::toDisplayString(
+      mpInverse->getRmsError(coordinates, pixels)) + " pixels RMS.", 1, NORMAL);
+
+   // the output grid covers the source outline
+   double rows = mInput.mpDescriptor->getRowCount();
+   double columns = mInput.mpDescriptor->getColumnCount();
+   const unsigned int steps = 32;
+   double north = -std::numeric_limits<double>::max();
+   double south = std::numeric_limits<double>::max();
+   double east = -std::numeric_limits<double>::max();
+   double west = std::numeric_limits<double>::max();
+   for (unsigned int step = 0; step <= steps; step++)
+   {
+      double fraction = static_cast<double>(step) / steps;
+      LocationType outline[4] = { LocationType(fraction * columns, 0.0), LocationType(fraction * columns, rows),
+                                  LocationType(0.0, fraction * rows), LocationType(columns, fraction * rows) };
+      for (unsigned int idx = 0; idx < 4; idx++)
+      {
+         LocationType coordinate = pForward->transform(outline[idx]);
+         north = std::max(north, coordinate.mX);
+         south = std::min(south, coordinate.mX);
+         east = std::max(east, coordinate.mY);
+         west = std::min(west, coordinate.mY);
+      }
+   }
+   if (mInput.mPixelSize == 0.0)
+   {
+      // keep the area of a source pixel at the scene center
+      LocationType center = pForward->transform(LocationType(columns / 2.0, rows / 2.0));
+      LocationType right = pForward->transform(LocationType(columns / 2.0 + 1.0, rows / 2.0));
+      LocationType down = pForward->transform(LocationType(columns / 2.0, rows / 2.0 + 1.0));
+      mInput.mPixelSize = sqrt(fabs((right.mX - center.mX) * (down.mY - center.mY) -
+         (right.mY - center.mY) * (down.mX - center.mX)));
+   }
+   if (!(mInput.mPixelSize > 0.0) || !(north > south) || !(east > west))
+   {
+      mProgress.report("The GCPs do not define an output grid.", 0, ERRORS, true);
+      return false;
+   }
+   double resultRows = ceil((north - south) / mInput.mPixelSize);
+   double resultColumns = ceil((east - west) / mInput.mPixelSize);
+   if (resultRows * resultColumns > 64.0 * rows * columns + 1.0e6)
+   {
+      mProgress.report("The output grid is too large. Increase the pixel size or check the GCPs.", 0, ERRORS, true);
+      return false;
+   }
+   mResultRows = static_cast<unsigned int>(resultRows);
+   mResultColumns = static_cast<unsigned int>(resultColumns);
+   mInput.mNorth = north;
+   mInput.mWest = west;
+   return true;
+}
+
+bool GcpWarp::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   if (pView->createLayer(RASTER, mInput.mpResult) == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   std::vector<DataElement*> lists = Service<ModelServices>()->getElements(mInput.mpResult,
+      TypeConverter::toString<GcpList>());
+   if (!lists.empty() && pView->createLayer(GCP_LAYER, lists.front()) == NULL)
+   {
+      mProgress.report("Unable to display corner coordinates.", 0, WARNING, true);
+   }
+   return true;
+}
+
+GcpWarp::GcpWarpThread::GcpWarpThread(const GcpWarpThreadInput &input, int threadCount, int threadIndex,
+                                      mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void GcpWarp::GcpWarpThread::run()
+{
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setInterleaveFormat(BIP);
+   pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+   if (!accessor.isValid() || !resultAccessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+
+   TileWarper warper(*this, accessor);
+   WarpTile::writeTiles(mInput.mpResultDescriptor, resultAccessor, mRowRange, mInput.mpAbortFlag, getReporter(),
+      getThreadIndex(), warper);
+}
+
+void GcpWarp::GcpWarpThread::TileWarper::operator()(void* pTile, unsigned int firstRow, unsigned int firstColumn,
+                                                    unsigned int rows, unsigned int columns)
+{
+   switchOnEncoding(mThread.mInput.mpDescriptor->getDataType(), mThread.warpTile, pTile, firstRow, firstColumn,
+      rows, columns, mAccessor);
+}
+
+template<typename T>
+void GcpWarp::GcpWarpThread::warpTile(T* pTile, unsigned int firstRow, unsigned int firstColumn,
+                                      unsigned int rows, unsigned int columns, DataAccessor& accessor)
+{
+   unsigned int bands = mInput.mpDescriptor->getBandCount();
+   T fillValue = WarpTile::toEncoding<T>(mInput.mFillValue);
+   std::fill(pTile, pTile + rows * columns * bands, fillValue);
+
+   std::vector<LocationType> locations;
+   WarpTile::mapTile(InverseMapping(*mInput.mpInverse), mInput.mNorth, mInput.mWest, mInput.mPixelSize,
+      firstRow, firstColumn, rows, columns, mInput.mGridSpacing, locations);
+   TileWriter<T> writer(pTile, bands);
+   WarpTile::resampleTile<T>(accessor, locations, mInput.mKernel, mInput.mpDescriptor->getRowCount(),
+      mInput.mpDescriptor->getColumnCount(), bands, writer);
+}
+
+bool GcpWarp::GcpWarpThreadOutput::compileOverallResults(const std::vector<GcpWarpThread*>& threads)
+{
+   return true;
+}
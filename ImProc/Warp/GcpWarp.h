@@ -0,0 +1,126 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef GCPWARP_H__
+#define GCPWARP_H__
+
+#include "AlgorithmShell.h"
+#include "EnumWrapper.h"
+#include "GcpTransform.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+#include "Resampler.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class DataAccessor;
+class GcpList;
+class RasterDataDescriptor;
+class RasterElement;
+
+enum WarpTransformTypeEnum { POLYNOMIAL_TRANSFORM, THIN_PLATE_SPLINE_TRANSFORM };
+typedef EnumWrapper<WarpTransformTypeEnum> WarpTransformType;
+
+/**
+ * Warp a raster element to a north up latitude/longitude grid using its GCP list.
+ *
+ * The inverse transform, from grid coordinates to source pixels, is fit directly to the GCPs. Output
+ * is produced in square tiles. The exact transform is evaluated on a coarse grid of nodes in each tile
+ * and interpolated between them, and only the source window under a tile is read. Memory use depends
+ * on the tile size and not the scene size, and the result is created on disk.
+ */
+class GcpWarp : public AlgorithmShell
+{
+public:
+   GcpWarp();
+   virtual ~GcpWarp();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Fit the forward and inverse transforms and lay out the output grid.
+    */
+   bool createTransforms();
+
+   struct GcpWarpThreadInput
+   {
+      GcpWarpThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL),
+         mpInverse(NULL), mKernel(BILINEAR_KERNEL), mNorth(0.0), mWest(0.0), mPixelSize(1.0), mGridSpacing(16),
+         mFillValue(0.0), mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      const GcpTransform* mpInverse;
+      ResamplingKernel mKernel;
+      double mNorth; // latitude of the top edge of the output grid
+      double mWest; // longitude of the left edge of the output grid
+      double mPixelSize;
+      unsigned int mGridSpacing;
+      double mFillValue;
+      const bool* mpAbortFlag;
+   };
+
+   class GcpWarpThread : public mta::AlgorithmThread
+   {
+   public:
+      GcpWarpThread(const GcpWarpThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      template<typename T> void warpTile(T* pTile, unsigned int firstRow, unsigned int firstColumn,
+         unsigned int rows, unsigned int columns, DataAccessor& accessor);
+
+      // fills result tiles for WarpTile::writeTiles()
+      class TileWarper
+      {
+      public:
+         TileWarper(GcpWarpThread& thread, DataAccessor& accessor) : mThread(thread), mAccessor(accessor) {}
+         void operator()(void* pTile, unsigned int firstRow, unsigned int firstColumn, unsigned int rows,
+            unsigned int columns);
+
+      private:
+         GcpWarpThread& mThread;
+         DataAccessor& mAccessor;
+      };
+
+      const GcpWarpThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct GcpWarpThreadOutput
+   {
+      bool compileOverallResults(const std::vector<GcpWarpThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   GcpWarpThreadInput mInput;
+   std::string mResultName;
+   GcpList* mpGcpList;
+   WarpTransformType mTransformType;
+   unsigned int mOrder;
+   std::auto_ptr<GcpTransform> mpInverse;
+   unsigned int mResultRows;
+   unsigned int mResultColumns;
+   bool mAbortFlag;
+};
+
+#endif
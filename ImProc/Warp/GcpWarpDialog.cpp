@@ -0,0 +1,160 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "GcpList.h"
+#include "GcpWarpDialog.h"
+#include "ModelServices.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "TypeConverter.h"
+#include <QtCore/QVariant>
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QSpinBox>
+
+namespace
+{
+   template<typename T>
+   void addEnumItems(QComboBox* pCombo)
+   {
+      std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<T>();
+      for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+      {
+         pCombo->addItem(QString::fromStdString(*val));
+      }
+   }
+
+   template<typename T>
+   void setEnumItem(QComboBox* pCombo, T value)
+   {
+      pCombo->setCurrentIndex(pCombo->findText(QString::fromStdString(StringUtilities::toDisplayString(value))));
+   }
+}
+
+GcpWarpDialog::GcpWarpDialog(const RasterElement* pRaster, QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pGcpLabel = new QLabel("GCP List:", this);
+   mpGcpList = new QComboBox(this);
+   mpGcpList->setEditable(false);
+   std::vector<DataElement*> lists = Service<ModelServices>()->getElements(pRaster, TypeConverter::toString<GcpList>());
+   for (std::vector<DataElement*>::iterator list = lists.begin(); list != lists.end(); ++list)
+   {
+      mpGcpList->addItem(QString::fromStdString((*list)->getName()), reinterpret_cast<qulonglong>(*list));
+   }
+   mpGcpList->setToolTip("The selected points of this list are the control points.");
+   QLabel* pTransformLabel = new QLabel("Transform:", this);
+   mpTransform = new QComboBox(this);
+   mpTransform->setEditable(false);
+   addEnumItems<WarpTransformType>(mpTransform);
+   mpTransform->setToolTip("A polynomial is a least squares fit. A thin plate spline passes through every GCP.");
+   QLabel* pOrderLabel = new QLabel("Polynomial Order:", this);
+   mpOrder = new QSpinBox(this);
+   mpOrder->setRange(1, 3);
+   QLabel* pKernelLabel = new QLabel("Resampling:", this);
+   mpKernel = new QComboBox(this);
+   mpKernel->setEditable(false);
+   addEnumItems<ResamplingKernel>(mpKernel);
+   QLabel* pPixelSizeLabel = new QLabel("Pixel Size:", this);
+   mpPixelSize = new QDoubleSpinBox(this);
+   mpPixelSize->setRange(0.0, 10.0);
+   mpPixelSize->setDecimals(8);
+   mpPixelSize->setSingleStep(0.0001);
+   mpPixelSize->setSuffix(" deg");
+   mpPixelSize->setSpecialValueText("Automatic");
+   mpPixelSize->setToolTip("Automatic matches the source resolution at the scene center.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pGcpLabel, 0, 0);
+   pTopLevel->addWidget(mpGcpList, 0, 1);
+   pTopLevel->addWidget(pTransformLabel, 1, 0);
+   pTopLevel->addWidget(mpTransform, 1, 1);
+   pTopLevel->addWidget(pOrderLabel, 2, 0);
+   pTopLevel->addWidget(mpOrder, 2, 1);
+   pTopLevel->addWidget(pKernelLabel, 3, 0);
+   pTopLevel->addWidget(mpKernel, 3, 1);
+   pTopLevel->addWidget(pPixelSizeLabel, 4, 0);
+   pTopLevel->addWidget(mpPixelSize, 4, 1);
+   pTopLevel->addWidget(pButtons, 5, 0, 1, 2);
+
+   connect(mpTransform, SIGNAL(currentIndexChanged(int)), this, SLOT(updateOrder()));
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+   updateOrder();
+}
+
+GcpWarpDialog::~GcpWarpDialog()
+{
+}
+
+GcpList* GcpWarpDialog::getGcpList() const
+{
+   if (mpGcpList->currentIndex() < 0)
+   {
+      return NULL;
+   }
+   return reinterpret_cast<GcpList*>(mpGcpList->itemData(mpGcpList->currentIndex()).toULongLong());
+}
+
+WarpTransformType GcpWarpDialog::getTransformType() const
+{
+   return StringUtilities::fromDisplayString<WarpTransformType>(mpTransform->currentText().toStdString());
+}
+
+unsigned int GcpWarpDialog::getOrder() const
+{
+   return static_cast<unsigned int>(mpOrder->value());
+}
+
+ResamplingKernel GcpWarpDialog::getKernel() const
+{
+   return StringUtilities::fromDisplayString<ResamplingKernel>(mpKernel->currentText().toStdString());
+}
+
+double GcpWarpDialog::getPixelSize() const
+{
+   return mpPixelSize->value();
+}
+
+void GcpWarpDialog::setGcpList(GcpList* pGcpList)
+{
+   int idx = mpGcpList->findData(reinterpret_cast<qulonglong>(pGcpList));
+   if (idx >= 0)
+   {
+      mpGcpList->setCurrentIndex(idx);
+   }
+}
+
+void GcpWarpDialog::setTransformType(WarpTransformType transformType)
+{
+   setEnumItem(mpTransform, transformType);
+}
+
+void GcpWarpDialog::setOrder(unsigned int order)
+{
+   mpOrder->setValue(static_cast<int>(order));
+}
+
+void GcpWarpDialog::setKernel(ResamplingKernel kernel)
+{
+   setEnumItem(mpKernel, kernel);
+}
+
+void GcpWarpDialog::setPixelSize(double pixelSize)
+{
+   mpPixelSize->setValue(pixelSize);
+}
+
+void GcpWarpDialog::updateOrder()
+{
+   mpOrder->setEnabled(getTransformType() == POLYNOMIAL_TRANSFORM);
+}
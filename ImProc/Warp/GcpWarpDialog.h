@@ -0,0 +1,49 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef GCPWARPDIALOG_H
+#define GCPWARPDIALOG_H
+
+#include "GcpWarp.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QDoubleSpinBox;
+class QSpinBox;
+
+class GcpWarpDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   GcpWarpDialog(const RasterElement* pRaster, QWidget* pParent=NULL);
+   virtual ~GcpWarpDialog();
+
+   GcpList* getGcpList() const;
+   WarpTransformType getTransformType() const;
+   unsigned int getOrder() const;
+   ResamplingKernel getKernel() const;
+   double getPixelSize() const;
+   void setGcpList(GcpList* pGcpList);
+   void setTransformType(WarpTransformType transformType);
+   void setOrder(unsigned int order);
+   void setKernel(ResamplingKernel kernel);
+   void setPixelSize(double pixelSize);
+
+private slots:
+   void updateOrder();
+
+private:
+   QComboBox* mpGcpList;
+   QComboBox* mpTransform;
+   QSpinBox* mpOrder;
+   QComboBox* mpKernel;
+   QDoubleSpinBox* mpPixelSize;
+};
+
+#endif
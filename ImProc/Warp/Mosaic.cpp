@@ -0,0 +1,616 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "GcpLayer.h"
+#include "GcpList.h"
+#include "ImProcVersion.h"
+#include "Mosaic.h"
+#include "MosaicDialog.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilities.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+#include "WarpTile.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+
+REGISTER_PLUGIN_BASIC(Warp, Mosaic);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(MosaicBlending)
+ADD_ENUM_MAPPING(FEATHER_BLENDING, "Feather", "feather")
+ADD_ENUM_MAPPING(MAX_NDVI_BLENDING, "Maximum NDVI", "maxndvi")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   // below any NDVI so the first scene at a pixel always wins
+   const double sNoScore = -2.0;
+
+   /**
+    * Maps grid coordinates to scene pixels with the scene's georeference.
+    */
+   class SceneMapping
+   {
+   public:
+      SceneMapping(const RasterElement& raster) : mRaster(raster) {}
+
+      LocationType operator()(const LocationType& coordinate) const
+      {
+         return mRaster.convertGeocoordToPixel(coordinate);
+      }
+
+   private:
+      const RasterElement& mRaster;
+   };
+
+   /**
+    * Adds resampled pixels weighted by their distance to the scene edge.
+    */
+   class FeatherBlender
+   {
+   public:
+      FeatherBlender(std::vector<double>& values, std::vector<double>& weights, const std::vector<LocationType>& locations,
+         int rows, int columns, double featherWidth, unsigned int bands) :
+         mValues(values), mWeights(weights), mLocations(locations), mRows(rows), mColumns(columns),
+         mFeatherWidth(featherWidth), mBands(bands) {}
+
+      void operator()(unsigned int pixel, const double* pValues)
+      {
+         const LocationType& location = mLocations[pixel];
+         double distance = std::min(std::min(location.mY + 0.5, mRows - 0.5 - location.mY),
+            std::min(location.mX + 0.5, mColumns - 0.5 - location.mX));
+         double weight = (mFeatherWidth > 0.0) ? std::min(1.0, distance / mFeatherWidth) : 1.0;
+         // pixels on the very edge still count where no other scene covers them
+         weight = std::max(weight, 1e-6);
+         double* pSums = &mValues[pixel * mBands];
+         for (unsigned int band = 0; band < mBands; band++)
+         {
+            pSums[band] += weight * pValues[band];
+         }
+         mWeights[pixel] += weight;
+      }
+
+   private:
+      std::vector<double>& mValues;
+      std::vector<double>& mWeights;
+      const std::vector<LocationType>& mLocations;
+      int mRows;
+      int mColumns;
+      double mFeatherWidth;
+      unsigned int mBands;
+   };
+
+   /**
+    * Keeps the resampled pixel with the largest NDVI.
+    */
+   class MaxNdviBlender
+   {
+   public:
+      MaxNdviBlender(std::vector<double>& values, std::vector<double>& ndvis, unsigned int bands,
+         unsigned int redBand, unsigned int nirBand) :
+         mValues(values), mNdvis(ndvis), mBands(bands), mRedBand(redBand), mNirBand(nirBand) {}
+
+      void operator()(unsigned int pixel, const double* pValues)
+      {
+         double red = pValues[mRedBand];
+         double nir = pValues[mNirBand];
+         double ndvi = (nir + red > 0.0) ? (nir - red) / (nir + red) : -1.0;
+         if (ndvi > mNdvis[pixel])
+         {
+            mNdvis[pixel] = ndvi;
+            std::copy(pValues, pValues + mBands, mValues.begin() + pixel * mBands);
+         }
+      }
+
+   private:
+      std::vector<double>& mValues;
+      std::vector<double>& mNdvis;
+      unsigned int mBands;
+      unsigned int mRedBand;
+      unsigned int mNirBand;
+   };
+}
+
+Mosaic::Mosaic() :
+   mResultRows(0),
+   mResultColumns(0),
+   mAbortFlag(false)
+{
+   setName("Mosaic");
+   setDescription("Mosaic georeferenced data sets onto a latitude/longitude grid.");
+   setDescriptorId("{9C4A7E21-D6B3-4F08-8E15-3B2A6F90C7D4}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Warp/Mosaic");
+}
+
+Mosaic::~Mosaic()
+{
+}
+
+bool Mosaic::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg(), NULL,
+      "The first scene. It sets the encoding and band count of the mosaic."));
+   VERIFY(pInArgList->addArg<std::vector<std::string> >("Additional Scenes", std::vector<std::string>(),
+      "Names of the other raster elements to mosaic."));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   std::string blendingHelp = "Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<MosaicBlending>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<MosaicBlending>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      blendingHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Blending",
+      StringUtilities::toXmlString<MosaicBlending>(FEATHER_BLENDING), blendingHelp));
+   VERIFY(pInArgList->addArg<double>("Feather Width", mInput.mFeatherWidth,
+      "Scene pixels from the scene edge where feathering reaches full weight."));
+   VERIFY(pInArgList->addArg<unsigned int>("Red Band", mInput.mRedBand, "The active red band number for NDVI."));
+   VERIFY(pInArgList->addArg<unsigned int>("NIR Band", mInput.mNirBand, "The active near infrared band number for NDVI."));
+   std::string kernelHelp = "Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<ResamplingKernel>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<ResamplingKernel>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      kernelHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Resampling",
+      StringUtilities::toXmlString<ResamplingKernel>(BILINEAR_KERNEL), kernelHelp));
+   VERIFY(pInArgList->addArg<double>("Pixel Size", 0.0,
+      "The output pixel size in degrees. 0 matches the finest scene resolution."));
+   VERIFY(pInArgList->addArg<unsigned int>("Grid Spacing", mInput.mGridSpacing,
+      "Output pixels between the nodes where the georeference is evaluated exactly."));
+   VERIFY(pInArgList->addArg<double>("Fill Value", mInput.mFillValue, "The value of output pixels outside every scene."));
+   return true;
+}
+
+bool Mosaic::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool Mosaic::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList) || !createGrid())
+   {
+      return false;
+   }
+
+   mProgress.report("Begin mosaic.", 1, NORMAL);
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   const RasterDataDescriptor* pFirst = mInput.mScenes.front().mpDescriptor;
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mResultRows, mResultColumns, pFirst->getBandCount(), pFirst->getDataType(), BIP, false));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   mInput.mpAbortFlag = &mAbortFlag;
+   MosaicThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Mosaicking", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<MosaicThreadInput, MosaicThreadOutput, MosaicThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Mosaic complete.", 100, NORMAL);
+         if (!WarpTile::addCornerCoordinates(mInput.mpResult, mInput.mNorth, mInput.mWest, mInput.mPixelSize))
+         {
+            mProgress.report("Unable to create corner coordinates.", 0, WARNING, true);
+         }
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Mosaic aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Mosaic failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool Mosaic::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{E15B8D03-7A4C-4C62-9F2E-68D0B4A1C395}");
+   std::vector<RasterElement*> rasters;
+   RasterElement* pFirst = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg());
+   if (pFirst != NULL)
+   {
+      rasters.push_back(pFirst);
+   }
+   std::vector<std::string> names;
+   pInArgList->getPlugInArgValue("Additional Scenes", names);
+   for (std::vector<std::string>::const_iterator name = names.begin(); name != names.end(); ++name)
+   {
+      RasterElement* pRaster = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(*name, TypeConverter::toString<RasterElement>(), NULL));
+      if (pRaster == NULL)
+      {
+         mProgress.report("No raster element named " + *name + ".", 0, ERRORS, true);
+         return false;
+      }
+      rasters.push_back(pRaster);
+   }
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = "Mosaic";
+   }
+   std::string blending;
+   pInArgList->getPlugInArgValue("Blending", blending);
+   mInput.mBlending = StringUtilities::fromXmlString<MosaicBlending>(blending);
+   pInArgList->getPlugInArgValue("Feather Width", mInput.mFeatherWidth);
+   pInArgList->getPlugInArgValue("Red Band", mInput.mRedBand);
+   pInArgList->getPlugInArgValue("NIR Band", mInput.mNirBand);
+   std::string kernel;
+   pInArgList->getPlugInArgValue("Resampling", kernel);
+   mInput.mKernel = StringUtilities::fromXmlString<ResamplingKernel>(kernel);
+   pInArgList->getPlugInArgValue("Pixel Size", mInput.mPixelSize);
+   pInArgList->getPlugInArgValue("Grid Spacing", mInput.mGridSpacing);
+   pInArgList->getPlugInArgValue("Fill Value", mInput.mFillValue);
+
+   if (!isBatch())
+   {
+      MosaicDialog dlg;
+      dlg.setScenes(rasters);
+      dlg.setBlending(mInput.mBlending);
+      dlg.setFeatherWidth(mInput.mFeatherWidth);
+      dlg.setRedBand(mInput.mRedBand);
+      dlg.setNirBand(mInput.mNirBand);
+      dlg.setKernel(mInput.mKernel);
+      dlg.setPixelSize(mInput.mPixelSize);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      rasters = dlg.getScenes();
+      mInput.mBlending = dlg.getBlending();
+      mInput.mFeatherWidth = dlg.getFeatherWidth();
+      mInput.mRedBand = dlg.getRedBand();
+      mInput.mNirBand = dlg.getNirBand();
+      mInput.mKernel = dlg.getKernel();
+      mInput.mPixelSize = dlg.getPixelSize();
+   }
+   if (rasters.empty())
+   {
+      mProgress.report("No scenes.", 0, ERRORS, true);
+      return false;
+   }
+   if (!mInput.mBlending.isValid())
+   {
+      mProgress.report("Invalid blending.", 0, ERRORS, true);
+      return false;
+   }
+   if (!mInput.mKernel.isValid())
+   {
+      mProgress.report("Invalid resampling kernel.", 0, ERRORS, true);
+      return false;
+   }
+   if (mInput.mPixelSize < 0.0)
+   {
+      mProgress.report("The pixel size can not be negative.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mGridSpacing = std::max(1U, std::min(WarpTile::sTileSize, mInput.mGridSpacing));
+
+   mInput.mScenes.clear();
+   for (std::vector<RasterElement*>::const_iterator raster = rasters.begin(); raster != rasters.end(); ++raster)
+   {
+      Scene scene;
+      scene.mpRaster = *raster;
+      scene.mpDescriptor = static_cast<const RasterDataDescriptor*>((*raster)->getDataDescriptor());
+      if (!(*raster)->isGeoreferenced())
+      {
+         mProgress.report((*raster)->getName() + " is not georeferenced.", 0, ERRORS, true);
+         return false;
+      }
+      EncodingType encoding = scene.mpDescriptor->getDataType();
+      if (encoding == INT4SCOMPLEX || encoding == FLT8COMPLEX)
+      {
+         mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+         return false;
+      }
+      if (!mInput.mScenes.empty() &&
+          scene.mpDescriptor->getBandCount() != mInput.mScenes.front().mpDescriptor->getBandCount())
+      {
+         mProgress.report("Every scene must have the same number of bands.", 0, ERRORS, true);
+         return false;
+      }
+      mInput.mScenes.push_back(scene);
+   }
+   unsigned int bands = mInput.mScenes.front().mpDescriptor->getBandCount();
+   if (mInput.mBlending == MAX_NDVI_BLENDING && (mInput.mRedBand >= bands || mInput.mNirBand >= bands))
+   {
+      mProgress.report("Invalid red or NIR band.", 0, ERRORS, true);
+      return false;
+   }
+   return true;
+}
+
+bool Mosaic::createGrid()
+{
+   const unsigned int steps = 32;
+   double north = -std::numeric_limits<double>::max();
+   double south = std::numeric_limits<double>::max();
+   double east = -std::numeric_limits<double>::max();
+   double west = std::numeric_limits<double>::max();
+   double finest = std::numeric_limits<double>::max();
+   for (std::vector<Scene>::iterator scene = mInput.mScenes.begin(); scene != mInput.mScenes.end(); ++scene)
+   {
+      double rows = scene->mpDescriptor->getRowCount();
+      double columns = scene->mpDescriptor->getColumnCount();
+      scene->mNorth = -std::numeric_limits<double>::max();
+      scene->mSouth = std::numeric_limits<double>::max();
+      scene->mEast = -std::numeric_limits<double>::max();
+      scene->mWest = std::numeric_limits<double>::max();
+      for (unsigned int step = 0; step <= steps; step++)
+      {
+         double fraction = static_cast<double>(step) / steps;
+         LocationType outline[4] = { LocationType(fraction * columns, 0.0), LocationType(fraction * columns, rows),
+                                     LocationType(0.0, fraction * rows), LocationType(columns, fraction * rows) };
+         for (unsigned int idx = 0; idx < 4; idx++)
+         {
+            LocationType coordinate = scene->mpRaster->convertPixelToGeocoord(outline[idx]);
+            scene->mNorth = std::max(scene->mNorth, coordinate.mX);
+            scene->mSouth = std::min(scene->mSouth, coordinate.mX);
+            scene->mEast = std::max(scene->mEast, coordinate.mY);
+            scene->mWest = std::min(scene->mWest, coordinate.mY);
+         }
+      }
+      north = std::max(north, scene->mNorth);
+      south = std::min(south, scene->mSouth);
+      east = std::max(east, scene->mEast);
+      west = std::min(west, scene->mWest);
+
+      // the side of a square with the area of a pixel at the scene center
+      LocationType center = scene->mpRaster->convertPixelToGeocoord(LocationType(columns / 2.0, rows / 2.0));
+      LocationType right = scene->mpRaster->convertPixelToGeocoord(LocationType(columns / 2.0 + 1.0, rows / 2.0));
+      LocationType down = scene->mpRaster->convertPixelToGeocoord(LocationType(columns / 2.0, rows / 2.0 + 1.0));
+      double pixelSize = sqrt(fabs((right.mX - center.mX) * (down.mY - center.mY) -
+         (right.mY - center.mY) * (down.mX - center.mX)));
+      if (pixelSize > 0.0)
+      {
+         finest = std::min(finest, pixelSize);
+      }
+   }
+   if (mInput.mPixelSize == 0.0)
+   {
+      mInput.mPixelSize = finest;
+   }
+   if (!(mInput.mPixelSize > 0.0) || mInput.mPixelSize == std::numeric_limits<double>::max() ||
+       !(north > south) || !(east > west))
+   {
+      mProgress.report("The scene footprints do not define an output grid.", 0, ERRORS, true);
+      return false;
+   }
+   double resultRows = ceil((north - south) / mInput.mPixelSize);
+   double resultColumns = ceil((east - west) / mInput.mPixelSize);
+   double scenePixels = 0.0;
+   for (std::vector<Scene>::const_iterator scene = mInput.mScenes.begin(); scene != mInput.mScenes.end(); ++scene)
+   {
+      scenePixels += static_cast<double>(scene->mpDescriptor->getRowCount()) * scene->mpDescriptor->getColumnCount();
+   }
+   if (resultRows * resultColumns > 64.0 * scenePixels + 1.0e6)
+   {
+      mProgress.report("The output grid is too large. Increase the pixel size or check the georeferences.",
+         0, ERRORS, true);
+      return false;
+   }
+   mResultRows = static_cast<unsigned int>(resultRows);
+   mResultColumns = static_cast<unsigned int>(resultColumns);
+   mInput.mNorth = north;
+   mInput.mWest = west;
+   return true;
+}
+
+bool Mosaic::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   if (pView->createLayer(RASTER, mInput.mpResult) == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   std::vector<DataElement*> lists = Service<ModelServices>()->getElements(mInput.mpResult,
+      TypeConverter::toString<GcpList>());
+   if (!lists.empty() && pView->createLayer(GCP_LAYER, lists.front()) == NULL)
+   {
+      mProgress.report("Unable to display corner coordinates.", 0, WARNING, true);
+   }
+   return true;
+}
+
+Mosaic::MosaicThread::MosaicThread(const MosaicThreadInput &input, int threadCount, int threadIndex,
+                                   mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void Mosaic::MosaicThread::run()
+{
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+   std::vector<DataAccessor> accessors;
+   for (std::vector<Scene>::const_iterator scene = mInput.mScenes.begin(); scene != mInput.mScenes.end(); ++scene)
+   {
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setInterleaveFormat(BIP);
+      accessors.push_back(scene->mpRaster->getDataAccessor(pRequest.release()));
+      if (!accessors.back().isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+   }
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setInterleaveFormat(BIP);
+   pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+   if (!resultAccessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+
+   TileBlender blender(*this, accessors);
+   WarpTile::writeTiles(mInput.mpResultDescriptor, resultAccessor, mRowRange, mInput.mpAbortFlag, getReporter(),
+      getThreadIndex(), blender);
+}
+
+void Mosaic::MosaicThread::TileBlender::operator()(void* pTile, unsigned int firstRow, unsigned int firstColumn,
+                                                   unsigned int rows, unsigned int columns)
+{
+   const MosaicThreadInput& input = mThread.mInput;
+   double tileNorth = input.mNorth - firstRow * input.mPixelSize;
+   double tileSouth = tileNorth - rows * input.mPixelSize;
+   double tileWest = input.mWest + firstColumn * input.mPixelSize;
+   double tileEast = tileWest + columns * input.mPixelSize;
+   mBlend.mValues.assign(rows * columns * input.mpResultDescriptor->getBandCount(), 0.0);
+   mBlend.mScores.assign(rows * columns, input.mBlending == FEATHER_BLENDING ? 0.0 : sNoScore);
+   for (unsigned int idx = 0; idx < input.mScenes.size(); idx++)
+   {
+      const Scene& scene = input.mScenes[idx];
+      if (scene.mNorth < tileSouth || scene.mSouth > tileNorth || scene.mEast < tileWest || scene.mWest > tileEast)
+      {
+         continue;
+      }
+      switchOnEncoding(scene.mpDescriptor->getDataType(), mThread.blendScene, NULL, scene, mAccessors[idx],
+         firstRow, firstColumn, rows, columns, mBlend);
+   }
+   switchOnEncoding(input.mpResultDescriptor->getDataType(), mThread.storeTile, pTile, mBlend);
+}
+
+template<typename T>
+void Mosaic::MosaicThread::blendScene(T* pUnused, const Scene& scene, DataAccessor& accessor, unsigned int firstRow,
+                                      unsigned int firstColumn, unsigned int rows, unsigned int columns, TileBlend& blend)
+{
+   int sceneRows = scene.mpDescriptor->getRowCount();
+   int sceneColumns = scene.mpDescriptor->getColumnCount();
+   unsigned int bands = scene.mpDescriptor->getBandCount();
+   std::vector<LocationType> locations;
+   WarpTile::mapTile(SceneMapping(*scene.mpRaster), mInput.mNorth, mInput.mWest, mInput.mPixelSize,
+      firstRow, firstColumn, rows, columns, mInput.mGridSpacing, locations);
+   if (mInput.mBlending == FEATHER_BLENDING)
+   {
+      FeatherBlender blender(blend.mValues, blend.mScores, locations, sceneRows, sceneColumns,
+         mInput.mFeatherWidth, bands);
+      WarpTile::resampleTile<T>(accessor, locations, mInput.mKernel, sceneRows, sceneColumns, bands, blender);
+   }
+   else
+   {
+      MaxNdviBlender blender(blend.mValues, blend.mScores, bands, mInput.mRedBand, mInput.mNirBand);
+      WarpTile::resampleTile<T>(accessor, locations, mInput.mKernel, sceneRows, sceneColumns, bands, blender);
+   }
+}
+
+template<typename T>
+void Mosaic::MosaicThread::storeTile(T* pTile, const TileBlend& blend)
+{
+   unsigned int bands = mInput.mpResultDescriptor->getBandCount();
+   T fillValue = WarpTile::toEncoding<T>(mInput.mFillValue);
+   bool feather = (mInput.mBlending == FEATHER_BLENDING);
+   for (unsigned int pixel = 0; pixel < blend.mScores.size(); pixel++)
+   {
+      double score = blend.mScores[pixel];
+      bool covered = feather ? (score > 0.0) : (score > sNoScore);
+      double scale = (feather && covered) ? 1.0 / score : 1.0;
+      const double* pValues = &blend.mValues[pixel * bands];
+      T* pOut = pTile + pixel * bands;
+      for (unsigned int band = 0; band < bands; band++)
+      {
+         pOut[band] = covered ? WarpTile::toEncoding<T>(pValues[band] * scale) : fillValue;
+      }
+   }
+}
+
+bool Mosaic::MosaicThreadOutput::compileOverallResults(const std::vector<MosaicThread*>& threads)
+{
+   return true;
+}
@@ -0,0 +1,149 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef MOSAIC_H__
+#define MOSAIC_H__
+
+#include "AlgorithmShell.h"
+#include "EnumWrapper.h"
+#include "LocationType.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+#include "Resampler.h"
+
+#include <string>
+#include <vector>
+
+class DataAccessor;
+class RasterDataDescriptor;
+class RasterElement;
+
+enum MosaicBlendingEnum { FEATHER_BLENDING, MAX_NDVI_BLENDING };
+typedef EnumWrapper<MosaicBlendingEnum> MosaicBlending;
+
+/**
+ * Mosaic georeferenced raster elements onto a north up latitude/longitude grid.
+ *
+ * The output grid covers the footprints of the scenes. Each output tile is built from only the scenes
+ * whose footprint overlaps it, reading just the source window under the tile, so every input pixel is
+ * read about once and the result is written to disk as it is produced.
+ *
+ * Feather blending weights each scene by the distance to its edge, reaching full weight at the
+ * feather width. Max NDVI blending keeps the scene with the greenest pixel, which favors cloud free
+ * and leaf on acquisitions.
+ */
+class Mosaic : public AlgorithmShell
+{
+public:
+   Mosaic();
+   virtual ~Mosaic();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Compute the scene footprints and lay out the output grid.
+    */
+   bool createGrid();
+
+   struct Scene
+   {
+      Scene() : mpRaster(NULL), mpDescriptor(NULL), mNorth(0.0), mSouth(0.0), mEast(0.0), mWest(0.0) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      double mNorth;
+      double mSouth;
+      double mEast;
+      double mWest;
+   };
+
+   struct MosaicThreadInput
+   {
+      MosaicThreadInput() : mpResultDescriptor(NULL), mpResult(NULL), mKernel(BILINEAR_KERNEL),
+         mBlending(FEATHER_BLENDING), mFeatherWidth(64.0), mRedBand(0), mNirBand(3), mNorth(0.0), mWest(0.0),
+         mPixelSize(0.0), mGridSpacing(16), mFillValue(0.0), mpAbortFlag(NULL) {}
+      std::vector<Scene> mScenes;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      ResamplingKernel mKernel;
+      MosaicBlending mBlending;
+      double mFeatherWidth; // in source pixels
+      unsigned int mRedBand;
+      unsigned int mNirBand;
+      double mNorth; // latitude of the top edge of the output grid
+      double mWest; // longitude of the left edge of the output grid
+      double mPixelSize;
+      unsigned int mGridSpacing;
+      double mFillValue;
+      const bool* mpAbortFlag;
+   };
+
+   /**
+    * The blended values of a tile. Feather blending keeps weighted sums and the total weight of each
+    * pixel and max NDVI blending keeps the values and NDVI of the greenest scene so far.
+    */
+   struct TileBlend
+   {
+      std::vector<double> mValues;
+      std::vector<double> mScores;
+   };
+
+   class MosaicThread : public mta::AlgorithmThread
+   {
+   public:
+      MosaicThread(const MosaicThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      template<typename T> void blendScene(T* pUnused, const Scene& scene, DataAccessor& accessor,
+         unsigned int firstRow, unsigned int firstColumn, unsigned int rows, unsigned int columns, TileBlend& blend);
+      template<typename T> void storeTile(T* pTile, const TileBlend& blend);
+
+      // fills result tiles for WarpTile::writeTiles()
+      class TileBlender
+      {
+      public:
+         TileBlender(MosaicThread& thread, std::vector<DataAccessor>& accessors) :
+            mThread(thread), mAccessors(accessors) {}
+         void operator()(void* pTile, unsigned int firstRow, unsigned int firstColumn, unsigned int rows,
+            unsigned int columns);
+
+      private:
+         MosaicThread& mThread;
+         std::vector<DataAccessor>& mAccessors;
+         TileBlend mBlend;
+      };
+
+      const MosaicThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct MosaicThreadOutput
+   {
+      bool compileOverallResults(const std::vector<MosaicThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   MosaicThreadInput mInput;
+   std::string mResultName;
+   unsigned int mResultRows;
+   unsigned int mResultColumns;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,211 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ModelServices.h"
+#include "MosaicDialog.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "TypeConverter.h"
+#include <QtCore/QVariant>
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QDoubleSpinBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QListWidget>
+#include <QtGui/QSpinBox>
+
+#include <algorithm>
+
+namespace
+{
+   template<typename T>
+   void addEnumItems(QComboBox* pCombo)
+   {
+      std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<T>();
+      for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+      {
+         pCombo->addItem(QString::fromStdString(*val));
+      }
+   }
+
+   template<typename T>
+   void setEnumItem(QComboBox* pCombo, T value)
+   {
+      pCombo->setCurrentIndex(pCombo->findText(QString::fromStdString(StringUtilities::toDisplayString(value))));
+   }
+}
+
+MosaicDialog::MosaicDialog(QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pScenesLabel = new QLabel("Scenes:", this);
+   mpScenes = new QListWidget(this);
+   std::vector<DataElement*> rasters = Service<ModelServices>()->getElements(TypeConverter::toString<RasterElement>());
+   for (std::vector<DataElement*>::iterator raster = rasters.begin(); raster != rasters.end(); ++raster)
+   {
+      RasterElement* pRaster = static_cast<RasterElement*>(*raster);
+      if (pRaster->isGeoreferenced())
+      {
+         QListWidgetItem* pItem = new QListWidgetItem(QString::fromStdString(pRaster->getName()), mpScenes);
+         pItem->setData(Qt::UserRole, reinterpret_cast<qulonglong>(pRaster));
+         pItem->setFlags(pItem->flags() | Qt::ItemIsUserCheckable);
+         pItem->setCheckState(Qt::Unchecked);
+      }
+   }
+   mpScenes->setToolTip("Only georeferenced data sets are listed. Every checked scene must have the same bands.");
+   QLabel* pBlendingLabel = new QLabel("Blending:", this);
+   mpBlending = new QComboBox(this);
+   mpBlending->setEditable(false);
+   addEnumItems<MosaicBlending>(mpBlending);
+   mpBlending->setToolTip("Feather blends overlaps by the distance to each scene edge. "
+      "Maximum NDVI keeps the greenest scene at each pixel.");
+   QLabel* pFeatherWidthLabel = new QLabel("Feather Width:", this);
+   mpFeatherWidth = new QDoubleSpinBox(this);
+   mpFeatherWidth->setRange(0.0, 100000.0);
+   mpFeatherWidth->setSuffix(" px");
+   QLabel* pRedBandLabel = new QLabel("Red Band:", this);
+   mpRedBand = new QSpinBox(this);
+   mpRedBand->setRange(1, 10000);
+   QLabel* pNirBandLabel = new QLabel("NIR Band:", this);
+   mpNirBand = new QSpinBox(this);
+   mpNirBand->setRange(1, 10000);
+   QLabel* pKernelLabel = new QLabel("Resampling:", this);
+   mpKernel = new QComboBox(this);
+   mpKernel->setEditable(false);
+   addEnumItems<ResamplingKernel>(mpKernel);
+   QLabel* pPixelSizeLabel = new QLabel("Pixel Size:", this);
+   mpPixelSize = new QDoubleSpinBox(this);
+   mpPixelSize->setRange(0.0, 10.0);
+   mpPixelSize->setDecimals(8);
+   mpPixelSize->setSingleStep(0.0001);
+   mpPixelSize->setSuffix(" deg");
+   mpPixelSize->setSpecialValueText("Automatic");
+   mpPixelSize->setToolTip("Automatic matches the finest scene resolution.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pScenesLabel, 0, 0, Qt::AlignTop);
+   pTopLevel->addWidget(mpScenes, 0, 1);
+   pTopLevel->addWidget(pBlendingLabel, 1, 0);
+   pTopLevel->addWidget(mpBlending, 1, 1);
+   pTopLevel->addWidget(pFeatherWidthLabel, 2, 0);
+   pTopLevel->addWidget(mpFeatherWidth, 2, 1);
+   pTopLevel->addWidget(pRedBandLabel, 3, 0);
+   pTopLevel->addWidget(mpRedBand, 3, 1);
+   pTopLevel->addWidget(pNirBandLabel, 4, 0);
+   pTopLevel->addWidget(mpNirBand, 4, 1);
+   pTopLevel->addWidget(pKernelLabel, 5, 0);
+   pTopLevel->addWidget(mpKernel, 5, 1);
+   pTopLevel->addWidget(pPixelSizeLabel, 6, 0);
+   pTopLevel->addWidget(mpPixelSize, 6, 1);
+   pTopLevel->addWidget(pButtons, 7, 0, 1, 2);
+   pTopLevel->setRowStretch(0, 10);
+
+   connect(mpBlending, SIGNAL(currentIndexChanged(int)), this, SLOT(updateBlending()));
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+   updateBlending();
+}
+
+MosaicDialog::~MosaicDialog()
+{
+}
+
+std::vector<RasterElement*> MosaicDialog::getScenes() const
+{
+   std::vector<RasterElement*> scenes;
+   for (int idx = 0; idx < mpScenes->count(); idx++)
+   {
+      QListWidgetItem* pItem = mpScenes->item(idx);
+      if (pItem->checkState() == Qt::Checked)
+      {
+         scenes.push_back(reinterpret_cast<RasterElement*>(pItem->data(Qt::UserRole).toULongLong()));
+      }
+   }
+   return scenes;
+}
+
+MosaicBlending MosaicDialog::getBlending() const
+{
+   return StringUtilities::fromDisplayString<MosaicBlending>(mpBlending->currentText().toStdString());
+}
+
+double MosaicDialog::getFeatherWidth() const
+{
+   return mpFeatherWidth->value();
+}
+
+unsigned int MosaicDialog::getRedBand() const
+{
+   return static_cast<unsigned int>(mpRedBand->value() - 1);
+}
+
+unsigned int MosaicDialog::getNirBand() const
+{
+   return static_cast<unsigned int>(mpNirBand->value() - 1);
+}
+
+ResamplingKernel MosaicDialog::getKernel() const
+{
+   return StringUtilities::fromDisplayString<ResamplingKernel>(mpKernel->currentText().toStdString());
+}
+
+double MosaicDialog::getPixelSize() const
+{
+   return mpPixelSize->value();
+}
+
+void MosaicDialog::setScenes(const std::vector<RasterElement*>& scenes)
+{
+   for (int idx = 0; idx < mpScenes->count(); idx++)
+   {
+      QListWidgetItem* pItem = mpScenes->item(idx);
+      RasterElement* pRaster = reinterpret_cast<RasterElement*>(pItem->data(Qt::UserRole).toULongLong());
+      bool checked = std::find(scenes.begin(), scenes.end(), pRaster) != scenes.end();
+      pItem->setCheckState(checked ? Qt::Checked : Qt::Unchecked);
+   }
+}
+
+void MosaicDialog::setBlending(MosaicBlending blending)
+{
+   setEnumItem(mpBlending, blending);
+}
+
+void MosaicDialog::setFeatherWidth(double featherWidth)
+{
+   mpFeatherWidth->setValue(featherWidth);
+}
+
+void MosaicDialog::setRedBand(unsigned int band)
+{
+   mpRedBand->setValue(static_cast<int>(band + 1));
+}
+
+void MosaicDialog::setNirBand(unsigned int band)
+{
+   mpNirBand->setValue(static_cast<int>(band + 1));
+}
+
+void MosaicDialog::setKernel(ResamplingKernel kernel)
+{
+   setEnumItem(mpKernel, kernel);
+}
+
+void MosaicDialog::setPixelSize(double pixelSize)
+{
+   mpPixelSize->setValue(pixelSize);
+}
+
+void MosaicDialog::updateBlending()
+{
+   bool feather = (getBlending() == FEATHER_BLENDING);
+   mpFeatherWidth->setEnabled(feather);
+   mpRedBand->setEnabled(!feather);
+   mpNirBand->setEnabled(!feather);
+}
@@ -0,0 +1,56 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef MOSAICDIALOG_H
+#define MOSAICDIALOG_H
+
+#include "Mosaic.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QDoubleSpinBox;
+class QListWidget;
+class QSpinBox;
+
+class MosaicDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   MosaicDialog(QWidget* pParent=NULL);
+   virtual ~MosaicDialog();
+
+   std::vector<RasterElement*> getScenes() const;
+   MosaicBlending getBlending() const;
+   double getFeatherWidth() const;
+   unsigned int getRedBand() const;
+   unsigned int getNirBand() const;
+   ResamplingKernel getKernel() const;
+   double getPixelSize() const;
+   void setScenes(const std::vector<RasterElement*>& scenes);
+   void setBlending(MosaicBlending blending);
+   void setFeatherWidth(double featherWidth);
+   void setRedBand(unsigned int band);
+   void setNirBand(unsigned int band);
+   void setKernel(ResamplingKernel kernel);
+   void setPixelSize(double pixelSize);
+
+private slots:
+   void updateBlending();
+
+private:
+   QListWidget* mpScenes;
+   QComboBox* mpBlending;
+   QDoubleSpinBox* mpFeatherWidth;
+   QSpinBox* mpRedBand;
+   QSpinBox* mpNirBand;
+   QComboBox* mpKernel;
+   QDoubleSpinBox* mpPixelSize;
+};
+
+#endif
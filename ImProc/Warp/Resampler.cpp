@@ -0,0 +1,93 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "Resampler.h"
+#include "StringUtilitiesMacros.h"
+
+#include <algorithm>
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(ResamplingKernel)
+ADD_ENUM_MAPPING(NEAREST_KERNEL, "Nearest Neighbor", "nearest")
+ADD_ENUM_MAPPING(BILINEAR_KERNEL, "Bilinear", "bilinear")
+ADD_ENUM_MAPPING(BICUBIC_KERNEL, "Bicubic", "bicubic")
+ADD_ENUM_MAPPING(LANCZOS_KERNEL, "Lanczos", "lanczos")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   const double sPi = 3.14159265358979323846;
+
+   double sinc(double x)
+   {
+      return (x == 0.0) ? 1.0 : sin(sPi * x) / (sPi * x);
+   }
+
+   double kernelWeight(ResamplingKernel kernel, double distance)
+   {
+      distance = fabs(distance);
+      switch (kernel)
+      {
+      case BILINEAR_KERNEL:
+         return std::max(0.0, 1.0 - distance);
+      case BICUBIC_KERNEL:
+         // Keys cubic convolution with a = -0.5
+         if (distance < 1.0)
+         {
+            return (1.5 * distance - 2.5) * distance * distance + 1.0;
+         }
+         if (distance < 2.0)
+         {
+            return ((-0.5 * distance + 2.5) * distance - 4.0) * distance + 2.0;
+         }
+         return 0.0;
+      case LANCZOS_KERNEL:
+         return (distance < Resampler::sMaxRadius) ? sinc(distance) * sinc(distance / Resampler::sMaxRadius) : 0.0;
+      default:
+         return 0.0;
+      }
+   }
+}
+
+unsigned int Resampler::getRadius(ResamplingKernel kernel)
+{
+   switch (kernel)
+   {
+   case BILINEAR_KERNEL:
+      return 1;
+   case BICUBIC_KERNEL:
+      return 2;
+   case LANCZOS_KERNEL:
+      return 3;
+   default:
+      return 0;
+   }
+}
+
+int Resampler::computeWeights(ResamplingKernel kernel, double position, int size, double* pWeights)
+{
+   int radius = static_cast<int>(getRadius(kernel));
+   int first = static_cast<int>(floor(position)) - radius + 1;
+   double total = 0.0;
+   for (int tap = 0; tap < 2 * radius; tap++)
+   {
+      int index = first + tap;
+      pWeights[tap] = (index < 0 || index >= size) ? 0.0 : kernelWeight(kernel, position - index);
+      total += pWeights[tap];
+   }
+   if (total != 0.0)
+   {
+      for (int tap = 0; tap < 2 * radius; tap++)
+      {
+         pWeights[tap] /= total;
+      }
+   }
+   return first;
+}
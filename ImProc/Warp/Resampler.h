@@ -0,0 +1,111 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RESAMPLER_H__
+#define RESAMPLER_H__
+
+#include "EnumWrapper.h"
+
+#include <algorithm>
+#include <math.h>
+
+enum ResamplingKernelEnum { NEAREST_KERNEL, BILINEAR_KERNEL, BICUBIC_KERNEL, LANCZOS_KERNEL };
+typedef EnumWrapper<ResamplingKernelEnum> ResamplingKernel;
+
+/**
+ * Separable interpolation of BIP pixels at fractional source locations.
+ *
+ * Locations are in sample index space so pixel centers fall on integers. Taps which fall outside the
+ * source are dropped and the remaining weights renormalized, so edges do not darken.
+ */
+namespace Resampler
+{
+   const unsigned int sMaxRadius = 3;
+
+   /**
+    * The number of taps on each side of the location.
+    */
+   unsigned int getRadius(ResamplingKernel kernel);
+
+   /**
+    * Compute the weights along one axis.
+    *
+    * @param kernel
+    *        The interpolation kernel. Must not be NEAREST_KERNEL.
+    * @param position
+    *        The location along the axis.
+    * @param size
+    *        The number of source samples along the axis.
+    * @param pWeights
+    *        Set to 2 * radius weights. Taps outside the source get a weight of 0.
+    * @return The index of the first tap.
+    */
+   int computeWeights(ResamplingKernel kernel, double position, int size, double* pWeights);
+
+   /**
+    * Interpolate every band at a location.
+    *
+    * @param sampler
+    *        Provides pixel(row, column), which returns the bands of an in range source pixel.
+    * @param pValues
+    *        Set to the interpolated values, one per band.
+    * @return False if the location is outside the source.
+    */
+   template<typename T, typename Sampler>
+   bool resample(Sampler& sampler, ResamplingKernel kernel, double row, double column, int rows, int columns,
+      unsigned int bands, double* pValues)
+   {
+      if (row < -0.5 || column < -0.5 || row > rows - 0.5 || column > columns - 0.5)
+      {
+         return false;
+      }
+      if (kernel == NEAREST_KERNEL)
+      {
+         int nearestRow = std::min(static_cast<int>(floor(row + 0.5)), rows - 1);
+         int nearestColumn = std::min(static_cast<int>(floor(column + 0.5)), columns - 1);
+         const T* pPixel = sampler.pixel(nearestRow, nearestColumn);
+         for (unsigned int band = 0; band < bands; band++)
+         {
+            pValues[band] = pPixel[band];
+         }
+         return true;
+      }
+      unsigned int taps = 2 * getRadius(kernel);
+      double pRowWeights[2 * sMaxRadius];
+      double pColumnWeights[2 * sMaxRadius];
+      int firstRow = computeWeights(kernel, row, rows, pRowWeights);
+      int firstColumn = computeWeights(kernel, column, columns, pColumnWeights);
+      for (unsigned int band = 0; band < bands; band++)
+      {
+         pValues[band] = 0.0;
+      }
+      for (unsigned int rowTap = 0; rowTap < taps; rowTap++)
+      {
+         if (pRowWeights[rowTap] == 0.0)
+         {
+            continue;
+         }
+         for (unsigned int columnTap = 0; columnTap < taps; columnTap++)
+         {
+            double weight = pRowWeights[rowTap] * pColumnWeights[columnTap];
+            if (weight == 0.0)
+            {
+               continue;
+            }
+            const T* pPixel = sampler.pixel(firstRow + rowTap, firstColumn + columnTap);
+            for (unsigned int band = 0; band < bands; band++)
+            {
+               pValues[band] += weight * pPixel[band];
+            }
+         }
+      }
+      return true;
+   }
+}
+
+#endif
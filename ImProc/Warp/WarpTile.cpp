@@ -0,0 +1,45 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "GcpList.h"
+#include "ModelServices.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "TypeConverter.h"
+#include "WarpTile.h"
+
+#include <list>
+
+bool WarpTile::addCornerCoordinates(RasterElement* pResult, double north, double west, double pixelSize)
+{
+   if (pResult == NULL)
+   {
+      return false;
+   }
+   ModelResource<GcpList> gcps("Corner Coordinates", pResult, TypeConverter::toString<GcpList>());
+   if (gcps.get() == NULL)
+   {
+      return false;
+   }
+   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(pResult->getDataDescriptor());
+   double rows = pDescriptor->getRowCount();
+   double columns = pDescriptor->getColumnCount();
+   double pixelRows[] = { 0.5, 0.5, rows - 0.5, rows - 0.5, rows / 2.0 };
+   double pixelColumns[] = { 0.5, columns - 0.5, 0.5, columns - 0.5, columns / 2.0 };
+   std::list<GcpPoint> points;
+   for (unsigned int idx = 0; idx < 5; idx++)
+   {
+      GcpPoint point;
+      point.mPixel = LocationType(pixelColumns[idx], pixelRows[idx]);
+      point.mCoordinate = LocationType(north - pixelRows[idx] * pixelSize, west + pixelColumns[idx] * pixelSize);
+      points.push_back(point);
+   }
+   gcps->addPoints(points);
+   gcps.release();
+   return true;
+}
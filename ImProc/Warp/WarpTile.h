@@ -0,0 +1,309 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WARPTILE_H__
+#define WARPTILE_H__
+
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "LocationType.h"
+#include "MultiThreadedAlgorithm.h"
+#include "RasterDataDescriptor.h"
+#include "Resampler.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+class RasterElement;
+
+/**
+ * Helpers for producing a north up latitude/longitude grid one square tile at a time.
+ *
+ * The source location of every tile pixel comes from evaluating the exact mapping on a coarse grid of
+ * nodes and interpolating between them. Only the source window under the tile is copied, so memory
+ * depends on the tile size and not on the scene size.
+ */
+namespace WarpTile
+{
+   const unsigned int sTileSize = 128;
+   const unsigned int sMaxWindowBytes = 64 * 1024 * 1024;
+
+   /**
+    * Attach corner coordinates for a grid to a result so it can be georeferenced.
+    *
+    * @return False if the GCP list could not be created.
+    */
+   bool addCornerCoordinates(RasterElement* pResult, double north, double west, double pixelSize);
+
+   inline LocationType interpolate(const LocationType& first, const LocationType& second, double weight)
+   {
+      return LocationType(first.mX + weight * (second.mX - first.mX), first.mY + weight * (second.mY - first.mY));
+   }
+
+   /**
+    * Convert to an encoding, rounding and clamping for integer encodings.
+    */
+   template<typename T>
+   T toEncoding(double value)
+   {
+      if (std::numeric_limits<T>::is_integer)
+      {
+         value = std::max<double>(std::numeric_limits<T>::min(),
+            std::min<double>(std::numeric_limits<T>::max(), floor(value + 0.5)));
+      }
+      return static_cast<T>(value);
+   }
+
+   /**
+    * Source pixels from a window copied out of the source element.
+    */
+   template<typename T>
+   class WindowSampler
+   {
+   public:
+      WindowSampler(const std::vector<T>& window, int firstRow, int firstColumn, int columns, unsigned int bands) :
+         mWindow(window), mFirstRow(firstRow), mFirstColumn(firstColumn), mColumns(columns), mBands(bands) {}
+
+      const T* pixel(int row, int column)
+      {
+         return &mWindow[((row - mFirstRow) * mColumns + column - mFirstColumn) * mBands];
+      }
+
+   private:
+      const std::vector<T>& mWindow;
+      int mFirstRow;
+      int mFirstColumn;
+      int mColumns;
+      unsigned int mBands;
+   };
+
+   /**
+    * Source pixels straight from an accessor, for tiles whose window is too large to copy.
+    */
+   template<typename T>
+   class AccessorSampler
+   {
+   public:
+      AccessorSampler(DataAccessor& accessor, unsigned int bands) : mAccessor(accessor), mZero(bands, T()) {}
+
+      const T* pixel(int row, int column)
+      {
+         mAccessor->toPixel(row, column);
+         return mAccessor.isValid() ? reinterpret_cast<const T*>(mAccessor->getColumn()) : &mZero.front();
+      }
+
+   private:
+      DataAccessor& mAccessor;
+      std::vector<T> mZero;
+   };
+
+   /**
+    * Compute the source location of every pixel in a tile.
+    *
+    * @param mapping
+    *        Provides LocationType operator()(const LocationType& coordinate) const, which maps a
+    *        (latitude, longitude) to a source pixel location with the first pixel center at (0.5, 0.5).
+    * @param north
+    *        The latitude of the top edge of the grid.
+    * @param west
+    *        The longitude of the left edge of the grid.
+    * @param pixelSize
+    *        The grid pixel size in degrees.
+    * @param spacing
+    *        Pixels between the nodes where the mapping is evaluated.
+    * @param locations
+    *        Set to the (column, row) source location of each tile pixel in sample index space, so the
+    *        first pixel center is (0, 0).
+    */
+   template<typename Mapping>
+   void mapTile(const Mapping& mapping, double north, double west, double pixelSize, unsigned int firstRow,
+                unsigned int firstColumn, unsigned int rows, unsigned int columns, unsigned int spacing,
+                std::vector<LocationType>& locations)
+   {
+      // node offsets within the tile, the last one on the far edge
+      std::vector<unsigned int> rowNodes;
+      std::vector<unsigned int> columnNodes;
+      for (unsigned int offset = 0; offset < rows; offset += spacing)
+      {
+         rowNodes.push_back(offset);
+      }
+      rowNodes.push_back(rows);
+      for (unsigned int offset = 0; offset < columns; offset += spacing)
+      {
+         columnNodes.push_back(offset);
+      }
+      columnNodes.push_back(columns);
+
+      std::vector<LocationType> nodes(rowNodes.size() * columnNodes.size());
+      for (unsigned int rowNode = 0; rowNode < rowNodes.size(); rowNode++)
+      {
+         double latitude = north - (firstRow + rowNodes[rowNode] + 0.5) * pixelSize;
+         for (unsigned int columnNode = 0; columnNode < columnNodes.size(); columnNode++)
+         {
+            double longitude = west + (firstColumn + columnNodes[columnNode] + 0.5) * pixelSize;
+            LocationType pixel = mapping(LocationType(latitude, longitude));
+            nodes[rowNode * columnNodes.size() + columnNode] = LocationType(pixel.mX - 0.5, pixel.mY - 0.5);
+         }
+      }
+
+      locations.resize(rows * columns);
+      for (unsigned int row = 0; row < rows; row++)
+      {
+         unsigned int rowNode = row / spacing;
+         double rowWeight = static_cast<double>(row - rowNodes[rowNode]) / (rowNodes[rowNode + 1] - rowNodes[rowNode]);
+         const LocationType* pTop = &nodes[rowNode * columnNodes.size()];
+         const LocationType* pBottom = pTop + columnNodes.size();
+         for (unsigned int column = 0; column < columns; column++)
+         {
+            unsigned int columnNode = column / spacing;
+            double columnWeight = static_cast<double>(column - columnNodes[columnNode]) /
+               (columnNodes[columnNode + 1] - columnNodes[columnNode]);
+            LocationType top = interpolate(pTop[columnNode], pTop[columnNode + 1], columnWeight);
+            LocationType bottom = interpolate(pBottom[columnNode], pBottom[columnNode + 1], columnWeight);
+            locations[row * columns + column] = interpolate(top, bottom, rowWeight);
+         }
+      }
+   }
+
+   template<typename T, typename Sampler, typename Visitor>
+   void resampleLocations(Sampler& sampler, const std::vector<LocationType>& locations, ResamplingKernel kernel,
+                          int sourceRows, int sourceColumns, unsigned int bands, Visitor& visitor)
+   {
+      std::vector<double> values(bands);
+      for (unsigned int pixel = 0; pixel < locations.size(); pixel++)
+      {
+         if (Resampler::resample<T>(sampler, kernel, locations[pixel].mY, locations[pixel].mX,
+               sourceRows, sourceColumns, bands, &values.front()))
+         {
+            visitor(pixel, &values.front());
+         }
+      }
+   }
+
+   /**
+    * Resample a BIP source at the locations of a tile.
+    *
+    * @param accessor
+    *        A BIP accessor over the whole source.
+    * @param visitor
+    *        Provides operator()(unsigned int pixel, const double* pValues), called with the band values
+    *        of each location inside the source.
+    */
+   template<typename T, typename Visitor>
+   void resampleTile(DataAccessor& accessor, const std::vector<LocationType>& locations, ResamplingKernel kernel,
+                     int sourceRows, int sourceColumns, unsigned int bands, Visitor& visitor)
+   {
+      // the interpolated locations lie within the hull of the nodes so their bounds give the source window
+      double minRow = std::numeric_limits<double>::max();
+      double maxRow = -std::numeric_limits<double>::max();
+      double minColumn = std::numeric_limits<double>::max();
+      double maxColumn = -std::numeric_limits<double>::max();
+      for (std::vector<LocationType>::const_iterator location = locations.begin(); location != locations.end(); ++location)
+      {
+         minRow = std::min(minRow, location->mY);
+         maxRow = std::max(maxRow, location->mY);
+         minColumn = std::min(minColumn, location->mX);
+         maxColumn = std::max(maxColumn, location->mX);
+      }
+      int radius = static_cast<int>(std::max(1U, Resampler::getRadius(kernel)));
+      int firstRow = std::max(0, static_cast<int>(std::max(-1.0e9, floor(minRow))) - radius);
+      int lastRow = std::min(sourceRows - 1, static_cast<int>(std::min(1.0e9, ceil(maxRow))) + radius);
+      int firstColumn = std::max(0, static_cast<int>(std::max(-1.0e9, floor(minColumn))) - radius);
+      int lastColumn = std::min(sourceColumns - 1, static_cast<int>(std::min(1.0e9, ceil(maxColumn))) + radius);
+      if (firstRow > lastRow || firstColumn > lastColumn)
+      {
+         return;
+      }
+
+      double windowRows = lastRow - firstRow + 1;
+      double windowColumns = lastColumn - firstColumn + 1;
+      if (windowRows * windowColumns * bands * sizeof(T) > sMaxWindowBytes)
+      {
+         AccessorSampler<T> sampler(accessor, bands);
+         resampleLocations<T>(sampler, locations, kernel, sourceRows, sourceColumns, bands, visitor);
+         return;
+      }
+      unsigned int rowSize = static_cast<unsigned int>(windowColumns) * bands;
+      std::vector<T> window(static_cast<unsigned int>(windowRows) * rowSize);
+      for (int row = firstRow; row <= lastRow; row++)
+      {
+         accessor->toPixel(row, firstColumn);
+         if (accessor.isValid())
+         {
+            memcpy(&window[(row - firstRow) * rowSize], accessor->getColumn(), rowSize * sizeof(T));
+         }
+      }
+      WindowSampler<T> sampler(window, firstRow, firstColumn, static_cast<int>(windowColumns), bands);
+      resampleLocations<T>(sampler, locations, kernel, sourceRows, sourceColumns, bands, visitor);
+   }
+
+   /**
+    * Produce a thread's rows of a BIP result one tile at a time.
+    *
+    * The abort flag is checked before each tile and progress is reported after each row of tiles.
+    * Completion is reported unless the result could not be accessed.
+    *
+    * @param filler
+    *        Provides void operator()(void* pTile, unsigned int firstRow, unsigned int firstColumn,
+    *        unsigned int rows, unsigned int columns), which fills a rows x columns BIP tile in the
+    *        result encoding.
+    */
+   template<typename Filler>
+   void writeTiles(const RasterDataDescriptor* pResultDescriptor, DataAccessor& resultAccessor,
+                   const mta::AlgorithmThread::Range& rowRange, const bool* pAbortFlag,
+                   mta::ThreadReporter& reporter, int threadIndex, Filler& filler)
+   {
+      unsigned int numCols = pResultDescriptor->getColumnCount();
+      unsigned int pixelSize = pResultDescriptor->getBandCount() * pResultDescriptor->getBytesPerElement();
+      std::vector<char> tile(sTileSize * sTileSize * pixelSize);
+      int oldPercentDone = 0;
+      bool aborted = false;
+      for (int firstRow = rowRange.mFirst; firstRow <= rowRange.mLast; firstRow += sTileSize)
+      {
+         unsigned int tileRows = std::min<unsigned int>(sTileSize, rowRange.mLast - firstRow + 1);
+         for (unsigned int firstColumn = 0; firstColumn < numCols; firstColumn += sTileSize)
+         {
+            if (pAbortFlag != NULL && *pAbortFlag)
+            {
+               aborted = true;
+               break;
+            }
+            unsigned int tileColumns = std::min(sTileSize, numCols - firstColumn);
+            filler(&tile.front(), firstRow, firstColumn, tileRows, tileColumns);
+
+            for (unsigned int row = 0; row < tileRows; row++)
+            {
+               resultAccessor->toPixel(firstRow + row, firstColumn);
+               if (!resultAccessor.isValid())
+               {
+                  reporter.reportError("Invalid data access.");
+                  return;
+               }
+               memcpy(resultAccessor->getColumn(), &tile[row * tileColumns * pixelSize], tileColumns * pixelSize);
+            }
+         }
+         if (aborted)
+         {
+            reporter.reportProgress(threadIndex, 100);
+            break;
+         }
+         int percentDone = rowRange.computePercent(firstRow + tileRows - 1);
+         if (percentDone > oldPercentDone)
+         {
+            oldPercentDone = percentDone;
+            reporter.reportProgress(threadIndex, percentDone);
+         }
+      }
+      reporter.reportCompletion(threadIndex);
+   }
+}
+
+#endif
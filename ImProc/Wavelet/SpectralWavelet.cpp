@@ -6,6 +6,8 @@
  * http://www.gnu.org/licenses/lgpl.html
  */
 
+#include "DataVariant.h"
+#include "DynamicObject.h"
 #include "ImProcVersion.h"
 #include "SpectralWavelet.h"
 #include "PlugInArgList.h"
@@ -22,9 +24,15 @@
 #include "switchOnEncoding.h"
 #include "Undo.h"
 #include "WaveletDialog.h"
-extern "C" {
-#include <local.h>
-};
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+   // the wvlt transforms need power of 2 lengths so the forward pass records the original band count
+   const char* const spBandCountPath = "Spectral Wavelet/Band Count";
+}
 
 REGISTER_PLUGIN_BASIC(WaveletModule, SpectralWavelet);
 
@@ -48,6 +56,8 @@ ADD_ENUM_MAPPING(SPLINE_2_2, "Spline 2,2", "S2-2")
 ADD_ENUM_MAPPING(SPLINE_2_4, "Spline 2,4", "S2-4")
 ADD_ENUM_MAPPING(SPLINE_3_3, "Spline 3,3", "S3-3")
 ADD_ENUM_MAPPING(SPLINE_3_7, "Spline 3,7", "S3-7")
+ADD_ENUM_MAPPING(LIFTING_5_3, "Lifting 5/3", "L5-3")
+ADD_ENUM_MAPPING(LIFTING_9_7, "Lifting 9/7", "L9-7")
 END_ENUM_MAPPING()
 }
 
@@ -116,9 +126,66 @@ bool SpectralWavelet::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgL
          Service<ModelServices>()->destroyElement(pResult);
       }
    }
+   EncodingType dataType = mInput.mpDescriptor->getDataType();
+   mInput.mResultType = WaveletUtils::isSinglePrecision(dataType) ? FLT4BYTES : FLT8BYTES;
+   mInput.mReversible = false;
+   if (WaveletUtils::isLifting(mInput.mBasis))
+   {
+      // integer data gets the integer to integer transform so the inverse is bit-exact
+      switch (dataType)
+      {
+      case INT1SBYTE:
+      case INT1UBYTE:
+      case INT2SBYTES:
+      case INT2UBYTES:
+         mInput.mResultType = INT4SBYTES;
+         mInput.mReversible = true;
+         break;
+      case INT4SBYTES:
+      case INT4UBYTES:
+         // the coefficients can exceed 32 bits but are exact integers in a double
+         mInput.mResultType = FLT8BYTES;
+         mInput.mReversible = true;
+         break;
+      default:
+         if (!mInput.mForward)
+         {
+            // 32-bit integer data is decomposed into integer valued doubles so look for the forward pass' flag
+            const DynamicObject* pMetadata = mInput.mpRaster->getMetadata();
+            const bool* pReversible = (pMetadata == NULL) ? NULL :
+               dv_cast<bool>(&pMetadata->getAttributeByPath("Spectral Wavelet/Reversible"));
+            mInput.mReversible = (pReversible != NULL && *pReversible && dataType == FLT8BYTES);
+         }
+         break;
+      }
+   }
+   // forward spectra are reflection padded to a power of 2, inverse results are cropped to the original bands
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+   unsigned int resultBands = numBands;
+   if (mInput.mForward)
+   {
+      mInput.mTransformLength = WaveletUtils::nextPowerOfTwo(numBands);
+      resultBands = mInput.mTransformLength;
+   }
+   else
+   {
+      if (WaveletUtils::nextPowerOfTwo(numBands) != numBands)
+      {
+         mProgress.report("The inverse transform needs a power of 2 number of coefficient bands.", 0, ERRORS, true);
+         return false;
+      }
+      mInput.mTransformLength = numBands;
+      const DynamicObject* pMetadata = mInput.mpRaster->getMetadata();
+      const unsigned int* pBandCount = (pMetadata == NULL) ? NULL :
+         dv_cast<unsigned int>(&pMetadata->getAttributeByPath(spBandCountPath));
+      if (pBandCount != NULL && *pBandCount > 0 && *pBandCount <= numBands)
+      {
+         resultBands = *pBandCount;
+      }
+   }
    ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
-      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), mInput.mpDescriptor->getBandCount(),
-      FLT8BYTES, BIP, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
+      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), resultBands,
+      mInput.mResultType, BIP, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
    mInput.mpResult = pResult.get();
    if (mInput.mpResult == NULL)
    {
@@ -126,6 +193,16 @@ bool SpectralWavelet::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgL
       return false;
    }
    mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   DynamicObject* pResultMetadata = mInput.mpResult->getMetadata();
+   if (mInput.mForward && pResultMetadata != NULL)
+   {
+      pResultMetadata->setAttributeByPath(spBandCountPath, numBands);
+      if (mInput.mReversible)
+      {
+         // record the integer transform so the inverse uses it too
+         pResultMetadata->setAttributeByPath("Spectral Wavelet/Reversible", true);
+      }
+   }
    mInput.mpAbortFlag = &mAbortFlag;
    SpectralWaveletThreadOutput outputData;
    mta::ProgressObjectReporter reporter("Decomposing", mProgress.getCurrentProgress());
@@ -242,18 +319,17 @@ void SpectralWavelet::SpectralWaveletThread::run()
       return;
    }
 
-   EncodingType encoding = mInput.mpDescriptor->getDataType();
    int numCols = mInput.mpResultDescriptor->getColumnCount();
 
-   int oldPercentDone = 0;
-
-   int startRow = mRowRange.mFirst;
-   int stopRow = mRowRange.mLast;
-   unsigned int numBands = mInput.mpResultDescriptor->getBandCount();
+   // request blocks of whole BIP rows so each page fetch covers many spectra
+   unsigned int rowBytes = numCols * mInput.mTransformLength *
+      std::max(mInput.mpDescriptor->getBytesPerElement(), mInput.mpResultDescriptor->getBytesPerElement());
+   unsigned int blockRows = std::max(1U, std::min<unsigned int>(mRowRange.mLast - mRowRange.mFirst + 1,
+      sBlockBytes / std::max(1U, rowBytes)));
 
    FactoryResource<DataRequest> pResultRequest;
    pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
-      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast));
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast), blockRows);
    pResultRequest->setColumns(mInput.mpResultDescriptor->getActiveColumn(0),
       mInput.mpResultDescriptor->getActiveColumn(numCols - 1));
    pResultRequest->setWritable(true);
@@ -266,7 +342,7 @@ void SpectralWavelet::SpectralWaveletThread::run()
 
    FactoryResource<DataRequest> pRequest;
    pRequest->setRows(mInput.mpDescriptor->getActiveRow(mRowRange.mFirst),
-      mInput.mpDescriptor->getActiveRow(mRowRange.mLast));
+      mInput.mpDescriptor->getActiveRow(mRowRange.mLast), blockRows);
    pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0),
       mInput.mpDescriptor->getActiveColumn(numCols - 1));
    pRequest->setInterleaveFormat(BIP);
@@ -277,9 +353,38 @@ void SpectralWavelet::SpectralWaveletThread::run()
       return;
    }
 
-   waveletfilter* pFlt = &wfltrDaubechies_4;
-   std::auto_ptr<double> pInput(new double[numBands]);
-   Service<ModelServices> pModel;
+   switch (mInput.mResultType)
+   {
+   case INT4SBYTES:
+      transformRows<int>(accessor, resultAccessor);
+      break;
+   case FLT4BYTES:
+      transformRows<float>(accessor, resultAccessor);
+      break;
+   default:
+      transformRows<double>(accessor, resultAccessor);
+      break;
+   }
+}
+
+template<typename T>
+void SpectralWavelet::SpectralWaveletThread::transformRows(DataAccessor& accessor, DataAccessor& resultAccessor)
+{
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   int numCols = mInput.mpResultDescriptor->getColumnCount();
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+   unsigned int resultBands = mInput.mpResultDescriptor->getBandCount();
+   unsigned int length = mInput.mTransformLength;
+
+   int oldPercentDone = 0;
+
+   int startRow = mRowRange.mFirst;
+   int stopRow = mRowRange.mLast;
+
+   // per-thread buffers so the inner loop does no allocation
+   std::vector<T> input(numCols * numBands);
+   std::vector<T> spectrum(length);
+   std::vector<T> scratch(length);
    for (int row_index = startRow; row_index <= stopRow; row_index++)
    {
       int percentDone = mRowRange.computePercent(row_index);
@@ -293,24 +398,22 @@ void SpectralWavelet::SpectralWaveletThread::run()
          getReporter().reportProgress(getThreadIndex(), 100);
          break;
       }
+      if (!accessor.isValid() || !resultAccessor.isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
 
+      // BIP rows are contiguous so convert and write a full row at a time
+      switchOnEncoding(encoding, loadValues, accessor->getRow(), &input.front(), numCols * numBands);
+      T* pResult = reinterpret_cast<T*>(resultAccessor->getRow());
       for (int col_index = 0; col_index < numCols; col_index++)
       {
-         if (!accessor.isValid() || !resultAccessor.isValid())
-         {
-            getReporter().reportError("Invalid data access.");
-            return;
-         }
-
-         // do the work
-         for (unsigned int band = 0; band < numBands; band++)
-         {
-            pInput.get()[band] = pModel->getDataValue(encoding, accessor->getColumn(), band);
-         }
-         wxfrm_da1d(pInput.get(), numBands, mInput.mForward ? 1 : 0, pFlt, reinterpret_cast<double*>(resultAccessor->getColumn()));
-
-         resultAccessor->nextColumn();
-         accessor->nextColumn();
+         std::copy(input.begin() + col_index * numBands, input.begin() + (col_index + 1) * numBands,
+            spectrum.begin());
+         WaveletUtils::reflectPad(&spectrum.front(), numBands, length);
+         transformPixel(&spectrum.front(), length, &spectrum.front(), &scratch.front());
+         std::copy(spectrum.begin(), spectrum.begin() + resultBands, pResult + col_index * resultBands);
       }
       resultAccessor->nextRow();
       accessor->nextRow();
@@ -318,6 +421,37 @@ void SpectralWavelet::SpectralWaveletThread::run()
    getReporter().reportCompletion(getThreadIndex());
 }
 
+void SpectralWavelet::SpectralWaveletThread::transformPixel(int* pData, int count, int* pResult, int* pScratch)
+{
+   WaveletUtils::transformReversible(pData, count, mInput.mForward, mInput.mBasis, pResult, pScratch);
+}
+
+void SpectralWavelet::SpectralWaveletThread::transformPixel(float* pData, int count, float* pResult, float* pScratch)
+{
+   WaveletUtils::transform(pData, count, mInput.mForward, mInput.mBasis, pResult, pScratch);
+}
+
+void SpectralWavelet::SpectralWaveletThread::transformPixel(double* pData, int count, double* pResult, double* pScratch)
+{
+   if (mInput.mReversible)
+   {
+      WaveletUtils::transformReversible(pData, count, mInput.mForward, mInput.mBasis, pResult, pScratch);
+   }
+   else
+   {
+      WaveletUtils::transform(pData, count, mInput.mForward, mInput.mBasis, pResult, pScratch);
+   }
+}
+
+template<typename T, typename U>
+void SpectralWavelet::SpectralWaveletThread::loadValues(const T* pData, U* pBuffer, unsigned int count)
+{
+   for (unsigned int idx = 0; idx < count; idx++)
+   {
+      pBuffer[idx] = static_cast<U>(pData[idx]);
+   }
+}
+
 bool SpectralWavelet::SpectralWaveletThreadOutput::compileOverallResults(const std::vector<SpectralWaveletThread*>& threads)
 {
    return true;
@@ -10,31 +10,11 @@
 #define SPECTRALWAVELET_H__
 
 #include "AlgorithmShell.h"
-#include "EnumWrapper.h"
 #include "MultiThreadedAlgorithm.h"
 #include "ProgressTracker.h"
+#include "WaveletUtils.h"
 
-enum WaveletBasisEnum {
-   BATTLE_LEMARIE,
-   BURT_ADELSON,
-   COIFLET_2,
-   COIFLET_4,
-   COIFLET_6,
-   DAUBECHIES_4,
-   DAUBECHIES_6,
-   DAUBECHIES_8,
-   DAUBECHIES_10,
-   DAUBECHIES_12,
-   DAUBECHIES_20,
-   HAAR,
-   PSEUDOCOIFLET_4_4,
-   SPLINE_2_2,
-   SPLINE_2_4,
-   SPLINE_3_3,
-   SPLINE_3_7
-};
-
-typedef EnumWrapper<WaveletBasisEnum> WaveletBasis;
+class DataAccessor;
 
 class SpectralWavelet : public AlgorithmShell
 {
@@ -57,13 +37,17 @@ protected:
 
    struct SpectralWaveletThreadInput
    {
-      SpectralWaveletThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL), mForward(true), mpAbortFlag(NULL) {}
+      SpectralWaveletThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL), mForward(true),
+         mResultType(FLT8BYTES), mReversible(false), mTransformLength(0), mpAbortFlag(NULL) {}
       const RasterElement* mpRaster;
       const RasterDataDescriptor* mpDescriptor;
       const RasterDataDescriptor* mpResultDescriptor;
       RasterElement* mpResult;
       bool mForward;
       WaveletBasis mBasis;
+      EncodingType mResultType; // coefficients are computed in the result type
+      bool mReversible; // integer to integer lifting transform
+      unsigned int mTransformLength; // power of 2 length each spectrum is reflection padded to
       const bool* mpAbortFlag;
    };
 
@@ -74,6 +58,14 @@ protected:
       void run();
 
    private:
+      template<typename T> void transformRows(DataAccessor& accessor, DataAccessor& resultAccessor);
+      void transformPixel(int* pData, int count, int* pResult, int* pScratch);
+      void transformPixel(float* pData, int count, float* pResult, float* pScratch);
+      void transformPixel(double* pData, int count, double* pResult, double* pScratch);
+      template<typename T, typename U> void loadValues(const T* pData, U* pBuffer, unsigned int count);
+
+      static const unsigned int sBlockBytes = 4 * 1024 * 1024; // target size of a block of rows
+
       const SpectralWaveletThreadInput &mInput;
       mta::AlgorithmThread::Range mRowRange;
    };
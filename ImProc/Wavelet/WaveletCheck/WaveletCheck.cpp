@@ -0,0 +1,226 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+/**
+ * Standalone checks of the WaveletUtils transforms used by the Wavelet plug-ins.
+ *
+ * This is not part of the plug-in build. See the Makefile in this directory.
+ */
+
+#include "WaveletUtils.h"
+
+#include <algorithm>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace
+{
+const unsigned int spLengths[] = { 1, 2, 3, 7, 31, 64, 100, 187, 224, 256, 257 };
+const unsigned int sLengthCount = sizeof(spLengths) / sizeof(spLengths[0]);
+const unsigned int sSpectraPerLength = 200;
+
+// FLT4 coefficients must agree with the double ones to this fraction of the largest coefficient
+const double sSinglePrecisionBound = 1e-5;
+
+int randomValue(int minValue, int maxValue)
+{
+   double fraction = static_cast<double>(rand()) / (static_cast<double>(RAND_MAX) + 1.0);
+   return minValue + static_cast<int>(fraction * (static_cast<double>(maxValue) - minValue + 1.0));
+}
+
+/**
+ * Transform one spectrum forward and back the way SpectralWavelet does.
+ *
+ * The spectrum is reflection padded to a power of 2, transformed into paddedCount coefficients
+ * and the inverse is cropped back to the original count.
+ *
+ * @return The number of values which do not reconstruct exactly.
+ */
+template<typename T>
+unsigned int roundTrip(const std::vector<T>& spectrum, WaveletBasis basis)
+{
+   unsigned int count = spectrum.size();
+   unsigned int paddedCount = WaveletUtils::nextPowerOfTwo(count);
+   std::vector<T> coefficients(paddedCount);
+   std::vector<T> scratch(paddedCount);
+   std::copy(spectrum.begin(), spectrum.end(), coefficients.begin());
+   WaveletUtils::reflectPad(&coefficients.front(), count, paddedCount);
+   WaveletUtils::transformReversible(&coefficients.front(), paddedCount, true, basis,
+      &coefficients.front(), &scratch.front());
+   WaveletUtils::transformReversible(&coefficients.front(), paddedCount, false, basis,
+      &coefficients.front(), &scratch.front());
+
+   unsigned int mismatches = 0;
+   for (unsigned int idx = 0; idx < count; idx++)
+   {
+      if (coefficients[idx] != spectrum[idx])
+      {
+         mismatches++;
+      }
+   }
+   return mismatches;
+}
+
+/**
+ * INT1 and INT2 data use the int lifting transform, INT4 data the double one.
+ */
+template<typename T>
+bool checkReversible(const char* pName, int minValue, int maxValue)
+{
+   bool success = true;
+   const WaveletBasis bases[] = { LIFTING_5_3, LIFTING_9_7 };
+   for (unsigned int basisIndex = 0; basisIndex < 2; basisIndex++)
+   {
+      unsigned int failedLengths = 0;
+      unsigned int mismatches = 0;
+      for (unsigned int lengthIndex = 0; lengthIndex < sLengthCount; lengthIndex++)
+      {
+         std::vector<T> spectrum(spLengths[lengthIndex]);
+         unsigned int lengthMismatches = 0;
+         for (unsigned int spectrumIndex = 0; spectrumIndex < sSpectraPerLength; spectrumIndex++)
+         {
+            for (unsigned int idx = 0; idx < spectrum.size(); idx++)
+            {
+               // alternate full range noise with the extremes which stress the rounding
+               spectrum[idx] = static_cast<T>((spectrumIndex % 4 == 0) ?
+                  ((idx % 2 == 0) ? minValue : maxValue) : randomValue(minValue, maxValue));
+            }
+            lengthMismatches += roundTrip(spectrum, bases[basisIndex]);
+         }
+         if (lengthMismatches > 0)
+         {
+            failedLengths++;
+            printf("   %s %s length %u: %u values differ\n", pName,
+               bases[basisIndex] == LIFTING_9_7 ? "9/7" : "5/3", spLengths[lengthIndex], lengthMismatches);
+         }
+         mismatches += lengthMismatches;
+      }
+      printf("%-5s %s lifting: %u of %u lengths bit exact\n", pName,
+         bases[basisIndex] == LIFTING_9_7 ? "9/7" : "5/3", sLengthCount - failedLengths, sLengthCount);
+      success = success && mismatches == 0;
+   }
+   return success;
+}
+
+/**
+ * Compare the FLT4 coefficients SpectralWavelet computes for INT1, INT2 and FLT4 data and their
+ * inverse with the double precision transform.
+ */
+bool checkSinglePrecision(WaveletBasis basis, const char* pName, int maxValue)
+{
+   double maxForwardError = 0.0;
+   double maxInverseError = 0.0;
+   for (unsigned int lengthIndex = 0; lengthIndex < sLengthCount; lengthIndex++)
+   {
+      unsigned int count = spLengths[lengthIndex];
+      unsigned int paddedCount = WaveletUtils::nextPowerOfTwo(count);
+      std::vector<float> floatData(paddedCount);
+      std::vector<float> floatScratch(paddedCount);
+      std::vector<double> doubleData(paddedCount);
+      std::vector<double> doubleScratch(paddedCount);
+      for (unsigned int spectrumIndex = 0; spectrumIndex < sSpectraPerLength; spectrumIndex++)
+      {
+         // smooth spectra with noise, like real radiance, and pure noise
+         double phase = randomValue(0, 1000) / 100.0;
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            double smooth = (spectrumIndex % 2 == 0) ? 0.5 + 0.4 * sin(phase + idx / 17.0) : 0.5;
+            floatData[idx] = static_cast<float>(floor(maxValue * smooth +
+               randomValue(-maxValue / 10, maxValue / 10) * (spectrumIndex % 2 == 0 ? 0.1 : 4.0)));
+            floatData[idx] = std::max(0.0f, std::min(static_cast<float>(maxValue), floatData[idx]));
+         }
+         WaveletUtils::reflectPad(&floatData.front(), count, paddedCount);
+         std::copy(floatData.begin(), floatData.end(), doubleData.begin());
+
+         WaveletUtils::transform(&floatData.front(), paddedCount, true, basis, &floatData.front(),
+            &floatScratch.front());
+         WaveletUtils::transform(&doubleData.front(), paddedCount, true, basis, &doubleData.front(),
+            &doubleScratch.front());
+         double largest = 0.0;
+         double forwardError = 0.0;
+         for (unsigned int idx = 0; idx < paddedCount; idx++)
+         {
+            largest = std::max(largest, fabs(doubleData[idx]));
+            forwardError = std::max(forwardError, fabs(floatData[idx] - doubleData[idx]));
+         }
+         if (largest > 0.0)
+         {
+            maxForwardError = std::max(maxForwardError, forwardError / largest);
+         }
+
+         // some filters do not reconstruct exactly so compare with the double precision round trip
+         WaveletUtils::transform(&floatData.front(), paddedCount, false, basis, &floatData.front(),
+            &floatScratch.front());
+         WaveletUtils::transform(&doubleData.front(), paddedCount, false, basis, &doubleData.front(),
+            &doubleScratch.front());
+         double inverseError = 0.0;
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            inverseError = std::max(inverseError, fabs(floatData[idx] - doubleData[idx]));
+         }
+         maxInverseError = std::max(maxInverseError, inverseError / std::max(1, maxValue));
+      }
+   }
+   bool success = maxForwardError <= sSinglePrecisionBound && maxInverseError <= sSinglePrecisionBound;
+   printf("%-18s max FLT4 error %.2e of largest coefficient, inverse %.2e of range%s\n", pName,
+      maxForwardError, maxInverseError, success ? "" : "  FAILED");
+   return success;
+}
+}
+
+int main(int argc, char** argv)
+{
+   srand(1);
+   bool success = true;
+
+   printf("Reversible round trip of padded spectra (%u spectra per length)\n", sSpectraPerLength);
+   success = checkReversible<int>("INT1S", SCHAR_MIN, SCHAR_MAX) && success;
+   success = checkReversible<int>("INT1U", 0, UCHAR_MAX) && success;
+   success = checkReversible<int>("INT2S", SHRT_MIN, SHRT_MAX) && success;
+   success = checkReversible<int>("INT2U", 0, USHRT_MAX) && success;
+   success = checkReversible<double>("INT4S", INT_MIN, INT_MAX) && success;
+
+   printf("\nFLT4 against double precision coefficients (bound %.0e)\n", sSinglePrecisionBound);
+   const struct
+   {
+      WaveletBasis mBasis;
+      const char* mpName;
+   } bases[] =
+   {
+      { BATTLE_LEMARIE, "Battle-Lemarie" },
+      { BURT_ADELSON, "Burt-Adelson" },
+      { COIFLET_2, "Coiflet 2" },
+      { COIFLET_4, "Coiflet 4" },
+      { COIFLET_6, "Coiflet 6" },
+      { DAUBECHIES_4, "Daubechies 4" },
+      { DAUBECHIES_6, "Daubechies 6" },
+      { DAUBECHIES_8, "Daubechies 8" },
+      { DAUBECHIES_10, "Daubechies 10" },
+      { DAUBECHIES_12, "Daubechies 12" },
+      { DAUBECHIES_20, "Daubechies 20" },
+      { HAAR, "Haar" },
+      { PSEUDOCOIFLET_4_4, "Pseudocoiflet 4,4" },
+      { SPLINE_2_2, "Spline 2,2" },
+      { SPLINE_2_4, "Spline 2,4" },
+      { SPLINE_3_3, "Spline 3,3" },
+      { SPLINE_3_7, "Spline 3,7" },
+      { LIFTING_5_3, "Lifting 5/3" },
+      { LIFTING_9_7, "Lifting 9/7" }
+   };
+   for (unsigned int basisIndex = 0; basisIndex < sizeof(bases) / sizeof(bases[0]); basisIndex++)
+   {
+      // INT2U covers the largest integer range which takes the FLT4 path
+      success = checkSinglePrecision(bases[basisIndex].mBasis, bases[basisIndex].mpName, USHRT_MAX) && success;
+   }
+
+   printf(success ? "PASSED\n" : "FAILED\n");
+   return success ? 0 : 1;
+}
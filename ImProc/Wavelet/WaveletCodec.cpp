@@ -0,0 +1,440 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "WaveletCodec.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QIODevice>
+#include <string.h>
+
+namespace
+{
+const quint32 sMagic = 0x434c5657; // "WVLC"
+const quint16 sVersion = 1;
+const qint64 sFixedHeaderSize = 4 + 2 + 8 * 4 + 8;
+
+// coefficients are coded in squares of this size
+const unsigned int sSquareSize = 4;
+const unsigned int sSquareCount = sSquareSize * sSquareSize;
+
+// Rice codes with a quotient of this many bits or more are escaped to a raw 32-bit value
+const unsigned int sEscapeLength = 24;
+const unsigned int sMaxRiceParameter = 31;
+const quint32 sMaxQuantized = 0x3fffffff;
+
+class BitWriter
+{
+public:
+   BitWriter(QByteArray& bytes) : mBytes(bytes), mAccumulator(0), mCount(0) {}
+
+   void write(quint32 value, unsigned int bits)
+   {
+      if (bits == 0)
+      {
+         return;
+      }
+      quint64 mask = (static_cast<quint64>(1) << bits) - 1;
+      mAccumulator = (mAccumulator << bits) | (value & mask);
+      mCount += bits;
+      while (mCount >= 8)
+      {
+         mCount -= 8;
+         mBytes.append(static_cast<char>((mAccumulator >> mCount) & 0xff));
+      }
+   }
+
+   void flush()
+   {
+      if (mCount > 0)
+      {
+         mBytes.append(static_cast<char>((mAccumulator << (8 - mCount)) & 0xff));
+         mCount = 0;
+      }
+      mAccumulator = 0;
+   }
+
+private:
+   QByteArray& mBytes;
+   quint64 mAccumulator;
+   unsigned int mCount;
+};
+
+class BitReader
+{
+public:
+   BitReader(const char* pData, int length) :
+      mpData(reinterpret_cast<const uchar*>(pData)), mLength(length), mPosition(0), mAccumulator(0), mCount(0), mOverrun(false) {}
+
+   quint32 read(unsigned int bits)
+   {
+      if (bits == 0)
+      {
+         return 0;
+      }
+      while (mCount < bits)
+      {
+         quint64 byte = 0;
+         if (mPosition < mLength)
+         {
+            byte = mpData[mPosition++];
+         }
+         else
+         {
+            mOverrun = true;
+         }
+         mAccumulator = (mAccumulator << 8) | byte;
+         mCount += 8;
+      }
+      mCount -= bits;
+      return static_cast<quint32>((mAccumulator >> mCount) & ((static_cast<quint64>(1) << bits) - 1));
+   }
+
+   bool overrun() const
+   {
+      return mOverrun;
+   }
+
+private:
+   const uchar* mpData;
+   int mLength;
+   int mPosition;
+   quint64 mAccumulator;
+   unsigned int mCount;
+   bool mOverrun;
+};
+
+// dead-zone quantizer, values are zig-zag mapped so the Rice code sees small unsigned integers
+quint32 quantize(float value, double step)
+{
+   double magnitude = floor(fabs(value) / step);
+   quint32 quantized = (magnitude >= sMaxQuantized) ? sMaxQuantized : static_cast<quint32>(magnitude);
+   if (quantized == 0)
+   {
+      return 0;
+   }
+   return (value < 0.0f) ? 2 * quantized - 1 : 2 * quantized;
+}
+
+float dequantize(quint32 mapped, double step)
+{
+   if (mapped == 0)
+   {
+      return 0.0f;
+   }
+   bool negative = (mapped & 1) != 0;
+   quint32 magnitude = negative ? (mapped + 1) / 2 : mapped / 2;
+   double value = (magnitude + 0.5) * step; // reconstruct at the middle of the quantization bin
+   return static_cast<float>(negative ? -value : value);
+}
+
+unsigned int riceLength(quint32 value, unsigned int k)
+{
+   quint32 quotient = value >> k;
+   return (quotient >= sEscapeLength) ? sEscapeLength + 32 : quotient + 1 + k;
+}
+}
+
+WaveletCodec::Header::Header() :
+   mRows(0),
+   mColumns(0),
+   mBands(0),
+   mEncoding(INT1UBYTE),
+   mBasis(DAUBECHIES_4),
+   mTransform(SPECTRAL_SPATIAL_TRANSFORM),
+   mTileSize(64),
+   mGroupSize(16),
+   mStep(1.0)
+{
+}
+
+bool WaveletCodec::Header::read(QIODevice& device)
+{
+   QDataStream stream(&device);
+   stream.setByteOrder(QDataStream::LittleEndian);
+   stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+   quint32 magic = 0;
+   quint16 version = 0;
+   stream >> magic >> version;
+   if (stream.status() != QDataStream::Ok || magic != sMagic || version != sVersion)
+   {
+      return false;
+   }
+   quint32 encoding = 0;
+   quint32 basis = 0;
+   quint32 transform = 0;
+   stream >> mRows >> mColumns >> mBands >> encoding >> basis >> transform >> mTileSize >> mGroupSize >> mStep;
+   if (stream.status() != QDataStream::Ok)
+   {
+      return false;
+   }
+   mEncoding = static_cast<EncodingTypeEnum>(encoding);
+   mBasis = static_cast<WaveletBasisEnum>(basis);
+   mTransform = static_cast<WaveletTransformTypeEnum>(transform);
+   if (mRows == 0 || mColumns == 0 || mBands == 0 || !mEncoding.isValid() || !mBasis.isValid() || !mTransform.isValid() ||
+      mTileSize < sSquareSize || WaveletUtils::nextPowerOfTwo(mTileSize) != mTileSize ||
+      mGroupSize == 0 || WaveletUtils::nextPowerOfTwo(mGroupSize) != mGroupSize || mStep <= 0.0)
+   {
+      return false;
+   }
+
+   mOffsets.resize(getBlockCount() + 1);
+   for (std::vector<quint64>::iterator offset = mOffsets.begin(); offset != mOffsets.end(); ++offset)
+   {
+      stream >> *offset;
+   }
+   return stream.status() == QDataStream::Ok;
+}
+
+bool WaveletCodec::Header::write(QIODevice& device) const
+{
+   QDataStream stream(&device);
+   stream.setByteOrder(QDataStream::LittleEndian);
+   stream.setFloatingPointPrecision(QDataStream::DoublePrecision);
+   stream << sMagic << sVersion << mRows << mColumns << mBands << static_cast<quint32>(mEncoding)
+          << static_cast<quint32>(mBasis) << static_cast<quint32>(mTransform) << mTileSize << mGroupSize << mStep;
+   for (unsigned int idx = 0; idx <= getBlockCount(); idx++)
+   {
+      stream << ((idx < mOffsets.size()) ? mOffsets[idx] : static_cast<quint64>(0));
+   }
+   return stream.status() == QDataStream::Ok;
+}
+
+unsigned int WaveletCodec::Header::getTileRowCount() const
+{
+   return (mRows + mTileSize - 1) / mTileSize;
+}
+
+unsigned int WaveletCodec::Header::getTileColumnCount() const
+{
+   return (mColumns + mTileSize - 1) / mTileSize;
+}
+
+unsigned int WaveletCodec::Header::getGroupCount() const
+{
+   return (mBands + mGroupSize - 1) / mGroupSize;
+}
+
+unsigned int WaveletCodec::Header::getBlockCount() const
+{
+   return getTileRowCount() * getTileColumnCount() * getGroupCount();
+}
+
+unsigned int WaveletCodec::Header::getBlockIndex(unsigned int tileRow, unsigned int tileColumn, unsigned int group) const
+{
+   return (tileRow * getTileColumnCount() + tileColumn) * getGroupCount() + group;
+}
+
+qint64 WaveletCodec::Header::getSize() const
+{
+   return sFixedHeaderSize + 8 * static_cast<qint64>(getBlockCount() + 1);
+}
+
+WaveletCodec::WaveletCodec(const Header& header) :
+   mBasis(header.mBasis),
+   mTransform(header.mTransform),
+   mTileSize(header.mTileSize),
+   mGroupSize(header.mGroupSize)
+{
+}
+
+unsigned int WaveletCodec::getBlockSize() const
+{
+   return mGroupSize * mTileSize * mTileSize;
+}
+
+void WaveletCodec::padTile(float* pTile, unsigned int validBands, unsigned int paddedBands,
+                           unsigned int validRows, unsigned int validColumns) const
+{
+   unsigned int planeSize = mTileSize * mTileSize;
+   for (unsigned int band = 0; band < validBands; band++)
+   {
+      float* pPlane = pTile + band * planeSize;
+      for (unsigned int row = 0; row < validRows; row++)
+      {
+         WaveletUtils::reflectPad(pPlane + row * mTileSize, validColumns, mTileSize);
+      }
+      for (unsigned int row = validRows; row < mTileSize; row++)
+      {
+         memcpy(pPlane + row * mTileSize, pPlane + WaveletUtils::reflectIndex(row, validRows) * mTileSize,
+            mTileSize * sizeof(float));
+      }
+   }
+   for (unsigned int band = validBands; band < paddedBands; band++)
+   {
+      memcpy(pTile + band * planeSize, pTile + WaveletUtils::reflectIndex(band, validBands) * planeSize,
+         planeSize * sizeof(float));
+   }
+}
+
+void WaveletCodec::forwardTransform(float* pBlock) const
+{
+   unsigned int planeSize = mTileSize * mTileSize;
+   if (mTransform != SPATIAL_TRANSFORM && mGroupSize > 1)
+   {
+      std::vector<float> spectrum(mGroupSize);
+      for (unsigned int pixel = 0; pixel < planeSize; pixel++)
+      {
+         for (unsigned int band = 0; band < mGroupSize; band++)
+         {
+            spectrum[band] = pBlock[band * planeSize + pixel];
+         }
+         WaveletUtils::transform(&spectrum.front(), mGroupSize, true, mBasis, &spectrum.front());
+         for (unsigned int band = 0; band < mGroupSize; band++)
+         {
+            pBlock[band * planeSize + pixel] = spectrum[band];
+         }
+      }
+   }
+   if (mTransform != SPECTRAL_TRANSFORM)
+   {
+      for (unsigned int band = 0; band < mGroupSize; band++)
+      {
+         float* pPlane = pBlock + band * planeSize;
+         WaveletUtils::transform2d(pPlane, mTileSize, mTileSize, true, mBasis, pPlane);
+      }
+   }
+}
+
+void WaveletCodec::inverseTransform(float* pBlock) const
+{
+   unsigned int planeSize = mTileSize * mTileSize;
+   if (mTransform != SPECTRAL_TRANSFORM)
+   {
+      for (unsigned int band = 0; band < mGroupSize; band++)
+      {
+         float* pPlane = pBlock + band * planeSize;
+         WaveletUtils::transform2d(pPlane, mTileSize, mTileSize, false, mBasis, pPlane);
+      }
+   }
+   if (mTransform != SPATIAL_TRANSFORM && mGroupSize > 1)
+   {
+      std::vector<float> spectrum(mGroupSize);
+      for (unsigned int pixel = 0; pixel < planeSize; pixel++)
+      {
+         for (unsigned int band = 0; band < mGroupSize; band++)
+         {
+            spectrum[band] = pBlock[band * planeSize + pixel];
+         }
+         WaveletUtils::transform(&spectrum.front(), mGroupSize, false, mBasis, &spectrum.front());
+         for (unsigned int band = 0; band < mGroupSize; band++)
+         {
+            pBlock[band * planeSize + pixel] = spectrum[band];
+         }
+      }
+   }
+}
+
+void WaveletCodec::encode(const float* pCoefficients, double step, QByteArray& payload) const
+{
+   BitWriter writer(payload);
+   quint32 pSquare[sSquareCount];
+   for (unsigned int band = 0; band < mGroupSize; band++)
+   {
+      const float* pPlane = pCoefficients + band * mTileSize * mTileSize;
+      for (unsigned int squareRow = 0; squareRow < mTileSize; squareRow += sSquareSize)
+      {
+         for (unsigned int squareColumn = 0; squareColumn < mTileSize; squareColumn += sSquareSize)
+         {
+            bool zero = true;
+            for (unsigned int idx = 0; idx < sSquareCount; idx++)
+            {
+               unsigned int row = squareRow + idx / sSquareSize;
+               unsigned int column = squareColumn + idx % sSquareSize;
+               pSquare[idx] = quantize(pPlane[row * mTileSize + column], step);
+               zero = zero && pSquare[idx] == 0;
+            }
+            if (zero)
+            {
+               writer.write(0, 1);
+               continue;
+            }
+            writer.write(1, 1);
+
+            // choose the Rice parameter which minimizes the coded length of this square
+            unsigned int bestK = 0;
+            unsigned int bestLength = std::numeric_limits<unsigned int>::max();
+            for (unsigned int k = 0; k <= sMaxRiceParameter; k++)
+            {
+               unsigned int length = 0;
+               for (unsigned int idx = 0; idx < sSquareCount; idx++)
+               {
+                  length += riceLength(pSquare[idx], k);
+               }
+               if (length < bestLength)
+               {
+                  bestLength = length;
+                  bestK = k;
+               }
+            }
+            writer.write(bestK, 5);
+            for (unsigned int idx = 0; idx < sSquareCount; idx++)
+            {
+               quint32 quotient = pSquare[idx] >> bestK;
+               if (quotient >= sEscapeLength)
+               {
+                  writer.write((1 << sEscapeLength) - 1, sEscapeLength);
+                  writer.write(pSquare[idx], 32);
+               }
+               else
+               {
+                  writer.write((1 << quotient) - 1, quotient);
+                  writer.write(0, 1);
+                  writer.write(pSquare[idx], bestK);
+               }
+            }
+         }
+      }
+   }
+   writer.flush();
+}
+
+bool WaveletCodec::decode(const char* pPayload, int length, double step, float* pCoefficients) const
+{
+   BitReader reader(pPayload, length);
+   for (unsigned int band = 0; band < mGroupSize; band++)
+   {
+      float* pPlane = pCoefficients + band * mTileSize * mTileSize;
+      for (unsigned int squareRow = 0; squareRow < mTileSize; squareRow += sSquareSize)
+      {
+         for (unsigned int squareColumn = 0; squareColumn < mTileSize; squareColumn += sSquareSize)
+         {
+            if (reader.read(1) == 0)
+            {
+               for (unsigned int idx = 0; idx < sSquareCount; idx++)
+               {
+                  pPlane[(squareRow + idx / sSquareSize) * mTileSize + squareColumn + idx % sSquareSize] = 0.0f;
+               }
+               continue;
+            }
+            unsigned int k = reader.read(5);
+            for (unsigned int idx = 0; idx < sSquareCount; idx++)
+            {
+               quint32 quotient = 0;
+               while (quotient < sEscapeLength && reader.read(1) == 1)
+               {
+                  quotient++;
+               }
+               quint32 value = (quotient >= sEscapeLength) ? reader.read(32) : ((quotient << k) | reader.read(k));
+               pPlane[(squareRow + idx / sSquareSize) * mTileSize + squareColumn + idx % sSquareSize] =
+                  dequantize(value, step);
+            }
+            if (reader.overrun())
+            {
+               return false;
+            }
+         }
+      }
+   }
+   return !reader.overrun();
+}
+
+double WaveletCodec::stepForPsnr(double psnr, double peak)
+{
+   double mse = peak * peak / pow(10.0, psnr / 10.0);
+   return sqrt(12.0 * mse);
+}
@@ -0,0 +1,141 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETCODEC_H__
+#define WAVELETCODEC_H__
+
+#include "EnumWrapper.h"
+#include "TypesFile.h"
+#include "WaveletUtils.h"
+
+#include <QtCore/QByteArray>
+#include <QtCore/QtGlobal>
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <vector>
+
+class QIODevice;
+
+enum WaveletTransformTypeEnum { SPECTRAL_TRANSFORM, SPATIAL_TRANSFORM, SPECTRAL_SPATIAL_TRANSFORM };
+typedef EnumWrapper<WaveletTransformTypeEnum> WaveletTransformType;
+
+/**
+ * Block based wavelet codec shared by the compression exporter and importer.
+ *
+ * A cube is split into square spatial tiles and groups of adjacent bands. Each tile/group block
+ * is transformed spectrally and/or spatially, quantized with a uniform dead-zone quantizer and
+ * Rice coded in 4x4 coefficient squares with a flag for squares that quantize to zero. Blocks are
+ * coded independently and located through an offset index so any tile and band range can be
+ * decoded without touching the rest of the file.
+ *
+ * File layout (little endian):
+ *   magic, version, rows, columns, bands, encoding, basis, transform, tile size, group size, step
+ *   block offsets (block count + 1 entries, the last one is the end of the final block)
+ *   block payloads ordered by tile row, tile column then band group
+ */
+class WaveletCodec
+{
+public:
+   struct Header
+   {
+      Header();
+
+      bool read(QIODevice& device);
+      bool write(QIODevice& device) const;
+
+      unsigned int getTileRowCount() const;
+      unsigned int getTileColumnCount() const;
+      unsigned int getGroupCount() const;
+      unsigned int getBlockCount() const;
+      unsigned int getBlockIndex(unsigned int tileRow, unsigned int tileColumn, unsigned int group) const;
+
+      /**
+       * The size in bytes of the header and block index. The first block starts here.
+       */
+      qint64 getSize() const;
+
+      unsigned int mRows;
+      unsigned int mColumns;
+      unsigned int mBands;
+      EncodingType mEncoding;
+      WaveletBasis mBasis;
+      WaveletTransformType mTransform;
+      unsigned int mTileSize;
+      unsigned int mGroupSize;
+      double mStep;
+      std::vector<quint64> mOffsets;
+   };
+
+   explicit WaveletCodec(const Header& header);
+
+   /**
+    * The number of coefficients in a block. Blocks are stored band major: [group size][tile size][tile size].
+    */
+   unsigned int getBlockSize() const;
+
+   /**
+    * Fill the padding of a tile by symmetric reflection.
+    *
+    * @param pTile
+    *        Tile of paddedBands planes of tile size x tile size values. Only the first validBands planes
+    *        and the top left validRows x validColumns of each plane need to be populated.
+    */
+   void padTile(float* pTile, unsigned int validBands, unsigned int paddedBands,
+      unsigned int validRows, unsigned int validColumns) const;
+
+   void forwardTransform(float* pBlock) const;
+   void inverseTransform(float* pBlock) const;
+
+   /**
+    * Quantize and entropy code a block of coefficients.
+    *
+    * @param pCoefficients
+    *        The transformed block.
+    * @param step
+    *        The quantizer step size.
+    * @param payload
+    *        The coded data is appended here.
+    */
+   void encode(const float* pCoefficients, double step, QByteArray& payload) const;
+
+   /**
+    * Decode and dequantize a block of coefficients.
+    *
+    * @return False if the payload is truncated or corrupt.
+    */
+   bool decode(const char* pPayload, int length, double step, float* pCoefficients) const;
+
+   /**
+    * The quantizer step size which gives approximately the requested PSNR.
+    *
+    * A uniform quantizer with step d has a mean squared error of about d^2 / 12 and the
+    * transforms are close to orthonormal so the same error appears in the reconstruction.
+    */
+   static double stepForPsnr(double psnr, double peak);
+
+   template<typename T>
+   static T toNative(double value)
+   {
+      if (std::numeric_limits<T>::is_integer)
+      {
+         value = floor(value + 0.5);
+         value = std::max(value, static_cast<double>(std::numeric_limits<T>::min()));
+         value = std::min(value, static_cast<double>(std::numeric_limits<T>::max()));
+      }
+      return static_cast<T>(value);
+   }
+
+private:
+   WaveletBasis mBasis;
+   WaveletTransformType mTransform;
+   unsigned int mTileSize;
+   unsigned int mGroupSize;
+};
+
+#endif
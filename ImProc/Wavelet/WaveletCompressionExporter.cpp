@@ -0,0 +1,439 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "Filename.h"
+#include "ImProcVersion.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterFileDescriptor.h"
+#include "RasterUtilities.h"
+#include "Statistics.h"
+#include "StringUtilities.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "TypeConverter.h"
+#include "WaveletCompressionExporter.h"
+
+#include <QtCore/QFile>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(WaveletModule, WaveletCompressionExporter);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(WaveletTransformType)
+ADD_ENUM_MAPPING(SPECTRAL_TRANSFORM, "Spectral", "spectral")
+ADD_ENUM_MAPPING(SPATIAL_TRANSFORM, "Spatial", "spatial")
+ADD_ENUM_MAPPING(SPECTRAL_SPATIAL_TRANSFORM, "Spectral and spatial", "spectral_spatial")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   // maximum number of blocks coded during each bisection step of the bit rate search
+   const unsigned int sCalibrationBlocks = 16;
+
+   template<typename T>
+   void loadTileData(const T* pUnused, DataAccessor& accessor, unsigned int startRow, unsigned int startColumn,
+      unsigned int validRows, unsigned int validColumns, unsigned int startBand, unsigned int bands,
+      unsigned int tileSize, float* pTile)
+   {
+      for (unsigned int row = 0; row < validRows; row++)
+      {
+         accessor->toPixel(startRow + row, startColumn);
+         for (unsigned int column = 0; column < validColumns; column++)
+         {
+            if (!accessor.isValid())
+            {
+               return;
+            }
+            const T* pPixel = reinterpret_cast<const T*>(accessor->getColumn()) + startBand;
+            for (unsigned int band = 0; band < bands; band++)
+            {
+               pTile[(band * tileSize + row) * tileSize + column] = static_cast<float>(pPixel[band]);
+            }
+            accessor->nextColumn();
+         }
+      }
+   }
+}
+
+WaveletCompressionExporter::WaveletCompressionExporter() :
+   mpRaster(NULL),
+   mpDescriptor(NULL),
+   mStartRow(0),
+   mStartColumn(0),
+   mStartBand(0),
+   mPsnr(40.0),
+   mBitRate(0.0),
+   mAbortFlag(false)
+{
+   setName("Wavelet Compression Exporter");
+   setDescription("Lossy wavelet domain cube compression");
+   setDescriptorId("{1207EB9B-BF86-4767-A0D3-7FF014CBAF67}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setExtensions("Wavelet Compressed Cube Files (*.wcc)");
+   setSubtype(TypeConverter::toString<RasterElement>());
+   setAbortSupported(true);
+}
+
+WaveletCompressionExporter::~WaveletCompressionExporter()
+{
+}
+
+bool WaveletCompressionExporter::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(ExportItemArg()));
+   VERIFY(pInArgList->addArg<RasterFileDescriptor>(ExportDescriptorArg()));
+   VERIFY(pInArgList->addArg<double>("Target PSNR", 40.0,
+      "The target peak signal to noise ratio in dB relative to the data range."));
+   VERIFY(pInArgList->addArg<double>("Target Bit Rate", 0.0,
+      "The target number of bits per sample. If this is greater than 0 it is used instead of the target PSNR."));
+   std::string transformHelp = "The wavelet transforms applied to each block. Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<WaveletTransformType>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<WaveletTransformType>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      transformHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Transform",
+      StringUtilities::toXmlString<WaveletTransformType>(SPECTRAL_SPATIAL_TRANSFORM), transformHelp));
+   std::string basisHelp = "The basis function for the wavelet. Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<WaveletBasis>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<WaveletBasis>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      basisHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Wavelet Basis", StringUtilities::toXmlString<WaveletBasis>(DAUBECHIES_4),
+      basisHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Tile Size", 64,
+      "The width and height of the spatial tiles. This must be a power of 2 no smaller than 16."));
+   VERIFY(pInArgList->addArg<unsigned int>("Band Group Size", 16,
+      "The number of adjacent bands transformed together. This must be a power of 2."));
+   return true;
+}
+
+bool WaveletCompressionExporter::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   pOutArgList = NULL;
+   return true;
+}
+
+bool WaveletCompressionExporter::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin wavelet compression.", 1, NORMAL);
+   double peak = calculatePeak();
+   if (mBitRate > 0.0)
+   {
+      if (!calibrateStep(peak))
+      {
+         return false;
+      }
+   }
+   else
+   {
+      mHeader.mStep = WaveletCodec::stepForPsnr(mPsnr, peak);
+   }
+
+   QFile file(QString::fromStdString(mFilename));
+   if (!file.open(QFile::WriteOnly | QFile::Truncate))
+   {
+      mProgress.report("Unable to open " + mFilename + " for writing.", 0, ERRORS, true);
+      return false;
+   }
+
+   // the block index is written with placeholders and filled in once the payload sizes are known
+   mHeader.mOffsets.assign(mHeader.getBlockCount() + 1, 0);
+   if (!mHeader.write(file))
+   {
+      mProgress.report("Unable to write the file header.", 0, ERRORS, true);
+      return false;
+   }
+
+   WaveletCodec codec(mHeader);
+   unsigned int blockSize = codec.getBlockSize();
+   unsigned int tileRows = mHeader.getTileRowCount();
+   unsigned int tileColumns = mHeader.getTileColumnCount();
+   unsigned int groups = mHeader.getGroupCount();
+   std::vector<float> tile;
+   QByteArray payload;
+   for (unsigned int tileRow = 0; tileRow < tileRows; tileRow++)
+   {
+      if (mAbortFlag)
+      {
+         mProgress.report("Wavelet compression aborted.", 0, ABORT, true);
+         file.remove();
+         return false;
+      }
+      mProgress.report("Compressing", 1 + 98 * tileRow / tileRows, NORMAL);
+      for (unsigned int tileColumn = 0; tileColumn < tileColumns; tileColumn++)
+      {
+         if (!loadTile(codec, tileRow, tileColumn, tile))
+         {
+            file.remove();
+            return false;
+         }
+         for (unsigned int group = 0; group < groups; group++)
+         {
+            float* pBlock = &tile[group * blockSize];
+            codec.forwardTransform(pBlock);
+            payload.clear();
+            codec.encode(pBlock, mHeader.mStep, payload);
+            mHeader.mOffsets[mHeader.getBlockIndex(tileRow, tileColumn, group)] = file.pos();
+            if (file.write(payload) != payload.size())
+            {
+               mProgress.report("Unable to write " + mFilename + ".", 0, ERRORS, true);
+               file.remove();
+               return false;
+            }
+         }
+      }
+   }
+   mHeader.mOffsets.back() = file.pos();
+   double bitRate = 8.0 * (file.pos() - mHeader.getSize()) /
+      (static_cast<double>(mHeader.mRows) * mHeader.mColumns * mHeader.mBands);
+   if (!file.seek(0) || !mHeader.write(file))
+   {
+      mProgress.report("Unable to write the block index.", 0, ERRORS, true);
+      file.remove();
+      return false;
+   }
+
+   mProgress.report("Wavelet compression complete at " + StringUtilities::toDisplayString(bitRate) +
+      " bits per sample.", 100, NORMAL);
+   mProgress.upALevel();
+   return true;
+}
+
+bool WaveletCompressionExporter::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{18DE93A6-9C0D-4548-8F10-573DA5457687}");
+   if ((mpRaster = pInArgList->getPlugInArgValue<RasterElement>(ExportItemArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mpDescriptor = static_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   RasterFileDescriptor* pFileDescriptor = pInArgList->getPlugInArgValue<RasterFileDescriptor>(ExportDescriptorArg());
+   if (pFileDescriptor == NULL)
+   {
+      mProgress.report("No export file descriptor.", 0, ERRORS, true);
+      return false;
+   }
+   mFilename = pFileDescriptor->getFilename().getFullPathAndName();
+
+   const std::vector<DimensionDescriptor>& rows = pFileDescriptor->getRows();
+   const std::vector<DimensionDescriptor>& columns = pFileDescriptor->getColumns();
+   const std::vector<DimensionDescriptor>& bands = pFileDescriptor->getBands();
+   unsigned int skipFactor = 0;
+   if (rows.empty() || columns.empty() || bands.empty() ||
+      !RasterUtilities::determineSkipFactor(rows, skipFactor) || skipFactor != 0 ||
+      !RasterUtilities::determineSkipFactor(columns, skipFactor) || skipFactor != 0 ||
+      !RasterUtilities::determineSkipFactor(bands, skipFactor) || skipFactor != 0)
+   {
+      mProgress.report("Only contiguous export subsets are supported.", 0, ERRORS, true);
+      return false;
+   }
+   mStartRow = rows.front().getActiveNumber();
+   mStartColumn = columns.front().getActiveNumber();
+   mStartBand = bands.front().getActiveNumber();
+
+   mHeader.mRows = rows.size();
+   mHeader.mColumns = columns.size();
+   mHeader.mBands = bands.size();
+   mHeader.mEncoding = mpDescriptor->getDataType();
+   if (mHeader.mEncoding == INT4SCOMPLEX || mHeader.mEncoding == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data can not be compressed.", 0, ERRORS, true);
+      return false;
+   }
+
+   pInArgList->getPlugInArgValue("Target PSNR", mPsnr);
+   pInArgList->getPlugInArgValue("Target Bit Rate", mBitRate);
+   std::string transformStr;
+   pInArgList->getPlugInArgValue("Transform", transformStr);
+   mHeader.mTransform = StringUtilities::fromXmlString<WaveletTransformType>(transformStr);
+   std::string basisStr;
+   pInArgList->getPlugInArgValue("Wavelet Basis", basisStr);
+   mHeader.mBasis = StringUtilities::fromXmlString<WaveletBasis>(basisStr);
+   pInArgList->getPlugInArgValue("Tile Size", mHeader.mTileSize);
+   pInArgList->getPlugInArgValue("Band Group Size", mHeader.mGroupSize);
+   if (!mHeader.mTransform.isValid() || !mHeader.mBasis.isValid())
+   {
+      mProgress.report("Invalid transform or wavelet basis.", 0, ERRORS, true);
+      return false;
+   }
+   if (mHeader.mTileSize < 16 || WaveletUtils::nextPowerOfTwo(mHeader.mTileSize) != mHeader.mTileSize)
+   {
+      mProgress.report("The tile size must be a power of 2 no smaller than 16.", 0, ERRORS, true);
+      return false;
+   }
+   if (mHeader.mGroupSize == 0 || WaveletUtils::nextPowerOfTwo(mHeader.mGroupSize) != mHeader.mGroupSize)
+   {
+      mProgress.report("The band group size must be a power of 2.", 0, ERRORS, true);
+      return false;
+   }
+   if (mHeader.mTransform == SPATIAL_TRANSFORM)
+   {
+      // groups only determine the decode granularity when there is no spectral transform
+      mHeader.mGroupSize = 1;
+   }
+   mHeader.mGroupSize = std::min(mHeader.mGroupSize, WaveletUtils::nextPowerOfTwo(mHeader.mBands));
+   if (mBitRate <= 0.0 && mPsnr <= 0.0)
+   {
+      mProgress.report("A positive target PSNR or bit rate is required.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+bool WaveletCompressionExporter::loadTile(const WaveletCodec& codec, unsigned int tileRow, unsigned int tileColumn,
+                                          std::vector<float>& tile)
+{
+   unsigned int tileSize = mHeader.mTileSize;
+   unsigned int firstRow = tileRow * tileSize;
+   unsigned int firstColumn = tileColumn * tileSize;
+   unsigned int validRows = std::min(tileSize, mHeader.mRows - firstRow);
+   unsigned int validColumns = std::min(tileSize, mHeader.mColumns - firstColumn);
+   unsigned int paddedBands = mHeader.getGroupCount() * mHeader.mGroupSize;
+   tile.resize(paddedBands * tileSize * tileSize);
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   pRequest->setRows(mpDescriptor->getActiveRow(mStartRow + firstRow),
+      mpDescriptor->getActiveRow(mStartRow + firstRow + validRows - 1));
+   pRequest->setColumns(mpDescriptor->getActiveColumn(mStartColumn + firstColumn),
+      mpDescriptor->getActiveColumn(mStartColumn + firstColumn + validColumns - 1));
+   DataAccessor accessor = mpRaster->getDataAccessor(pRequest.release());
+   if (!accessor.isValid())
+   {
+      mProgress.report("Invalid data access.", 0, ERRORS, true);
+      return false;
+   }
+   switchOnEncoding(mHeader.mEncoding, loadTileData, accessor->getColumn(), accessor, mStartRow + firstRow,
+      mStartColumn + firstColumn, validRows, validColumns, mStartBand, mHeader.mBands, tileSize, &tile.front());
+   if (!accessor.isValid())
+   {
+      mProgress.report("Invalid data access.", 0, ERRORS, true);
+      return false;
+   }
+   codec.padTile(&tile.front(), mHeader.mBands, paddedBands, validRows, validColumns);
+   return true;
+}
+
+double WaveletCompressionExporter::calculatePeak() const
+{
+   double minValue = 0.0;
+   double maxValue = 0.0;
+   for (unsigned int band = 0; band < mHeader.mBands; band++)
+   {
+      Statistics* pStatistics = mpRaster->getStatistics(mpDescriptor->getActiveBand(mStartBand + band));
+      if (pStatistics == NULL)
+      {
+         continue;
+      }
+      if (band == 0)
+      {
+         minValue = pStatistics->getMin();
+         maxValue = pStatistics->getMax();
+      }
+      else
+      {
+         minValue = std::min(minValue, pStatistics->getMin());
+         maxValue = std::max(maxValue, pStatistics->getMax());
+      }
+   }
+   return (maxValue > minValue) ? maxValue - minValue : 1.0;
+}
+
+bool WaveletCompressionExporter::calibrateStep(double peak)
+{
+   mProgress.report("Calibrating quantizer", 1, NORMAL);
+   WaveletCodec codec(mHeader);
+   unsigned int blockSize = codec.getBlockSize();
+   unsigned int tileRows = mHeader.getTileRowCount();
+   unsigned int tileColumns = mHeader.getTileColumnCount();
+   unsigned int tileCount = tileRows * tileColumns;
+   unsigned int sampleTiles = std::min(tileCount, std::max(1U, sCalibrationBlocks / mHeader.getGroupCount()));
+
+   // transform an evenly spaced sample of tiles once, only the quantization is repeated during the search
+   std::vector<float> coefficients;
+   std::vector<float> tile;
+   double samples = 0.0;
+   for (unsigned int sample = 0; sample < sampleTiles; sample++)
+   {
+      unsigned int tileIndex = sample * tileCount / sampleTiles;
+      unsigned int tileRow = tileIndex / tileColumns;
+      unsigned int tileColumn = tileIndex % tileColumns;
+      if (!loadTile(codec, tileRow, tileColumn, tile))
+      {
+         return false;
+      }
+      for (unsigned int group = 0; group < mHeader.getGroupCount(); group++)
+      {
+         codec.forwardTransform(&tile[group * blockSize]);
+      }
+      coefficients.insert(coefficients.end(), tile.begin(), tile.end());
+      samples += static_cast<double>(std::min(mHeader.mTileSize, mHeader.mRows - tileRow * mHeader.mTileSize)) *
+         std::min(mHeader.mTileSize, mHeader.mColumns - tileColumn * mHeader.mTileSize) * mHeader.mBands;
+   }
+
+   double lowStep = peak * 1e-7;
+   double highStep = peak;
+   QByteArray payload;
+   for (int iteration = 0; iteration < 24; iteration++)
+   {
+      if (mAbortFlag)
+      {
+         mProgress.report("Wavelet compression aborted.", 0, ABORT, true);
+         return false;
+      }
+      double step = sqrt(lowStep * highStep);
+      double bits = 0.0;
+      for (unsigned int offset = 0; offset < coefficients.size(); offset += blockSize)
+      {
+         payload.clear();
+         codec.encode(&coefficients[offset], step, payload);
+         bits += 8.0 * payload.size();
+      }
+      if (bits / samples > mBitRate)
+      {
+         lowStep = step;
+      }
+      else
+      {
+         highStep = step;
+      }
+   }
+   mHeader.mStep = highStep;
+   return true;
+}
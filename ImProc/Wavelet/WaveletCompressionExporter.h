@@ -0,0 +1,80 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETCOMPRESSIONEXPORTER_H__
+#define WAVELETCOMPRESSIONEXPORTER_H__
+
+#include "ExporterShell.h"
+#include "ProgressTracker.h"
+#include "WaveletCodec.h"
+
+#include <vector>
+
+class RasterDataDescriptor;
+class RasterElement;
+
+/**
+ * Lossy wavelet domain cube compression.
+ *
+ * The quantizer step is chosen for a target PSNR relative to the data range or, if a target
+ * bit rate is specified, by bisection over a sample of blocks.
+ */
+class WaveletCompressionExporter : public ExporterShell
+{
+public:
+   WaveletCompressionExporter();
+   virtual ~WaveletCompressionExporter();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   bool extractInputArgs(PlugInArgList* pInArgList);
+
+   /**
+    * Read and pad all band groups of a tile.
+    *
+    * @param tile
+    *        Resized to hold group count blocks.
+    */
+   bool loadTile(const WaveletCodec& codec, unsigned int tileRow, unsigned int tileColumn, std::vector<float>& tile);
+
+   /**
+    * Calculate the data range used as the PSNR peak.
+    */
+   double calculatePeak() const;
+
+   /**
+    * Bisect for the quantizer step which codes a sample of blocks at the target bit rate.
+    */
+   bool calibrateStep(double peak);
+
+private:
+   ProgressTracker mProgress;
+   RasterElement* mpRaster;
+   const RasterDataDescriptor* mpDescriptor;
+   std::string mFilename;
+   WaveletCodec::Header mHeader;
+
+   // contiguous export subset in active numbers
+   unsigned int mStartRow;
+   unsigned int mStartColumn;
+   unsigned int mStartBand;
+
+   double mPsnr;
+   double mBitRate;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "DataRequest.h"
+#include "Filename.h"
+#include "ImportDescriptor.h"
+#include "ImProcVersion.h"
+#include "ObjectResource.h"
+#include "PlugInArgList.h"
+#include "PlugInRegistration.h"
+#include "PlugInResource.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterFileDescriptor.h"
+#include "RasterUtilities.h"
+#include "StringUtilities.h"
+#include "switchOnEncoding.h"
+#include "TypeConverter.h"
+#include "WaveletCompressionImporter.h"
+
+#include <algorithm>
+
+REGISTER_PLUGIN_BASIC(WaveletModule, WaveletCompressionImporter);
+REGISTER_PLUGIN_BASIC(WaveletModule, WaveletCompressionPager);
+
+namespace
+{
+   template<typename T>
+   void storeValues(T* pData, const float* pValues, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pData[idx] = WaveletCodec::toNative<T>(pValues[idx]);
+      }
+   }
+}
+
+WaveletCompressionImporter::WaveletCompressionImporter()
+{
+   setDescriptorId("{B5DA29BE-E261-4962-B032-EF737D1D1DFC}");
+   setName("Wavelet Compression Importer");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setExtensions("Wavelet Compressed Cube Files (*.wcc)");
+}
+
+WaveletCompressionImporter::~WaveletCompressionImporter()
+{
+}
+
+std::vector<ImportDescriptor*> WaveletCompressionImporter::getImportDescriptors(const std::string& filename)
+{
+   mErrors.clear();
+   std::vector<ImportDescriptor*> descriptors;
+
+   ImportDescriptorResource pImportDescriptor(filename, TypeConverter::toString<RasterElement>());
+   VERIFYRV(pImportDescriptor.get(), descriptors);
+   descriptors.push_back(pImportDescriptor.release());
+
+   QFile file(QString::fromStdString(filename));
+   WaveletCodec::Header header;
+   if (!file.open(QFile::ReadOnly) || !header.read(file))
+   {
+      mErrors.push_back("Invalid wavelet compressed cube file.");
+      return descriptors;
+   }
+
+   // decoding on demand is what makes tile and band subsets cheap so default to on-disk access
+   pImportDescriptor->setDataDescriptor(RasterUtilities::generateRasterDataDescriptor(
+      filename, NULL, header.mRows, header.mColumns, header.mBands, BSQ, header.mEncoding, ON_DISK_READ_ONLY));
+   RasterUtilities::generateAndSetFileDescriptor(pImportDescriptor->getDataDescriptor(), filename,
+      std::string(), LITTLE_ENDIAN_ORDER);
+
+   return descriptors;
+}
+
+unsigned char WaveletCompressionImporter::getFileAffinity(const std::string& filename)
+{
+   QFile file(QString::fromStdString(filename));
+   WaveletCodec::Header header;
+   if (!file.open(QFile::ReadOnly) || !header.read(file))
+   {
+      return CAN_NOT_LOAD;
+   }
+   return CAN_LOAD;
+}
+
+bool WaveletCompressionImporter::validate(const DataDescriptor* pDescriptor, std::string& errorMessage) const
+{
+   errorMessage = "";
+   if (!mErrors.empty())
+   {
+      errorMessage = StringUtilities::join(mErrors, "\n");
+      return false;
+   }
+   const RasterDataDescriptor* pRasterDescriptor = dynamic_cast<const RasterDataDescriptor*>(pDescriptor);
+   if (pRasterDescriptor != NULL)
+   {
+      unsigned int skipFactor = 0;
+      if (!RasterUtilities::determineSkipFactor(pRasterDescriptor->getRows(), skipFactor) || skipFactor != 0 ||
+         !RasterUtilities::determineSkipFactor(pRasterDescriptor->getColumns(), skipFactor) || skipFactor != 0)
+      {
+         errorMessage = "Skip factors are not supported for rows or columns.";
+         return false;
+      }
+   }
+   return RasterElementImporterShell::validate(pDescriptor, errorMessage);
+}
+
+bool WaveletCompressionImporter::createRasterPager(RasterElement* pRaster) const
+{
+   VERIFY(pRaster != NULL);
+   DataDescriptor* pDescriptor = pRaster->getDataDescriptor();
+   VERIFY(pDescriptor != NULL);
+   FileDescriptor* pFileDescriptor = pDescriptor->getFileDescriptor();
+   VERIFY(pFileDescriptor != NULL);
+
+   std::string filename = pRaster->getFilename();
+   Progress* pProgress = getProgress();
+
+   FactoryResource<Filename> pFilename;
+   pFilename->setFullPathAndName(filename);
+
+   ExecutableResource pagerPlugIn("WaveletCompressionPager", std::string(), pProgress);
+   pagerPlugIn->getInArgList().setPlugInArgValue(CachedPager::PagedElementArg(), pRaster);
+   pagerPlugIn->getInArgList().setPlugInArgValue(CachedPager::PagedFilenameArg(), pFilename.get());
+
+   bool success = pagerPlugIn->execute();
+
+   RasterPager* pPager = dynamic_cast<RasterPager*>(pagerPlugIn->getPlugIn());
+   if (!success || pPager == NULL)
+   {
+      std::string message = "Execution of WaveletCompressionPager failed!";
+      if (pProgress != NULL) pProgress->updateProgress(message, 0, ERRORS);
+      return false;
+   }
+
+   pRaster->setPager(pPager);
+   pagerPlugIn->releasePlugIn();
+
+   return true;
+}
+
+WaveletCompressionPager::WaveletCompressionPager() :
+   mBlocks(64 * 1024 * 1024) // 64MB decoded block cache
+{
+   setName("WaveletCompressionPager");
+   setCopyright(IMPROC_COPYRIGHT);
+   setDescription("Provides access to on-disk wavelet compressed data");
+   setDescriptorId("{C7F03169-CCFF-4110-9730-3773E2DEEB8D}");
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setShortDescription("Wavelet compression pager");
+}
+
+WaveletCompressionPager::~WaveletCompressionPager()
+{
+}
+
+bool WaveletCompressionPager::openFile(const std::string& filename)
+{
+   mFile.setFileName(QString::fromStdString(filename));
+   if (!mFile.open(QFile::ReadOnly) || !mHeader.read(mFile))
+   {
+      return false;
+   }
+   mpCodec.reset(new WaveletCodec(mHeader));
+   return true;
+}
+
+const std::vector<float>* WaveletCompressionPager::getBlock(unsigned int blockIndex)
+{
+   std::vector<float>* pBlock = mBlocks.object(blockIndex);
+   if (pBlock != NULL)
+   {
+      return pBlock;
+   }
+   VERIFYRV(mpCodec.get() != NULL && blockIndex + 1 < mHeader.mOffsets.size(), NULL);
+   quint64 start = mHeader.mOffsets[blockIndex];
+   quint64 stop = mHeader.mOffsets[blockIndex + 1];
+   if (stop < start || !mFile.seek(start))
+   {
+      return NULL;
+   }
+   QByteArray payload = mFile.read(stop - start);
+   if (static_cast<quint64>(payload.size()) != stop - start)
+   {
+      return NULL;
+   }
+   std::auto_ptr<std::vector<float> > pDecoded(new std::vector<float>(mpCodec->getBlockSize()));
+   if (!mpCodec->decode(payload.constData(), payload.size(), mHeader.mStep, &pDecoded->front()))
+   {
+      return NULL;
+   }
+   mpCodec->inverseTransform(&pDecoded->front());
+   pBlock = pDecoded.get();
+   if (!mBlocks.insert(blockIndex, pDecoded.release(), pBlock->size() * sizeof(float)))
+   {
+      // larger than the whole cache...the cache has already deleted it
+      return NULL;
+   }
+   return pBlock;
+}
+
+CachedPage::UnitPtr WaveletCompressionPager::fetchUnit(DataRequest* pOriginalRequest)
+{
+   VERIFYRV(pOriginalRequest != NULL, CachedPage::UnitPtr());
+   const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(getRasterElement()->getDataDescriptor());
+   unsigned int band = pOriginalRequest->getStartBand().getOnDiskNumber();
+   unsigned int startRow = pOriginalRequest->getStartRow().getOnDiskNumber();
+   unsigned int rowCount = std::min(pOriginalRequest->getConcurrentRows(), mHeader.mRows - startRow);
+   unsigned int startColumn = pDesc->getActiveColumn(0).getOnDiskNumber();
+   unsigned int columnCount = pDesc->getColumnCount();
+   VERIFYRV(band < mHeader.mBands && startColumn + columnCount <= mHeader.mColumns, CachedPage::UnitPtr());
+
+   unsigned int bpp = pDesc->getBytesPerElement();
+   size_t bufsize = static_cast<size_t>(rowCount) * columnCount * bpp;
+   char* pBuffer = new char[bufsize];
+
+   unsigned int tileSize = mHeader.mTileSize;
+   unsigned int group = band / mHeader.mGroupSize;
+   const unsigned int planeOffset = (band % mHeader.mGroupSize) * tileSize * tileSize;
+   for (unsigned int tileRow = startRow / tileSize; tileRow <= (startRow + rowCount - 1) / tileSize; tileRow++)
+   {
+      for (unsigned int tileColumn = startColumn / tileSize;
+         tileColumn <= (startColumn + columnCount - 1) / tileSize; tileColumn++)
+      {
+         const std::vector<float>* pBlock = getBlock(mHeader.getBlockIndex(tileRow, tileColumn, group));
+         if (pBlock == NULL)
+         {
+            delete [] pBuffer;
+            return CachedPage::UnitPtr();
+         }
+         unsigned int firstRow = std::max(startRow, tileRow * tileSize);
+         unsigned int lastRow = std::min(startRow + rowCount, (tileRow + 1) * tileSize);
+         unsigned int firstColumn = std::max(startColumn, tileColumn * tileSize);
+         unsigned int lastColumn = std::min(startColumn + columnCount, (tileColumn + 1) * tileSize);
+         for (unsigned int row = firstRow; row < lastRow; row++)
+         {
+            const float* pSource = &(*pBlock)[planeOffset + (row - tileRow * tileSize) * tileSize +
+               firstColumn - tileColumn * tileSize];
+            char* pDest = pBuffer + ((row - startRow) * columnCount + firstColumn - startColumn) * bpp;
+            switchOnEncoding(mHeader.mEncoding, storeValues, pDest, pSource, lastColumn - firstColumn);
+         }
+      }
+   }
+
+   return CachedPage::UnitPtr(new CachedPage::CacheUnit(
+      pBuffer, pOriginalRequest->getStartRow(), rowCount, bufsize, pOriginalRequest->getStartBand()));
+}
@@ -0,0 +1,60 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETCOMPRESSIONIMPORTER_H__
+#define WAVELETCOMPRESSIONIMPORTER_H__
+
+#include "CachedPager.h"
+#include "RasterElementImporterShell.h"
+#include "WaveletCodec.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QFile>
+#include <memory>
+#include <vector>
+
+class WaveletCompressionImporter : public RasterElementImporterShell
+{
+public:
+   WaveletCompressionImporter();
+   virtual ~WaveletCompressionImporter();
+
+   virtual std::vector<ImportDescriptor*> getImportDescriptors(const std::string& filename);
+   virtual unsigned char getFileAffinity(const std::string& filename);
+   virtual bool validate(const DataDescriptor* pDescriptor, std::string& errorMessage) const;
+   virtual bool createRasterPager(RasterElement* pRaster) const;
+
+private:
+   std::vector<std::string> mErrors;
+};
+
+/**
+ * Decodes blocks on demand.
+ *
+ * Only the blocks which intersect a requested row range and band are read and decoded.
+ * Decoded blocks are cached since a block holds several bands.
+ */
+class WaveletCompressionPager : public CachedPager
+{
+public:
+   WaveletCompressionPager();
+   virtual ~WaveletCompressionPager();
+
+private:
+   virtual bool openFile(const std::string& filename);
+   virtual CachedPage::UnitPtr fetchUnit(DataRequest* pOriginalRequest);
+
+   const std::vector<float>* getBlock(unsigned int blockIndex);
+
+   QFile mFile;
+   WaveletCodec::Header mHeader;
+   std::auto_ptr<WaveletCodec> mpCodec;
+   QCache<unsigned int, std::vector<float> > mBlocks;
+};
+
+#endif
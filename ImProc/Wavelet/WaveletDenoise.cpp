@@ -0,0 +1,447 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+#include "WaveletDenoise.h"
+#include "WaveletDenoiseDialog.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+
+REGISTER_PLUGIN_BASIC(WaveletModule, WaveletDenoise);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(ThresholdMethod)
+ADD_ENUM_MAPPING(HARD_THRESHOLD, "Hard threshold", "hard")
+ADD_ENUM_MAPPING(SOFT_THRESHOLD, "Soft threshold", "soft")
+ADD_ENUM_MAPPING(BAYES_SHRINK, "BayesShrink", "bayes")
+END_ENUM_MAPPING()
+}
+
+WaveletDenoise::WaveletDenoise() :
+   mAbortFlag(false)
+{
+   setName("WaveletDenoise");
+   setDescription("Spectral wavelet denoising");
+   setDescriptorId("{4C09B371-AF94-4A6C-89D7-2E8CE0C8BD3C}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Spectral Wavelet Denoise");
+}
+
+WaveletDenoise::~WaveletDenoise()
+{
+}
+
+bool WaveletDenoise::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   std::string defBasis = StringUtilities::toXmlString<WaveletBasis>(DAUBECHIES_4);
+   std::string basisHelp = "The basis function for the wavelet. Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<WaveletBasis>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<WaveletBasis>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      basisHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Wavelet Basis", defBasis, basisHelp));
+   std::string defMethod = StringUtilities::toXmlString<ThresholdMethod>(SOFT_THRESHOLD);
+   std::string methodHelp = "The detail coefficient threshold. Hard and soft thresholds use the universal threshold "
+      "for all levels, BayesShrink calculates a soft threshold for each level. Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<ThresholdMethod>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<ThresholdMethod>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      methodHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Threshold Method", defMethod, methodHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Levels", 0,
+      "The number of detail levels to threshold starting with the finest. 0 thresholds all levels."));
+   return true;
+}
+
+bool WaveletDenoise::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool WaveletDenoise::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin spectral wavelet denoising.", 1, NORMAL);
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   mInput.mSinglePrecision = WaveletUtils::isSinglePrecision(mInput.mpDescriptor->getDataType());
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), mInput.mpDescriptor->getBandCount(),
+      mInput.mSinglePrecision ? FLT4BYTES : FLT8BYTES, BIP, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+   mInput.mpAbortFlag = &mAbortFlag;
+   WaveletDenoiseThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Denoising", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<WaveletDenoiseThreadInput, WaveletDenoiseThreadOutput, WaveletDenoiseThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Denoising complete.", 100, NORMAL);
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Denoising aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Denoising failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool WaveletDenoise::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{10f4ca30-e401-4e48-bc95-1482965e1fc6}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+   if (mInput.mpDescriptor->getBandCount() < 4)
+   {
+      mProgress.report("At least 4 bands are required for denoising.", 0, ERRORS, true);
+      return false;
+   }
+
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+
+   std::string basisStr;
+   pInArgList->getPlugInArgValue("Wavelet Basis", basisStr);
+   mInput.mBasis = StringUtilities::fromXmlString<WaveletBasis>(basisStr);
+   std::string methodStr;
+   pInArgList->getPlugInArgValue("Threshold Method", methodStr);
+   mInput.mMethod = StringUtilities::fromXmlString<ThresholdMethod>(methodStr);
+   pInArgList->getPlugInArgValue("Levels", mInput.mLevels);
+   if (!isBatch())
+   {
+      WaveletDenoiseDialog dlg;
+      dlg.setBasis(mInput.mBasis);
+      dlg.setMethod(mInput.mMethod);
+      dlg.setLevels(mInput.mLevels);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mInput.mBasis = dlg.getBasis();
+      mInput.mMethod = dlg.getMethod();
+      mInput.mLevels = dlg.getLevels();
+   }
+   if (!mInput.mBasis.isValid() || !mInput.mMethod.isValid())
+   {
+      mProgress.report("Invalid wavelet basis or threshold method.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+bool WaveletDenoise::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+WaveletDenoise::WaveletDenoiseThread::WaveletDenoiseThread(
+   const WaveletDenoiseThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void WaveletDenoise::WaveletDenoiseThread::run()
+{
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   int numCols = mInput.mpResultDescriptor->getColumnCount();
+
+   // request blocks of whole BIP rows so each page fetch covers many spectra
+   unsigned int rowBytes = numCols * mInput.mpResultDescriptor->getBandCount() *
+      std::max(mInput.mpDescriptor->getBytesPerElement(), mInput.mpResultDescriptor->getBytesPerElement());
+   unsigned int blockRows = std::max(1U, std::min<unsigned int>(mRowRange.mLast - mRowRange.mFirst + 1,
+      sBlockBytes / std::max(1U, rowBytes)));
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast), blockRows);
+   pResultRequest->setColumns(mInput.mpResultDescriptor->getActiveColumn(0),
+      mInput.mpResultDescriptor->getActiveColumn(numCols - 1));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+   if (!resultAccessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setRows(mInput.mpDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpDescriptor->getActiveRow(mRowRange.mLast), blockRows);
+   pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0),
+      mInput.mpDescriptor->getActiveColumn(numCols - 1));
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+   if (!accessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+
+   if (mInput.mSinglePrecision)
+   {
+      denoiseRows<float>(accessor, resultAccessor);
+   }
+   else
+   {
+      denoiseRows<double>(accessor, resultAccessor);
+   }
+}
+
+template<typename T>
+void WaveletDenoise::WaveletDenoiseThread::denoiseRows(DataAccessor& accessor, DataAccessor& resultAccessor)
+{
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   int numCols = mInput.mpResultDescriptor->getColumnCount();
+   unsigned int numBands = mInput.mpResultDescriptor->getBandCount();
+   unsigned int paddedBands = WaveletUtils::nextPowerOfTwo(numBands);
+
+   int oldPercentDone = 0;
+
+   int startRow = mRowRange.mFirst;
+   int stopRow = mRowRange.mLast;
+
+   // scratch space is allocated once per thread and reused for every pixel
+   std::vector<T> input(numCols * numBands);
+   std::vector<T> coefficients(paddedBands);
+   std::vector<T> scratch(paddedBands / 2);
+   std::vector<T> transformScratch(paddedBands);
+   for (int row_index = startRow; row_index <= stopRow; row_index++)
+   {
+      int percentDone = mRowRange.computePercent(row_index);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         getReporter().reportProgress(getThreadIndex(), 100);
+         break;
+      }
+
+      if (!accessor.isValid() || !resultAccessor.isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+
+      // BIP rows are contiguous so convert and write a full row at a time
+      switchOnEncoding(encoding, loadValues, accessor->getRow(), &input.front(), numCols * numBands);
+      T* pResult = reinterpret_cast<T*>(resultAccessor->getRow());
+      for (int col_index = 0; col_index < numCols; col_index++)
+      {
+         T* pCoefficients = &coefficients.front();
+         memcpy(pCoefficients, &input[col_index * numBands], numBands * sizeof(T));
+         WaveletUtils::reflectPad(pCoefficients, numBands, paddedBands);
+         WaveletUtils::transform(pCoefficients, paddedBands, true, mInput.mBasis, pCoefficients,
+            &transformScratch.front());
+         thresholdCoefficients(pCoefficients, paddedBands, numBands, scratch);
+         WaveletUtils::transform(pCoefficients, paddedBands, false, mInput.mBasis, pCoefficients,
+            &transformScratch.front());
+         memcpy(pResult + col_index * numBands, pCoefficients, numBands * sizeof(T));
+      }
+      resultAccessor->nextRow();
+      accessor->nextRow();
+   }
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+template<typename T, typename U>
+void WaveletDenoise::WaveletDenoiseThread::loadValues(const T* pData, U* pBuffer, unsigned int count)
+{
+   for (unsigned int idx = 0; idx < count; idx++)
+   {
+      pBuffer[idx] = static_cast<U>(pData[idx]);
+   }
+}
+
+template<typename T>
+void WaveletDenoise::WaveletDenoiseThread::thresholdCoefficients(T* pCoefficients, unsigned int count,
+                                                                unsigned int validCount, std::vector<T>& scratch)
+{
+   if (count < 4)
+   {
+      return;
+   }
+
+   // robust noise estimate: sigma = MAD / 0.6745 of the finest detail level
+   // only coefficients of real bands are used since the reflected padding repeats them
+   unsigned int half = count / 2;
+   unsigned int validHalf = std::max(1U, std::min(half, validCount / 2));
+   for (unsigned int idx = 0; idx < validHalf; idx++)
+   {
+      scratch[idx] = fabs(pCoefficients[half + idx]);
+   }
+   std::nth_element(scratch.begin(), scratch.begin() + validHalf / 2, scratch.begin() + validHalf);
+   double sigma = scratch[validHalf / 2] / 0.6745;
+   if (sigma <= 0.0)
+   {
+      return;
+   }
+   double sigma2 = sigma * sigma;
+
+   unsigned int numLevels = 0;
+   for (unsigned int size = count; size > 1; size >>= 1)
+   {
+      numLevels++;
+   }
+   if (mInput.mLevels > 0 && mInput.mLevels < numLevels)
+   {
+      numLevels = mInput.mLevels;
+   }
+
+   double universal = sigma * sqrt(2.0 * log(static_cast<double>(count)));
+   for (unsigned int level = 1; level <= numLevels; level++)
+   {
+      unsigned int begin = count >> level;
+      unsigned int end = count >> (level - 1);
+      double lambda = universal;
+      if (mInput.mMethod == BAYES_SHRINK)
+      {
+         // lambda = sigma^2 / sigma_x where sigma_x^2 = max(var(detail) - sigma^2, 0)
+         unsigned int validEnd = begin + std::max(1U, std::min(end - begin, validCount >> level));
+         double energy = 0.0;
+         double maxAbs = 0.0;
+         for (unsigned int idx = begin; idx < validEnd; idx++)
+         {
+            energy += pCoefficients[idx] * pCoefficients[idx];
+            maxAbs = std::max(maxAbs, static_cast<double>(fabs(pCoefficients[idx])));
+         }
+         double signal2 = energy / (validEnd - begin) - sigma2;
+         lambda = (signal2 > 0.0) ? sigma2 / sqrt(signal2) : maxAbs;
+      }
+
+      for (unsigned int idx = begin; idx < end; idx++)
+      {
+         double val = pCoefficients[idx];
+         double mag = fabs(val);
+         if (mInput.mMethod == HARD_THRESHOLD)
+         {
+            pCoefficients[idx] = (mag > lambda) ? static_cast<T>(val) : 0;
+         }
+         else
+         {
+            double shrunk = std::max(mag - lambda, 0.0);
+            pCoefficients[idx] = static_cast<T>(val < 0.0 ? -shrunk : shrunk);
+         }
+      }
+   }
+}
+
+bool WaveletDenoise::WaveletDenoiseThreadOutput::compileOverallResults(const std::vector<WaveletDenoiseThread*>& threads)
+{
+   return true;
+}
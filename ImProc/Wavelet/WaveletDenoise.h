@@ -0,0 +1,96 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETDENOISE_H__
+#define WAVELETDENOISE_H__
+
+#include "AlgorithmShell.h"
+#include "EnumWrapper.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+#include "WaveletUtils.h"
+
+#include <vector>
+
+class DataAccessor;
+
+enum ThresholdMethodEnum { HARD_THRESHOLD, SOFT_THRESHOLD, BAYES_SHRINK };
+typedef EnumWrapper<ThresholdMethodEnum> ThresholdMethod;
+
+/**
+ * Denoise each spectrum by shrinking its wavelet detail coefficients.
+ *
+ * Each pixel is forward transformed, the noise level is estimated from the median absolute
+ * deviation of the finest detail coefficients, the detail levels are thresholded and the
+ * result is inverse transformed. Pixels are processed as they are read so the coefficient
+ * cube is never stored.
+ */
+class WaveletDenoise : public AlgorithmShell
+{
+public:
+   WaveletDenoise();
+   virtual ~WaveletDenoise();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   struct WaveletDenoiseThreadInput
+   {
+      WaveletDenoiseThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL),
+         mLevels(0), mSinglePrecision(false), mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      WaveletBasis mBasis;
+      ThresholdMethod mMethod;
+      unsigned int mLevels; // number of detail levels to threshold, finest first. 0 thresholds all levels
+      bool mSinglePrecision;
+      const bool* mpAbortFlag;
+   };
+
+   class WaveletDenoiseThread : public mta::AlgorithmThread
+   {
+   public:
+      WaveletDenoiseThread(const WaveletDenoiseThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      template<typename T> void denoiseRows(DataAccessor& accessor, DataAccessor& resultAccessor);
+      template<typename T, typename U> void loadValues(const T* pData, U* pBuffer, unsigned int count);
+      template<typename T> void thresholdCoefficients(T* pCoefficients, unsigned int count, unsigned int validCount,
+         std::vector<T>& scratch);
+
+      static const unsigned int sBlockBytes = 4 * 1024 * 1024; // target size of a block of rows
+
+      const WaveletDenoiseThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct WaveletDenoiseThreadOutput
+   {
+      bool compileOverallResults(const std::vector<WaveletDenoiseThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   WaveletDenoiseThreadInput mInput;
+   std::string mResultName;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "StringUtilities.h"
+#include "WaveletDenoiseDialog.h"
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QSpinBox>
+
+WaveletDenoiseDialog::WaveletDenoiseDialog(QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pBasisLabel = new QLabel("Wavelet Basis:", this);
+   mpBasis = new QComboBox(this);
+   mpBasis->setEditable(false);
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<WaveletBasis>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      mpBasis->addItem(QString::fromStdString(*val));
+   }
+   QLabel* pMethodLabel = new QLabel("Threshold Method:", this);
+   mpMethod = new QComboBox(this);
+   mpMethod->setEditable(false);
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<ThresholdMethod>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      mpMethod->addItem(QString::fromStdString(*val));
+   }
+   QLabel* pLevelsLabel = new QLabel("Levels:", this);
+   mpLevels = new QSpinBox(this);
+   mpLevels->setRange(0, 31);
+   mpLevels->setSpecialValueText("All");
+   mpLevels->setToolTip("Number of detail levels to threshold starting with the finest.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pBasisLabel, 0, 0);
+   pTopLevel->addWidget(mpBasis, 0, 1);
+   pTopLevel->addWidget(pMethodLabel, 1, 0);
+   pTopLevel->addWidget(mpMethod, 1, 1);
+   pTopLevel->addWidget(pLevelsLabel, 2, 0);
+   pTopLevel->addWidget(mpLevels, 2, 1);
+   pTopLevel->addWidget(pButtons, 3, 0, 1, 2);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+WaveletDenoiseDialog::~WaveletDenoiseDialog()
+{
+}
+
+WaveletBasis WaveletDenoiseDialog::getBasis() const
+{
+   return StringUtilities::fromDisplayString<WaveletBasis>(mpBasis->currentText().toStdString());
+}
+
+ThresholdMethod WaveletDenoiseDialog::getMethod() const
+{
+   return StringUtilities::fromDisplayString<ThresholdMethod>(mpMethod->currentText().toStdString());
+}
+
+unsigned int WaveletDenoiseDialog::getLevels() const
+{
+   return static_cast<unsigned int>(mpLevels->value());
+}
+
+void WaveletDenoiseDialog::setBasis(WaveletBasis basis)
+{
+   QString val = QString::fromStdString(StringUtilities::toDisplayString(basis));
+   mpBasis->setCurrentIndex(mpBasis->findText(val));
+}
+
+void WaveletDenoiseDialog::setMethod(ThresholdMethod method)
+{
+   QString val = QString::fromStdString(StringUtilities::toDisplayString(method));
+   mpMethod->setCurrentIndex(mpMethod->findText(val));
+}
+
+void WaveletDenoiseDialog::setLevels(unsigned int levels)
+{
+   mpLevels->setValue(static_cast<int>(levels));
+}
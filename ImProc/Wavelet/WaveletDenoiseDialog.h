@@ -0,0 +1,39 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETDENOISEDIALOG_H
+#define WAVELETDENOISEDIALOG_H
+
+#include "WaveletDenoise.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QSpinBox;
+
+class WaveletDenoiseDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   WaveletDenoiseDialog(QWidget* pParent=NULL);
+   virtual ~WaveletDenoiseDialog();
+
+   WaveletBasis getBasis() const;
+   ThresholdMethod getMethod() const;
+   unsigned int getLevels() const;
+   void setBasis(WaveletBasis basis);
+   void setMethod(ThresholdMethod method);
+   void setLevels(unsigned int levels);
+
+private:
+   QComboBox* mpBasis;
+   QComboBox* mpMethod;
+   QSpinBox* mpLevels;
+};
+
+#endif
@@ -0,0 +1,527 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "DynamicObject.h"
+#include "ImProcVersion.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilitiesMacros.h"
+#include "switchOnEncoding.h"
+#include "Undo.h"
+#include "WaveletPacket.h"
+#include "WaveletPacketDialog.h"
+
+#include <algorithm>
+
+REGISTER_PLUGIN_BASIC(WaveletModule, WaveletPacket);
+
+namespace StringUtilities
+{
+BEGIN_ENUM_MAPPING(PacketCost)
+ADD_ENUM_MAPPING(ENTROPY_COST, "Entropy", "entropy")
+ADD_ENUM_MAPPING(LOG_ENERGY_COST, "Log energy", "logenergy")
+END_ENUM_MAPPING()
+}
+
+namespace
+{
+   template<typename T>
+   void loadValues(const T* pData, double* pBuffer, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pBuffer[idx] = static_cast<double>(pData[idx]);
+      }
+   }
+
+   class GreaterEnergy
+   {
+   public:
+      GreaterEnergy(const std::vector<double>& energy) : mEnergy(energy) {}
+      bool operator()(unsigned int left, unsigned int right) const
+      {
+         return mEnergy[left] > mEnergy[right];
+      }
+
+   private:
+      const std::vector<double>& mEnergy;
+   };
+}
+
+WaveletPacket::WaveletPacket() :
+   mCost(ENTROPY_COST),
+   mCoefficientCount(0),
+   mSampleCount(0),
+   mAbortFlag(false)
+{
+   setName("WaveletPacket");
+   setDescription("Spectral wavelet packet best basis features");
+   setDescriptorId("{083E21F6-E79F-4D24-A429-C1B65FF5E8E9}");
+   setCopyright(IMPROC_COPYRIGHT);
+   setVersion(IMPROC_VERSION_NUMBER);
+   setProductionStatus(IMPROC_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Spectral Wavelet Packet Features");
+}
+
+WaveletPacket::~WaveletPacket()
+{
+}
+
+bool WaveletPacket::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<std::string>("Result Name"));
+   std::string defBasis = StringUtilities::toXmlString<WaveletBasis>(DAUBECHIES_4);
+   std::string basisHelp = "The basis function for the wavelet. Lifting bases are not supported. "
+      "Valid values and their interpretation are:";
+   std::vector<std::string> xmls = StringUtilities::getAllEnumValuesAsXmlString<WaveletBasis>();
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<WaveletBasis>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      basisHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Wavelet Basis", defBasis, basisHelp));
+   std::string defCost = StringUtilities::toXmlString<PacketCost>(ENTROPY_COST);
+   std::string costHelp = "The additive cost minimized by the best basis. Valid values and their interpretation are:";
+   xmls = StringUtilities::getAllEnumValuesAsXmlString<PacketCost>();
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<PacketCost>();
+   for (unsigned int idx = 0; idx < xmls.size(); idx++)
+   {
+      costHelp += "\n" + xmls[idx] + " = " + vals[idx];
+   }
+   VERIFY(pInArgList->addArg<std::string>("Cost Function", defCost, costHelp));
+   VERIFY(pInArgList->addArg<unsigned int>("Levels", 0,
+      "The depth of the packet tree. 0 uses the deepest tree the band count allows."));
+   VERIFY(pInArgList->addArg<unsigned int>("Coefficient Count", 16,
+      "The number of basis coefficients kept as result bands, highest energy first."));
+   VERIFY(pInArgList->addArg<unsigned int>("Sample Count", 2000,
+      "The number of pixels used to select the basis. 0 uses every pixel."));
+   return true;
+}
+
+bool WaveletPacket::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool WaveletPacket::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Selecting the best basis.", 1, NORMAL);
+   if (!selectBasis())
+   {
+      return false;
+   }
+
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   mInput.mSinglePrecision = WaveletUtils::isSinglePrecision(mInput.mpDescriptor->getDataType());
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      mInput.mpDescriptor->getRowCount(), mInput.mpDescriptor->getColumnCount(), mInput.mCoefficients.size(),
+      mInput.mSinglePrecision ? FLT4BYTES : FLT8BYTES, BIP, mInput.mpDescriptor->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+
+   // record the basis so the features can be interpreted
+   DynamicObject* pMetadata = mInput.mpResult->getMetadata();
+   if (pMetadata != NULL)
+   {
+      std::vector<unsigned int> nodes;
+      for (unsigned int node = 0; node < mInput.mBasisNodes.size(); node++)
+      {
+         if (mInput.mBasisNodes[node] != 0)
+         {
+            nodes.push_back(node);
+         }
+      }
+      pMetadata->setAttributeByPath("Wavelet Packet/Wavelet Basis", StringUtilities::toXmlString(mInput.mBasis));
+      pMetadata->setAttributeByPath("Wavelet Packet/Levels", mInput.mLevels);
+      pMetadata->setAttributeByPath("Wavelet Packet/Basis Nodes", nodes);
+      pMetadata->setAttributeByPath("Wavelet Packet/Coefficients", mInput.mCoefficients);
+   }
+
+   mInput.mpAbortFlag = &mAbortFlag;
+   WaveletPacketThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Extracting features", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<WaveletPacketThreadInput, WaveletPacketThreadOutput, WaveletPacketThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Feature extraction complete.", 100, NORMAL);
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Feature extraction aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Feature extraction failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool WaveletPacket::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{F1B71A19-A241-461A-9021-D786FE5C7D88}");
+   if ((mInput.mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpRaster->getDataDescriptor());
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+   if (numBands < 2)
+   {
+      mProgress.report("At least 2 bands are required for a wavelet packet decomposition.", 0, ERRORS, true);
+      return false;
+   }
+   if (mInput.mpDescriptor->getDataType() == INT4SCOMPLEX || mInput.mpDescriptor->getDataType() == FLT8COMPLEX)
+   {
+      mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   if (mResultName.empty())
+   {
+      mResultName = mInput.mpRaster->getName() + ":" + getName();
+   }
+
+   std::string basisStr;
+   pInArgList->getPlugInArgValue("Wavelet Basis", basisStr);
+   mInput.mBasis = StringUtilities::fromXmlString<WaveletBasis>(basisStr);
+   std::string costStr;
+   pInArgList->getPlugInArgValue("Cost Function", costStr);
+   mCost = StringUtilities::fromXmlString<PacketCost>(costStr);
+   pInArgList->getPlugInArgValue("Levels", mInput.mLevels);
+   pInArgList->getPlugInArgValue("Coefficient Count", mCoefficientCount);
+   pInArgList->getPlugInArgValue("Sample Count", mSampleCount);
+   if (!isBatch())
+   {
+      WaveletPacketDialog dlg;
+      dlg.setBasis(mInput.mBasis);
+      dlg.setCost(mCost);
+      dlg.setLevels(mInput.mLevels);
+      dlg.setCoefficientCount(mCoefficientCount);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mInput.mBasis = dlg.getBasis();
+      mCost = dlg.getCost();
+      mInput.mLevels = dlg.getLevels();
+      mCoefficientCount = dlg.getCoefficientCount();
+   }
+   if (!mInput.mBasis.isValid() || WaveletUtils::isLifting(mInput.mBasis) || !mCost.isValid())
+   {
+      mProgress.report("Invalid wavelet basis or cost function.", 0, ERRORS, true);
+      return false;
+   }
+
+   mInput.mPaddedBands = WaveletUtils::nextPowerOfTwo(numBands);
+   unsigned int maxLevels = 0;
+   while ((2U << maxLevels) <= mInput.mPaddedBands)
+   {
+      maxLevels++;
+   }
+   if (mInput.mLevels == 0 || mInput.mLevels > maxLevels)
+   {
+      mInput.mLevels = maxLevels;
+   }
+   if (mCoefficientCount == 0)
+   {
+      mProgress.report("At least one coefficient must be kept.", 0, ERRORS, true);
+      return false;
+   }
+   mCoefficientCount = std::min(mCoefficientCount, mInput.mPaddedBands);
+
+   return true;
+}
+
+bool WaveletPacket::selectBasis()
+{
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   unsigned int numRows = mInput.mpDescriptor->getRowCount();
+   unsigned int numCols = mInput.mpDescriptor->getColumnCount();
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+   unsigned int paddedBands = mInput.mPaddedBands;
+   int levels = static_cast<int>(mInput.mLevels);
+   unsigned int pixelCount = numRows * numCols;
+   unsigned int sampleCount = (mSampleCount == 0) ? pixelCount : std::min(mSampleCount, pixelCount);
+
+   // the sample is read once and held since it is needed for both the basis and the coefficient selection
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+   std::vector<double> spectra(static_cast<size_t>(sampleCount) * paddedBands);
+   for (unsigned int sample = 0; sample < sampleCount; sample++)
+   {
+      if (mAbortFlag)
+      {
+         mProgress.report("Feature extraction aborted.", 0, ABORT, true);
+         return false;
+      }
+      // spread the sample evenly over the scene
+      unsigned int pixel = static_cast<unsigned int>(static_cast<double>(sample) * pixelCount / sampleCount);
+      accessor->toPixel(pixel / numCols, pixel % numCols);
+      if (!accessor.isValid())
+      {
+         mProgress.report("Invalid data access.", 0, ERRORS, true);
+         return false;
+      }
+      double* pSpectrum = &spectra[static_cast<size_t>(sample) * paddedBands];
+      switchOnEncoding(encoding, loadValues, accessor->getColumn(), pSpectrum, numBands);
+      WaveletUtils::reflectPad(pSpectrum, numBands, paddedBands);
+   }
+   mProgress.report("Selecting the best basis.", 5, NORMAL);
+
+   // node costs are additive so the sample's summed costs select one basis for the scene
+   unsigned int nodeCount = WaveletUtils::getPacketNodeCount(levels);
+   std::vector<double> tree(static_cast<size_t>(levels + 1) * paddedBands);
+   std::vector<double> nodeCosts(nodeCount);
+   std::vector<double> totalCosts(nodeCount, 0.0);
+   for (unsigned int sample = 0; sample < sampleCount; sample++)
+   {
+      WaveletUtils::packetDecompose(&spectra[static_cast<size_t>(sample) * paddedBands], paddedBands, levels,
+         mInput.mBasis, &tree.front());
+      WaveletUtils::packetCost(&tree.front(), paddedBands, levels, mCost, &nodeCosts.front());
+      for (unsigned int node = 0; node < nodeCount; node++)
+      {
+         totalCosts[node] += nodeCosts[node];
+      }
+   }
+   mInput.mBasisNodes.resize(nodeCount);
+   unsigned int basisSize = WaveletUtils::bestBasis(&totalCosts.front(), levels, &mInput.mBasisNodes.front());
+   mProgress.report("Selected a basis of " + StringUtilities::toDisplayString(basisSize) + " packets.", 8, NORMAL);
+
+   // keep the coefficients with the most energy over the sample
+   std::vector<double> energy(paddedBands, 0.0);
+   std::vector<double> coefficients(paddedBands);
+   std::vector<double> scratch(paddedBands);
+   for (unsigned int sample = 0; sample < sampleCount; sample++)
+   {
+      WaveletUtils::packetTransform(&spectra[static_cast<size_t>(sample) * paddedBands], paddedBands, levels,
+         mInput.mBasis, &mInput.mBasisNodes.front(), &scratch.front(), &coefficients.front());
+      for (unsigned int idx = 0; idx < paddedBands; idx++)
+      {
+         energy[idx] += coefficients[idx] * coefficients[idx];
+      }
+   }
+   std::vector<unsigned int> order(paddedBands);
+   for (unsigned int idx = 0; idx < paddedBands; idx++)
+   {
+      order[idx] = idx;
+   }
+   std::partial_sort(order.begin(), order.begin() + mCoefficientCount, order.end(), GreaterEnergy(energy));
+   mInput.mCoefficients.assign(order.begin(), order.begin() + mCoefficientCount);
+   mProgress.report("Basis selection complete.", 10, NORMAL);
+
+   return true;
+}
+
+bool WaveletPacket::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+WaveletPacket::WaveletPacketThread::WaveletPacketThread(
+   const WaveletPacketThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void WaveletPacket::WaveletPacketThread::run()
+{
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   int numCols = mInput.mpResultDescriptor->getColumnCount();
+
+   // request blocks of whole BIP rows so each page fetch covers many spectra
+   unsigned int rowBytes = numCols * mInput.mpDescriptor->getBandCount() * mInput.mpDescriptor->getBytesPerElement();
+   unsigned int blockRows = std::max(1U, std::min<unsigned int>(mRowRange.mLast - mRowRange.mFirst + 1,
+      sBlockBytes / std::max(1U, rowBytes)));
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast), blockRows);
+   pResultRequest->setColumns(mInput.mpResultDescriptor->getActiveColumn(0),
+      mInput.mpResultDescriptor->getActiveColumn(numCols - 1));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+   if (!resultAccessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+
+   FactoryResource<DataRequest> pRequest;
+   pRequest->setRows(mInput.mpDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpDescriptor->getActiveRow(mRowRange.mLast), blockRows);
+   pRequest->setColumns(mInput.mpDescriptor->getActiveColumn(0),
+      mInput.mpDescriptor->getActiveColumn(numCols - 1));
+   pRequest->setInterleaveFormat(BIP);
+   DataAccessor accessor = mInput.mpRaster->getDataAccessor(pRequest.release());
+   if (!accessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+
+   if (mInput.mSinglePrecision)
+   {
+      transformRows<float>(accessor, resultAccessor);
+   }
+   else
+   {
+      transformRows<double>(accessor, resultAccessor);
+   }
+}
+
+template<typename T>
+void WaveletPacket::WaveletPacketThread::transformRows(DataAccessor& accessor, DataAccessor& resultAccessor)
+{
+   EncodingType encoding = mInput.mpDescriptor->getDataType();
+   int numCols = mInput.mpResultDescriptor->getColumnCount();
+   unsigned int numBands = mInput.mpDescriptor->getBandCount();
+   unsigned int paddedBands = mInput.mPaddedBands;
+   unsigned int numCoefficients = mInput.mCoefficients.size();
+   // the basis flags are not modified but the wvlt interface is not const correct
+   int* pBasisNodes = const_cast<int*>(&mInput.mBasisNodes.front());
+
+   int oldPercentDone = 0;
+
+   int startRow = mRowRange.mFirst;
+   int stopRow = mRowRange.mLast;
+
+   // per-thread buffers so the inner loop does no allocation
+   std::vector<double> input(numCols * numBands);
+   std::vector<double> spectrum(paddedBands);
+   std::vector<double> coefficients(paddedBands);
+   std::vector<double> scratch(paddedBands);
+   for (int row_index = startRow; row_index <= stopRow; row_index++)
+   {
+      int percentDone = mRowRange.computePercent(row_index);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         getReporter().reportProgress(getThreadIndex(), 100);
+         break;
+      }
+      if (!accessor.isValid() || !resultAccessor.isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+
+      switchOnEncoding(encoding, loadValues, accessor->getRow(), &input.front(), numCols * numBands);
+      T* pResult = reinterpret_cast<T*>(resultAccessor->getRow());
+      for (int col_index = 0; col_index < numCols; col_index++)
+      {
+         std::copy(input.begin() + col_index * numBands, input.begin() + (col_index + 1) * numBands,
+            spectrum.begin());
+         WaveletUtils::reflectPad(&spectrum.front(), numBands, paddedBands);
+         WaveletUtils::packetTransform(&spectrum.front(), paddedBands, mInput.mLevels, mInput.mBasis,
+            pBasisNodes, &scratch.front(), &coefficients.front());
+         for (unsigned int band = 0; band < numCoefficients; band++)
+         {
+            pResult[band] = static_cast<T>(coefficients[mInput.mCoefficients[band]]);
+         }
+         pResult += numCoefficients;
+      }
+      resultAccessor->nextRow();
+      accessor->nextRow();
+   }
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+bool WaveletPacket::WaveletPacketThreadOutput::compileOverallResults(const std::vector<WaveletPacketThread*>& threads)
+{
+   return true;
+}
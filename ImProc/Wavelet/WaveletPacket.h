@@ -0,0 +1,98 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETPACKET_H__
+#define WAVELETPACKET_H__
+
+#include "AlgorithmShell.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+#include "WaveletUtils.h"
+
+#include <vector>
+
+class DataAccessor;
+
+/**
+ * Compact spectral features from a wavelet packet best basis.
+ *
+ * A Coifman-Wickerhauser best basis is selected once per scene from the summed node costs of a
+ * sample of pixels. The coefficients with the most energy over the sample are chosen and every
+ * pixel is expanded in the basis, keeping only the chosen coefficients as result bands.
+ */
+class WaveletPacket : public AlgorithmShell
+{
+public:
+   WaveletPacket();
+   virtual ~WaveletPacket();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Select the best basis and the retained coefficients from a sample of pixels.
+    */
+   bool selectBasis();
+
+   struct WaveletPacketThreadInput
+   {
+      WaveletPacketThreadInput() : mpRaster(NULL), mpDescriptor(NULL), mpResultDescriptor(NULL), mpResult(NULL),
+         mLevels(0), mPaddedBands(0), mSinglePrecision(false), mpAbortFlag(NULL) {}
+      const RasterElement* mpRaster;
+      const RasterDataDescriptor* mpDescriptor;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      WaveletBasis mBasis;
+      unsigned int mLevels;
+      unsigned int mPaddedBands;
+      std::vector<int> mBasisNodes; // basis flags for each packet tree node
+      std::vector<unsigned int> mCoefficients; // basis coefficient for each result band
+      bool mSinglePrecision;
+      const bool* mpAbortFlag;
+   };
+
+   class WaveletPacketThread : public mta::AlgorithmThread
+   {
+   public:
+      WaveletPacketThread(const WaveletPacketThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      template<typename T> void transformRows(DataAccessor& accessor, DataAccessor& resultAccessor);
+
+      static const unsigned int sBlockBytes = 4 * 1024 * 1024; // target size of a block of rows
+
+      const WaveletPacketThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+   };
+
+   struct WaveletPacketThreadOutput
+   {
+      bool compileOverallResults(const std::vector<WaveletPacketThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   WaveletPacketThreadInput mInput;
+   std::string mResultName;
+   PacketCost mCost;
+   unsigned int mCoefficientCount;
+   unsigned int mSampleCount;
+   bool mAbortFlag;
+};
+
+#endif
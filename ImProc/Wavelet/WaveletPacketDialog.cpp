@@ -0,0 +1,110 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "StringUtilities.h"
+#include "WaveletPacketDialog.h"
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QSpinBox>
+
+WaveletPacketDialog::WaveletPacketDialog(QWidget* pParent) : QDialog(pParent)
+{
+   QLabel* pBasisLabel = new QLabel("Wavelet Basis:", this);
+   mpBasis = new QComboBox(this);
+   mpBasis->setEditable(false);
+   std::vector<std::string> vals = StringUtilities::getAllEnumValuesAsDisplayString<WaveletBasis>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      // packets are built from filter banks so the lifting bases are not offered
+      if (!WaveletUtils::isLifting(StringUtilities::fromDisplayString<WaveletBasis>(*val)))
+      {
+         mpBasis->addItem(QString::fromStdString(*val));
+      }
+   }
+   QLabel* pCostLabel = new QLabel("Cost Function:", this);
+   mpCost = new QComboBox(this);
+   mpCost->setEditable(false);
+   vals = StringUtilities::getAllEnumValuesAsDisplayString<PacketCost>();
+   for (std::vector<std::string>::const_iterator val = vals.begin(); val != vals.end(); ++val)
+   {
+      mpCost->addItem(QString::fromStdString(*val));
+   }
+   QLabel* pLevelsLabel = new QLabel("Levels:", this);
+   mpLevels = new QSpinBox(this);
+   mpLevels->setRange(0, 31);
+   mpLevels->setSpecialValueText("Maximum");
+   mpLevels->setToolTip("Depth of the packet tree searched for the best basis.");
+   QLabel* pCoefficientCountLabel = new QLabel("Coefficient Count:", this);
+   mpCoefficientCount = new QSpinBox(this);
+   mpCoefficientCount->setRange(1, 65535);
+   mpCoefficientCount->setToolTip("Number of highest energy basis coefficients kept as result bands.");
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pBasisLabel, 0, 0);
+   pTopLevel->addWidget(mpBasis, 0, 1);
+   pTopLevel->addWidget(pCostLabel, 1, 0);
+   pTopLevel->addWidget(mpCost, 1, 1);
+   pTopLevel->addWidget(pLevelsLabel, 2, 0);
+   pTopLevel->addWidget(mpLevels, 2, 1);
+   pTopLevel->addWidget(pCoefficientCountLabel, 3, 0);
+   pTopLevel->addWidget(mpCoefficientCount, 3, 1);
+   pTopLevel->addWidget(pButtons, 4, 0, 1, 2);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+WaveletPacketDialog::~WaveletPacketDialog()
+{
+}
+
+WaveletBasis WaveletPacketDialog::getBasis() const
+{
+   return StringUtilities::fromDisplayString<WaveletBasis>(mpBasis->currentText().toStdString());
+}
+
+PacketCost WaveletPacketDialog::getCost() const
+{
+   return StringUtilities::fromDisplayString<PacketCost>(mpCost->currentText().toStdString());
+}
+
+unsigned int WaveletPacketDialog::getLevels() const
+{
+   return static_cast<unsigned int>(mpLevels->value());
+}
+
+unsigned int WaveletPacketDialog::getCoefficientCount() const
+{
+   return static_cast<unsigned int>(mpCoefficientCount->value());
+}
+
+void WaveletPacketDialog::setBasis(WaveletBasis basis)
+{
+   QString val = QString::fromStdString(StringUtilities::toDisplayString(basis));
+   mpBasis->setCurrentIndex(mpBasis->findText(val));
+}
+
+void WaveletPacketDialog::setCost(PacketCost cost)
+{
+   QString val = QString::fromStdString(StringUtilities::toDisplayString(cost));
+   mpCost->setCurrentIndex(mpCost->findText(val));
+}
+
+void WaveletPacketDialog::setLevels(unsigned int levels)
+{
+   mpLevels->setValue(static_cast<int>(levels));
+}
+
+void WaveletPacketDialog::setCoefficientCount(unsigned int count)
+{
+   mpCoefficientCount->setValue(static_cast<int>(count));
+}
@@ -0,0 +1,42 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETPACKETDIALOG_H
+#define WAVELETPACKETDIALOG_H
+
+#include "WaveletPacket.h"
+#include <QtGui/QDialog>
+
+class QComboBox;
+class QSpinBox;
+
+class WaveletPacketDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   WaveletPacketDialog(QWidget* pParent=NULL);
+   virtual ~WaveletPacketDialog();
+
+   WaveletBasis getBasis() const;
+   PacketCost getCost() const;
+   unsigned int getLevels() const;
+   unsigned int getCoefficientCount() const;
+   void setBasis(WaveletBasis basis);
+   void setCost(PacketCost cost);
+   void setLevels(unsigned int levels);
+   void setCoefficientCount(unsigned int count);
+
+private:
+   QComboBox* mpBasis;
+   QComboBox* mpCost;
+   QSpinBox* mpLevels;
+   QSpinBox* mpCoefficientCount;
+};
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "WaveletUtils.h"
+extern "C" {
+#include <local.h>
+};
+
+namespace
+{
+waveletfilter* getFilter(WaveletBasis basis)
+{
+   switch (basis)
+   {
+   case BATTLE_LEMARIE:
+      return &wfltrBattleLemarie;
+   case BURT_ADELSON:
+      return &wfltrBurtAdelson;
+   case COIFLET_2:
+      return &wfltrCoiflet_2;
+   case COIFLET_4:
+      return &wfltrCoiflet_4;
+   case COIFLET_6:
+      return &wfltrCoiflet_6;
+   case DAUBECHIES_6:
+      return &wfltrDaubechies_6;
+   case DAUBECHIES_8:
+      return &wfltrDaubechies_8;
+   case DAUBECHIES_10:
+      return &wfltrDaubechies_10;
+   case DAUBECHIES_12:
+      return &wfltrDaubechies_12;
+   case DAUBECHIES_20:
+      return &wfltrDaubechies_20;
+   case HAAR:
+      return &wfltrHaar;
+   case PSEUDOCOIFLET_4_4:
+      return &wfltrPseudocoiflet_4_4;
+   case SPLINE_2_2:
+      return &wfltrSpline_2_2;
+   case SPLINE_2_4:
+      return &wfltrSpline_2_4;
+   case SPLINE_3_3:
+      return &wfltrSpline_3_3;
+   case SPLINE_3_7:
+      return &wfltrSpline_3_7;
+   case DAUBECHIES_4:
+   default:
+      return &wfltrDaubechies_4;
+   }
+}
+
+int getLiftingScheme(WaveletBasis basis)
+{
+   return (basis == LIFTING_9_7) ? WLIFT_9_7 : WLIFT_5_3;
+}
+}
+
+namespace WaveletUtils
+{
+bool isSinglePrecision(EncodingType encoding)
+{
+   switch (encoding)
+   {
+   case INT1SBYTE:
+   case INT1UBYTE:
+   case INT2SBYTES:
+   case INT2UBYTES:
+   case FLT4BYTES:
+      return true;
+   default:
+      return false;
+   }
+}
+
+bool isLifting(WaveletBasis basis)
+{
+   return basis == LIFTING_5_3 || basis == LIFTING_9_7;
+}
+
+unsigned int nextPowerOfTwo(unsigned int value)
+{
+   unsigned int result = 1;
+   while (result < value)
+   {
+      result <<= 1;
+   }
+   return result;
+}
+
+void transform(float* pData, int count, bool forward, WaveletBasis basis, float* pResult, float* pScratch)
+{
+   if (isLifting(basis))
+   {
+      if (pScratch == NULL)
+      {
+         wlift_fa1d(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 0, pResult);
+      }
+      else
+      {
+         wlift_fa1d_buf(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 0, pScratch, pResult);
+      }
+   }
+   else if (pScratch == NULL)
+   {
+      wxfrm_fa1d(pData, count, forward ? 1 : 0, getFilter(basis), pResult);
+   }
+   else
+   {
+      wxfrm_fa1d_buf(pData, count, forward ? 1 : 0, getFilter(basis), pScratch, pResult);
+   }
+}
+
+void transform(double* pData, int count, bool forward, WaveletBasis basis, double* pResult, double* pScratch)
+{
+   if (isLifting(basis))
+   {
+      if (pScratch == NULL)
+      {
+         wlift_da1d(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 0, pResult);
+      }
+      else
+      {
+         wlift_da1d_buf(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 0, pScratch, pResult);
+      }
+   }
+   else if (pScratch == NULL)
+   {
+      wxfrm_da1d(pData, count, forward ? 1 : 0, getFilter(basis), pResult);
+   }
+   else
+   {
+      wxfrm_da1d_buf(pData, count, forward ? 1 : 0, getFilter(basis), pScratch, pResult);
+   }
+}
+
+void transformReversible(int* pData, int count, bool forward, WaveletBasis basis, int* pResult, int* pScratch)
+{
+   if (pScratch == NULL)
+   {
+      wlift_ia1d(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 1, pResult);
+   }
+   else
+   {
+      wlift_ia1d_buf(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 1, pScratch, pResult);
+   }
+}
+
+void transformReversible(double* pData, int count, bool forward, WaveletBasis basis, double* pResult,
+                         double* pScratch)
+{
+   if (pScratch == NULL)
+   {
+      wlift_da1d(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 1, pResult);
+   }
+   else
+   {
+      wlift_da1d_buf(pData, count, forward ? 1 : 0, getLiftingScheme(basis), 1, pScratch, pResult);
+   }
+}
+
+unsigned int getPacketNodeCount(int levels)
+{
+   return wpkt_node_count(levels);
+}
+
+void packetDecompose(double* pData, int count, int levels, WaveletBasis basis, double* pTree)
+{
+   wpkt_da1d(pData, count, levels, getFilter(basis), pTree);
+}
+
+void packetCost(double* pTree, int count, int levels, PacketCost cost, double* pNodeCosts)
+{
+   wpkt_dcost(pTree, count, levels, (cost == LOG_ENERGY_COST) ? WPKT_LOG_ENERGY : WPKT_ENTROPY, pNodeCosts);
+}
+
+unsigned int bestBasis(double* pNodeCosts, int levels, int* pBasis)
+{
+   return wpkt_best(pNodeCosts, levels, pBasis);
+}
+
+void packetTransform(double* pData, int count, int levels, WaveletBasis basis, int* pBasis,
+                     double* pScratch, double* pResult)
+{
+   wpkt_da1d_basis(pData, count, levels, getFilter(basis), pBasis, pScratch, pResult);
+}
+
+void transform2d(float* pData, int rows, int columns, bool forward, WaveletBasis basis, float* pResult)
+{
+   int pDims[] = {rows, columns};
+   if (isLifting(basis))
+   {
+      wlift_fand(pData, pDims, 2, forward ? 1 : 0, getLiftingScheme(basis), 0, pResult);
+   }
+   else
+   {
+      wxfrm_fand(pData, pDims, 2, forward ? 1 : 0, 0, getFilter(basis), pResult);
+   }
+}
+}
@@ -0,0 +1,238 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef WAVELETUTILS_H__
+#define WAVELETUTILS_H__
+
+#include "EnumWrapper.h"
+#include "TypesFile.h"
+
+#include <stdlib.h>
+
+enum WaveletBasisEnum {
+   BATTLE_LEMARIE,
+   BURT_ADELSON,
+   COIFLET_2,
+   COIFLET_4,
+   COIFLET_6,
+   DAUBECHIES_4,
+   DAUBECHIES_6,
+   DAUBECHIES_8,
+   DAUBECHIES_10,
+   DAUBECHIES_12,
+   DAUBECHIES_20,
+   HAAR,
+   PSEUDOCOIFLET_4_4,
+   SPLINE_2_2,
+   SPLINE_2_4,
+   SPLINE_3_3,
+   SPLINE_3_7,
+   LIFTING_5_3,
+   LIFTING_9_7
+};
+
+typedef EnumWrapper<WaveletBasisEnum> WaveletBasis;
+
+enum PacketCostEnum { ENTROPY_COST, LOG_ENERGY_COST };
+typedef EnumWrapper<PacketCostEnum> PacketCost;
+
+namespace WaveletUtils
+{
+/**
+ * Can the coefficients for data of this encoding be computed in single precision?
+ *
+ * Data of float precision or lower (8 and 16 bit integers and FLT4) gains nothing from a double
+ * precision transform so it is processed and stored as FLT4 which halves memory and bandwidth.
+ */
+bool isSinglePrecision(EncodingType encoding);
+
+/**
+ * Is the basis computed with lifting steps instead of a filter bank?
+ *
+ * Only lifting bases support the integer to integer transforms.
+ */
+bool isLifting(WaveletBasis basis);
+
+/**
+ * Calculate the smallest power of 2 which is not less than a value.
+ *
+ * The wvlt transforms require power of 2 lengths.
+ */
+unsigned int nextPowerOfTwo(unsigned int value);
+
+/**
+ * Perform a full depth 1-dimensional discrete wavelet transform.
+ *
+ * The coefficients are ordered from coarsest to finest. Index 0 holds the smooth coefficient and
+ * the detail coefficients for level j (1 is the finest) are in [count / 2^j, count / 2^(j-1)).
+ *
+ * @param pData
+ *        The input values.
+ * @param count
+ *        The number of values, this must be a power of 2.
+ * @param forward
+ *        True for the forward transform, false for the inverse.
+ * @param basis
+ *        The wavelet basis.
+ * @param pResult
+ *        Output buffer of count values. This may be the same as pData.
+ * @param pScratch
+ *        Optional scratch space of count values. Callers transforming many signals should
+ *        supply this to avoid a heap allocation per transform.
+ */
+void transform(float* pData, int count, bool forward, WaveletBasis basis, float* pResult, float* pScratch = NULL);
+void transform(double* pData, int count, bool forward, WaveletBasis basis, double* pResult,
+               double* pScratch = NULL);
+
+/**
+ * Perform a full depth reversible integer to integer 1-dimensional wavelet transform.
+ *
+ * The coefficient layout matches transform(). Every lifting step is rounded so the inverse
+ * reconstructs integer input bit-exactly. Values must stay well within the range of the data type,
+ * the 9/7 smooth coefficient grows by about 1.23 per level.
+ *
+ * @param pData
+ *        The input values. For the double overload these must be integral.
+ * @param count
+ *        The number of values, this must be a power of 2.
+ * @param forward
+ *        True for the forward transform, false for the inverse.
+ * @param basis
+ *        The wavelet basis, this must be a lifting basis.
+ * @param pResult
+ *        Output buffer of count values. This may be the same as pData.
+ * @param pScratch
+ *        Optional scratch space of count values.
+ */
+void transformReversible(int* pData, int count, bool forward, WaveletBasis basis, int* pResult,
+                         int* pScratch = NULL);
+void transformReversible(double* pData, int count, bool forward, WaveletBasis basis, double* pResult,
+                         double* pScratch = NULL);
+
+/**
+ * Perform a full depth non-standard (Mallat) 2-dimensional discrete wavelet transform.
+ *
+ * @param pData
+ *        The input plane in row major order.
+ * @param rows
+ *        The number of rows, this must be a power of 2.
+ * @param columns
+ *        The number of columns, this must be a power of 2.
+ * @param forward
+ *        True for the forward transform, false for the inverse.
+ * @param basis
+ *        The wavelet basis.
+ * @param pResult
+ *        Output buffer of rows * columns values. This may be the same as pData.
+ */
+void transform2d(float* pData, int rows, int columns, bool forward, WaveletBasis basis, float* pResult);
+
+/**
+ * The number of nodes in a wavelet packet tree.
+ *
+ * Nodes are numbered as a heap. Node k of level j is 2^j - 1 + k and the children of node n
+ * are 2n + 1 and 2n + 2.
+ */
+unsigned int getPacketNodeCount(int levels);
+
+/**
+ * Perform a full wavelet packet decomposition.
+ *
+ * @param pData
+ *        The input values.
+ * @param count
+ *        The number of values, this must be a power of 2.
+ * @param levels
+ *        The number of levels, 2^levels may not exceed count.
+ * @param basis
+ *        The wavelet basis. Lifting bases are not supported.
+ * @param pTree
+ *        Output buffer of (levels + 1) * count values. Row j holds every node of level j.
+ */
+void packetDecompose(double* pData, int count, int levels, WaveletBasis basis, double* pTree);
+
+/**
+ * Calculate the additive cost of each node in a packet tree.
+ *
+ * @param pNodeCosts
+ *        Output buffer of getPacketNodeCount(levels) values. Costs of several trees may be summed
+ *        before calling bestBasis() to select one basis for all of them.
+ */
+void packetCost(double* pTree, int count, int levels, PacketCost cost, double* pNodeCosts);
+
+/**
+ * Select the Coifman-Wickerhauser best basis.
+ *
+ * @param pNodeCosts
+ *        The node costs. These are overwritten.
+ * @param levels
+ *        The number of levels in the tree.
+ * @param pBasis
+ *        Output buffer of getPacketNodeCount(levels) flags which are non-zero for the basis nodes.
+ *
+ * @return The number of nodes in the basis.
+ */
+unsigned int bestBasis(double* pNodeCosts, int levels, int* pBasis);
+
+/**
+ * Expand a signal in a wavelet packet basis.
+ *
+ * The coefficients of each basis node are in the same place as in its row of the full decomposition.
+ *
+ * @param pBasis
+ *        Basis flags from bestBasis().
+ * @param pScratch
+ *        Scratch space of count values.
+ * @param pResult
+ *        Output buffer of count values. This may be the same as pData.
+ */
+void packetTransform(double* pData, int count, int levels, WaveletBasis basis, int* pBasis,
+                     double* pScratch, double* pResult);
+
+/**
+ * Map an index beyond the end of a signal back into it by symmetric reflection about the last sample.
+ */
+inline unsigned int reflectIndex(unsigned int idx, unsigned int count)
+{
+   if (count <= 1)
+   {
+      return 0;
+   }
+   unsigned int period = 2 * (count - 1);
+   idx %= period;
+   return (idx < count) ? idx : period - idx;
+}
+
+/**
+ * Extend a signal to a power of 2 length by symmetric reflection about its last sample.
+ *
+ * Reflection avoids the step at the boundary which zero padding or periodic wrapping would
+ * introduce into the finest detail coefficients.
+ *
+ * @param pData
+ *        Buffer of paddedCount values. The first count values hold the signal.
+ * @param count
+ *        The number of valid values.
+ * @param paddedCount
+ *        The size of the buffer.
+ */
+template<typename T>
+void reflectPad(T* pData, unsigned int count, unsigned int paddedCount)
+{
+   if (count == 0)
+   {
+      return;
+   }
+   for (unsigned int idx = count; idx < paddedCount; idx++)
+   {
+      pData[idx] = pData[reflectIndex(idx, count)];
+   }
+}
+}
+
+#endif
@@ -0,0 +1,439 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "BandMath.h"
+#include "BandMathDialog.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "ModelServices.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "RasterLayer.h"
+#include "RasterMathVersion.h"
+#include "RasterUtilities.h"
+#include "SpatialDataView.h"
+#include "SpatialDataWindow.h"
+#include "StringUtilities.h"
+#include "switchOnEncoding.h"
+#include "TypeConverter.h"
+#include "Undo.h"
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+
+REGISTER_PLUGIN_BASIC(BandMathModule, BandMath);
+
+namespace
+{
+   template<typename T>
+   void loadValues(const T* pData, double* pBuffer, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pBuffer[idx] = static_cast<double>(pData[idx]);
+      }
+   }
+
+   template<typename T>
+   void storeValues(T* pData, const double* pValues, unsigned int count)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         double value = pValues[idx];
+         if (std::numeric_limits<T>::is_integer)
+         {
+            // NaN has no integer representation
+            value = (value == value) ? floor(value + 0.5) : 0.0;
+            value = std::max(value, static_cast<double>(std::numeric_limits<T>::min()));
+            value = std::min(value, static_cast<double>(std::numeric_limits<T>::max()));
+         }
+         pData[idx] = static_cast<T>(value);
+      }
+   }
+}
+
+BandMath::BandMath() : mResultType(FLT4BYTES), mAbortFlag(false)
+{
+   setName("BandMath");
+   setDescription("Evaluate an expression of raster bands.");
+   setDescriptorId("{058D260D-8AEB-45B9-96DD-7A5493A3C2F8}");
+   setCopyright(RASTERMATH_COPYRIGHT);
+   setVersion(RASTERMATH_VERSION_NUMBER);
+   setProductionStatus(RASTERMATH_IS_PRODUCTION_RELEASE);
+   setAbortSupported(true);
+   setMenuLocation("[General Algorithms]/Band Math");
+}
+
+BandMath::~BandMath()
+{
+}
+
+bool BandMath::getInputSpecification(PlugInArgList*& pInArgList)
+{
+   VERIFY(pInArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pInArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pInArgList->addArg<RasterElement>(DataElementArg()));
+   VERIFY(pInArgList->addArg<std::string>("Expression",
+      "The expression to evaluate. b<n> is band n of the data element and e<m>b<n> is band n of element m. "
+      "Element 1 is the data element and elements 2 and higher are the entries of Element Names. "
+      "Band and element numbers start at 1."));
+   VERIFY(pInArgList->addArg<std::vector<std::string> >("Element Names", std::vector<std::string>(),
+      "Names of additional raster elements referenced by the expression. They must have the same number "
+      "of rows and columns as the data element."));
+   VERIFY(pInArgList->addArg<std::string>("Result Name", std::string(),
+      "The name of the result data element. The default is derived from the data element name."));
+   VERIFY(pInArgList->addArg<EncodingType>("Result Type", FLT4BYTES, "The data type of the result."));
+   return true;
+}
+
+bool BandMath::getOutputSpecification(PlugInArgList*& pOutArgList)
+{
+   VERIFY(pOutArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pOutArgList->addArg<RasterElement>("Data Element"));
+   VERIFY(pOutArgList->addArg<SpatialDataView>("View"));
+   return true;
+}
+
+bool BandMath::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin band math.", 1, NORMAL);
+
+   const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(
+      mInput.mElements.front()->getDataDescriptor());
+   { // scope the lifetime
+      RasterElement *pResult = static_cast<RasterElement*>(
+         Service<ModelServices>()->getElement(mResultName, TypeConverter::toString<RasterElement>(), NULL));
+      if (pResult != NULL)
+      {
+         Service<ModelServices>()->destroyElement(pResult);
+      }
+   }
+   ModelResource<RasterElement> pResult(RasterUtilities::createRasterElement(mResultName,
+      pDesc->getRowCount(), pDesc->getColumnCount(), 1, mResultType, BSQ,
+      pDesc->getProcessingLocation() == IN_MEMORY));
+   mInput.mpResult = pResult.get();
+   if (mInput.mpResult == NULL)
+   {
+      mProgress.report("Unable to create result data set.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mpResultDescriptor = static_cast<const RasterDataDescriptor*>(mInput.mpResult->getDataDescriptor());
+
+   mInput.mpAbortFlag = &mAbortFlag;
+   BandMathThreadOutput outputData;
+   mta::ProgressObjectReporter reporter("Evaluating expression", mProgress.getCurrentProgress());
+   mta::MultiThreadedAlgorithm<BandMathThreadInput, BandMathThreadOutput, BandMathThread>
+          alg(Service<ConfigurationSettings>()->getSettingThreadCount(), mInput, outputData, &reporter);
+   switch(alg.run())
+   {
+   case mta::SUCCESS:
+      if (!mAbortFlag)
+      {
+         mProgress.report("Band math complete.", 100, NORMAL);
+         if (!displayResult())
+         {
+            return false;
+         }
+         pOutArgList->setPlugInArgValue("Data Element", pResult.get());
+         pResult.release();
+         mProgress.upALevel();
+         return true;
+      }
+      // fall through
+   case mta::ABORT:
+      mProgress.report("Band math aborted.", 0, ABORT, true);
+      return false;
+   case mta::FAILURE:
+      mProgress.report("Band math failed.", 0, ERRORS, true);
+      return false;
+   }
+   return true; // make the compiler happy
+}
+
+bool BandMath::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "app", "{9B9C0F73-C894-47DA-809C-CFDD5368B1C2}");
+   RasterElement* pElement = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg());
+   if (pElement == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mInput.mElements.clear();
+   mInput.mElements.push_back(pElement);
+
+   pInArgList->getPlugInArgValue("Expression", mExpression);
+   pInArgList->getPlugInArgValue("Result Name", mResultName);
+   pInArgList->getPlugInArgValue("Result Type", mResultType);
+   if (!isBatch())
+   {
+      // every other loaded raster element may be referenced
+      std::vector<DataElement*> rasters =
+         Service<ModelServices>()->getElements(TypeConverter::toString<RasterElement>());
+      for (std::vector<DataElement*>::iterator raster = rasters.begin(); raster != rasters.end(); ++raster)
+      {
+         if (*raster != pElement)
+         {
+            mInput.mElements.push_back(static_cast<RasterElement*>(*raster));
+         }
+      }
+      BandMathDialog dlg(mInput.mElements);
+      dlg.setExpression(mExpression);
+      dlg.setResultType(mResultType);
+      if (dlg.exec() != QDialog::Accepted)
+      {
+         mProgress.report("User aborted.", 0, ABORT, true);
+         return false;
+      }
+      mExpression = dlg.getExpression();
+      mResultType = dlg.getResultType();
+   }
+   else
+   {
+      std::vector<std::string> names;
+      pInArgList->getPlugInArgValue("Element Names", names);
+      std::vector<DataElement*> rasters =
+         Service<ModelServices>()->getElements(TypeConverter::toString<RasterElement>());
+      for (std::vector<std::string>::const_iterator name = names.begin(); name != names.end(); ++name)
+      {
+         const RasterElement* pOther = NULL;
+         for (std::vector<DataElement*>::iterator raster = rasters.begin(); raster != rasters.end(); ++raster)
+         {
+            if ((*raster)->getName() == *name || (*raster)->getDisplayName() == *name)
+            {
+               pOther = static_cast<RasterElement*>(*raster);
+               break;
+            }
+         }
+         if (pOther == NULL)
+         {
+            mProgress.report("Unable to locate raster element " + *name + ".", 0, ERRORS, true);
+            return false;
+         }
+         mInput.mElements.push_back(pOther);
+      }
+   }
+
+   std::string errorMessage;
+   if (!mInput.mProgram.compile(mExpression, errorMessage))
+   {
+      mProgress.report("Invalid expression: " + errorMessage, 0, ERRORS, true);
+      return false;
+   }
+   if (!mResultType.isValid() || mResultType == INT4SCOMPLEX || mResultType == FLT8COMPLEX)
+   {
+      mProgress.report("Invalid result type.", 0, ERRORS, true);
+      return false;
+   }
+   if (mResultName.empty())
+   {
+      mResultName = pElement->getName() + ":" + getName();
+   }
+
+   return validateInputs();
+}
+
+bool BandMath::validateInputs()
+{
+   const RasterDataDescriptor* pPrimaryDesc = static_cast<const RasterDataDescriptor*>(
+      mInput.mElements.front()->getDataDescriptor());
+   const std::vector<BandMathProgram::Input>& inputs = mInput.mProgram.getInputs();
+   for (std::vector<BandMathProgram::Input>::const_iterator input = inputs.begin(); input != inputs.end(); ++input)
+   {
+      std::string reference = "e" + StringUtilities::toDisplayString(input->mElement + 1) +
+         "b" + StringUtilities::toDisplayString(input->mBand + 1);
+      if (input->mElement >= mInput.mElements.size())
+      {
+         mProgress.report("There is no element for " + reference + ".", 0, ERRORS, true);
+         return false;
+      }
+      const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(
+         mInput.mElements[input->mElement]->getDataDescriptor());
+      if (input->mBand >= pDesc->getBandCount())
+      {
+         mProgress.report("There is no band for " + reference + ".", 0, ERRORS, true);
+         return false;
+      }
+      if (pDesc->getRowCount() != pPrimaryDesc->getRowCount() ||
+          pDesc->getColumnCount() != pPrimaryDesc->getColumnCount())
+      {
+         mProgress.report("The element for " + reference + " is not the same size as the data element.",
+            0, ERRORS, true);
+         return false;
+      }
+      if (pDesc->getDataType() == INT4SCOMPLEX || pDesc->getDataType() == FLT8COMPLEX)
+      {
+         mProgress.report("Complex data is not supported.", 0, ERRORS, true);
+         return false;
+      }
+   }
+   return true;
+}
+
+bool BandMath::displayResult()
+{
+   if (isBatch())
+   {
+      return true;
+   }
+   if (mInput.mpResult == NULL)
+   {
+      return false;
+   }
+   SpatialDataWindow* pWindow = static_cast<SpatialDataWindow*>(
+      Service<DesktopServices>()->createWindow(mInput.mpResult->getName(), SPATIAL_DATA_WINDOW));
+   SpatialDataView* pView = (pWindow == NULL) ? NULL : pWindow->getSpatialDataView();
+   if (pView == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+   pView->setPrimaryRasterElement(mInput.mpResult);
+
+   UndoLock lock(pView);
+   RasterLayer* pLayer = static_cast<RasterLayer*>(pView->createLayer(RASTER, mInput.mpResult));
+   if (pLayer == NULL)
+   {
+      mProgress.report("Unable to create view.", 0, ERRORS, true);
+      return false;
+   }
+
+   return true;
+}
+
+BandMath::BandMathThread::BandMathThread(
+   const BandMathThreadInput &input, int threadCount, int threadIndex, mta::ThreadReporter &reporter) :
+               mta::AlgorithmThread(threadIndex, reporter),
+               mInput(input),
+               mRowRange(getThreadRange(threadCount, input.mpResultDescriptor->getRowCount()))
+{
+}
+
+void BandMath::BandMathThread::run()
+{
+   if (mInput.mpResult == NULL)
+   {
+      getReporter().reportError("No result data element.");
+      return;
+   }
+
+   const std::vector<BandMathProgram::Input>& inputs = mInput.mProgram.getInputs();
+   unsigned int numInputs = inputs.size();
+   int numCols = mInput.mpResultDescriptor->getColumnCount();
+
+   // request blocks of rows so each page fetch covers many rows of every input
+   unsigned int rowBytes = numCols * sizeof(double);
+   unsigned int blockRows = std::max(1U, std::min<unsigned int>(mRowRange.mLast - mRowRange.mFirst + 1,
+      sBlockBytes / std::max(1U, rowBytes * std::max(1U, numInputs))));
+
+   // one single band accessor for each band the expression reads
+   std::vector<DataAccessor> accessors;
+   std::vector<EncodingType> encodings;
+   for (unsigned int idx = 0; idx < numInputs; idx++)
+   {
+      const RasterElement* pElement = mInput.mElements[inputs[idx].mElement];
+      const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(pElement->getDataDescriptor());
+      FactoryResource<DataRequest> pRequest;
+      pRequest->setRows(pDesc->getActiveRow(mRowRange.mFirst), pDesc->getActiveRow(mRowRange.mLast), blockRows);
+      pRequest->setColumns(pDesc->getActiveColumn(0), pDesc->getActiveColumn(numCols - 1));
+      pRequest->setBands(pDesc->getActiveBand(inputs[idx].mBand), pDesc->getActiveBand(inputs[idx].mBand));
+      pRequest->setInterleaveFormat(BSQ);
+      accessors.push_back(pElement->getDataAccessor(pRequest.release()));
+      encodings.push_back(pDesc->getDataType());
+      if (!accessors.back().isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+   }
+
+   FactoryResource<DataRequest> pResultRequest;
+   pResultRequest->setRows(mInput.mpResultDescriptor->getActiveRow(mRowRange.mFirst),
+      mInput.mpResultDescriptor->getActiveRow(mRowRange.mLast), blockRows);
+   pResultRequest->setColumns(mInput.mpResultDescriptor->getActiveColumn(0),
+      mInput.mpResultDescriptor->getActiveColumn(numCols - 1));
+   pResultRequest->setWritable(true);
+   DataAccessor resultAccessor = mInput.mpResult->getDataAccessor(pResultRequest.release());
+   if (!resultAccessor.isValid())
+   {
+      getReporter().reportError("Invalid data access.");
+      return;
+   }
+   EncodingType resultEncoding = mInput.mpResultDescriptor->getDataType();
+
+   int oldPercentDone = 0;
+
+   int startRow = mRowRange.mFirst;
+   int stopRow = mRowRange.mLast;
+
+   // per-thread buffers so the inner loop does no allocation
+   std::vector<double> inputValues(numInputs * numCols);
+   std::vector<const double*> inputRows(numInputs);
+   for (unsigned int idx = 0; idx < numInputs; idx++)
+   {
+      inputRows[idx] = &inputValues[idx * numCols];
+   }
+   std::vector<double> stack(std::max(1U, mInput.mProgram.getStackDepth()) * numCols);
+   for (int row_index = startRow; row_index <= stopRow; row_index++)
+   {
+      int percentDone = mRowRange.computePercent(row_index);
+      if (percentDone > oldPercentDone)
+      {
+         oldPercentDone = percentDone;
+         getReporter().reportProgress(getThreadIndex(), percentDone);
+      }
+      if (mInput.mpAbortFlag != NULL && *mInput.mpAbortFlag)
+      {
+         getReporter().reportProgress(getThreadIndex(), 100);
+         break;
+      }
+
+      for (unsigned int idx = 0; idx < numInputs; idx++)
+      {
+         if (!accessors[idx].isValid())
+         {
+            getReporter().reportError("Invalid data access.");
+            return;
+         }
+         switchOnEncoding(encodings[idx], loadValues, accessors[idx]->getRow(), &inputValues[idx * numCols], numCols);
+         accessors[idx]->nextRow();
+      }
+      if (!resultAccessor.isValid())
+      {
+         getReporter().reportError("Invalid data access.");
+         return;
+      }
+      mInput.mProgram.evaluate(inputRows.empty() ? NULL : &inputRows.front(), &stack.front(), numCols);
+      switchOnEncoding(resultEncoding, storeValues, resultAccessor->getRow(), &stack.front(), numCols);
+      resultAccessor->nextRow();
+   }
+
+   getReporter().reportCompletion(getThreadIndex());
+}
+
+bool BandMath::BandMathThreadOutput::compileOverallResults(const std::vector<BandMathThread*>& threads)
+{
+   return true;
+}
@@ -0,0 +1,91 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BANDMATH_H__
+#define BANDMATH_H__
+
+#include "AlgorithmShell.h"
+#include "BandMathProgram.h"
+#include "MultiThreadedAlgorithm.h"
+#include "ProgressTracker.h"
+#include "TypesFile.h"
+
+#include <string>
+#include <vector>
+
+class RasterDataDescriptor;
+class RasterElement;
+
+/**
+ * Evaluate a band math expression in a single pass.
+ *
+ * The expression is compiled to bytecode once and evaluated a row at a time. Only the bands the
+ * expression references are read, each is converted from its native type as it is loaded and the
+ * only data element created is the single band result.
+ */
+class BandMath : public AlgorithmShell
+{
+public:
+   BandMath();
+   virtual ~BandMath();
+
+   virtual bool getInputSpecification(PlugInArgList*& pInArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pOutArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+   virtual bool abort()
+   {
+      mAbortFlag = true;
+      return true;
+   }
+
+protected:
+   virtual bool extractInputArgs(PlugInArgList* pInArgList);
+   virtual bool displayResult();
+
+   /**
+    * Check that every band the program references exists and matches the primary element's size.
+    */
+   bool validateInputs();
+
+   struct BandMathThreadInput
+   {
+      BandMathThreadInput() : mpResultDescriptor(NULL), mpResult(NULL), mpAbortFlag(NULL) {}
+      std::vector<const RasterElement*> mElements; // element 0 is the primary element
+      BandMathProgram mProgram;
+      const RasterDataDescriptor* mpResultDescriptor;
+      RasterElement* mpResult;
+      const bool* mpAbortFlag;
+   };
+
+   class BandMathThread : public mta::AlgorithmThread
+   {
+   public:
+      BandMathThread(const BandMathThreadInput& input, int threadCount, int threadIndex, mta::ThreadReporter& reporter);
+      void run();
+
+   private:
+      const BandMathThreadInput &mInput;
+      mta::AlgorithmThread::Range mRowRange;
+
+      static const unsigned int sBlockBytes = 4 * 1024 * 1024; // target size of a block of rows
+   };
+
+   struct BandMathThreadOutput
+   {
+      bool compileOverallResults(const std::vector<BandMathThread*> &threads);
+   };
+
+   ProgressTracker mProgress;
+   BandMathThreadInput mInput;
+   std::string mExpression;
+   std::string mResultName;
+   EncodingType mResultType;
+   bool mAbortFlag;
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "BandMathDialog.h"
+#include "BandMathProgram.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include <QtCore/QVariant>
+#include <QtGui/QComboBox>
+#include <QtGui/QDialogButtonBox>
+#include <QtGui/QGridLayout>
+#include <QtGui/QLabel>
+#include <QtGui/QLineEdit>
+#include <QtGui/QListWidget>
+#include <QtGui/QMessageBox>
+
+BandMathDialog::BandMathDialog(const std::vector<const RasterElement*>& elements, QWidget* pParent) :
+   QDialog(pParent)
+{
+   setWindowTitle("Band Math");
+
+   QLabel* pElementsLabel = new QLabel("Elements:", this);
+   QListWidget* pElements = new QListWidget(this);
+   for (unsigned int idx = 0; idx < elements.size(); idx++)
+   {
+      const RasterDataDescriptor* pDesc = static_cast<const RasterDataDescriptor*>(elements[idx]->getDataDescriptor());
+      pElements->addItem(QString("e%1: %2 (%3 bands)").arg(idx + 1)
+         .arg(QString::fromStdString(elements[idx]->getDisplayName()))
+         .arg(pDesc->getBandCount()));
+   }
+   QLabel* pExpressionLabel = new QLabel("Expression:", this);
+   mpExpression = new QLineEdit(this);
+   mpExpression->setToolTip("b<n> is band n of e1 and e<m>b<n> is band n of element m, for example (b4 - b3) / (b4 + b3).\n"
+      "Operators: + - * / ^ < <= > >= == != && || ! and c ? a : b.\n"
+      "Functions: abs sqrt exp log log10 sin cos tan asin acos atan floor ceil atan2 pow min max if.");
+   QLabel* pResultTypeLabel = new QLabel("Result Type:", this);
+   mpResultType = new QComboBox(this);
+   mpResultType->setEditable(false);
+   const EncodingTypeEnum types[] = {INT1UBYTE, INT1SBYTE, INT2UBYTES, INT2SBYTES, INT4UBYTES, INT4SBYTES,
+      FLT4BYTES, FLT8BYTES};
+   for (unsigned int idx = 0; idx < sizeof(types) / sizeof(types[0]); idx++)
+   {
+      mpResultType->addItem(QString::fromStdString(StringUtilities::toDisplayString(EncodingType(types[idx]))),
+         static_cast<int>(types[idx]));
+   }
+
+   QDialogButtonBox* pButtons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, Qt::Horizontal, this);
+
+   QGridLayout* pTopLevel = new QGridLayout(this);
+   pTopLevel->addWidget(pElementsLabel, 0, 0, 1, 2);
+   pTopLevel->addWidget(pElements, 1, 0, 1, 2);
+   pTopLevel->addWidget(pExpressionLabel, 2, 0);
+   pTopLevel->addWidget(mpExpression, 2, 1);
+   pTopLevel->addWidget(pResultTypeLabel, 3, 0);
+   pTopLevel->addWidget(mpResultType, 3, 1);
+   pTopLevel->addWidget(pButtons, 4, 0, 1, 2);
+   pTopLevel->setColumnStretch(1, 10);
+
+   connect(pButtons, SIGNAL(accepted()), this, SLOT(accept()));
+   connect(pButtons, SIGNAL(rejected()), this, SLOT(reject()));
+}
+
+BandMathDialog::~BandMathDialog()
+{
+}
+
+std::string BandMathDialog::getExpression() const
+{
+   return mpExpression->text().toStdString();
+}
+
+EncodingType BandMathDialog::getResultType() const
+{
+   return static_cast<EncodingTypeEnum>(mpResultType->itemData(mpResultType->currentIndex()).toInt());
+}
+
+void BandMathDialog::setExpression(const std::string& expression)
+{
+   mpExpression->setText(QString::fromStdString(expression));
+}
+
+void BandMathDialog::setResultType(EncodingType type)
+{
+   int index = mpResultType->findData(static_cast<int>(type));
+   if (index >= 0)
+   {
+      mpResultType->setCurrentIndex(index);
+   }
+}
+
+void BandMathDialog::accept()
+{
+   // the bands are checked against the elements after the dialog closes but syntax errors are caught here
+   BandMathProgram program;
+   std::string errorMessage;
+   if (!program.compile(getExpression(), errorMessage))
+   {
+      QMessageBox::warning(this, "Band Math", QString::fromStdString("Invalid expression: " + errorMessage));
+      return;
+   }
+   QDialog::accept();
+}
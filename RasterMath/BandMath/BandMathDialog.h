@@ -0,0 +1,42 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BANDMATHDIALOG_H
+#define BANDMATHDIALOG_H
+
+#include "TypesFile.h"
+#include <QtGui/QDialog>
+#include <string>
+#include <vector>
+
+class QComboBox;
+class QLineEdit;
+class RasterElement;
+
+class BandMathDialog : public QDialog
+{
+   Q_OBJECT
+
+public:
+   BandMathDialog(const std::vector<const RasterElement*>& elements, QWidget* pParent=NULL);
+   virtual ~BandMathDialog();
+
+   std::string getExpression() const;
+   EncodingType getResultType() const;
+   void setExpression(const std::string& expression);
+   void setResultType(EncodingType type);
+
+public slots:
+   virtual void accept();
+
+private:
+   QLineEdit* mpExpression;
+   QComboBox* mpResultType;
+};
+
+#endif
@@ -0,0 +1,645 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "BandMathProgram.h"
+
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+   const double sPi = 3.14159265358979323846;
+
+   struct Negate { double operator()(double a) const { return -a; } };
+   struct Not { double operator()(double a) const { return (a == 0.0) ? 1.0 : 0.0; } };
+   struct Add { double operator()(double a, double b) const { return a + b; } };
+   struct Subtract { double operator()(double a, double b) const { return a - b; } };
+   struct Multiply { double operator()(double a, double b) const { return a * b; } };
+   struct Divide { double operator()(double a, double b) const { return a / b; } };
+   struct Power { double operator()(double a, double b) const { return pow(a, b); } };
+   struct Atan2 { double operator()(double a, double b) const { return atan2(a, b); } };
+   struct Minimum { double operator()(double a, double b) const { return (b < a) ? b : a; } };
+   struct Maximum { double operator()(double a, double b) const { return (a < b) ? b : a; } };
+   struct Less { double operator()(double a, double b) const { return (a < b) ? 1.0 : 0.0; } };
+   struct LessEqual { double operator()(double a, double b) const { return (a <= b) ? 1.0 : 0.0; } };
+   struct Greater { double operator()(double a, double b) const { return (a > b) ? 1.0 : 0.0; } };
+   struct GreaterEqual { double operator()(double a, double b) const { return (a >= b) ? 1.0 : 0.0; } };
+   struct Equal { double operator()(double a, double b) const { return (a == b) ? 1.0 : 0.0; } };
+   struct NotEqual { double operator()(double a, double b) const { return (a != b) ? 1.0 : 0.0; } };
+   struct And { double operator()(double a, double b) const { return (a != 0.0 && b != 0.0) ? 1.0 : 0.0; } };
+   struct Or { double operator()(double a, double b) const { return (a != 0.0 || b != 0.0) ? 1.0 : 0.0; } };
+
+   typedef double (*MathFunction)(double);
+
+   template<typename Operation>
+   void unaryLoop(double* pA, unsigned int count, Operation operation)
+   {
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         pA[idx] = operation(pA[idx]);
+      }
+   }
+
+   /**
+    * pB is NULL when the second operand is the immediate value b.
+    */
+   template<typename Operation>
+   void binaryLoop(double* pA, const double* pB, double b, unsigned int count, Operation operation)
+   {
+      if (pB == NULL)
+      {
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            pA[idx] = operation(pA[idx], b);
+         }
+      }
+      else
+      {
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            pA[idx] = operation(pA[idx], pB[idx]);
+         }
+      }
+   }
+
+   struct FunctionEntry
+   {
+      const char* mpName;
+      unsigned int mOp;
+      unsigned int mArity;
+   };
+
+   struct BinaryOperator
+   {
+      const char* mpToken;
+      unsigned int mOp;
+   };
+}
+
+BandMathProgram::BandMathProgram() : mStackDepth(0), mPosition(0)
+{
+}
+
+bool BandMathProgram::compile(const std::string& expression, std::string& errorMessage)
+{
+   mCode.clear();
+   mInputs.clear();
+   mStackDepth = 0;
+   mExpression = expression;
+   mPosition = 0;
+   mError.clear();
+
+   bool success = parseConditional();
+   if (success)
+   {
+      skipSpace();
+      if (mPosition < mExpression.size())
+      {
+         success = fail("Unexpected '" + mExpression.substr(mPosition, 1) + "'");
+      }
+   }
+   if (!success)
+   {
+      errorMessage = mError;
+      mCode.clear();
+      mInputs.clear();
+      return false;
+   }
+
+   // folding and immediate operands change the depth so measure the final code
+   unsigned int depth = 0;
+   for (std::vector<Instruction>::const_iterator instruction = mCode.begin(); instruction != mCode.end(); ++instruction)
+   {
+      unsigned int arity = getArity(instruction->mOp);
+      if (arity == 0)
+      {
+         depth++;
+      }
+      else if (!instruction->mImmediate)
+      {
+         depth -= arity - 1;
+      }
+      mStackDepth = std::max(mStackDepth, depth);
+   }
+   errorMessage.clear();
+   return true;
+}
+
+void BandMathProgram::evaluate(const double* const* pInputs, double* pStack, unsigned int count) const
+{
+   double* pTop = pStack; // one past the top of the stack
+   for (std::vector<Instruction>::const_iterator instruction = mCode.begin(); instruction != mCode.end(); ++instruction)
+   {
+      double* pA = NULL;
+      const double* pB = NULL;
+      unsigned int arity = getArity(instruction->mOp);
+      if (arity == 1 || (arity == 2 && instruction->mImmediate))
+      {
+         pA = pTop - count;
+      }
+      else if (arity == 2)
+      {
+         pTop -= count;
+         pA = pTop - count;
+         pB = pTop;
+      }
+      double b = instruction->mConstant;
+
+      switch (instruction->mOp)
+      {
+      case PUSH_CONSTANT:
+         std::fill(pTop, pTop + count, instruction->mConstant);
+         pTop += count;
+         break;
+      case PUSH_INPUT:
+         std::copy(pInputs[instruction->mInput], pInputs[instruction->mInput] + count, pTop);
+         pTop += count;
+         break;
+      case NEGATE:
+         unaryLoop(pA, count, Negate());
+         break;
+      case NOT:
+         unaryLoop(pA, count, Not());
+         break;
+      case ABS:
+         unaryLoop(pA, count, static_cast<MathFunction>(fabs));
+         break;
+      case SQRT:
+         unaryLoop(pA, count, static_cast<MathFunction>(sqrt));
+         break;
+      case EXP:
+         unaryLoop(pA, count, static_cast<MathFunction>(exp));
+         break;
+      case LOG:
+         unaryLoop(pA, count, static_cast<MathFunction>(log));
+         break;
+      case LOG10:
+         unaryLoop(pA, count, static_cast<MathFunction>(log10));
+         break;
+      case SIN:
+         unaryLoop(pA, count, static_cast<MathFunction>(sin));
+         break;
+      case COS:
+         unaryLoop(pA, count, static_cast<MathFunction>(cos));
+         break;
+      case TAN:
+         unaryLoop(pA, count, static_cast<MathFunction>(tan));
+         break;
+      case ASIN:
+         unaryLoop(pA, count, static_cast<MathFunction>(asin));
+         break;
+      case ACOS:
+         unaryLoop(pA, count, static_cast<MathFunction>(acos));
+         break;
+      case ATAN:
+         unaryLoop(pA, count, static_cast<MathFunction>(atan));
+         break;
+      case FLOOR:
+         unaryLoop(pA, count, static_cast<MathFunction>(floor));
+         break;
+      case CEIL:
+         unaryLoop(pA, count, static_cast<MathFunction>(ceil));
+         break;
+      case ADD:
+         binaryLoop(pA, pB, b, count, Add());
+         break;
+      case SUBTRACT:
+         binaryLoop(pA, pB, b, count, Subtract());
+         break;
+      case MULTIPLY:
+         binaryLoop(pA, pB, b, count, Multiply());
+         break;
+      case DIVIDE:
+         binaryLoop(pA, pB, b, count, Divide());
+         break;
+      case POWER:
+         binaryLoop(pA, pB, b, count, Power());
+         break;
+      case ATAN2:
+         binaryLoop(pA, pB, b, count, Atan2());
+         break;
+      case MINIMUM:
+         binaryLoop(pA, pB, b, count, Minimum());
+         break;
+      case MAXIMUM:
+         binaryLoop(pA, pB, b, count, Maximum());
+         break;
+      case LESS:
+         binaryLoop(pA, pB, b, count, Less());
+         break;
+      case LESS_EQUAL:
+         binaryLoop(pA, pB, b, count, LessEqual());
+         break;
+      case GREATER:
+         binaryLoop(pA, pB, b, count, Greater());
+         break;
+      case GREATER_EQUAL:
+         binaryLoop(pA, pB, b, count, GreaterEqual());
+         break;
+      case EQUAL:
+         binaryLoop(pA, pB, b, count, Equal());
+         break;
+      case NOT_EQUAL:
+         binaryLoop(pA, pB, b, count, NotEqual());
+         break;
+      case AND:
+         binaryLoop(pA, pB, b, count, And());
+         break;
+      case OR:
+         binaryLoop(pA, pB, b, count, Or());
+         break;
+      case SELECT:
+      {
+         // both branches have already been evaluated for every pixel
+         double* pCondition = pTop - 3 * count;
+         const double* pTrue = pTop - 2 * count;
+         const double* pFalse = pTop - count;
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            pCondition[idx] = (pCondition[idx] != 0.0) ? pTrue[idx] : pFalse[idx];
+         }
+         pTop = pCondition + count;
+         break;
+      }
+      }
+   }
+}
+
+unsigned int BandMathProgram::getArity(OpCode op)
+{
+   if (op <= PUSH_INPUT)
+   {
+      return 0;
+   }
+   if (op <= CEIL)
+   {
+      return 1;
+   }
+   if (op <= OR)
+   {
+      return 2;
+   }
+   return 3;
+}
+
+double BandMathProgram::apply(OpCode op, double a, double b, double c)
+{
+   switch (op)
+   {
+   case NEGATE: return Negate()(a);
+   case NOT: return Not()(a);
+   case ABS: return fabs(a);
+   case SQRT: return sqrt(a);
+   case EXP: return exp(a);
+   case LOG: return log(a);
+   case LOG10: return log10(a);
+   case SIN: return sin(a);
+   case COS: return cos(a);
+   case TAN: return tan(a);
+   case ASIN: return asin(a);
+   case ACOS: return acos(a);
+   case ATAN: return atan(a);
+   case FLOOR: return floor(a);
+   case CEIL: return ceil(a);
+   case ADD: return Add()(a, b);
+   case SUBTRACT: return Subtract()(a, b);
+   case MULTIPLY: return Multiply()(a, b);
+   case DIVIDE: return Divide()(a, b);
+   case POWER: return Power()(a, b);
+   case ATAN2: return Atan2()(a, b);
+   case MINIMUM: return Minimum()(a, b);
+   case MAXIMUM: return Maximum()(a, b);
+   case LESS: return Less()(a, b);
+   case LESS_EQUAL: return LessEqual()(a, b);
+   case GREATER: return Greater()(a, b);
+   case GREATER_EQUAL: return GreaterEqual()(a, b);
+   case EQUAL: return Equal()(a, b);
+   case NOT_EQUAL: return NotEqual()(a, b);
+   case AND: return And()(a, b);
+   case OR: return Or()(a, b);
+   case SELECT: return (a != 0.0) ? b : c;
+   default: break;
+   }
+   return a;
+}
+
+void BandMathProgram::emit(OpCode op)
+{
+   unsigned int arity = getArity(op);
+   unsigned int constants = 0;
+   for (std::vector<Instruction>::reverse_iterator instruction = mCode.rbegin();
+      constants < arity && instruction != mCode.rend() && instruction->mOp == PUSH_CONSTANT; ++instruction)
+   {
+      constants++;
+   }
+
+   // each constant is a whole operand so trailing constants are the last operands
+   if (constants == arity)
+   {
+      double operands[3] = {0.0, 0.0, 0.0};
+      for (unsigned int idx = 0; idx < arity; idx++)
+      {
+         operands[idx] = mCode[mCode.size() - arity + idx].mConstant;
+      }
+      mCode.erase(mCode.end() - arity, mCode.end());
+      emitConstant(apply(op, operands[0], operands[1], operands[2]));
+      return;
+   }
+   if (arity == 2 && constants == 1)
+   {
+      Instruction instruction(op, mCode.back().mConstant);
+      instruction.mImmediate = true;
+      mCode.back() = instruction;
+      return;
+   }
+   mCode.push_back(Instruction(op));
+}
+
+void BandMathProgram::emitConstant(double value)
+{
+   mCode.push_back(Instruction(PUSH_CONSTANT, value));
+}
+
+void BandMathProgram::emitInput(unsigned int element, unsigned int band)
+{
+   Input input(element, band);
+   std::vector<Input>::iterator pos = std::find(mInputs.begin(), mInputs.end(), input);
+   unsigned int index = pos - mInputs.begin();
+   if (pos == mInputs.end())
+   {
+      mInputs.push_back(input);
+   }
+   mCode.push_back(Instruction(PUSH_INPUT, 0.0, index));
+}
+
+bool BandMathProgram::parseConditional()
+{
+   if (!parseBinary(0))
+   {
+      return false;
+   }
+   if (accept("?"))
+   {
+      if (!parseConditional() || !expect(":") || !parseConditional())
+      {
+         return false;
+      }
+      emit(SELECT);
+   }
+   return true;
+}
+
+bool BandMathProgram::parseBinary(int precedence)
+{
+   // lowest precedence first, longer tokens before their prefixes
+   static const BinaryOperator sOperators[][4] = {
+      {{"||", OR}, {NULL, 0}},
+      {{"&&", AND}, {NULL, 0}},
+      {{"==", EQUAL}, {"!=", NOT_EQUAL}, {NULL, 0}},
+      {{"<=", LESS_EQUAL}, {">=", GREATER_EQUAL}, {"<", LESS}, {">", GREATER}},
+      {{"+", ADD}, {"-", SUBTRACT}, {NULL, 0}},
+      {{"*", MULTIPLY}, {"/", DIVIDE}, {NULL, 0}}
+   };
+   static const int sLevels = sizeof(sOperators) / sizeof(sOperators[0]);
+
+   if (precedence >= sLevels)
+   {
+      return parseUnary();
+   }
+   if (!parseBinary(precedence + 1))
+   {
+      return false;
+   }
+   for (;;)
+   {
+      const BinaryOperator* pOperator = NULL;
+      for (int idx = 0; idx < 4 && sOperators[precedence][idx].mpToken != NULL; idx++)
+      {
+         if (accept(sOperators[precedence][idx].mpToken))
+         {
+            pOperator = &sOperators[precedence][idx];
+            break;
+         }
+      }
+      if (pOperator == NULL)
+      {
+         return true;
+      }
+      if (!parseBinary(precedence + 1))
+      {
+         return false;
+      }
+      emit(static_cast<OpCode>(pOperator->mOp));
+   }
+}
+
+bool BandMathProgram::parseUnary()
+{
+   if (accept("-"))
+   {
+      if (!parseUnary())
+      {
+         return false;
+      }
+      emit(NEGATE);
+      return true;
+   }
+   if (accept("+"))
+   {
+      return parseUnary();
+   }
+   skipSpace();
+   if (mExpression.compare(mPosition, 2, "!=") != 0 && accept("!"))
+   {
+      if (!parseUnary())
+      {
+         return false;
+      }
+      emit(NOT);
+      return true;
+   }
+   return parsePower();
+}
+
+bool BandMathProgram::parsePower()
+{
+   if (!parsePrimary())
+   {
+      return false;
+   }
+   if (accept("^"))
+   {
+      // right associative and binds tighter than unary minus on its left: -2^2 is -4, 2^-1 is 0.5
+      if (!parseUnary())
+      {
+         return false;
+      }
+      emit(POWER);
+   }
+   return true;
+}
+
+bool BandMathProgram::parsePrimary()
+{
+   skipSpace();
+   if (mPosition >= mExpression.size())
+   {
+      return fail("Expected a value");
+   }
+   const char* pStart = mExpression.c_str() + mPosition;
+   if (isdigit(*pStart) || *pStart == '.')
+   {
+      char* pEnd = NULL;
+      double value = strtod(pStart, &pEnd);
+      if (pEnd == pStart)
+      {
+         return fail("Invalid number");
+      }
+      mPosition += pEnd - pStart;
+      emitConstant(value);
+      return true;
+   }
+   if (accept("("))
+   {
+      return parseConditional() && expect(")");
+   }
+   if (isalpha(*pStart))
+   {
+      std::string name;
+      while (mPosition < mExpression.size() &&
+         (isalnum(mExpression[mPosition]) || mExpression[mPosition] == '_'))
+      {
+         name += static_cast<char>(tolower(mExpression[mPosition++]));
+      }
+      skipSpace();
+      if (mPosition < mExpression.size() && mExpression[mPosition] == '(')
+      {
+         return parseFunction(name);
+      }
+      if (name == "pi")
+      {
+         emitConstant(sPi);
+         return true;
+      }
+      return parseBand(name);
+   }
+   return fail("Expected a value");
+}
+
+bool BandMathProgram::parseFunction(const std::string& name)
+{
+   static const FunctionEntry sFunctions[] = {
+      {"abs", ABS, 1}, {"sqrt", SQRT, 1}, {"exp", EXP, 1}, {"log", LOG, 1}, {"log10", LOG10, 1},
+      {"sin", SIN, 1}, {"cos", COS, 1}, {"tan", TAN, 1}, {"asin", ASIN, 1}, {"acos", ACOS, 1},
+      {"atan", ATAN, 1}, {"floor", FLOOR, 1}, {"ceil", CEIL, 1}, {"atan2", ATAN2, 2}, {"pow", POWER, 2},
+      {"min", MINIMUM, 2}, {"max", MAXIMUM, 2}, {"if", SELECT, 3}
+   };
+
+   const FunctionEntry* pFunction = NULL;
+   for (unsigned int idx = 0; idx < sizeof(sFunctions) / sizeof(sFunctions[0]); idx++)
+   {
+      if (name == sFunctions[idx].mpName)
+      {
+         pFunction = &sFunctions[idx];
+         break;
+      }
+   }
+   if (pFunction == NULL)
+   {
+      return fail("Unknown function '" + name + "'");
+   }
+   if (!expect("("))
+   {
+      return false;
+   }
+   for (unsigned int arg = 0; arg < pFunction->mArity; arg++)
+   {
+      if ((arg > 0 && !expect(",")) || !parseConditional())
+      {
+         return false;
+      }
+   }
+   if (!expect(")"))
+   {
+      return false;
+   }
+   emit(static_cast<OpCode>(pFunction->mOp));
+   return true;
+}
+
+bool BandMathProgram::parseBand(const std::string& name)
+{
+   // b<band> or e<element>b<band>
+   unsigned long element = 1;
+   const char* pName = name.c_str();
+   char* pEnd = NULL;
+   if (*pName == 'e' && isdigit(pName[1]))
+   {
+      element = strtoul(pName + 1, &pEnd, 10);
+      pName = pEnd;
+   }
+   if (*pName != 'b' || !isdigit(pName[1]))
+   {
+      return fail("Unknown name '" + name + "'");
+   }
+   unsigned long band = strtoul(pName + 1, &pEnd, 10);
+   if (*pEnd != '\0')
+   {
+      return fail("Unknown name '" + name + "'");
+   }
+   if (element == 0 || band == 0)
+   {
+      return fail("Element and band numbers start at 1 in '" + name + "'");
+   }
+   emitInput(element - 1, band - 1);
+   return true;
+}
+
+void BandMathProgram::skipSpace()
+{
+   while (mPosition < mExpression.size() && isspace(mExpression[mPosition]))
+   {
+      mPosition++;
+   }
+}
+
+bool BandMathProgram::accept(const char* pToken)
+{
+   skipSpace();
+   size_t length = strlen(pToken);
+   if (mExpression.compare(mPosition, length, pToken) != 0)
+   {
+      return false;
+   }
+   mPosition += length;
+   return true;
+}
+
+bool BandMathProgram::expect(const char* pToken)
+{
+   if (!accept(pToken))
+   {
+      return fail(std::string("Expected '") + pToken + "'");
+   }
+   return true;
+}
+
+bool BandMathProgram::fail(const std::string& message)
+{
+   if (mError.empty())
+   {
+      std::stringstream error;
+      error << message << " at position " << (mPosition + 1) << ".";
+      mError = error.str();
+   }
+   return false;
+}
@@ -0,0 +1,144 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BANDMATHPROGRAM_H__
+#define BANDMATHPROGRAM_H__
+
+#include <string>
+#include <vector>
+
+/**
+ * A band math expression compiled to stack machine bytecode.
+ *
+ * Each instruction operates on a whole vector of pixels so the cost of decoding an instruction
+ * is paid once per row instead of once per pixel. Constant subexpressions are folded when the
+ * expression is compiled and constant operands of binary operators are stored in the instruction.
+ *
+ * Expression syntax:
+ * - b<n> is band n (1 based) of the primary element. e<m>b<n> is band n of element m, element 1
+ *   being the primary element.
+ * - Numbers and the constant pi.
+ * - Arithmetic: + - * / ^ (power, right associative) and unary -.
+ * - Comparison: < <= > >= == != which evaluate to 1 or 0.
+ * - Logic: && || ! where any non-zero value is true, and the conditional c ? a : b.
+ * - Functions: abs sqrt exp log log10 sin cos tan asin acos atan floor ceil with one argument,
+ *   atan2 pow min max with two arguments and if(c, a, b).
+ */
+class BandMathProgram
+{
+public:
+   /**
+    * A band referenced by the expression.
+    */
+   struct Input
+   {
+      Input(unsigned int element, unsigned int band) : mElement(element), mBand(band) {}
+      bool operator==(const Input& other) const
+      {
+         return mElement == other.mElement && mBand == other.mBand;
+      }
+
+      unsigned int mElement; // zero based, 0 is the primary element
+      unsigned int mBand; // zero based active band number
+   };
+
+   BandMathProgram();
+
+   /**
+    * Compile an expression, replacing any previously compiled program.
+    *
+    * @param expression
+    *        The band math expression.
+    * @param errorMessage
+    *        Set to a description of the problem when the expression is not valid.
+    *
+    * @return True if the expression compiled.
+    */
+   bool compile(const std::string& expression, std::string& errorMessage);
+
+   /**
+    * The bands the program reads, in the order evaluate() expects them.
+    */
+   const std::vector<Input>& getInputs() const
+   {
+      return mInputs;
+   }
+
+   /**
+    * The number of vectors of working storage evaluate() needs.
+    */
+   unsigned int getStackDepth() const
+   {
+      return mStackDepth;
+   }
+
+   /**
+    * Evaluate the program over a vector of pixels.
+    *
+    * @param pInputs
+    *        One pointer to count values for each entry in getInputs().
+    * @param pStack
+    *        Working storage of getStackDepth() * count values. On return the first
+    *        count values are the result.
+    * @param count
+    *        The number of pixels.
+    */
+   void evaluate(const double* const* pInputs, double* pStack, unsigned int count) const;
+
+private:
+   enum OpCode
+   {
+      PUSH_CONSTANT, PUSH_INPUT,
+      NEGATE, NOT, ABS, SQRT, EXP, LOG, LOG10, SIN, COS, TAN, ASIN, ACOS, ATAN, FLOOR, CEIL,
+      ADD, SUBTRACT, MULTIPLY, DIVIDE, POWER, ATAN2, MINIMUM, MAXIMUM,
+      LESS, LESS_EQUAL, GREATER, GREATER_EQUAL, EQUAL, NOT_EQUAL, AND, OR,
+      SELECT
+   };
+
+   struct Instruction
+   {
+      Instruction(OpCode op, double constant = 0.0, unsigned int input = 0) :
+         mOp(op), mImmediate(false), mConstant(constant), mInput(input) {}
+
+      OpCode mOp;
+      bool mImmediate; // the second operand of a binary operator is mConstant instead of the stack
+      double mConstant;
+      unsigned int mInput;
+   };
+
+   static unsigned int getArity(OpCode op);
+   static double apply(OpCode op, double a, double b, double c);
+
+   void emit(OpCode op);
+   void emitConstant(double value);
+   void emitInput(unsigned int element, unsigned int band);
+
+   bool parseConditional();
+   bool parseBinary(int precedence);
+   bool parseUnary();
+   bool parsePower();
+   bool parsePrimary();
+   bool parseFunction(const std::string& name);
+   bool parseBand(const std::string& name);
+
+   void skipSpace();
+   bool accept(const char* pToken);
+   bool expect(const char* pToken);
+   bool fail(const std::string& message);
+
+   std::vector<Instruction> mCode;
+   std::vector<Input> mInputs;
+   unsigned int mStackDepth;
+
+   // parser state
+   std::string mExpression;
+   std::string::size_type mPosition;
+   std::string mError;
+};
+
+#endif
@@ -0,0 +1,18 @@
+/*
+ * The information in this file is
+ * subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef RASTERMATHVERSION_H
+#define RASTERMATHVERSION_H
+
+#define RASTERMATH_NAME "RASTERMATH"
+#define RASTERMATH_NAME_LONG "Raster band math."
+#define RASTERMATH_COPYRIGHT ""
+#define RASTERMATH_VERSION_NUMBER "1.0"
+#define RASTERMATH_IS_PRODUCTION_RELEASE false
+
+#endif
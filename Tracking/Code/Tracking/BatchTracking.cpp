@@ -0,0 +1,463 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AoiElement.h"
+#include "AppVerify.h"
+#include "BatchTracking.h"
+#include "BitMask.h"
+#include "DataAccessor.h"
+#include "DataAccessorImpl.h"
+#include "DataRequest.h"
+#include "Filename.h"
+#include "PlugInArgList.h"
+#include "PlugInManagerServices.h"
+#include "PlugInRegistration.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "StringUtilities.h"
+#include "TrackingManager.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+
+REGISTER_PLUGIN_BASIC(Tracking, BatchTracking);
+
+namespace
+{
+   const quint32 sMagic = 0x4b435254; // "TRCK"
+   const quint32 sVersion = 1;
+}
+
+BatchTracking::BatchTracking() :
+   mpRaster(NULL),
+   mpDescriptor(NULL),
+   mExportFormat(TrackExporter::CSV),
+   mFirstFrame(0),
+   mLastFrame(0),
+   mStartColumn(0),
+   mStartRow(0),
+   mColumns(0),
+   mRows(0),
+   mDetectionCount(0),
+   mFrameTableOffset(0),
+   mTrackTableOffset(0)
+{
+   setName("BatchTracking");
+   setDescription("Track objects through a range of frames without a display and write the tracks to a file.");
+   setDescriptorId("{d03194dd-1779-4dc4-9f68-cb4f64b384d9}");
+   setType("Algorithm");
+   setSubtype("Video");
+   setAbortSupported(true);
+}
+
+BatchTracking::~BatchTracking()
+{
+}
+
+bool BatchTracking::getInputSpecification(PlugInArgList*& pArgList)
+{
+   TrackingParameters defaults = TrackingManager::getSettingParameters();
+   VERIFY(pArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pArgList->addArg<Progress>(ProgressArg(), NULL));
+   VERIFY(pArgList->addArg<RasterElement>(DataElementArg(), "The frame cube. Each band is a frame."));
+   VERIFY(pArgList->addArg<Filename>("Output File", NULL, "The track file."));
+   VERIFY(pArgList->addArg<Filename>("Export File", NULL,
+      "Optional track point export. The format is chosen by the extension: .csv, .geojson or .kml."));
+   VERIFY(pArgList->addArg<unsigned int>("First Frame", "The first frame (active band number) to track. Defaults to the first band."));
+   VERIFY(pArgList->addArg<unsigned int>("Last Frame", "The last frame (active band number) to track. Defaults to the last band."));
+   VERIFY(pArgList->addArg<AoiElement>("AOI", NULL,
+      "Optional tracked area. Only the bounding box will be used and inverted AOIs will be ignored."));
+   VERIFY(pArgList->addArg<unsigned int>("Track Window Size", defaults.mTrackWindow,
+      "Number of frames whose detections are kept in the live track graph."));
+   VERIFY(pArgList->addArg<double>("Gate Radius", defaults.mGateRadius, "Maximum movement in pixels between frames."));
+   VERIFY(pArgList->addArg<bool>("Global Assignment", defaults.mGlobalAssignment,
+      "Match objects with the minimum total cost instead of greedily."));
+   VERIFY(pArgList->addArg<std::string>("Motion Model", TrackingManager::getSettingMotionModel(),
+      "none, constant velocity or constant acceleration."));
+   VERIFY(pArgList->addArg<unsigned int>("Max Coast Frames", defaults.mMaxCoastFrames,
+      "Frames a filtered track may go undetected before it ends."));
+   VERIFY(pArgList->addArg<bool>("RANSAC Guided", defaults.mRansacGuided,
+      "Rank the flow vectors by tracking error when registering frames."));
+   VERIFY(pArgList->addArg<double>("Object Threshold", defaults.mObjectThreshold, "Object detection threshold in 8-bit levels. Other data is mapped through each frame's display range."));
+   return true;
+}
+
+bool BatchTracking::getOutputSpecification(PlugInArgList*& pArgList)
+{
+   VERIFY(pArgList = Service<PlugInManagerServices>()->getPlugInArgList());
+   VERIFY(pArgList->addArg<unsigned int>("Track Count", "The number of tracks written."));
+   VERIFY(pArgList->addArg<unsigned int>("Detection Count", "The number of detections written. "
+      "Saturates at the largest unsigned int."));
+   VERIFY(pArgList->addArg<unsigned int>("Buffer Growth Count", "The number of frames which had to grow a frame or "
+      "pipeline buffer. It stops increasing once the largest object count has been seen, after which tracking "
+      "allocates no per-frame buffers."));
+   return true;
+}
+
+bool BatchTracking::execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList)
+{
+   if (pInArgList == NULL || pOutArgList == NULL)
+   {
+      return false;
+   }
+   if (!extractInputArgs(pInArgList))
+   {
+      return false;
+   }
+
+   mProgress.report("Begin batch tracking.", 1, NORMAL);
+   QFile file(QString::fromStdString(mFilename));
+   if (!file.open(QFile::WriteOnly | QFile::Truncate))
+   {
+      mProgress.report("Unable to open " + mFilename + " for writing.", 0, ERRORS, true);
+      return false;
+   }
+   QDataStream stream(&file);
+   stream.setByteOrder(QDataStream::LittleEndian);
+   stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+   // the counts and table offsets are written with placeholders and filled in once the run is done
+   unsigned int frameCount = mLastFrame - mFirstFrame + 1;
+   mFrames.assign(frameCount, FrameRecord());
+   mTrackTable.clear();
+   mDetectionCount = 0;
+   mFrameTableOffset = 0;
+   mTrackTableOffset = 0;
+   if (!writeHeader(stream))
+   {
+      mProgress.report("Unable to write the file header.", 0, ERRORS, true);
+      discardOutput(file);
+      return false;
+   }
+   if (!mExportFilename.empty() && !mExporter.open(mExportFilename, mExportFormat, mpRaster))
+   {
+      mProgress.report(mExporter.getError(), 0, ERRORS, true);
+      discardOutput(file);
+      return false;
+   }
+
+   TrackingPipeline pipeline;
+   pipeline.setParameters(mParams);
+   FrameSnapshot frame;
+   TrackUpdate update;
+   std::deque<TrackPoint> points;
+   unsigned int bufferGrowths = 0;
+   for (unsigned int frameNum = mFirstFrame; frameNum <= mLastFrame; frameNum++)
+   {
+      if (isAborted())
+      {
+         mProgress.report("Batch tracking aborted.", 0, ABORT, true);
+         discardOutput(file);
+         return false;
+      }
+      int percentDone = 1 + 98 * (frameNum - mFirstFrame) / frameCount;
+      size_t frameCapacity = frame.mData.capacity();
+      unsigned int pipelineGrowths = pipeline.getBufferGrowthCount();
+      if (!readFrame(frameNum, frame))
+      {
+         mProgress.report("Unable to read frame " + StringUtilities::toDisplayString(frameNum) + ".", 0, ERRORS, true);
+         discardOutput(file);
+         return false;
+      }
+      frame.mReset = (frameNum == mFirstFrame);
+      pipeline.process(frame, update);
+      if (frame.mData.capacity() > frameCapacity || pipeline.getBufferGrowthCount() > pipelineGrowths)
+      {
+         bufferGrowths++;
+      }
+      if (!update.mError.empty())
+      {
+         mProgress.report("Frame " + StringUtilities::toDisplayString(frameNum) + ": " + update.mError,
+            percentDone, WARNING, true);
+      }
+      FrameRecord& record = mFrames[frameNum - mFirstFrame];
+      record.mFrameNum = frameNum;
+      record.mBaseFrameNum = frame.mReset ? -1 : update.mBaseFrameNum;
+      record.mRegistered = update.mRegistered;
+
+      pipeline.takeTrackHistory(points);
+      if (!writeDetections(stream, points))
+      {
+         discardOutput(file);
+         return false;
+      }
+      mProgress.report("Tracking", percentDone, NORMAL);
+   }
+   pipeline.retireAll();
+   pipeline.takeTrackHistory(points);
+   if (!writeDetections(stream, points))
+   {
+      discardOutput(file);
+      return false;
+   }
+   if (!writeTables(stream))
+   {
+      mProgress.report("Unable to write " + mFilename + ".", 0, ERRORS, true);
+      discardOutput(file);
+      return false;
+   }
+   if (!file.seek(0) || !writeHeader(stream))
+   {
+      mProgress.report("Unable to write the file header.", 0, ERRORS, true);
+      discardOutput(file);
+      return false;
+   }
+   file.close();
+   if (!mExporter.close())
+   {
+      mProgress.report(mExporter.getError(), 0, ERRORS, true);
+      QFile::remove(QString::fromStdString(mExportFilename));
+      return false;
+   }
+
+   unsigned int trackCount = mTrackTable.size();
+   // the arg is 32 bit so saturate rather than wrap, the message reports the full count
+   unsigned int detectionCount = static_cast<unsigned int>(
+      std::min<quint64>(mDetectionCount, std::numeric_limits<unsigned int>::max()));
+   pOutArgList->setPlugInArgValue("Track Count", &trackCount);
+   pOutArgList->setPlugInArgValue("Detection Count", &detectionCount);
+   pOutArgList->setPlugInArgValue("Buffer Growth Count", &bufferGrowths);
+   mProgress.report("Wrote " + StringUtilities::toDisplayString(trackCount) + " tracks with " +
+      QString::number(mDetectionCount).toStdString() + " detections.", 100, NORMAL);
+   mProgress.upALevel();
+   return true;
+}
+
+void BatchTracking::discardOutput(QFile& file)
+{
+   file.remove();
+   mExporter.discard();
+}
+
+bool BatchTracking::extractInputArgs(PlugInArgList* pInArgList)
+{
+   VERIFY(pInArgList);
+   mProgress = ProgressTracker(pInArgList->getPlugInArgValue<Progress>(ProgressArg()),
+      "Executing " + getName(), "Tracking", "{6cec00a9-e0f7-49e3-97ba-aa0657722ebd}");
+   if ((mpRaster = pInArgList->getPlugInArgValue<RasterElement>(DataElementArg())) == NULL)
+   {
+      mProgress.report("No raster element.", 0, ERRORS, true);
+      return false;
+   }
+   mpDescriptor = static_cast<const RasterDataDescriptor*>(mpRaster->getDataDescriptor());
+   EncodingType encoding = mpDescriptor->getDataType();
+   if (encoding != INT1UBYTE && encoding != INT2UBYTES && encoding != INT2SBYTES && encoding != FLT4BYTES)
+   {
+      mProgress.report("Invalid data type, only 8-bit, 16-bit and float data are supported.", 0, ERRORS, true);
+      return false;
+   }
+
+   Filename* pFilename = pInArgList->getPlugInArgValue<Filename>("Output File");
+   if (pFilename == NULL || pFilename->getFullPathAndName().empty())
+   {
+      mProgress.report("No output file.", 0, ERRORS, true);
+      return false;
+   }
+   mFilename = pFilename->getFullPathAndName();
+   mExportFilename.clear();
+   Filename* pExportFilename = pInArgList->getPlugInArgValue<Filename>("Export File");
+   if (pExportFilename != NULL && !pExportFilename->getFullPathAndName().empty())
+   {
+      mExportFilename = pExportFilename->getFullPathAndName();
+      if (!TrackExporter::getFormat(mExportFilename, mExportFormat))
+      {
+         mProgress.report("Unknown export format for " + mExportFilename + ".", 0, ERRORS, true);
+         return false;
+      }
+   }
+
+   unsigned int bandCount = mpDescriptor->getBandCount();
+   mFirstFrame = 0;
+   mLastFrame = bandCount - 1;
+   pInArgList->getPlugInArgValue("First Frame", mFirstFrame);
+   pInArgList->getPlugInArgValue("Last Frame", mLastFrame);
+   if (bandCount < 2 || mFirstFrame >= mLastFrame || mLastFrame >= bandCount)
+   {
+      mProgress.report("Invalid frame range, at least two frames are needed.", 0, ERRORS, true);
+      return false;
+   }
+
+   int startColumn = 0;
+   int startRow = 0;
+   int endColumn = mpDescriptor->getColumnCount() - 1;
+   int endRow = mpDescriptor->getRowCount() - 1;
+   AoiElement* pAoi = pInArgList->getPlugInArgValue<AoiElement>("AOI");
+   if (pAoi != NULL)
+   {
+      int aoiStartColumn = 0;
+      int aoiStartRow = 0;
+      int aoiEndColumn = 0;
+      int aoiEndRow = 0;
+      pAoi->getSelectedPoints()->getMinimalBoundingBox(aoiStartColumn, aoiStartRow, aoiEndColumn, aoiEndRow);
+      startColumn = std::max(startColumn, aoiStartColumn);
+      startRow = std::max(startRow, aoiStartRow);
+      endColumn = std::min(endColumn, aoiEndColumn);
+      endRow = std::min(endRow, aoiEndRow);
+   }
+   if (endColumn < startColumn || endRow < startRow)
+   {
+      mProgress.report("The AOI does not overlap the frames.", 0, ERRORS, true);
+      return false;
+   }
+   mStartColumn = startColumn;
+   mStartRow = startRow;
+   mColumns = endColumn - startColumn + 1;
+   mRows = endRow - startRow + 1;
+
+   mParams = TrackingManager::getSettingParameters();
+   pInArgList->getPlugInArgValue("Track Window Size", mParams.mTrackWindow);
+   pInArgList->getPlugInArgValue("Gate Radius", mParams.mGateRadius);
+   pInArgList->getPlugInArgValue("Global Assignment", mParams.mGlobalAssignment);
+   pInArgList->getPlugInArgValue("Max Coast Frames", mParams.mMaxCoastFrames);
+   pInArgList->getPlugInArgValue("RANSAC Guided", mParams.mRansacGuided);
+   pInArgList->getPlugInArgValue("Object Threshold", mParams.mObjectThreshold);
+   std::string motionModel;
+   if (pInArgList->getPlugInArgValue("Motion Model", motionModel))
+   {
+      if (motionModel == "none")
+      {
+         mParams.mMotionModel = MOTION_NONE;
+      }
+      else if (motionModel == "constant velocity")
+      {
+         mParams.mMotionModel = MOTION_CONSTANT_VELOCITY;
+      }
+      else if (motionModel == "constant acceleration")
+      {
+         mParams.mMotionModel = MOTION_CONSTANT_ACCELERATION;
+      }
+      else
+      {
+         mProgress.report("Unknown motion model " + motionModel + ".", 0, ERRORS, true);
+         return false;
+      }
+   }
+   if (mParams.mTrackWindow < 2)
+   {
+      mProgress.report("The track window must be at least 2 frames.", 0, ERRORS, true);
+      return false;
+   }
+   // the file is the history so the pipeline only needs to hold one frame's worth of retired detections
+   mParams.mHistorySize = 0;
+   return true;
+}
+
+bool BatchTracking::readFrame(unsigned int frameNum, FrameSnapshot& frame)
+{
+   FactoryResource<DataRequest> req;
+   req->setRows(mpDescriptor->getActiveRow(mStartRow), mpDescriptor->getActiveRow(mStartRow + mRows - 1), mRows);
+   req->setColumns(mpDescriptor->getActiveColumn(mStartColumn),
+      mpDescriptor->getActiveColumn(mStartColumn + mColumns - 1), mColumns);
+   req->setBands(mpDescriptor->getActiveBand(frameNum), mpDescriptor->getActiveBand(frameNum), 1);
+   req->setInterleaveFormat(BSQ);
+   DataAccessor acc = mpRaster->getDataAccessor(req.release());
+   if (!acc.isValid())
+   {
+      return false;
+   }
+   int rowBytes = mColumns * mpDescriptor->getBytesPerElement();
+   frame.mFrameNum = frameNum;
+   frame.mWidth = mColumns;
+   frame.mHeight = mRows;
+   frame.mOrigin = Opticks::PixelLocation(mStartColumn, mStartRow);
+   switch (mpDescriptor->getDataType())
+   {
+   case INT2UBYTES:
+      frame.mDepth = IPL_DEPTH_16U;
+      break;
+   case INT2SBYTES:
+      frame.mDepth = IPL_DEPTH_16S;
+      break;
+   case FLT4BYTES:
+      frame.mDepth = IPL_DEPTH_32F;
+      break;
+   default:
+      frame.mDepth = IPL_DEPTH_8U;
+      break;
+   }
+   frame.mData.resize(rowBytes * mRows);
+   for (int row = 0; row < mRows; ++row)
+   {
+      if (row > 0)
+      {
+         acc->nextRow();
+         if (!acc.isValid())
+         {
+            return false;
+         }
+      }
+      memcpy(&frame.mData[row * rowBytes], acc->getRow(), rowBytes);
+   }
+   return true;
+}
+
+bool BatchTracking::writeHeader(QDataStream& stream)
+{
+   stream << sMagic << sVersion << static_cast<quint32>(mColumns) << static_cast<quint32>(mRows)
+          << static_cast<quint32>(mStartColumn) << static_cast<quint32>(mStartRow)
+          << static_cast<quint32>(mFirstFrame) << static_cast<quint32>(mLastFrame)
+          << static_cast<quint32>(mFrames.size()) << mDetectionCount << static_cast<quint32>(mTrackTable.size())
+          << mFrameTableOffset << mTrackTableOffset;
+   return stream.status() == QDataStream::Ok;
+}
+
+bool BatchTracking::writeDetections(QDataStream& stream, std::deque<TrackPoint>& points)
+{
+   for (std::deque<TrackPoint>::const_iterator point = points.begin(); point != points.end(); ++point)
+   {
+      stream << static_cast<quint32>(point->mTrackId) << static_cast<quint32>(point->mFrameNum)
+             << static_cast<float>(point->mCentroid.mX) << static_cast<float>(point->mCentroid.mY)
+             << point->mDispersion;
+      size_t frameIndex = static_cast<size_t>(point->mFrameNum - mFirstFrame);
+      if (frameIndex < mFrames.size())
+      {
+         mFrames[frameIndex].mDetections++;
+      }
+      TrackRecord& track = mTrackTable[point->mTrackId];
+      if (track.mDetections == 0)
+      {
+         track.mFirstFrame = point->mFrameNum;
+      }
+      track.mLastFrame = point->mFrameNum;
+      track.mDetections++;
+   }
+   mDetectionCount += points.size();
+   if (mExporter.isOpen() && !mExporter.append(points))
+   {
+      mProgress.report(mExporter.getError(), 0, ERRORS, true);
+      return false;
+   }
+   points.clear();
+   if (stream.status() != QDataStream::Ok)
+   {
+      mProgress.report("Unable to write " + mFilename + ".", 0, ERRORS, true);
+      return false;
+   }
+   return true;
+}
+
+bool BatchTracking::writeTables(QDataStream& stream)
+{
+   mFrameTableOffset = stream.device()->pos();
+   for (std::vector<FrameRecord>::const_iterator frame = mFrames.begin(); frame != mFrames.end(); ++frame)
+   {
+      stream << frame->mFrameNum << frame->mBaseFrameNum << static_cast<quint8>(frame->mRegistered) << frame->mDetections;
+   }
+   mTrackTableOffset = stream.device()->pos();
+   for (std::map<unsigned int, TrackRecord>::const_iterator track = mTrackTable.begin(); track != mTrackTable.end(); ++track)
+   {
+      stream << static_cast<quint32>(track->first) << track->second.mFirstFrame << track->second.mLastFrame
+             << track->second.mDetections;
+   }
+   return stream.status() == QDataStream::Ok;
+}
@@ -0,0 +1,108 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef BATCHTRACKING_H__
+#define BATCHTRACKING_H__
+
+#include "ExecutableShell.h"
+#include "ProgressTracker.h"
+#include "TrackExporter.h"
+#include "TrackingPipeline.h"
+#include <QtCore/QtGlobal>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+class QDataStream;
+class QFile;
+class RasterDataDescriptor;
+class RasterElement;
+
+/**
+ * Runs the tracking pipeline over a range of frames with no display and writes the results to a track file.
+ *
+ * Each band of the raster element is a frame. The frames are read and processed in order on the calling
+ * thread, so the run is limited only by how fast the data can be read and tracked.
+ *
+ * The track file is little endian:
+ *   - Header: magic "TRCK", version, tracked area columns, rows, first column and first row (active
+ *     numbers), first and last frame (active band numbers), frame count, detection count, track count,
+ *     frame table offset and track table offset. The counts and offsets are filled in when the run finishes.
+ *   - Detections, oldest frame first, 20 bytes each: track id, frame, column, row, dispersion. The position
+ *     is a float in tracked area pixels. Detections are written as they leave the pipeline's track window
+ *     so memory use doesn't grow with the sequence length.
+ *   - Frame table, 13 bytes per frame: frame, base frame (-1 for a reset), registered flag and detection count.
+ *   - Track table, 16 bytes per track: track id, first frame, last frame and detection count.
+ * All integers are 32-bit except the header's detection count and offsets, which are 64-bit.
+ *
+ * The detections may also be streamed to a CSV, GeoJSON or KML file with a TrackExporter.
+ */
+class BatchTracking : public ExecutableShell
+{
+public:
+   BatchTracking();
+   virtual ~BatchTracking();
+   virtual bool getInputSpecification(PlugInArgList*& pArgList);
+   virtual bool getOutputSpecification(PlugInArgList*& pArgList);
+   virtual bool execute(PlugInArgList* pInArgList, PlugInArgList* pOutArgList);
+
+private:
+   struct FrameRecord
+   {
+      FrameRecord() : mFrameNum(0), mBaseFrameNum(-1), mRegistered(false), mDetections(0) {}
+
+      quint32 mFrameNum;
+      qint32 mBaseFrameNum;
+      bool mRegistered;
+      quint32 mDetections;
+   };
+   struct TrackRecord
+   {
+      TrackRecord() : mFirstFrame(0), mLastFrame(0), mDetections(0) {}
+
+      quint32 mFirstFrame;
+      quint32 mLastFrame;
+      quint32 mDetections;
+   };
+
+   bool extractInputArgs(PlugInArgList* pInArgList);
+
+   /**
+    * Delete the track file and any unfinished export after an error or abort.
+    */
+   void discardOutput(QFile& file);
+   bool readFrame(unsigned int frameNum, FrameSnapshot& frame);
+   bool writeHeader(QDataStream& stream);
+   bool writeDetections(QDataStream& stream, std::deque<TrackPoint>& points);
+   bool writeTables(QDataStream& stream);
+
+   ProgressTracker mProgress;
+   RasterElement* mpRaster;
+   const RasterDataDescriptor* mpDescriptor;
+   std::string mFilename;
+   std::string mExportFilename;
+   TrackExporter::Format mExportFormat;
+   TrackExporter mExporter;
+   unsigned int mFirstFrame;
+   unsigned int mLastFrame;
+   int mStartColumn;
+   int mStartRow;
+   int mColumns;
+   int mRows;
+   TrackingParameters mParams;
+
+   std::vector<FrameRecord> mFrames; // indexed from mFirstFrame
+   std::map<unsigned int, TrackRecord> mTrackTable;
+   quint64 mDetectionCount;
+   quint64 mFrameTableOffset;
+   quint64 mTrackTableOffset;
+};
+
+#endif
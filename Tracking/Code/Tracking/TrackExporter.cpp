@@ -0,0 +1,259 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "DataVariant.h"
+#include "DynamicObject.h"
+#include "RasterDataDescriptor.h"
+#include "RasterElement.h"
+#include "TrackExporter.h"
+#include "VideoUtils.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+
+namespace
+{
+   QString formatTime(double seconds)
+   {
+      uint wholeSeconds = static_cast<uint>(seconds);
+      int msecs = static_cast<int>((seconds - wholeSeconds) * 1000.0 + 0.5);
+      return QDateTime::fromTime_t(wholeSeconds).toUTC().addMSecs(msecs).toString("yyyy-MM-ddThh:mm:ss.zzzZ");
+   }
+}
+
+TrackExporter::TrackExporter() :
+   mFormat(CSV),
+   mpRaster(NULL),
+   mGeoreferenced(false),
+   mFirstPoint(true)
+{
+}
+
+TrackExporter::~TrackExporter()
+{
+   close();
+}
+
+bool TrackExporter::getFormat(const std::string& filename, Format& format)
+{
+   QString suffix = QFileInfo(QString::fromStdString(filename)).suffix().toLower();
+   if (suffix == "csv")
+   {
+      format = CSV;
+   }
+   else if (suffix == "geojson" || suffix == "json")
+   {
+      format = GEOJSON;
+   }
+   else if (suffix == "kml")
+   {
+      format = KML;
+   }
+   else
+   {
+      return false;
+   }
+   return true;
+}
+
+bool TrackExporter::open(const std::string& filename, Format format, const RasterElement* pRaster)
+{
+   close();
+   mError.clear();
+   if (pRaster == NULL)
+   {
+      mError = "No raster element.";
+      return false;
+   }
+   mFormat = format;
+   mpRaster = pRaster;
+   mGeoreferenced = pRaster->isGeoreferenced();
+   if (mFormat == KML && !mGeoreferenced)
+   {
+      mError = "KML export needs a georeferenced data set.";
+      return false;
+   }
+   mFrameTimes.clear();
+   const RasterDataDescriptor* pDescriptor = static_cast<const RasterDataDescriptor*>(pRaster->getDataDescriptor());
+   const DynamicObject* pMetadata = pDescriptor->getMetadata();
+   if (pMetadata != NULL)
+   {
+      const std::vector<double>* pTimes =
+         dv_cast<std::vector<double> >(&pMetadata->getAttributeByPath(FRAME_TIMES_METADATA_PATH));
+      if (pTimes != NULL && pTimes->size() >= pDescriptor->getBandCount())
+      {
+         mFrameTimes = *pTimes;
+      }
+   }
+
+   mFile.setFileName(QString::fromStdString(filename));
+   if (!mFile.open(QFile::WriteOnly | QFile::Truncate | QFile::Text))
+   {
+      mError = "Unable to open " + filename + " for writing.";
+      return false;
+   }
+   mStream.setDevice(&mFile);
+   mStream.setCodec("UTF-8");
+   mFirstPoint = true;
+   if (!writeHeader())
+   {
+      mFile.close();
+      mFile.remove();
+      return false;
+   }
+   return true;
+}
+
+bool TrackExporter::append(const std::deque<TrackPoint>& points)
+{
+   if (!isOpen())
+   {
+      return false;
+   }
+   for (std::deque<TrackPoint>::const_iterator point = points.begin(); point != points.end(); ++point)
+   {
+      writePoint(*point);
+   }
+   mStream.flush();
+   return checkStatus();
+}
+
+bool TrackExporter::close()
+{
+   if (!isOpen())
+   {
+      return true;
+   }
+   switch (mFormat)
+   {
+   case GEOJSON:
+      mStream << "\n]}\n";
+      break;
+   case KML:
+      mStream << "</Document>\n</kml>\n";
+      break;
+   default:
+      break;
+   }
+   mStream.flush();
+   bool success = checkStatus();
+   mStream.setDevice(NULL);
+   mFile.close();
+   mpRaster = NULL;
+   return success;
+}
+
+void TrackExporter::discard()
+{
+   if (!isOpen())
+   {
+      return;
+   }
+   mStream.setDevice(NULL);
+   mFile.close();
+   mFile.remove();
+   mpRaster = NULL;
+}
+
+bool TrackExporter::isOpen() const
+{
+   return mFile.isOpen();
+}
+
+const std::string& TrackExporter::getError() const
+{
+   return mError;
+}
+
+bool TrackExporter::writeHeader()
+{
+   switch (mFormat)
+   {
+   case CSV:
+      mStream << "track,frame,time,column,row,latitude,longitude\n";
+      break;
+   case GEOJSON:
+      mStream << "{\"type\":\"FeatureCollection\",\"features\":[";
+      break;
+   case KML:
+      mStream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+              << "<kml xmlns=\"http://www.opengis.net/kml/2.2\">\n<Document>\n"
+              << "<name>" << QFileInfo(mFile).completeBaseName().replace('&', "&amp;").replace('<', "&lt;")
+              << "</name>\n";
+      break;
+   }
+   mStream.flush();
+   return checkStatus();
+}
+
+void TrackExporter::writePoint(const TrackPoint& point)
+{
+   QString time;
+   if (point.mFrameNum >= 0 && static_cast<size_t>(point.mFrameNum) < mFrameTimes.size())
+   {
+      time = formatTime(mFrameTimes[point.mFrameNum]);
+   }
+   QString column = QString::number(point.mPixel.mX, 'f', 2);
+   QString row = QString::number(point.mPixel.mY, 'f', 2);
+   QString latitude;
+   QString longitude;
+   if (mGeoreferenced)
+   {
+      // pixel centers are half a pixel from the pixel's corner coordinate
+      LocationType geo = mpRaster->convertPixelToGeocoord(LocationType(point.mPixel.mX + 0.5, point.mPixel.mY + 0.5));
+      latitude = QString::number(geo.mX, 'f', 7);
+      longitude = QString::number(geo.mY, 'f', 7);
+   }
+
+   switch (mFormat)
+   {
+   case CSV:
+      mStream << point.mTrackId << ',' << point.mFrameNum << ',' << time << ',' << column << ',' << row << ','
+              << latitude << ',' << longitude << '\n';
+      break;
+   case GEOJSON:
+      mStream << (mFirstPoint ? "\n" : ",\n") << "{\"type\":\"Feature\",\"geometry\":";
+      if (mGeoreferenced)
+      {
+         mStream << "{\"type\":\"Point\",\"coordinates\":[" << longitude << ',' << latitude << "]}";
+      }
+      else
+      {
+         mStream << "null";
+      }
+      mStream << ",\"properties\":{\"track\":" << point.mTrackId << ",\"frame\":" << point.mFrameNum;
+      if (!time.isEmpty())
+      {
+         mStream << ",\"time\":\"" << time << '"';
+      }
+      mStream << ",\"column\":" << column << ",\"row\":" << row << "}}";
+      break;
+   case KML:
+      mStream << "<Placemark><name>Track " << point.mTrackId << "</name>";
+      if (!time.isEmpty())
+      {
+         mStream << "<TimeStamp><when>" << time << "</when></TimeStamp>";
+      }
+      mStream << "<ExtendedData><Data name=\"track\"><value>" << point.mTrackId << "</value></Data>"
+              << "<Data name=\"frame\"><value>" << point.mFrameNum << "</value></Data></ExtendedData>"
+              << "<Point><coordinates>" << longitude << ',' << latitude << "</coordinates></Point></Placemark>\n";
+      break;
+   }
+   mFirstPoint = false;
+}
+
+bool TrackExporter::checkStatus()
+{
+   if (mStream.status() != QTextStream::Ok || mFile.error() != QFile::NoError)
+   {
+      mError = "Unable to write " + mFile.fileName().toStdString() + ".";
+      return false;
+   }
+   return true;
+}
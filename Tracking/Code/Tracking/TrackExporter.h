@@ -0,0 +1,99 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef TRACKEXPORTER_H__
+#define TRACKEXPORTER_H__
+
+#include "TrackingPipeline.h"
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+#include <deque>
+#include <string>
+#include <vector>
+
+class RasterElement;
+
+/**
+ * Streams retired track points to a CSV, GeoJSON or KML file.
+ *
+ * Each point is written with its track id, frame, time from the element's FrameTimes metadata, data set
+ * pixel position and latitude and longitude through the element's georeference. Points are appended and
+ * flushed as they arrive so a long run never holds its tracks in memory and the file can be read while
+ * tracking continues. The GeoJSON and KML closing tags are written by close().
+ */
+class TrackExporter
+{
+public:
+   enum Format
+   {
+      CSV,
+      GEOJSON,
+      KML
+   };
+
+   TrackExporter();
+   ~TrackExporter();
+
+   /**
+    * Pick a format from a file extension.
+    *
+    * @return False if the extension isn't .csv, .geojson, .json or .kml.
+    */
+   static bool getFormat(const std::string& filename, Format& format);
+
+   /**
+    * Create the file and write its header.
+    *
+    * @param filename
+    *        The file is replaced if it exists.
+    * @param format
+    *        The file format. KML needs a georeferenced element.
+    * @param pRaster
+    *        The tracked element. It must stay valid until close() is called.
+    * @return False if the file can't be written. The reason is available from getError().
+    */
+   bool open(const std::string& filename, Format format, const RasterElement* pRaster);
+
+   /**
+    * Write points to the end of the file.
+    */
+   bool append(const std::deque<TrackPoint>& points);
+
+   /**
+    * Finish the file.
+    */
+   bool close();
+
+   /**
+    * Close and delete an unfinished file.
+    */
+   void discard();
+
+   bool isOpen() const;
+   const std::string& getError() const;
+
+private:
+   TrackExporter(const TrackExporter&);
+   TrackExporter& operator=(const TrackExporter&);
+
+   bool writeHeader();
+   void writePoint(const TrackPoint& point);
+   bool checkStatus();
+
+   QFile mFile;
+   QTextStream mStream;
+   Format mFormat;
+   const RasterElement* mpRaster;
+   bool mGeoreferenced;
+   std::vector<double> mFrameTimes; // seconds since the epoch, indexed by active band number
+   bool mFirstPoint;
+   std::string mError;
+};
+
+#endif
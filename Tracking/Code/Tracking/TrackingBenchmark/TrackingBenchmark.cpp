@@ -0,0 +1,415 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+/**
+ * Standalone checks and benchmarks of the tracking pipeline on synthetic feeds.
+ *
+ *    grid     SpatialGrid::findWithin() against a brute force radius search, then the cost of gating
+ *             10k objects with the grid and by brute force
+ *    steady   per-frame buffer growth and C++ heap allocations once a feed reaches steady state
+ *    long     a long feed, checking the live track graph and the track history stay bounded and the
+ *             per-frame time stays flat
+ *    objects  per-frame time with 1k to 10k moving objects
+ *
+ * This is not part of the plug-in build. See the Makefile in this directory.
+ */
+
+#include "TrackingPipeline.h"
+#include "TrackingUtils.h"
+
+#include <algorithm>
+#include <math.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+namespace
+{
+// counts operator new calls while enabled so pipeline allocations can be told from the driver's own
+bool sCountAllocations = false;
+unsigned long sAllocations = 0;
+
+double now()
+{
+   return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+}
+
+double randomValue(double minValue, double maxValue)
+{
+   return minValue + (maxValue - minValue) * rand() / (static_cast<double>(RAND_MAX) + 1.0);
+}
+
+/**
+ * A static textured background with small bright objects moving in straight lines and bouncing
+ * off the edges. The texture gives optical flow corners to register on and the objects show up
+ * in the frame difference.
+ */
+class SyntheticFeed
+{
+public:
+   SyntheticFeed(int width, int height, unsigned int objectCount) :
+      mWidth(width),
+      mHeight(height),
+      mBackground(width * height),
+      mObjects(objectCount)
+   {
+      const int block = 8;
+      for (int row = 0; row < height; row += block)
+      {
+         for (int col = 0; col < width; col += block)
+         {
+            unsigned char level = static_cast<unsigned char>(randomValue(30.0, 110.0));
+            for (int y = row; y < std::min(height, row + block); y++)
+            {
+               memset(&mBackground[y * width + col], level, std::min(block, width - col));
+            }
+         }
+      }
+      for (std::vector<Object>::iterator object = mObjects.begin(); object != mObjects.end(); ++object)
+      {
+         object->mX = randomValue(sObjectSize, width - 2 * sObjectSize);
+         object->mY = randomValue(sObjectSize, height - 2 * sObjectSize);
+         double angle = randomValue(0.0, 6.283185307179586);
+         double speed = randomValue(1.0, 3.0);
+         object->mDx = speed * cos(angle);
+         object->mDy = speed * sin(angle);
+      }
+   }
+
+   /**
+    * Render the next frame into a snapshot, reusing its buffer.
+    */
+   void next(int frameNum, FrameSnapshot& frame)
+   {
+      frame.mFrameNum = frameNum;
+      frame.mWidth = mWidth;
+      frame.mHeight = mHeight;
+      frame.mDepth = IPL_DEPTH_8U;
+      frame.mOrigin = Opticks::PixelLocation(0, 0);
+      frame.mReset = (frameNum == 0);
+      frame.mGeneration = 0;
+      frame.mData.resize(mBackground.size());
+      std::copy(mBackground.begin(), mBackground.end(), frame.mData.begin());
+      for (std::vector<Object>::iterator object = mObjects.begin(); object != mObjects.end(); ++object)
+      {
+         if (frameNum > 0)
+         {
+            object->mX += object->mDx;
+            object->mY += object->mDy;
+            if (object->mX < 0.0 || object->mX > mWidth - sObjectSize)
+            {
+               object->mDx = -object->mDx;
+               object->mX = std::max(0.0, std::min<double>(mWidth - sObjectSize, object->mX));
+            }
+            if (object->mY < 0.0 || object->mY > mHeight - sObjectSize)
+            {
+               object->mDy = -object->mDy;
+               object->mY = std::max(0.0, std::min<double>(mHeight - sObjectSize, object->mY));
+            }
+         }
+         int col = static_cast<int>(object->mX);
+         int row = static_cast<int>(object->mY);
+         for (int y = row; y < row + sObjectSize; y++)
+         {
+            memset(&frame.mData[y * mWidth + col], 250, sObjectSize);
+         }
+      }
+   }
+
+private:
+   struct Object
+   {
+      double mX;
+      double mY;
+      double mDx;
+      double mDy;
+   };
+   static const int sObjectSize = 3;
+
+   int mWidth;
+   int mHeight;
+   std::vector<unsigned char> mBackground;
+   std::vector<Object> mObjects;
+};
+
+/**
+ * Run a feed through a pipeline the way BatchTracking does.
+ */
+class FeedRun
+{
+public:
+   FeedRun(int width, int height, unsigned int objectCount, const TrackingParameters& params, bool drainHistory) :
+      mFeed(width, height, objectCount),
+      mDrainHistory(drainHistory),
+      mFrameNum(0)
+   {
+      mPipeline.setParameters(params);
+   }
+
+   /**
+    * @return The time the pipeline took in seconds.
+    */
+   double step()
+   {
+      mFeed.next(mFrameNum++, mFrame);
+      double start = now();
+      sCountAllocations = true;
+      mPipeline.process(mFrame, mUpdate);
+      sCountAllocations = false;
+      double elapsed = now() - start;
+      if (!mUpdate.mError.empty())
+      {
+         printf("   frame %d: %s\n", mUpdate.mFrameNum, mUpdate.mError.c_str());
+      }
+      if (mDrainHistory)
+      {
+         mRetired.clear();
+         mPipeline.takeTrackHistory(mRetired);
+      }
+      return elapsed;
+   }
+
+   TrackingPipeline& getPipeline()
+   {
+      return mPipeline;
+   }
+
+private:
+   SyntheticFeed mFeed;
+   TrackingPipeline mPipeline;
+   FrameSnapshot mFrame;
+   TrackUpdate mUpdate;
+   std::deque<TrackPoint> mRetired;
+   bool mDrainHistory;
+   int mFrameNum;
+};
+
+bool checkGrid()
+{
+   printf("SpatialGrid against brute force\n");
+   bool success = true;
+   SpatialGrid grid;
+   std::vector<LocationType> points;
+   std::vector<unsigned int> found;
+   std::vector<unsigned int> expected;
+   unsigned int queries = 0;
+   for (unsigned int trial = 0; trial < 200; trial++)
+   {
+      // vary the density, the extent and the cell size against the query radius, including
+      // points on a lattice so some lie exactly on cell edges and at the query radius
+      unsigned int count = static_cast<unsigned int>(randomValue(0.0, 2000.0));
+      double extent = randomValue(1.0, 5000.0);
+      bool lattice = (trial % 4 == 0);
+      points.resize(count);
+      for (unsigned int idx = 0; idx < count; idx++)
+      {
+         points[idx] = lattice ? LocationType(floor(randomValue(0.0, 64.0)) * 4.0, floor(randomValue(0.0, 64.0)) * 4.0) :
+            LocationType(randomValue(-extent, extent), randomValue(-extent, extent));
+      }
+      double cellSize = lattice ? 4.0 : randomValue(0.5, extent / 4.0 + 1.0);
+      grid.build(points, cellSize);
+      for (unsigned int query = 0; query < 50; query++, queries++)
+      {
+         LocationType center = lattice ? LocationType(floor(randomValue(0.0, 64.0)) * 4.0, 0.0) :
+            LocationType(randomValue(-1.2 * extent, 1.2 * extent), randomValue(-1.2 * extent, 1.2 * extent));
+         double radius = lattice ? 4.0 * floor(randomValue(0.0, 5.0)) : randomValue(0.0, extent / 2.0);
+         grid.findWithin(center, radius, found);
+         expected.clear();
+         for (unsigned int idx = 0; idx < count; idx++)
+         {
+            double dx = points[idx].mX - center.mX;
+            double dy = points[idx].mY - center.mY;
+            if (dx * dx + dy * dy < radius * radius)
+            {
+               expected.push_back(idx);
+            }
+         }
+         if (found != expected)
+         {
+            printf("   trial %u: %u points, cell %.2f, radius %.2f at (%.2f, %.2f): %u found, %u expected\n",
+               trial, count, cellSize, radius, center.mX, center.mY, static_cast<unsigned int>(found.size()),
+               static_cast<unsigned int>(expected.size()));
+            success = false;
+         }
+      }
+   }
+   printf("   %u queries %s\n", queries, success ? "match" : "DIFFER");
+
+   // gating cost at the 10k object scale the association sees, 150 pixel gates over a wide area
+   const unsigned int objectCount = 10000;
+   const double gate = 150.0;
+   points.resize(objectCount);
+   for (unsigned int idx = 0; idx < objectCount; idx++)
+   {
+      points[idx] = LocationType(randomValue(0.0, 20000.0), randomValue(0.0, 20000.0));
+   }
+   unsigned long gridPairs = 0;
+   double start = now();
+   grid.build(points, gate);
+   for (unsigned int idx = 0; idx < objectCount; idx++)
+   {
+      grid.findWithin(points[idx], gate, found);
+      gridPairs += found.size();
+   }
+   double gridTime = now() - start;
+   unsigned long brutePairs = 0;
+   start = now();
+   for (unsigned int idx = 0; idx < objectCount; idx++)
+   {
+      for (unsigned int other = 0; other < objectCount; other++)
+      {
+         double dx = points[other].mX - points[idx].mX;
+         double dy = points[other].mY - points[idx].mY;
+         if (dx * dx + dy * dy < gate * gate)
+         {
+            brutePairs++;
+         }
+      }
+   }
+   double bruteTime = now() - start;
+   printf("   %u objects: grid %.2f ms, brute force %.2f ms, %lu gated pairs%s\n", objectCount, 1e3 * gridTime,
+      1e3 * bruteTime, gridPairs, gridPairs == brutePairs ? "" : " DIFFER");
+   return success && gridPairs == brutePairs;
+}
+
+bool checkSteadyState()
+{
+   printf("Steady state buffers, 512x512 feed with 50 objects\n");
+   TrackingParameters params;
+   FeedRun run(512, 512, 50, params, true);
+   const unsigned int warmup = 200;
+   const unsigned int measured = 500;
+   for (unsigned int frame = 0; frame < warmup; frame++)
+   {
+      run.step();
+   }
+   unsigned int growths = run.getPipeline().getBufferGrowthCount();
+   sAllocations = 0;
+   double elapsed = 0.0;
+   for (unsigned int frame = 0; frame < measured; frame++)
+   {
+      elapsed += run.step();
+   }
+   unsigned int newGrowths = run.getPipeline().getBufferGrowthCount() - growths;
+   printf("   %u buffer growths in the first %u frames, %u in the next %u\n", growths, warmup, newGrowths, measured);
+   printf("   %.2f C++ heap allocations and %.2f ms per frame in steady state\n",
+      static_cast<double>(sAllocations) / measured, 1e3 * elapsed / measured);
+   return newGrowths == 0;
+}
+
+bool checkLongFeed()
+{
+   const unsigned int frames = 20000;
+   const unsigned int objectCount = 40;
+   printf("Long feed, %u frames of 256x256 with %u objects\n", frames, objectCount);
+   TrackingParameters params;
+   params.mTrackWindow = 30;
+   params.mHistorySize = 5000;
+   // the history is left in the pipeline so its cap is exercised
+   FeedRun run(256, 256, objectCount, params, false);
+   bool success = true;
+   size_t maxLive = 0;
+   size_t maxHistory = 0;
+   const unsigned int segments = 10;
+   std::vector<double> segmentTimes(segments, 0.0);
+   for (unsigned int frame = 0; frame < frames; frame++)
+   {
+      segmentTimes[frame * segments / frames] += run.step();
+      size_t live = boost::num_vertices(run.getPipeline().getTracks());
+      maxLive = std::max(maxLive, live);
+      maxHistory = std::max(maxHistory, run.getPipeline().getTrackHistory().size());
+   }
+
+   // each object can leave a difference blob at its old and new position, allow for splits
+   size_t liveBound = (params.mTrackWindow + 1) * objectCount * 4;
+   printf("   at most %u live vertices (bound %u), at most %u retired detections kept (cap %u)\n",
+      static_cast<unsigned int>(maxLive), static_cast<unsigned int>(liveBound),
+      static_cast<unsigned int>(maxHistory), params.mHistorySize);
+   success = success && maxLive <= liveBound && maxHistory > 0 && maxHistory <= params.mHistorySize;
+
+   printf("   ms per frame by tenth of the feed:");
+   for (unsigned int segment = 0; segment < segments; segment++)
+   {
+      printf(" %.2f", 1e3 * segmentTimes[segment] / (frames / segments));
+   }
+   printf("\n");
+   // the last tenth should cost no more than the second, allowing for timer noise
+   bool flat = segmentTimes[segments - 1] <= 1.5 * segmentTimes[1];
+   printf("   per-frame time %s\n", flat ? "flat" : "GROWS");
+   return success && flat;
+}
+
+void benchmarkObjects()
+{
+   printf("Objects per frame, 2048x2048 feed, 100 frames each\n");
+   const unsigned int counts[] = { 1000, 2500, 5000, 10000 };
+   for (unsigned int idx = 0; idx < sizeof(counts) / sizeof(counts[0]); idx++)
+   {
+      TrackingParameters params;
+      params.mGateRadius = 10.0;
+      FeedRun run(2048, 2048, counts[idx], params, true);
+      run.step();
+      double elapsed = 0.0;
+      const unsigned int frames = 100;
+      for (unsigned int frame = 0; frame < frames; frame++)
+      {
+         elapsed += run.step();
+      }
+      printf("   %5u objects: %.1f ms per frame\n", counts[idx], 1e3 * elapsed / frames);
+   }
+}
+}
+
+void* operator new(size_t size) throw(std::bad_alloc)
+{
+   if (sCountAllocations)
+   {
+      sAllocations++;
+   }
+   void* pMemory = malloc(size == 0 ? 1 : size);
+   if (pMemory == NULL)
+   {
+      throw std::bad_alloc();
+   }
+   return pMemory;
+}
+
+void operator delete(void* pMemory) throw()
+{
+   free(pMemory);
+}
+
+int main(int argc, char** argv)
+{
+   srand(1);
+   std::string mode = (argc > 1) ? argv[1] : "";
+   bool success = true;
+   if (mode.empty() || mode == "grid")
+   {
+      success = checkGrid() && success;
+   }
+   if (mode.empty() || mode == "steady")
+   {
+      success = checkSteadyState() && success;
+   }
+   if (mode.empty() || mode == "long")
+   {
+      success = checkLongFeed() && success;
+   }
+   if (mode.empty() || mode == "objects")
+   {
+      benchmarkObjects();
+   }
+   printf(success ? "PASSED\n" : "FAILED\n");
+   return success ? 0 : 1;
+}
@@ -33,62 +33,32 @@
 #include "ThresholdLayer.h"
 #include "TrackingManager.h"
 #include "TrackingUtils.h"
-#include <opencv/cv.h>
-#include <BlobResult.h>
-#include <map>
-#include <set>
-#include <time.h>
+#include <string.h>
 #include <vector>
-#include <QtCore/QtDebug>
-#include <opencv/highgui.h>
 
 REGISTER_PLUGIN_BASIC(Tracking, TrackingManager);
 
-#define SQR(x) ((x) * (x))
-
 // Define this to generate an annotation layer showing the optical flow vectors
 // This will slow down processing quite a bit.
 #define SHOW_FLOW_VECTORS
 
-// Define this to calculate connected components on the object results
-#define CONNECTED
-
-// Define the threshold for locating objects
-#define OBJECT_THRESHOLD 15
-
-// Maximum number of corners to use when calculating optical flow.
-// Higher numbers may result in more accurate calculations but may also slow down calculations.
-// There's a point where increasing this number does nothing as there are only so many strong corners in a frame.
-#define MAX_CORNERS 500
-
-// Maximum change in location allowed before a track is considered...lower values shrink the possible search space for matching objects
-#define MAX_SPEED 150
-
-namespace
-{
-static const int CodeDeltas[8][2] =
-{ {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1} };
-}
-
 const char* TrackingManager::spPlugInName("TrackingManager");
 
 TrackingManager::TrackingManager() :
-      mCalcBaseObjects(true),
+      mGeneration(0),
+      mExportGeneration(0),
       mPaused(false),
       mpDesc(NULL),
       mpElement(NULL),
-      mBaseFrameNum(-1),
-      mBaseAcc(NULL, NULL),
-      mpBaseCorners(new CvPoint2D32f[MAX_CORNERS]),
-      mCurrentFrameNum(-1),
       mpGroup(NULL),
       mpTracks(NULL),
-      mCornerCount(MAX_CORNERS),
       mpRes(NULL),
-      mpRes2(NULL)
+      mpRes2(NULL),
+      mpFocus(NULL)
 {
    mpAnimation.addSignal(SIGNAL_NAME(Animation, FrameChanged), Slot(this, &TrackingManager::processFrame));
    mpLayer.addSignal(SIGNAL_NAME(Subject, Deleted), Slot(this, &TrackingManager::clearData));
+   VERIFYNR(connect(&mWorker, SIGNAL(updateReady()), this, SLOT(applyUpdates()), Qt::QueuedConnection));
    setName(spPlugInName);
    setDescriptorId("{c5f096e1-1584-4d7c-aa6f-29c4e422aad1}");
    setType("Manager");
@@ -103,7 +73,7 @@ TrackingManager::TrackingManager() :
 
 TrackingManager::~TrackingManager()
 {
-   mpBaseFrame.reset(NULL);
+   finishExport();
 }
 
 bool TrackingManager::getInputSpecification(PlugInArgList*& pArgList)
@@ -127,10 +97,6 @@ void TrackingManager::setTrackedLayer(RasterLayer* pLayer)
 {
    mpLayer.reset(pLayer);
    mpAnimation.reset((pLayer == NULL) ? NULL : pLayer->getAnimation());
-   mpBasePyramid.reset(NULL);
-   mpBaseCorners.reset(NULL);
-   mpBaseFrame.reset(NULL);
-   mBaseAcc = DataAccessor(NULL, NULL);
    initializeDataset();
 }
 
@@ -165,205 +131,212 @@ void TrackingManager::setFocus(LocationType loc, int maxSize)
 
 void TrackingManager::processFrame(Subject& subject, const std::string& signal, const boost::any& val)
 {
-   if (mPaused)
+   if (mPaused || mpElement == NULL)
    {
       return;
    }
    VERIFYNRV(mpLayer.get());
-   try
+   if (readFrame(mpAnimation->getCurrentFrame()->mFrameNumber, mFrame))
    {
-      unsigned int curFrame = mpAnimation->getCurrentFrame()->mFrameNumber;
-      mCurrentFrameNum = curFrame;
-      int width = (*mpBaseFrame).width;
-      int height = (*mpBaseFrame).height;
-      bool fullScene = (width == mpDesc->getColumnCount() && height == mpDesc->getRowCount());
+      mWorker.submit(mFrame);
+   }
+}
 
-      FactoryResource<DataRequest> req;
-      if (!fullScene)
-      {
-         req->setRows(mpDesc->getActiveRow(mMinBb.mY), mpDesc->getActiveRow(mMaxBb.mY), height);
-         req->setColumns(mpDesc->getActiveColumn(mMinBb.mX), mpDesc->getActiveColumn(mMaxBb.mX), width);
-      }
-      req->setBands(mpDesc->getActiveBand(curFrame), mpDesc->getActiveBand(curFrame), 1);
-      req->setInterleaveFormat(BSQ);
-      DataAccessor curAcc = mpElement->getDataAccessor(req.release());
+void TrackingManager::clearData(Subject& subject, const std::string& signal, const boost::any& val)
+{
+   setTrackedLayer(NULL);
+}
 
-      if (!curAcc.isValid())
+bool TrackingManager::readFrame(unsigned int frameNum, FrameSnapshot& frame)
+{
+   int width = mMaxBb.mX - mMinBb.mX + 1;
+   int height = mMaxBb.mY - mMinBb.mY + 1;
+   FactoryResource<DataRequest> req;
+   req->setRows(mpDesc->getActiveRow(mMinBb.mY), mpDesc->getActiveRow(mMaxBb.mY), height);
+   req->setColumns(mpDesc->getActiveColumn(mMinBb.mX), mpDesc->getActiveColumn(mMaxBb.mX), width);
+   req->setBands(mpDesc->getActiveBand(frameNum), mpDesc->getActiveBand(frameNum), 1);
+   req->setInterleaveFormat(BSQ);
+   DataAccessor acc = mpElement->getDataAccessor(req.release());
+   if (!acc.isValid())
+   {
+      return false;
+   }
+   int rowBytes = width * mpDesc->getBytesPerElement();
+   frame.mFrameNum = frameNum;
+   frame.mWidth = width;
+   frame.mHeight = height;
+   frame.mOrigin = mMinBb;
+   frame.mReset = false;
+   switch (mpDesc->getDataType())
+   {
+   case INT2UBYTES:
+      frame.mDepth = IPL_DEPTH_16U;
+      break;
+   case INT2SBYTES:
+      frame.mDepth = IPL_DEPTH_16S;
+      break;
+   case FLT4BYTES:
+      frame.mDepth = IPL_DEPTH_32F;
+      break;
+   default:
+      frame.mDepth = IPL_DEPTH_8U;
+      break;
+   }
+   frame.mGeneration = mGeneration;
+   frame.mData.resize(rowBytes * height);
+   for (int row = 0; row < height; ++row)
+   {
+      if (row > 0)
       {
-         return;
+         acc->nextRow();
+         VERIFY(acc.isValid());
       }
-      IplImageResource pCurFrame(NULL);
-      if (fullScene)
+      memcpy(&frame.mData[row * rowBytes], acc->getRow(), rowBytes);
+   }
+   return true;
+}
+
+void TrackingManager::writeFrame(unsigned int frameNum, const std::vector<unsigned char>& data)
+{
+   int width = mMaxBb.mX - mMinBb.mX + 1;
+   int height = mMaxBb.mY - mMinBb.mY + 1;
+   int rowBytes = width * mpDesc->getBytesPerElement();
+   VERIFYNRV(data.size() == static_cast<size_t>(rowBytes * height));
+   FactoryResource<DataRequest> req;
+   req->setRows(mpDesc->getActiveRow(mMinBb.mY), mpDesc->getActiveRow(mMaxBb.mY), height);
+   req->setColumns(mpDesc->getActiveColumn(mMinBb.mX), mpDesc->getActiveColumn(mMaxBb.mX), width);
+   req->setBands(mpDesc->getActiveBand(frameNum), mpDesc->getActiveBand(frameNum), 1);
+   req->setInterleaveFormat(BSQ);
+   req->setWritable(true);
+   DataAccessor acc = mpElement->getDataAccessor(req.release());
+   VERIFYNRV(acc.isValid());
+   for (int row = 0; row < height; ++row)
+   {
+      if (row > 0)
       {
-         pCurFrame = IplImageResource(width, height, 8, 1, reinterpret_cast<char*>(curAcc->getColumn()));
+         acc->nextRow();
+         VERIFYNRV(acc.isValid());
       }
-      else
+      memcpy(acc->getRow(), &data[row * rowBytes], rowBytes);
+   }
+}
+
+void TrackingManager::applyUpdates()
+{
+   while (mWorker.takeUpdate(mUpdate))
+   {
+      exportPoints(mUpdate.mRetired);
+      if (mUpdate.mGeneration == mGeneration && mpElement != NULL)
       {
-         pCurFrame = IplImageResource(width, height, 8, 1);
-         for (int row = 0; row < height; ++row)
-         {
-            if (row > 0)
-            {
-               curAcc->nextRow();
-               VERIFYNRV(curAcc.isValid());
-            }
-            memcpy((*pCurFrame).imageData + (row * width), curAcc->getRow(), (*pCurFrame).width);
-         }
+         applyUpdate(mUpdate);
       }
-      CvSize pyr_sz = cvSize((*mpBaseFrame).width + 8, (*mpBaseFrame).height / 3);
-      IplImageResource pCurPyramid(pyr_sz.width, pyr_sz.height, IPL_DEPTH_32F, 1);
-      std::auto_ptr<CvPoint2D32f> pCurCorners(new CvPoint2D32f[MAX_CORNERS]);
-      cvCalcOpticalFlowPyrLK(mpBaseFrame, pCurFrame, mpBasePyramid, pCurPyramid, mpBaseCorners.get(), pCurCorners.get(), mCornerCount,
-         cvSize(10,10), 5, mpFeaturesFound, mpFeatureErrors, cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS, 20, 0.3), 0);
+   }
+}
 
-      // display flow vectors in an annotation layer
-      std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> > corr;
+void TrackingManager::openExport()
+{
+   std::string filename = TrackingManager::getSettingExportFile();
+   if (filename.empty() || mpElement == NULL)
+   {
+      return;
+   }
+   TrackExporter::Format format;
+   if (!TrackExporter::getFormat(filename, format))
+   {
+      Service<DesktopServices>()->showMessageBox("Track Export", "Unknown export format for " + filename + ".");
+      return;
+   }
+   mExportGeneration = mGeneration;
+   if (!mExporter.open(filename, format, mpElement))
+   {
+      Service<DesktopServices>()->showMessageBox("Track Export", mExporter.getError());
+   }
+}
 
-      if (mpGroup != NULL)
+void TrackingManager::exportPoints(const std::deque<TrackPoint>& points)
+{
+   if (!mExporter.isOpen() || points.empty())
+   {
+      return;
+   }
+   std::deque<TrackPoint> current;
+   for (std::deque<TrackPoint>::const_iterator point = points.begin(); point != points.end(); ++point)
+   {
+      if (point->mGeneration >= mExportGeneration)
       {
-         mpGroup->removeAllObjects(true);
+         current.push_back(*point);
       }
-      for (int i = 0; i < mCornerCount; ++i)
+   }
+   if (!mExporter.append(current))
+   {
+      // stop exporting rather than reporting the same error every frame
+      std::string error = mExporter.getError();
+      mExporter.close();
+      Service<DesktopServices>()->showMessageBox("Track Export", error);
+   }
+}
+
+void TrackingManager::finishExport()
+{
+   std::deque<TrackPoint> retired;
+   mWorker.finish(retired);
+   exportPoints(retired);
+   mExporter.close();
+}
+
+void TrackingManager::applyUpdate(const TrackUpdate& update)
+{
+   if (!update.mError.empty())
+   {
+      Service<DesktopServices>()->showMessageBox("Tracking Error", update.mError);
+      return;
+   }
+   if (!update.mRegistered)
+   {
+      return;
+   }
+
+   // display flow vectors in an annotation layer
+   if (mpGroup != NULL)
+   {
+      mpGroup->removeAllObjects(true);
+      for (std::vector<std::pair<LocationType, LocationType> >::const_iterator vec = update.mFlowVectors.begin();
+         vec != update.mFlowVectors.end(); ++vec)
       {
-         if (mpFeaturesFound[i] == 0 || mpFeatureErrors[i] > 550)
-         {
-            continue;
-         }
-         if (mpGroup != NULL)
-         {
-            GraphicObject* pObj = mpGroup->addObject(ARROW_OBJECT);
-            pObj->setBoundingBox(LocationType(mpBaseCorners.get()[i].x, mpBaseCorners.get()[i].y),
-               LocationType(pCurCorners.get()[i].x, pCurCorners.get()[i].y));
-         }
-         corr.push_back(std::make_pair(mpBaseCorners.get()[i], pCurCorners.get()[i]));
+         mpGroup->addObject(ARROW_OBJECT)->setBoundingBox(vec->first, vec->second);
       }
-      srand((unsigned int)time(NULL));
-      CvMat* pMapMatrix = TrackingUtils::ransac_affine(corr, 15, 5.0f, 5);
-      if (pMapMatrix != NULL)
+   }
+   if (mpTracks != NULL)
+   {
+      mpTracks->removeAllObjects(true);
+      for (std::vector<std::pair<LocationType, LocationType> >::const_iterator seg = update.mTrackSegments.begin();
+         seg != update.mTrackSegments.end(); ++seg)
       {
-         IplImageResource pXform(width, height, 8, 1);
-         IplImageResource pTemp(width, height, 8, 1);
-         IplImageResource pRes(width, height, 8, 1, reinterpret_cast<char*>(mpRes->getRawData()));
-         IplImageResource pRes2(width, height, 8, 1, reinterpret_cast<char*>(mpRes2->getRawData()));
-         cvCopy(pCurFrame, pXform); // initialize to the current frame so any "offsets" have a consistent background
-         cvWarpAffine(mpBaseFrame, pXform, pMapMatrix, CV_INTER_LINEAR); // warp the base frame to the current camera position
-         cvCopy(pXform, mpBaseFrame); // copy the transformed base frame back to the raster element
-         cvSmooth(pXform, pRes, CV_MEDIAN, 5, 5); // smooth the base frame to remove high frequency noise
-         cvSmooth(pCurFrame, pTemp, CV_MEDIAN, 5, 5); // smooth the current frame to remove high frequency noise
-
-         // threhold the results
-         cvThreshold(pCurFrame, pTemp, OBJECT_THRESHOLD, 255, CV_THRESH_BINARY); // threshold the current frame
-         cvThreshold(pXform, pRes, OBJECT_THRESHOLD, 255, CV_THRESH_BINARY); // threshold the base frame
-         // erode to remove some noise
-         cvErode(pTemp, pTemp); // erode the current frame
-         cvErode(pRes,pRes); // erode the base frame
-         // difference the frames
-         cvSub(pTemp, pRes, pRes2); // subtract the base from the current and store in res2
-         cvSub(pRes, pTemp, pRes);  // subtract the current from the base and store in res
-         // remove final small differences with an open
-         cvErode(pRes,pRes, NULL, 3); // open the current frame
-         cvDilate(pRes,pRes,NULL,3);
-
-         cvErode(pRes2,pRes2, NULL, 3); // open the base frame
-         cvDilate(pRes2,pRes2,NULL,3);
-
-         std::vector<TrackVertex> curObjs;
-         { // scope blobs
-            CBlobResult blobs(pRes, NULL, 0);
-#ifdef CONNECTED
-            for (int bidx = 0; bidx < blobs.GetNumBlobs(); ++bidx)
-            {
-               CBlob blob(blobs.GetBlob(bidx));
-               blob.FillBlob(pRes, CV_RGB(bidx+1,bidx+1,bidx+1));
-            }
-#endif
-            curObjs = updateTrackObjects(blobs, pCurFrame, true);
-         } // scope blobs
-         { // scope blobs
-            CBlobResult blobs(pRes2, NULL, 0);
-#ifdef CONNECTED
-            for (int bidx = 0; bidx < blobs.GetNumBlobs(); ++bidx)
-            {
-               CBlob blob(blobs.GetBlob(bidx));
-               blob.FillBlob(pRes2, CV_RGB(bidx+1,bidx+1,bidx+1));
-            }
-#endif
-            if (mCalcBaseObjects)
-            {
-               mBaseObjects = updateTrackObjects(blobs, mpBaseFrame, false);
-            }
-            else
-            {
-               // apply affine transform to the coords
-               for (size_t idx = 0; idx < mBaseObjects.size(); ++idx)
-               {
-                  mTracks[mBaseObjects[idx]].mCentroidB.mX =
-                     (mTracks[mBaseObjects[idx]].mCentroidA.mX * cvGetReal2D(pMapMatrix, 0, 0)) +
-                     (mTracks[mBaseObjects[idx]].mCentroidA.mY * cvGetReal2D(pMapMatrix, 0, 1)) +
-                     cvGetReal2D(pMapMatrix, 0, 2);
-                  mTracks[mBaseObjects[idx]].mCentroidB.mY =
-                     (mTracks[mBaseObjects[idx]].mCentroidA.mX * cvGetReal2D(pMapMatrix, 1, 0)) +
-                     (mTracks[mBaseObjects[idx]].mCentroidA.mY * cvGetReal2D(pMapMatrix, 1, 1)) +
-                     cvGetReal2D(pMapMatrix, 1, 2);
-               }
-            }
-         } // scope blobs
-         matchTracks(curObjs);
-
-         if (!fullScene)
-         {
-            mBaseAcc->toPixel(mMinBb.mY, mMinBb.mX);
-            VERIFYNRV(mBaseAcc.isValid());
-            for (int row = 0; row < height; ++row)
-            {
-               if (row > 0)
-               {
-                  mBaseAcc->nextRow();
-                  VERIFYNRV(mBaseAcc.isValid());
-               }
-               memcpy(mBaseAcc->getRow(), (*mpBaseFrame).imageData + (row * width), (*mpBaseFrame).width);
-            }
-         }
-         mpElement->updateData();
-         if (mpRes != NULL)
-         {
-            mpRes->updateData();
-         }
-         if (mpRes2 != NULL)
-         {
-            mpRes2->updateData();
-         }
-
-         cvReleaseMat(&pMapMatrix);
-         mBaseObjects = curObjs;
+         mpTracks->addObject(LINE_OBJECT)->setBoundingBox(seg->first, seg->second);
       }
+   }
 
-      // prep for next frame
-      mpBasePyramid = pCurPyramid;
-      mpBaseCorners.reset(pCurCorners.release());
-      mpBaseFrame = pCurFrame;
-      mBaseAcc = curAcc;
-      mBaseFrameNum = mCurrentFrameNum;
-
-      mCornerCount = MAX_CORNERS;
-      cvGoodFeaturesToTrack(mpBaseFrame, mpEigImage, mpTmpImage, mpBaseCorners.get(), &mCornerCount, 0.01, 5.0);
-      cvFindCornerSubPix(mpBaseFrame, mpBaseCorners.get(), mCornerCount, cvSize(10, 10), cvSize(-1, -1), cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS, 20, 0.03));
-
-      mCalcBaseObjects = false;
+   // copy the transformed base frame back to the raster element
+   writeFrame(update.mBaseFrameNum, update.mWarpedBase);
+   mpElement->updateData();
+   if (mpRes != NULL && !update.mCurrentObjects.empty())
+   {
+      memcpy(mpRes->getRawData(), &update.mCurrentObjects.front(), update.mCurrentObjects.size());
+      mpRes->updateData();
    }
-   catch (cv::Exception& err)
+   if (mpRes2 != NULL && !update.mBaseObjects.empty())
    {
-      Service<DesktopServices>()->showMessageBox("OpenCV Error", err.err + "\n" + err.file + ":" + StringUtilities::toDisplayString(err.line) + "\n" + err.func);
+      memcpy(mpRes2->getRawData(), &update.mBaseObjects.front(), update.mBaseObjects.size());
+      mpRes2->updateData();
    }
 }
 
-void TrackingManager::clearData(Subject& subject, const std::string& signal, const boost::any& val)
-{
-   setTrackedLayer(NULL);
-}
-
 void TrackingManager::initializeDataset()
 {
+   // finish the previous data set's export and drop its work
+   finishExport();
+   mWorker.start();
+   mGeneration++;
    if (mpLayer.get() == NULL)
    {
       mpElement = NULL;
@@ -372,9 +345,10 @@ void TrackingManager::initializeDataset()
    }
    VERIFYNRV(mpElement = static_cast<RasterElement*>(mpLayer->getDataElement()));
    VERIFYNRV(mpDesc = static_cast<RasterDataDescriptor*>(mpElement->getDataDescriptor()));
-   if (mpDesc->getBytesPerElement() != 1)
+   EncodingType encoding = mpDesc->getDataType();
+   if (encoding != INT1UBYTE && encoding != INT2UBYTES && encoding != INT2SBYTES && encoding != FLT4BYTES)
    {
-      // only 8-bit supported right now
+      // unsigned 8-bit, 16-bit and float are supported right now
       mpElement = NULL;
       mpDesc = NULL;
       return;
@@ -426,302 +400,105 @@ void TrackingManager::initializeDataset()
    mMinBb = Opticks::PixelLocation(0, 0);
    mMaxBb = Opticks::PixelLocation(mpDesc->getColumnCount()-1, mpDesc->getRowCount()-1);
 
+   openExport();
    initializeFrame0();
 }
 
+TrackingParameters TrackingManager::getSettingParameters()
+{
+   TrackingParameters params;
+   params.mTrackWindow = TrackingManager::getSettingTrackWindowSize();
+   params.mGateRadius = TrackingManager::getSettingGateRadius();
+   params.mGlobalAssignment = TrackingManager::getSettingGlobalAssignment();
+   params.mUnassignedCost = TrackingManager::getSettingUnassignedCost();
+   std::string motionModel = TrackingManager::getSettingMotionModel();
+   if (motionModel == "constant velocity")
+   {
+      params.mMotionModel = MOTION_CONSTANT_VELOCITY;
+   }
+   else if (motionModel == "constant acceleration")
+   {
+      params.mMotionModel = MOTION_CONSTANT_ACCELERATION;
+   }
+   params.mGateSigma = TrackingManager::getSettingGateSigma();
+   params.mMeasurementNoise = TrackingManager::getSettingMeasurementNoise();
+   params.mProcessNoise = TrackingManager::getSettingProcessNoise();
+   params.mMaxCoastFrames = TrackingManager::getSettingMaxCoastFrames();
+   params.mRansacMaxIterations = static_cast<int>(TrackingManager::getSettingRansacMaxIterations());
+   params.mRansacConfidence = TrackingManager::getSettingRansacConfidence();
+   params.mRansacGuided = TrackingManager::getSettingRansacGuided();
+   params.mObjectThreshold = TrackingManager::getSettingObjectThreshold();
+   return params;
+}
+
 void TrackingManager::initializeFrame0()
 {
+   // a new tracked area makes queued frames and pending updates stale, their retired detections are still valid
+   mGeneration++;
+   std::deque<TrackPoint> retired;
+   mWorker.clear(retired);
+   exportPoints(retired);
    if (mpLayer.get() == NULL)
    {
       mpElement = NULL;
       mpDesc = NULL;
       return;
    }
-   try
+   unsigned int baseFrame = mpLayer->getDisplayedBand(GRAY).getActiveNumber();
+   int width = mMaxBb.mX - mMinBb.mX + 1;
+   int height = mMaxBb.mY - mMinBb.mY + 1;
+   FrameSnapshot frame;
+   if (!readFrame(baseFrame, frame))
    {
-      unsigned int baseFrame = mpLayer->getDisplayedBand(GRAY).getActiveNumber();
-      mBaseFrameNum = baseFrame;
-      mCurrentFrameNum = -1;
-
-      int width = mMaxBb.mX - mMinBb.mX + 1;
-      int height = mMaxBb.mY - mMinBb.mY + 1;
-      bool fullScene = (width == mpDesc->getColumnCount() && height == mpDesc->getRowCount());
-
-      FactoryResource<DataRequest> baseRequest;
-      if (!fullScene)
-      {
-         baseRequest->setRows(mpDesc->getActiveRow(mMinBb.mY), mpDesc->getActiveRow(mMaxBb.mY), height);
-         baseRequest->setColumns(mpDesc->getActiveColumn(mMinBb.mX), mpDesc->getActiveColumn(mMaxBb.mX), width);
-      }
-      baseRequest->setBands(mpDesc->getActiveBand(baseFrame), mpDesc->getActiveBand(baseFrame), 1);
-      baseRequest->setInterleaveFormat(BSQ);
-      mBaseAcc = mpElement->getDataAccessor(baseRequest.release());
-
-      if (!mBaseAcc.isValid())
-      {
-         return;
-      }
-      // Wrap the accessors with OpenCV data structures and create some temporary arrays.
-      if (fullScene)
-      {
-         mpBaseFrame = IplImageResource(width, height, 8, 1, reinterpret_cast<char*>(mBaseAcc->getColumn()));
-      }
-      else
-      {
-         mpBaseFrame = IplImageResource(width, height, 8, 1);
-         for (int row = 0; row < height; ++row)
-         {
-            if (row > 0)
-            {
-               mBaseAcc->nextRow();
-               VERIFYNRV(mBaseAcc.isValid());
-            }
-            memcpy((*mpBaseFrame).imageData + (row * width), mBaseAcc->getRow(), (*mpBaseFrame).width);
-         }
-      }
-
-      mpEigImage = IplImageResource(width, height, IPL_DEPTH_32F, 1);
-      mpTmpImage = IplImageResource(width, height, IPL_DEPTH_32F, 1);
-      mCornerCount = MAX_CORNERS;
-      mpBaseCorners.reset(new CvPoint2D32f[MAX_CORNERS]);
-      cvGoodFeaturesToTrack(mpBaseFrame, mpEigImage, mpTmpImage, mpBaseCorners.get(), &mCornerCount, 0.01, 5.0);
-      cvFindCornerSubPix(mpBaseFrame, mpBaseCorners.get(), mCornerCount, cvSize(10, 10), cvSize(-1, -1), cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS, 20, 0.03));
-
-      CvSize pyr_sz = cvSize((*mpBaseFrame).width + 8, (*mpBaseFrame).height / 3);
-      mpBasePyramid = IplImageResource(pyr_sz.width, pyr_sz.height, IPL_DEPTH_32F, 1);
+      return;
+   }
+   frame.mReset = true;
 
-      // Create elements and views to show identified objects
-      mpRes = NULL;
-      mpRes2 = NULL;
+   // Create elements and views to show identified objects
+   mpRes = NULL;
+   mpRes2 = NULL;
 
-      RasterElementArgs args={height, width, 1, 0, 1, 1, mpElement, 0, NULL}; // BSQ, uchar (ushort)
-      DataElement* pTmp = Service<ModelServices>()->getElement("Current Objects", TypeConverter::toString<RasterElement>(), mpElement);
-      if (pTmp != NULL)
-      {
-         Service<ModelServices>()->destroyElement(pTmp);
-      }
-      mpRes = static_cast<RasterElement*>(createRasterElement("Current Objects", args));
+   RasterElementArgs args={height, width, 1, 0, 1, 1, mpElement, 0, NULL}; // BSQ, uchar (ushort)
+   DataElement* pTmp = Service<ModelServices>()->getElement("Current Objects", TypeConverter::toString<RasterElement>(), mpElement);
+   if (pTmp != NULL)
+   {
+      Service<ModelServices>()->destroyElement(pTmp);
+   }
+   mpRes = static_cast<RasterElement*>(createRasterElement("Current Objects", args));
 #pragma message(__FILE__ "(" STRING(__LINE__) ") : warning : Work around for OPTICKS-932 (tclarke)")
-      std::vector<int> badValues(1, 0);
-      mpRes->getStatistics()->setBadValues(badValues);
+   std::vector<int> badValues(1, 0);
+   mpRes->getStatistics()->setBadValues(badValues);
 #ifdef CONNECTED
-      RasterLayer* pPseudo = static_cast<RasterLayer*>(
-         static_cast<SpatialDataView*>(mpLayer->getView())->createLayer(RASTER, mpRes));
-      pPseudo->setXOffset(mMinBb.mX);
-      pPseudo->setYOffset(mMinBb.mY);
-      pTmp = Service<ModelServices>()->getElement("Base Objects", TypeConverter::toString<RasterElement>(), mpElement);
-      if (pTmp != NULL)
-      {
-         Service<ModelServices>()->destroyElement(pTmp);
-      }
-      mpRes2 = static_cast<RasterElement*>(createRasterElement("Base Objects", args));
-      mpRes2->getStatistics()->setBadValues(badValues);
-      RasterLayer* pPseudo2 = static_cast<RasterLayer*>(
-         static_cast<SpatialDataView*>(mpLayer->getView())->createLayer(RASTER, mpRes2));
-      pPseudo2->setXOffset(mMinBb.mX);
-      pPseudo2->setYOffset(mMinBb.mY);
-      pPseudo->setStretchUnits(GRAYSCALE_MODE, RAW_VALUE);
-      pPseudo->setStretchValues(GRAY, 0, 47);
-      pPseudo2->setStretchUnits(GRAYSCALE_MODE, RAW_VALUE);
-      pPseudo2->setStretchValues(GRAY, 0, 47);
-      ColorMap cmap("C:/Opticks/COAN/Tracking/Release/SupportFiles/ColorTables/pseudocolor.clu");
-      pPseudo->setColorMap(cmap);
-      pPseudo2->setColorMap(cmap);
-#endif
-
-      mCalcBaseObjects = true;
-   }
-   catch (const cv::Exception& exc)
+   RasterLayer* pPseudo = static_cast<RasterLayer*>(
+      static_cast<SpatialDataView*>(mpLayer->getView())->createLayer(RASTER, mpRes));
+   pPseudo->setXOffset(mMinBb.mX);
+   pPseudo->setYOffset(mMinBb.mY);
+   pTmp = Service<ModelServices>()->getElement("Base Objects", TypeConverter::toString<RasterElement>(), mpElement);
+   if (pTmp != NULL)
    {
-      MessageResource msg("OpenCV error occurred.", "tracking", "{b16ae5e9-ef7e-474f-9c45-8a061aa3cda2}");
-      msg->addProperty("Code", exc.code);
-      msg->addProperty("Error", exc.err);
-      msg->addProperty("Function", exc.func);
-      msg->addProperty("File", exc.file);
-      msg->addProperty("Line", exc.line);
-      msg->finalize(Message::Failure);
-   }
-}
-
-std::vector<TrackingManager::TrackVertex> TrackingManager::updateTrackObjects(CBlobResult& blobs, IplImage* pFrame, bool current)
-{
-   // Get contour points for each blob
-   std::vector<TrackVertex> objects;
-   for (int blobi = 0; blobi < blobs.GetNumBlobs(); ++blobi)
-   {
-      std::map<int, std::set<int> > pts;
-      CBlob blob = blobs.GetBlob(blobi);
-      CBlobContour* pCon = blob.GetExternalContour();
-      CvTreeNodeIterator iter;
-      cvInitTreeNodeIterator(&iter, pCon->GetContourPoints(), 0);
-      CvSeq* pContour;
-      while((pContour = reinterpret_cast<CvSeq*>(cvNextTreeNode(&iter))) != 0 )
-      {
-         CvSeqReader reader;
-         int count = pContour->total;
-         int elem_type = CV_MAT_TYPE(pContour->flags);
-         cvStartReadSeq(pContour, &reader, 0);
-         if (CV_IS_SEQ_CHAIN_CONTOUR(pContour))
-         {
-            cv::Point pt = ((CvChain*)pContour)->origin;
-            char prev_code = reader.ptr ? reader.ptr[0] : '\0';
-
-            for (int i = 0; i < count; i++)
-            {
-               char code;
-               CV_READ_SEQ_ELEM(code, reader);
-
-               if (code != prev_code)
-               {
-                  prev_code = code;
-                  pts[pt.y].insert(pt.x);
-               }
-
-               pt.x += CodeDeltas[(int)code][0];
-               pt.y += CodeDeltas[(int)code][1];
-            }
-         }
-         else if (CV_IS_SEQ_POLYLINE(pContour) && elem_type == CV_32SC2)
-         {
-            cv::Point pt1, pt2;
-            int shift = 0;
-
-            count -= !CV_IS_SEQ_CLOSED(pContour);
-            CV_READ_SEQ_ELEM(pt1, reader);
-            pts[pt1.y].insert(pt1.x);
-
-            for(int i = 0; i < count; i++)
-            {
-               CV_READ_SEQ_ELEM(pt2, reader);
-               pts[pt2.y].insert(pt2.x);
-               pt1 = pt2;
-            }
-         }
-      }
-      // Fill the contour and calculate some properties
-      Opticks::PixelLocation centroid(0,0);
-      std::vector<cv::Point> filledPoints;
-      for (std::map<int, std::set<int> >::iterator ptiter = pts.begin(); ptiter != pts.end(); ++ptiter)
-      {
-         int startCol = -1;
-         for (std::set<int>::iterator coliter = ptiter->second.begin(); coliter != ptiter->second.end(); ++coliter)
-         {
-            if (startCol == -1)
-            {
-               startCol = *coliter;
-            }
-            else
-            {
-               for (int col = startCol; col <= *coliter; ++col)
-               {
-                  filledPoints.push_back(cv::Point(col, ptiter->first));
-                  centroid.mX += col;
-                  centroid.mY += ptiter->first;
-               }
-               startCol = -1;
-            }
-         }
-      }
-      centroid.mX /= filledPoints.size();
-      centroid.mY /= filledPoints.size();
-      double tmpNum = 0.0, tmpDen = 0.0;
-      for (std::vector<cv::Point>::iterator ptiter = filledPoints.begin(); ptiter != filledPoints.end(); ++ptiter)
-      {
-         double val = cvGetReal2D(pFrame, ptiter->y, ptiter->x);
-         tmpNum += sqrt((double)SQR(ptiter->x - centroid.mX) +
-                        SQR(ptiter->y - centroid.mY)) * val;
-         tmpDen += val;
-      }
-      TrackVertex obj;
-      if (current || mCalcBaseObjects)
-      {
-         obj = boost::add_vertex(mTracks);
-         mTracks[obj].mFrameNum = current ? mCurrentFrameNum : mBaseFrameNum;
-         mTracks[obj].mDispersion = static_cast<float>(tmpNum / tmpDen);
-      }
-      else
-      {
-         // locate the correct item.
-      }
-      if (current)
-      {
-         mTracks[obj].mCentroidA = centroid;
-      }
-      else
-      {
-         mTracks[obj].mCentroidB = centroid;
-      }
-      objects.push_back(obj);
+      Service<ModelServices>()->destroyElement(pTmp);
    }
-   return objects;
-}
+   mpRes2 = static_cast<RasterElement*>(createRasterElement("Base Objects", args));
+   mpRes2->getStatistics()->setBadValues(badValues);
+   RasterLayer* pPseudo2 = static_cast<RasterLayer*>(
+      static_cast<SpatialDataView*>(mpLayer->getView())->createLayer(RASTER, mpRes2));
+   pPseudo2->setXOffset(mMinBb.mX);
+   pPseudo2->setYOffset(mMinBb.mY);
+   pPseudo->setStretchUnits(GRAYSCALE_MODE, RAW_VALUE);
+   pPseudo->setStretchValues(GRAY, 0, 47);
+   pPseudo2->setStretchUnits(GRAYSCALE_MODE, RAW_VALUE);
+   pPseudo2->setStretchValues(GRAY, 0, 47);
+   ColorMap cmap("C:/Opticks/COAN/Tracking/Release/SupportFiles/ColorTables/pseudocolor.clu");
+   pPseudo->setColorMap(cmap);
+   pPseudo2->setColorMap(cmap);
+#endif
 
-void TrackingManager::matchTracks(const std::vector<TrackVertex>& curObjs)
-{
-   if (mpTracks != NULL)
+   mWorker.setQueueSize(TrackingManager::getSettingFrameQueueSize());
+   mWorker.setOffline(TrackingManager::getSettingOfflineMode());
+   mWorker.setParameters(getSettingParameters());
+   if (!mWorker.isRunning())
    {
-      mpTracks->removeAllObjects(true);
-   }
-   for (std::vector<TrackVertex>::const_iterator base = mBaseObjects.begin(); base != mBaseObjects.end(); ++base)
-   {
-      std::pair<TrackTraits::in_edge_iterator, TrackTraits::in_edge_iterator> edges = boost::in_edges(*base, mTracks);
-      bool hasInVel = false;
-      Opticks::Location<int, 2> inVel(0, 0);
-      double inVelAng = 0.0;
-      if (edges.first != edges.second)
-      {
-         inVel = mTracks[*(edges.first)].mVelocity;
-         inVelAng = atan((double)inVel.mY / inVel.mX);
-         hasInVel = true;
-      }
-      // add connections which meet certain minimum criteria
-      TrackEdge minE;
-      float minCost = std::numeric_limits<float>::max();
-      for (std::vector<TrackVertex>::const_iterator cur = curObjs.begin(); cur != curObjs.end(); ++cur)
-      {
-         Opticks::Location<int, 2> vel(mTracks[*cur].mCentroidA.mX - mTracks[*base].mCentroidB.mX,
-                                       mTracks[*cur].mCentroidA.mY - mTracks[*base].mCentroidB.mY);
-         double velDiff = 0.0;
-         if (hasInVel)
-         {
-            velDiff = fabs(inVelAng - atan((double)vel.mY / vel.mX));
-         }
-         if (vel.length() < MAX_SPEED)
-         {
-            TrackEdge e = boost::add_edge(*base, *cur, mTracks).first;
-            mTracks[e].mVelocity = vel;
-            mTracks[e].mVelDiff = velDiff;
-            mTracks[e].mSpeedDiff = fabs(vel.length() - inVel.length());
-            mTracks[e].mDiffDispersion = fabs(mTracks[*base].mDispersion - mTracks[*cur].mDispersion);
-            mTracks[e].mCost = mTracks[e].mDiffDispersion * 0.2
-                             + mTracks[e].mVelDiff * 0.5
-                             + mTracks[e].mSpeedDiff * 0.3;
-            if (mTracks[e].mCost < minCost)
-            {
-               minCost = mTracks[e].mCost;
-               minE = e;
-            }
-         }
-      }
-      TrackTraits::edge_iterator ei, eitmp, ei_end;
-      for (boost::tie(ei, ei_end) = boost::edges(mTracks); ei != ei_end;)
-      {
-         eitmp = ei;
-         ++eitmp;
-         if (*ei != minE)
-         {
-            boost::remove_edge(*ei, mTracks);
-         }
-         else
-         {
-            LocationType start(mTracks[boost::source(*ei, mTracks)].mCentroidB.mX, mTracks[boost::source(*ei, mTracks)].mCentroidB.mY);
-            LocationType stop(mTracks[boost::target(*ei, mTracks)].mCentroidA.mX, mTracks[boost::target(*ei, mTracks)].mCentroidA.mY);
-            mpTracks->addObject(LINE_OBJECT)->setBoundingBox(start, stop);
-         }
-         ei = eitmp;
-      }
+      mWorker.start();
    }
-   // diff in velocity
-   // ang = atan(A.y/A.x) - atan(B.y/B.x); if (ang > 180) ang = 360 - ang
-   // mag = fabs(A.distance() - B.distance())
+   mWorker.submit(frame);
 }
@@ -13,28 +13,56 @@
 #include "Animation.h"
 #include "AttachmentPtr.h"
 #include "ConfigurationSettings.h"
-#include "DataAccessor.h"
 #include "ExecutableShell.h"
-#include "RasterData.h"
 #include "RasterLayer.h"
+#include "TrackExporter.h"
 #include "TrackingUtils.h"
+#include "TrackingWorker.h"
+#include <QtCore/QObject>
 #include <boost/any.hpp>
-#include <boost/graph/graph_traits.hpp>
-#include <boost/graph/adjacency_list.hpp>
 
 class AoiElement;
-class CBlobResult;
 class GraphicGroup;
 class RasterDataDescriptor;
 class RasterElement;
 
-class TrackingManager : public ExecutableShell
+/**
+ * Tracks objects in the animated layer of a view.
+ *
+ * The manager runs on the GUI thread. It copies the tracked area of each displayed frame and hands it
+ * to a TrackingWorker, then draws the results when the worker publishes them, so playback never waits
+ * on the tracking pipeline.
+ */
+class TrackingManager : public QObject, public ExecutableShell
 {
+   Q_OBJECT
+
 public:
    SETTING(InitialSubcubeSize, TrackingManager, unsigned int, 0);
+   SETTING(FrameQueueSize, TrackingManager, unsigned int, 2);
+   SETTING(OfflineMode, TrackingManager, bool, false);
+   SETTING(TrackWindowSize, TrackingManager, unsigned int, 30);
+   SETTING(GateRadius, TrackingManager, double, 150.0);
+   SETTING(GlobalAssignment, TrackingManager, bool, false);
+   SETTING(UnassignedCost, TrackingManager, double, 1000.0);
+   SETTING(MotionModel, TrackingManager, std::string, "none"); // none, constant velocity or constant acceleration
+   SETTING(GateSigma, TrackingManager, double, 3.0);
+   SETTING(MeasurementNoise, TrackingManager, double, 2.0);
+   SETTING(ProcessNoise, TrackingManager, double, 1.0);
+   SETTING(MaxCoastFrames, TrackingManager, unsigned int, 5);
+   SETTING(RansacMaxIterations, TrackingManager, unsigned int, 200);
+   SETTING(RansacConfidence, TrackingManager, double, 0.99);
+   SETTING(RansacGuided, TrackingManager, bool, false);
+   SETTING(ObjectThreshold, TrackingManager, double, 15.0); // in 8-bit levels
+   SETTING(ExportFile, TrackingManager, std::string, ""); // track points are streamed here, .csv, .geojson or .kml
 
    static const char* spPlugInName;
 
+   /**
+    * Build tracking parameters from the current settings.
+    */
+   static TrackingParameters getSettingParameters();
+
    TrackingManager();
    virtual ~TrackingManager();
 
@@ -46,71 +74,43 @@ public:
    void setPauseState(bool state);
    void setFocus(LocationType loc, int maxSize);
 
-   struct TrackVertexProps
-   {
-      TrackVertexProps() : mFrameNum(-1), mCentroidA(0,0), mCentroidB(0,0), mTexture(0.0), mDispersion(0.0) {}
-
-      int mFrameNum;                     // frame number where this objects was found
-      Opticks::PixelLocation mCentroidA; // position when this is the "current" frame (pre-transform)
-      Opticks::PixelLocation mCentroidB; // position when this is the "base" frame (post-transform)
-      float mTexture;                    // grayscale texture
-      float mDispersion;                 // grayscale dispersion
-      // optional HSI sig goes here
-   };
-   struct TrackEdgeProps
-   {
-      TrackEdgeProps() : mVelocity(0,0), mVelDiff(0.0), mSpeedDiff(0.0), mDiffDispersion(0.0) {}
-
-      Opticks::Location<int, 2> mVelocity; // previous frame's centroid B to this frame's centroid A
-      float mVelDiff;                      // angular difference between this velocity vector and the previous location's  
-      float mSpeedDiff;                    // magnitude difference between this velocity vector and the previous location's  
-      float mDiffDispersion;               // difference in dispersion values
-      float mCost;                         // total "cost" of this track
-   };
-   typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::bidirectionalS, TrackVertexProps, TrackEdgeProps> TrackGraph;
-   typedef boost::graph_traits<TrackGraph> TrackTraits;
-   typedef boost::graph_traits<TrackGraph>::vertex_descriptor TrackVertex;
-   typedef boost::graph_traits<TrackGraph>::edge_descriptor TrackEdge;
-
 protected:
    void processFrame(Subject& subject, const std::string& signal, const boost::any& val);
    void clearData(Subject& subject, const std::string& signal, const boost::any& val);
-   std::vector<TrackVertex> updateTrackObjects(CBlobResult& blobs, IplImage* pFrame, bool current);
-   void matchTracks(const std::vector<TrackVertex>& curObjs);
+
+protected slots:
+   void applyUpdates();
 
 private:
    void initializeDataset();
    void initializeFrame0();
+   bool readFrame(unsigned int frameNum, FrameSnapshot& frame);
+   void writeFrame(unsigned int frameNum, const std::vector<unsigned char>& data);
+   void applyUpdate(const TrackUpdate& update);
+   void openExport();
+   void exportPoints(const std::deque<TrackPoint>& points);
+
+   /**
+    * Export every detection the worker still holds, including its live track window, and close the export.
+    */
+   void finishExport();
+
+   TrackingWorker mWorker;
+   FrameSnapshot mFrame; // swapped with the worker's recycled snapshots and updates so their storage is reused
+   TrackUpdate mUpdate;
+   unsigned int mGeneration; // updates from an older generation are for a previous tracked area
+   TrackExporter mExporter;
+   unsigned int mExportGeneration; // detections from before this generation belong to a previous data set
 
-   TrackGraph mTracks;
-
-   bool mCalcBaseObjects; // should the base objects be calculated or results from the previous iteration used?
-   std::vector<TrackVertex> mBaseObjects;
    bool mPaused;
    AttachmentPtr<RasterLayer> mpLayer; // tracked layer
    AttachmentPtr<Animation> mpAnimation; // tracked animation
    const RasterDataDescriptor* mpDesc; // tracked element descriptor
    RasterElement* mpElement; // tracked element
 
-   // base frame information, passed to the next iteration
-   int mBaseFrameNum;
-   DataAccessor mBaseAcc;
-   IplImageResource mpBaseFrame;
-   IplImageResource mpEigImage;
-   IplImageResource mpTmpImage;
-   std::auto_ptr<CvPoint2D32f> mpBaseCorners;
-   IplImageResource mpBasePyramid;
-
-   // pass feature state to the next iteration
-   char mpFeaturesFound[500];
-   float mpFeatureErrors[500];
-
-   int mCurrentFrameNum;
    GraphicGroup* mpGroup; // draw flow vectors
    GraphicGroup* mpTracks; // draw tracks
 
-   int mCornerCount;
-
    RasterElement* mpRes; // base frame object blobs
    RasterElement* mpRes2; // current frame object blobs
 
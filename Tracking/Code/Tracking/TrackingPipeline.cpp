@@ -0,0 +1,1171 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "AppVerify.h"
+#include "StringUtilities.h"
+#include "TrackingPipeline.h"
+#include <opencv/cv.h>
+#include <BlobResult.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <math.h>
+#include <set>
+#include <stdlib.h>
+#include <string.h>
+
+#define SQR(x) ((x) * (x))
+
+// Percentiles of each frame's histogram mapped to 0 and 255 when a 16-bit or float frame is scaled to 8-bit
+#define RANGE_LOW_PERCENTILE 0.005
+#define RANGE_HIGH_PERCENTILE 0.995
+
+// Fraction of the range a new frame's range may drift before the base frame is rescaled to match
+#define RANGE_TOLERANCE 0.01
+
+namespace
+{
+static const int CodeDeltas[8][2] =
+{ {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1} };
+
+// IplImage rows are padded to 4 bytes so copy a row at a time
+void copyToImage(const std::vector<unsigned char>& data, IplImage* pImage)
+{
+   for (int row = 0; row < pImage->height; ++row)
+   {
+      memcpy(pImage->imageData + row * pImage->widthStep, &data[row * pImage->width], pImage->width);
+   }
+}
+
+void copyFromImage(const IplImage* pImage, std::vector<unsigned char>& data)
+{
+   data.resize(pImage->width * pImage->height);
+   for (int row = 0; row < pImage->height; ++row)
+   {
+      memcpy(&data[row * pImage->width], pImage->imageData + row * pImage->widthStep, pImage->width);
+   }
+}
+
+int matrixType(int depth)
+{
+   switch (depth)
+   {
+   case IPL_DEPTH_16U:
+      return CV_16UC1;
+   case IPL_DEPTH_16S:
+      return CV_16SC1;
+   case IPL_DEPTH_32F:
+      return CV_32FC1;
+   default:
+      return CV_8UC1;
+   }
+}
+
+int bytesPerSample(int depth)
+{
+   return (depth & 0xff) / 8;
+}
+
+// NaN fails both comparisons
+bool isFinite(float value)
+{
+   return value >= -std::numeric_limits<float>::max() && value <= std::numeric_limits<float>::max();
+}
+}
+
+void FrameSnapshot::swap(FrameSnapshot& other)
+{
+   std::swap(mFrameNum, other.mFrameNum);
+   std::swap(mWidth, other.mWidth);
+   std::swap(mHeight, other.mHeight);
+   std::swap(mDepth, other.mDepth);
+   mData.swap(other.mData);
+   std::swap(mOrigin, other.mOrigin);
+   std::swap(mReset, other.mReset);
+   std::swap(mGeneration, other.mGeneration);
+}
+
+void TrackUpdate::swap(TrackUpdate& other)
+{
+   std::swap(mFrameNum, other.mFrameNum);
+   std::swap(mBaseFrameNum, other.mBaseFrameNum);
+   std::swap(mRegistered, other.mRegistered);
+   std::swap(mGeneration, other.mGeneration);
+   mFlowVectors.swap(other.mFlowVectors);
+   mTrackSegments.swap(other.mTrackSegments);
+   mWarpedBase.swap(other.mWarpedBase);
+   mCurrentObjects.swap(other.mCurrentObjects);
+   mBaseObjects.swap(other.mBaseObjects);
+   mRetired.swap(other.mRetired);
+   mError.swap(other.mError);
+}
+
+void TrackUpdate::clear()
+{
+   mFrameNum = -1;
+   mBaseFrameNum = -1;
+   mRegistered = false;
+   mGeneration = 0;
+   mFlowVectors.clear();
+   mTrackSegments.clear();
+   mWarpedBase.clear();
+   mCurrentObjects.clear();
+   mBaseObjects.clear();
+   mRetired.clear();
+   mError.clear();
+}
+
+MotionFilter::MotionFilter() : mOrder(2)
+{
+   memset(mState, 0, sizeof(mState));
+   memset(mCov, 0, sizeof(mCov));
+}
+
+void MotionFilter::initialize(MotionModel model, LocationType position, double positionVar, double velocityVar)
+{
+   mOrder = (model == MOTION_CONSTANT_ACCELERATION) ? 3 : 2;
+   memset(mState, 0, sizeof(mState));
+   memset(mCov, 0, sizeof(mCov));
+   mState[0][0] = position.mX;
+   mState[1][0] = position.mY;
+   for (int axis = 0; axis < 2; ++axis)
+   {
+      mCov[axis][0][0] = positionVar;
+      for (unsigned int i = 1; i < mOrder; ++i)
+      {
+         mCov[axis][i][i] = velocityVar;
+      }
+   }
+}
+
+void MotionFilter::transform(const CvMat* pMap)
+{
+   double a00 = cvGetReal2D(pMap, 0, 0);
+   double a01 = cvGetReal2D(pMap, 0, 1);
+   double a10 = cvGetReal2D(pMap, 1, 0);
+   double a11 = cvGetReal2D(pMap, 1, 1);
+   for (unsigned int i = 0; i < mOrder; ++i)
+   {
+      double x = mState[0][i];
+      double y = mState[1][i];
+      mState[0][i] = a00 * x + a01 * y;
+      mState[1][i] = a10 * x + a11 * y;
+   }
+   // the derivatives only see the linear part of the map
+   mState[0][0] += cvGetReal2D(pMap, 0, 2);
+   mState[1][0] += cvGetReal2D(pMap, 1, 2);
+}
+
+void MotionFilter::predict(double dt, double processVar)
+{
+   // F[i][j] = dt^(j-i) / (j-i)!, Q = processVar * g g' where g is the effect of a unit kick in the highest derivative
+   double F[3][3] = { {1.0, dt, dt * dt / 2.0}, {0.0, 1.0, dt}, {0.0, 0.0, 1.0} };
+   double g[3];
+   if (mOrder == 3)
+   {
+      g[0] = dt * dt * dt / 6.0;
+      g[1] = dt * dt / 2.0;
+      g[2] = dt;
+   }
+   else
+   {
+      g[0] = dt * dt / 2.0;
+      g[1] = dt;
+   }
+   for (int axis = 0; axis < 2; ++axis)
+   {
+      double state[3] = {0.0, 0.0, 0.0};
+      double FP[3][3] = { {0.0} };
+      for (unsigned int i = 0; i < mOrder; ++i)
+      {
+         for (unsigned int k = 0; k < mOrder; ++k)
+         {
+            state[i] += F[i][k] * mState[axis][k];
+            for (unsigned int j = 0; j < mOrder; ++j)
+            {
+               FP[i][j] += F[i][k] * mCov[axis][k][j];
+            }
+         }
+      }
+      for (unsigned int i = 0; i < mOrder; ++i)
+      {
+         mState[axis][i] = state[i];
+         for (unsigned int j = 0; j < mOrder; ++j)
+         {
+            double sum = processVar * g[i] * g[j];
+            for (unsigned int k = 0; k < mOrder; ++k)
+            {
+               sum += FP[i][k] * F[j][k];
+            }
+            mCov[axis][i][j] = sum;
+         }
+      }
+   }
+}
+
+void MotionFilter::update(LocationType position, double measurementVar)
+{
+   double measured[2] = {position.mX, position.mY};
+   for (int axis = 0; axis < 2; ++axis)
+   {
+      double innovation = measured[axis] - mState[axis][0];
+      double S = mCov[axis][0][0] + measurementVar;
+      double K[3];
+      double P0[3];
+      for (unsigned int i = 0; i < mOrder; ++i)
+      {
+         K[i] = mCov[axis][i][0] / S;
+         P0[i] = mCov[axis][0][i];
+         mState[axis][i] += K[i] * innovation;
+      }
+      for (unsigned int i = 0; i < mOrder; ++i)
+      {
+         for (unsigned int j = 0; j < mOrder; ++j)
+         {
+            mCov[axis][i][j] -= K[i] * P0[j];
+         }
+      }
+   }
+}
+
+LocationType MotionFilter::getPosition() const
+{
+   return LocationType(mState[0][0], mState[1][0]);
+}
+
+double MotionFilter::getInnovationVariance(double measurementVar) const
+{
+   return std::max(mCov[0][0][0], mCov[1][0][0]) + measurementVar;
+}
+
+TrackingPipeline::TrackingPipeline() :
+      mNextTrackId(1),
+      mCalcBaseObjects(true),
+      mBaseFrameNum(-1),
+      mOrigin(0, 0),
+      mGeneration(0),
+      mBasePyramidReady(false),
+      mBaseCorners(MAX_CORNERS),
+      mCurCorners(MAX_CORNERS),
+      mDepth(IPL_DEPTH_8U),
+      mRangeLow(0.0),
+      mRangeHigh(255.0),
+      mHistogram(1024),
+      mCurrentFrameNum(-1),
+      mCornerCount(0),
+      mBufferGrowths(0),
+      mpMapMatrix(cvCreateMat(2, 3, CV_32F))
+{
+   mCorrespondences.reserve(MAX_CORNERS);
+   mRankedFeatures.reserve(MAX_CORNERS);
+}
+
+TrackingPipeline::~TrackingPipeline()
+{
+   cvReleaseMat(&mpMapMatrix);
+}
+
+void TrackingPipeline::setParameters(const TrackingParameters& params)
+{
+   mParams = params;
+   mParams.mTrackWindow = std::max(2U, mParams.mTrackWindow);
+}
+
+const TrackingParameters& TrackingPipeline::getParameters() const
+{
+   return mParams;
+}
+
+const TrackingPipeline::TrackGraph& TrackingPipeline::getTracks() const
+{
+   return mTracks;
+}
+
+const std::deque<TrackPoint>& TrackingPipeline::getTrackHistory() const
+{
+   return mHistory;
+}
+
+void TrackingPipeline::takeTrackHistory(std::deque<TrackPoint>& history)
+{
+   history.insert(history.end(), mHistory.begin(), mHistory.end());
+   mHistory.clear();
+}
+
+unsigned int TrackingPipeline::getBufferGrowthCount() const
+{
+   return mBufferGrowths;
+}
+
+size_t TrackingPipeline::getBufferCapacity(const TrackUpdate& update) const
+{
+   size_t capacity = update.mFlowVectors.capacity() + update.mTrackSegments.capacity() +
+      update.mWarpedBase.capacity() + update.mCurrentObjects.capacity() + update.mBaseObjects.capacity() +
+      mBaseObjects.capacity() + mCurObjects.capacity();
+   // the spare window slots are counted too since their storage moves between slots
+   for (size_t idx = 0; idx < mWindow.getSlotCount(); ++idx)
+   {
+      capacity += mWindow[idx].capacity();
+   }
+   return capacity;
+}
+
+void TrackingPipeline::retireAll()
+{
+   retireFrames(0);
+   mMotion.clear();
+   mBaseObjects.clear();
+   mCalcBaseObjects = true;
+}
+
+void TrackingPipeline::retireFrames(size_t keep)
+{
+   while (mWindow.size() > keep)
+   {
+      const std::vector<TrackVertex>& vertices = mWindow[0];
+      for (std::vector<TrackVertex>::const_iterator vertex = vertices.begin(); vertex != vertices.end(); ++vertex)
+      {
+         const TrackVertexProps& props = mTracks[*vertex];
+         TrackPoint point;
+         point.mTrackId = props.mTrackId;
+         point.mFrameNum = props.mFrameNum;
+         point.mCentroid = LocationType(props.mCentroidA.mX, props.mCentroidA.mY);
+         point.mPixel = LocationType(props.mCentroidA.mX + mOrigin.mX, props.mCentroidA.mY + mOrigin.mY);
+         point.mDispersion = props.mDispersion;
+         point.mGeneration = mGeneration;
+         mHistory.push_back(point);
+         // a coasting track ends when its last detection leaves the window
+         std::map<unsigned int, TrackMotion>::iterator motion = mMotion.find(props.mTrackId);
+         if (motion != mMotion.end() && motion->second.mVertex == *vertex)
+         {
+            mMotion.erase(motion);
+         }
+         boost::clear_vertex(*vertex, mTracks);
+         boost::remove_vertex(*vertex, mTracks);
+      }
+      mWindow.erase(0);
+   }
+   if (mParams.mHistorySize > 0 && mHistory.size() > mParams.mHistorySize)
+   {
+      mHistory.erase(mHistory.begin(), mHistory.begin() + (mHistory.size() - mParams.mHistorySize));
+   }
+}
+
+void TrackingPipeline::process(const FrameSnapshot& frame, TrackUpdate& update)
+{
+   size_t capacity = getBufferCapacity(update);
+   update.clear();
+   update.mFrameNum = frame.mFrameNum;
+   update.mBaseFrameNum = mBaseFrameNum;
+   update.mGeneration = frame.mGeneration;
+   try
+   {
+      if (frame.mReset)
+      {
+         initializeBaseFrame(frame);
+      }
+      else if (mpBaseFrame.get() == NULL)
+      {
+         update.mError = "Frame " + StringUtilities::toDisplayString(frame.mFrameNum) +
+            " was skipped because there is no base frame.";
+      }
+      else if (frame.mDepth != mDepth || frame.mWidth != (*mpBaseFrame).width || frame.mHeight != (*mpBaseFrame).height)
+      {
+         update.mError = "Frame " + StringUtilities::toDisplayString(frame.mFrameNum) +
+            " was skipped because its size or data type does not match the base frame.";
+      }
+      else
+      {
+         processFrame(frame, update);
+      }
+   }
+   catch (const cv::Exception& err)
+   {
+      update.mRegistered = false;
+      update.mError = err.err + "\n" + err.file + ":" + StringUtilities::toDisplayString(err.line) + "\n" + err.func;
+   }
+   if (getBufferCapacity(update) > capacity)
+   {
+      mBufferGrowths++;
+   }
+}
+
+void TrackingPipeline::allocateBuffers(int width, int height, int depth)
+{
+   if (mpBaseFrame.get() != NULL && (*mpBaseFrame).width == width && (*mpBaseFrame).height == height && mDepth == depth)
+   {
+      return;
+   }
+   mDepth = depth;
+   mpBaseFrame = IplImageResource(width, height, 8, 1);
+   mpCurFrame = IplImageResource(width, height, 8, 1);
+   CvSize pyr_sz = cvSize(width + 8, height / 3);
+   mpBasePyramid = IplImageResource(pyr_sz.width, pyr_sz.height, IPL_DEPTH_32F, 1);
+   mpCurPyramid = IplImageResource(pyr_sz.width, pyr_sz.height, IPL_DEPTH_32F, 1);
+   mpEigImage = IplImageResource(width, height, IPL_DEPTH_32F, 1);
+   mpTmpImage = IplImageResource(width, height, IPL_DEPTH_32F, 1);
+   mpXform = IplImageResource(width, height, 8, 1);
+   mpTemp = IplImageResource(width, height, 8, 1);
+   mpRes = IplImageResource(width, height, 8, 1);
+   mpRes2 = IplImageResource(width, height, 8, 1);
+   if (mDepth == IPL_DEPTH_8U)
+   {
+      mpBaseWork.reset(NULL);
+      mpCurWork.reset(NULL);
+      mpXformWork.reset(NULL);
+      mpThresholdWork.reset(NULL);
+   }
+   else
+   {
+      mpBaseWork = IplImageResource(width, height, IPL_DEPTH_32F, 1);
+      mpCurWork = IplImageResource(width, height, IPL_DEPTH_32F, 1);
+      mpXformWork = IplImageResource(width, height, IPL_DEPTH_32F, 1);
+      mpThresholdWork = IplImageResource(width, height, IPL_DEPTH_32F, 1);
+   }
+}
+
+void TrackingPipeline::initializeBaseFrame(const FrameSnapshot& frame)
+{
+   retireAll();
+   mBaseFrameNum = frame.mFrameNum;
+   mOrigin = frame.mOrigin;
+   mGeneration = frame.mGeneration;
+   mCurrentFrameNum = -1;
+   allocateBuffers(frame.mWidth, frame.mHeight, frame.mDepth);
+   loadFrame(frame, mpBaseFrame, mpBaseWork);
+   if (mDepth != IPL_DEPTH_8U)
+   {
+      calculateRange(mpBaseWork, mRangeLow, mRangeHigh);
+      double scale = 255.0 / (mRangeHigh - mRangeLow);
+      cvConvertScale(mpBaseWork, mpBaseFrame, scale, -mRangeLow * scale);
+   }
+   findCorners();
+
+   mBasePyramidReady = false;
+}
+
+void TrackingPipeline::loadFrame(const FrameSnapshot& frame, IplImage* pFrame, IplImage* pWork)
+{
+   if (mDepth == IPL_DEPTH_8U)
+   {
+      copyToImage(frame.mData, pFrame);
+      return;
+   }
+   VERIFYNRV(frame.mData.size() == static_cast<size_t>(frame.mWidth * frame.mHeight * bytesPerSample(mDepth)));
+   CvMat data = cvMat(frame.mHeight, frame.mWidth, matrixType(mDepth), const_cast<unsigned char*>(&frame.mData.front()));
+   cvConvert(&data, pWork);
+}
+
+void TrackingPipeline::calculateRange(const IplImage* pWork, double& low, double& high)
+{
+   // non-finite samples are usually no-data values so they are left out of the range
+   double minVal = std::numeric_limits<double>::max();
+   double maxVal = -std::numeric_limits<double>::max();
+   size_t finiteCount = 0;
+   for (int row = 0; row < pWork->height; ++row)
+   {
+      const float* pRow = reinterpret_cast<const float*>(pWork->imageData + row * pWork->widthStep);
+      for (int col = 0; col < pWork->width; ++col)
+      {
+         if (isFinite(pRow[col]))
+         {
+            minVal = std::min<double>(minVal, pRow[col]);
+            maxVal = std::max<double>(maxVal, pRow[col]);
+            finiteCount++;
+         }
+      }
+   }
+   if (finiteCount == 0)
+   {
+      low = 0.0;
+      high = 1.0;
+      return;
+   }
+   if (!(maxVal > minVal))
+   {
+      low = minVal;
+      high = minVal + 1.0;
+      return;
+   }
+   std::fill(mHistogram.begin(), mHistogram.end(), 0);
+   double binScale = (mHistogram.size() - 1) / (maxVal - minVal);
+   for (int row = 0; row < pWork->height; ++row)
+   {
+      const float* pRow = reinterpret_cast<const float*>(pWork->imageData + row * pWork->widthStep);
+      for (int col = 0; col < pWork->width; ++col)
+      {
+         if (isFinite(pRow[col]))
+         {
+            mHistogram[static_cast<size_t>((pRow[col] - minVal) * binScale)]++;
+         }
+      }
+   }
+   double total = static_cast<double>(finiteCount);
+   double lowCount = total * RANGE_LOW_PERCENTILE;
+   double highCount = total * RANGE_HIGH_PERCENTILE;
+   size_t lowBin = 0;
+   size_t highBin = mHistogram.size() - 1;
+   double cumulative = 0.0;
+   for (size_t bin = 0; bin < mHistogram.size(); ++bin)
+   {
+      cumulative += mHistogram[bin];
+      if (cumulative <= lowCount)
+      {
+         lowBin = bin + 1;
+      }
+      if (cumulative >= highCount)
+      {
+         highBin = bin;
+         break;
+      }
+   }
+   low = minVal + lowBin / binScale;
+   high = minVal + (highBin + 1) / binScale;
+   if (!(high > low))
+   {
+      high = low + 1.0;
+   }
+}
+
+void TrackingPipeline::thresholdObjects(const IplImage* pFrame, IplImage* pMask)
+{
+   if (pFrame->depth == IPL_DEPTH_8U)
+   {
+      cvThreshold(pFrame, pMask, mParams.mObjectThreshold, 255, CV_THRESH_BINARY);
+   }
+   else
+   {
+      // the threshold is in 8-bit levels so map it through the frame's display range
+      double threshold = mRangeLow + mParams.mObjectThreshold * (mRangeHigh - mRangeLow) / 255.0;
+      cvThreshold(pFrame, mpThresholdWork, threshold, 255, CV_THRESH_BINARY);
+      cvConvert(mpThresholdWork, pMask);
+   }
+}
+
+void TrackingPipeline::findCorners()
+{
+   mCornerCount = MAX_CORNERS;
+   cvGoodFeaturesToTrack(mpBaseFrame, mpEigImage, mpTmpImage, &mBaseCorners.front(), &mCornerCount, 0.01, 5.0);
+   cvFindCornerSubPix(mpBaseFrame, &mBaseCorners.front(), mCornerCount, cvSize(10, 10), cvSize(-1, -1), cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS, 20, 0.03));
+}
+
+void TrackingPipeline::processFrame(const FrameSnapshot& frame, TrackUpdate& update)
+{
+   mCurrentFrameNum = frame.mFrameNum;
+   IplImage* pCurFrame = mpCurFrame;
+   loadFrame(frame, pCurFrame, mpCurWork);
+
+   // detection and measurement use the data in its own units, optical flow needs 8-bit
+   IplImage* pCurData = pCurFrame;
+   IplImage* pBaseData = mpBaseFrame;
+   if (mDepth != IPL_DEPTH_8U)
+   {
+      pCurData = mpCurWork;
+      pBaseData = mpBaseWork;
+      double low = 0.0;
+      double high = 0.0;
+      calculateRange(pCurData, low, high);
+      double tolerance = (mRangeHigh - mRangeLow) * RANGE_TOLERANCE;
+      if (fabs(low - mRangeLow) > tolerance || fabs(high - mRangeHigh) > tolerance)
+      {
+         // both frames must share a scale for the optical flow so rescale the base frame and its pyramid
+         mRangeLow = low;
+         mRangeHigh = high;
+         double scale = 255.0 / (mRangeHigh - mRangeLow);
+         cvConvertScale(pBaseData, mpBaseFrame, scale, -mRangeLow * scale);
+         mBasePyramidReady = false;
+      }
+      double scale = 255.0 / (mRangeHigh - mRangeLow);
+      cvConvertScale(pCurData, pCurFrame, scale, -mRangeLow * scale);
+   }
+   // the base pyramid is the previous frame's current pyramid so only the current pyramid needs to be built
+   cvCalcOpticalFlowPyrLK(mpBaseFrame, pCurFrame, mpBasePyramid, mpCurPyramid, &mBaseCorners.front(), &mCurCorners.front(), mCornerCount,
+      cvSize(10,10), 5, mpFeaturesFound, mpFeatureErrors, cvTermCriteria(CV_TERMCRIT_ITER|CV_TERMCRIT_EPS, 20, 0.3),
+      mBasePyramidReady ? CV_LKFLOW_PYR_A_READY : 0);
+
+   std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr = mCorrespondences;
+   corr.clear();
+   mRankedFeatures.clear();
+   update.mFlowVectors.reserve(MAX_CORNERS);
+   for (int i = 0; i < mCornerCount; ++i)
+   {
+      if (mpFeaturesFound[i] == 0 || mpFeatureErrors[i] > 550)
+      {
+         continue;
+      }
+      update.mFlowVectors.push_back(std::make_pair(LocationType(mBaseCorners[i].x, mBaseCorners[i].y),
+         LocationType(mCurCorners[i].x, mCurCorners[i].y)));
+      mRankedFeatures.push_back(std::make_pair(mpFeatureErrors[i], i));
+   }
+   if (mParams.mRansacGuided)
+   {
+      // guided RANSAC wants the most reliable flow vectors first
+      std::sort(mRankedFeatures.begin(), mRankedFeatures.end());
+   }
+   for (std::vector<std::pair<float, int> >::const_iterator feature = mRankedFeatures.begin();
+        feature != mRankedFeatures.end(); ++feature)
+   {
+      corr.push_back(std::make_pair(mBaseCorners[feature->second], mCurCorners[feature->second]));
+   }
+   // seed from the frame number so a sequence always gives the same results
+   mRansac.seed(static_cast<unsigned int>(mCurrentFrameNum));
+   mRansac.setMode(mParams.mRansacGuided ? AffineRansac::GUIDED : AffineRansac::STANDARD);
+   mRansac.setMaxIterations(mParams.mRansacMaxIterations);
+   mRansac.setConfidence(mParams.mRansacConfidence);
+   mRansac.setThreshold(5.0f);
+   mRansac.setMinInliers(5);
+   CvMat* pMapMatrix = mRansac.estimate(corr, mpMapMatrix) ? mpMapMatrix : NULL;
+   if (pMapMatrix != NULL)
+   {
+      IplImage* pXform = (mDepth == IPL_DEPTH_8U) ? mpXform.get() : mpXformWork.get();
+      IplImage* pTemp = mpTemp;
+      IplImage* pRes = mpRes;
+      IplImage* pRes2 = mpRes2;
+      cvCopy(pCurData, pXform); // initialize to the current frame so any "offsets" have a consistent background
+      cvWarpAffine(pBaseData, pXform, pMapMatrix, CV_INTER_LINEAR); // warp the base frame to the current camera position
+      // the manager copies the transformed base frame back to the raster element
+      if (mDepth == IPL_DEPTH_8U)
+      {
+         copyFromImage(pXform, update.mWarpedBase);
+      }
+      else
+      {
+         update.mWarpedBase.resize((*pXform).width * (*pXform).height * bytesPerSample(mDepth));
+         CvMat warped = cvMat((*pXform).height, (*pXform).width, matrixType(mDepth), &update.mWarpedBase.front());
+         cvConvert(pXform, &warped);
+      }
+
+      // threhold the results
+      thresholdObjects(pCurData, pTemp); // threshold the current frame
+      thresholdObjects(pXform, pRes); // threshold the base frame
+      // erode to remove some noise
+      cvErode(pTemp, pTemp); // erode the current frame
+      cvErode(pRes,pRes); // erode the base frame
+      // difference the frames
+      cvSub(pTemp, pRes, pRes2); // subtract the base from the current and store in res2
+      cvSub(pRes, pTemp, pRes);  // subtract the current from the base and store in res
+      // remove final small differences with an open
+      cvErode(pRes,pRes, NULL, 3); // open the current frame
+      cvDilate(pRes,pRes,NULL,3);
+
+      cvErode(pRes2,pRes2, NULL, 3); // open the base frame
+      cvDilate(pRes2,pRes2,NULL,3);
+
+      { // scope blobs
+         CBlobResult blobs(pRes, NULL, 0);
+#ifdef CONNECTED
+         for (int bidx = 0; bidx < blobs.GetNumBlobs(); ++bidx)
+         {
+            CBlob blob(blobs.GetBlob(bidx));
+            blob.FillBlob(pRes, CV_RGB(bidx+1,bidx+1,bidx+1));
+         }
+#endif
+         updateTrackObjects(blobs, pCurData, true, mCurObjects);
+      } // scope blobs
+      { // scope blobs
+         CBlobResult blobs(pRes2, NULL, 0);
+#ifdef CONNECTED
+         for (int bidx = 0; bidx < blobs.GetNumBlobs(); ++bidx)
+         {
+            CBlob blob(blobs.GetBlob(bidx));
+            blob.FillBlob(pRes2, CV_RGB(bidx+1,bidx+1,bidx+1));
+         }
+#endif
+         if (mCalcBaseObjects)
+         {
+            updateTrackObjects(blobs, pBaseData, false, mBaseObjects);
+         }
+         else
+         {
+            // apply affine transform to the coords
+            for (size_t idx = 0; idx < mBaseObjects.size(); ++idx)
+            {
+               mTracks[mBaseObjects[idx]].mCentroidB.mX =
+                  (mTracks[mBaseObjects[idx]].mCentroidA.mX * cvGetReal2D(pMapMatrix, 0, 0)) +
+                  (mTracks[mBaseObjects[idx]].mCentroidA.mY * cvGetReal2D(pMapMatrix, 0, 1)) +
+                  cvGetReal2D(pMapMatrix, 0, 2);
+               mTracks[mBaseObjects[idx]].mCentroidB.mY =
+                  (mTracks[mBaseObjects[idx]].mCentroidA.mX * cvGetReal2D(pMapMatrix, 1, 0)) +
+                  (mTracks[mBaseObjects[idx]].mCentroidA.mY * cvGetReal2D(pMapMatrix, 1, 1)) +
+                  cvGetReal2D(pMapMatrix, 1, 2);
+            }
+         }
+      } // scope blobs
+      predictMotion(pMapMatrix);
+      matchTracks(mCurObjects, update);
+      // assignment reuses the storage of the recycled window slots
+      if (mCalcBaseObjects)
+      {
+         mWindow.pushSlot() = mBaseObjects;
+      }
+      mWindow.pushSlot() = mCurObjects;
+      retireFrames(mParams.mTrackWindow);
+      copyFromImage(pRes, update.mCurrentObjects);
+      copyFromImage(pRes2, update.mBaseObjects);
+
+      mBaseObjects.swap(mCurObjects);
+      update.mRegistered = true;
+   }
+
+   // prep for next frame
+   mpBasePyramid.swap(mpCurPyramid);
+   mpBaseFrame.swap(mpCurFrame);
+   mpBaseWork.swap(mpCurWork);
+   mBasePyramidReady = true;
+   mBaseFrameNum = mCurrentFrameNum;
+   findCorners();
+
+   mCalcBaseObjects = false;
+}
+
+void TrackingPipeline::updateTrackObjects(CBlobResult& blobs, IplImage* pFrame, bool current,
+                                          std::vector<TrackVertex>& objects)
+{
+   // Get contour points for each blob
+   objects.clear();
+   for (int blobi = 0; blobi < blobs.GetNumBlobs(); ++blobi)
+   {
+      std::map<int, std::set<int> > pts;
+      CBlob blob = blobs.GetBlob(blobi);
+      CBlobContour* pCon = blob.GetExternalContour();
+      CvTreeNodeIterator iter;
+      cvInitTreeNodeIterator(&iter, pCon->GetContourPoints(), 0);
+      CvSeq* pContour;
+      while((pContour = reinterpret_cast<CvSeq*>(cvNextTreeNode(&iter))) != 0 )
+      {
+         CvSeqReader reader;
+         int count = pContour->total;
+         int elem_type = CV_MAT_TYPE(pContour->flags);
+         cvStartReadSeq(pContour, &reader, 0);
+         if (CV_IS_SEQ_CHAIN_CONTOUR(pContour))
+         {
+            cv::Point pt = ((CvChain*)pContour)->origin;
+            char prev_code = reader.ptr ? reader.ptr[0] : '\0';
+
+            for (int i = 0; i < count; i++)
+            {
+               char code;
+               CV_READ_SEQ_ELEM(code, reader);
+
+               if (code != prev_code)
+               {
+                  prev_code = code;
+                  pts[pt.y].insert(pt.x);
+               }
+
+               pt.x += CodeDeltas[(int)code][0];
+               pt.y += CodeDeltas[(int)code][1];
+            }
+         }
+         else if (CV_IS_SEQ_POLYLINE(pContour) && elem_type == CV_32SC2)
+         {
+            cv::Point pt1, pt2;
+            int shift = 0;
+
+            count -= !CV_IS_SEQ_CLOSED(pContour);
+            CV_READ_SEQ_ELEM(pt1, reader);
+            pts[pt1.y].insert(pt1.x);
+
+            for(int i = 0; i < count; i++)
+            {
+               CV_READ_SEQ_ELEM(pt2, reader);
+               pts[pt2.y].insert(pt2.x);
+               pt1 = pt2;
+            }
+         }
+      }
+      // Fill the contour and calculate some properties
+      Opticks::PixelLocation centroid(0,0);
+      std::vector<cv::Point> filledPoints;
+      for (std::map<int, std::set<int> >::iterator ptiter = pts.begin(); ptiter != pts.end(); ++ptiter)
+      {
+         int startCol = -1;
+         for (std::set<int>::iterator coliter = ptiter->second.begin(); coliter != ptiter->second.end(); ++coliter)
+         {
+            if (startCol == -1)
+            {
+               startCol = *coliter;
+            }
+            else
+            {
+               for (int col = startCol; col <= *coliter; ++col)
+               {
+                  filledPoints.push_back(cv::Point(col, ptiter->first));
+                  centroid.mX += col;
+                  centroid.mY += ptiter->first;
+               }
+               startCol = -1;
+            }
+         }
+      }
+      centroid.mX /= filledPoints.size();
+      centroid.mY /= filledPoints.size();
+      double tmpNum = 0.0, tmpDen = 0.0;
+      for (std::vector<cv::Point>::iterator ptiter = filledPoints.begin(); ptiter != filledPoints.end(); ++ptiter)
+      {
+         double val = cvGetReal2D(pFrame, ptiter->y, ptiter->x);
+         tmpNum += sqrt((double)SQR(ptiter->x - centroid.mX) +
+                        SQR(ptiter->y - centroid.mY)) * val;
+         tmpDen += val;
+      }
+      TrackVertex obj;
+      if (current || mCalcBaseObjects)
+      {
+         obj = boost::add_vertex(mTracks);
+         mTracks[obj].mFrameNum = current ? mCurrentFrameNum : mBaseFrameNum;
+         mTracks[obj].mDispersion = static_cast<float>(tmpNum / tmpDen);
+         if (!current)
+         {
+            // objects in the first base frame start new tracks, current objects are assigned by matchTracks()
+            mTracks[obj].mTrackId = mNextTrackId++;
+            mTracks[obj].mCentroidA = centroid;
+         }
+      }
+      else
+      {
+         // locate the correct item.
+      }
+      if (current)
+      {
+         mTracks[obj].mCentroidA = centroid;
+      }
+      else
+      {
+         mTracks[obj].mCentroidB = centroid;
+      }
+      objects.push_back(obj);
+   }
+}
+
+void TrackingPipeline::matchTracks(const std::vector<TrackVertex>& curObjs, TrackUpdate& update)
+{
+   // index the current objects so each base object is only compared with the objects inside its gate
+   mCandidatePositions.clear();
+   for (std::vector<TrackVertex>::const_iterator cur = curObjs.begin(); cur != curObjs.end(); ++cur)
+   {
+      mCandidatePositions.push_back(LocationType(mTracks[*cur].mCentroidA.mX, mTracks[*cur].mCentroidA.mY));
+   }
+   mCandidateGrid.build(mCandidatePositions, mParams.mGateRadius);
+   buildMatchRows();
+
+   // add connections which meet certain minimum criteria
+   mCandidatePairs.clear();
+   for (unsigned int baseIdx = 0; baseIdx < mMatchRows.size(); ++baseIdx)
+   {
+      const MatchRow& row = mMatchRows[baseIdx];
+      TrackVertex base = row.mVertex;
+      std::pair<TrackTraits::in_edge_iterator, TrackTraits::in_edge_iterator> edges = boost::in_edges(base, mTracks);
+      bool hasInVel = false;
+      Opticks::Location<int, 2> inVel(0, 0);
+      double inVelAng = 0.0;
+      if (edges.first != edges.second)
+      {
+         inVel = mTracks[*(edges.first)].mVelocity;
+         // a stationary track has no heading so the angle term is left out
+         hasInVel = (inVel.mX != 0 || inVel.mY != 0);
+         inVelAng = hasInVel ? atan2(static_cast<double>(inVel.mY), static_cast<double>(inVel.mX)) : 0.0;
+      }
+      mCandidateGrid.findWithin(row.mCenter, row.mRadius, mGatedCandidates);
+      for (std::vector<unsigned int>::const_iterator gated = mGatedCandidates.begin(); gated != mGatedCandidates.end(); ++gated)
+      {
+         TrackVertex cur = curObjs[*gated];
+         Opticks::Location<int, 2> vel(mTracks[cur].mCentroidA.mX - static_cast<int>(row.mReference.mX),
+                                       mTracks[cur].mCentroidA.mY - static_cast<int>(row.mReference.mY));
+         double velDiff = 0.0;
+         if (hasInVel && (vel.mX != 0 || vel.mY != 0))
+         {
+            // heading difference wrapped into [0, pi]
+            velDiff = fabs(inVelAng - atan2(static_cast<double>(vel.mY), static_cast<double>(vel.mX)));
+            if (velDiff > CV_PI)
+            {
+               velDiff = 2.0 * CV_PI - velDiff;
+            }
+         }
+         TrackEdge e = boost::add_edge(base, cur, mTracks).first;
+         mTracks[e].mVelocity = vel;
+         mTracks[e].mVelDiff = velDiff;
+         mTracks[e].mSpeedDiff = fabs(vel.length() - inVel.length());
+         mTracks[e].mDiffDispersion = fabs(mTracks[base].mDispersion - mTracks[cur].mDispersion);
+         mTracks[e].mCost = mTracks[e].mDiffDispersion * 0.2
+                          + mTracks[e].mVelDiff * 0.5
+                          + mTracks[e].mSpeedDiff * 0.3;
+         CandidatePair pair;
+         pair.mBase = baseIdx;
+         pair.mCurrent = *gated;
+         pair.mEdge = e;
+         pair.mKeep = false;
+         mCandidatePairs.push_back(pair);
+      }
+   }
+
+   if (mParams.mGlobalAssignment)
+   {
+      assignGlobal(curObjs.size());
+   }
+   else
+   {
+      assignGreedy();
+   }
+
+   // drop the rejected connections and extend the tracks along the kept ones
+   for (std::vector<CandidatePair>::const_iterator pair = mCandidatePairs.begin(); pair != mCandidatePairs.end(); ++pair)
+   {
+      if (!pair->mKeep)
+      {
+         boost::remove_edge(pair->mEdge, mTracks);
+         continue;
+      }
+      const MatchRow& row = mMatchRows[pair->mBase];
+      TrackVertex cur = curObjs[pair->mCurrent];
+      if (mTracks[cur].mTrackId == 0)
+      {
+         mTracks[cur].mTrackId = mTracks[row.mVertex].mTrackId;
+      }
+      LocationType start = row.mReference;
+      LocationType stop(mTracks[cur].mCentroidA.mX, mTracks[cur].mCentroidA.mY);
+      update.mTrackSegments.push_back(std::make_pair(start, stop));
+   }
+   // unmatched objects start new tracks
+   for (std::vector<TrackVertex>::const_iterator cur = curObjs.begin(); cur != curObjs.end(); ++cur)
+   {
+      if (mTracks[*cur].mTrackId == 0)
+      {
+         mTracks[*cur].mTrackId = mNextTrackId++;
+      }
+   }
+   updateMotion(curObjs);
+   // diff in velocity
+   // ang = atan(A.y/A.x) - atan(B.y/B.x); if (ang > 180) ang = 360 - ang
+   // mag = fabs(A.distance() - B.distance())
+}
+
+void TrackingPipeline::predictMotion(const CvMat* pMap)
+{
+   if (mParams.mMotionModel == MOTION_NONE)
+   {
+      mMotion.clear();
+      return;
+   }
+   double processVar = mParams.mProcessNoise * mParams.mProcessNoise;
+   for (std::map<unsigned int, TrackMotion>::iterator motion = mMotion.begin(); motion != mMotion.end(); ++motion)
+   {
+      TrackMotion& track = motion->second;
+      track.mFilter.transform(pMap);
+      track.mPrior = track.mFilter.getPosition();
+      track.mFilter.predict(std::max(1, mCurrentFrameNum - track.mFrameNum), processVar);
+      track.mFrameNum = mCurrentFrameNum;
+      track.mUpdated = false;
+   }
+}
+
+void TrackingPipeline::buildMatchRows()
+{
+   bool filtered = (mParams.mMotionModel != MOTION_NONE);
+   double measurementVar = mParams.mMeasurementNoise * mParams.mMeasurementNoise;
+   mMatchRows.clear();
+   for (std::vector<TrackVertex>::const_iterator base = mBaseObjects.begin(); base != mBaseObjects.end(); ++base)
+   {
+      MatchRow row;
+      row.mVertex = *base;
+      row.mReference = LocationType(mTracks[*base].mCentroidB.mX, mTracks[*base].mCentroidB.mY);
+      row.mCenter = row.mReference;
+      row.mRadius = mParams.mGateRadius;
+      if (filtered)
+      {
+         std::map<unsigned int, TrackMotion>::iterator motion = mMotion.find(mTracks[*base].mTrackId);
+         if (motion == mMotion.end())
+         {
+            // start new tracks at rest with a velocity uncertainty which spans the largest gate
+            TrackMotion track;
+            double velocitySigma = mParams.mGateRadius / std::max(mParams.mGateSigma, 1e-3);
+            track.mFilter.initialize(mParams.mMotionModel, row.mReference, measurementVar, velocitySigma * velocitySigma);
+            track.mVertex = *base;
+            track.mPrior = row.mReference;
+            track.mFrameNum = mCurrentFrameNum;
+            track.mMissed = 0;
+            track.mUpdated = false;
+            motion = mMotion.insert(std::make_pair(mTracks[*base].mTrackId, track)).first;
+         }
+         row.mCenter = motion->second.mFilter.getPosition();
+         row.mRadius = std::min(mParams.mGateRadius,
+            mParams.mGateSigma * sqrt(motion->second.mFilter.getInnovationVariance(measurementVar)));
+      }
+      mMatchRows.push_back(row);
+   }
+   if (filtered)
+   {
+      // coasting tracks compete for the current objects from their last detection
+      for (std::map<unsigned int, TrackMotion>::const_iterator motion = mMotion.begin(); motion != mMotion.end(); ++motion)
+      {
+         if (motion->second.mMissed == 0)
+         {
+            continue;
+         }
+         MatchRow row;
+         row.mVertex = motion->second.mVertex;
+         row.mReference = motion->second.mPrior;
+         row.mCenter = motion->second.mFilter.getPosition();
+         row.mRadius = std::min(mParams.mGateRadius,
+            mParams.mGateSigma * sqrt(motion->second.mFilter.getInnovationVariance(measurementVar)));
+         mMatchRows.push_back(row);
+      }
+   }
+}
+
+void TrackingPipeline::updateMotion(const std::vector<TrackVertex>& curObjs)
+{
+   if (mParams.mMotionModel == MOTION_NONE)
+   {
+      return;
+   }
+   double measurementVar = mParams.mMeasurementNoise * mParams.mMeasurementNoise;
+   for (std::vector<TrackVertex>::const_iterator cur = curObjs.begin(); cur != curObjs.end(); ++cur)
+   {
+      LocationType position(mTracks[*cur].mCentroidA.mX, mTracks[*cur].mCentroidA.mY);
+      std::map<unsigned int, TrackMotion>::iterator motion = mMotion.find(mTracks[*cur].mTrackId);
+      if (motion == mMotion.end())
+      {
+         TrackMotion track;
+         double velocitySigma = mParams.mGateRadius / std::max(mParams.mGateSigma, 1e-3);
+         track.mFilter.initialize(mParams.mMotionModel, position, measurementVar, velocitySigma * velocitySigma);
+         track.mPrior = position;
+         track.mFrameNum = mCurrentFrameNum;
+         motion = mMotion.insert(std::make_pair(mTracks[*cur].mTrackId, track)).first;
+      }
+      else
+      {
+         motion->second.mFilter.update(position, measurementVar);
+      }
+      motion->second.mVertex = *cur;
+      motion->second.mMissed = 0;
+      motion->second.mUpdated = true;
+   }
+   // tracks without a detection coast on their prediction until they run out of frames
+   for (std::map<unsigned int, TrackMotion>::iterator motion = mMotion.begin(); motion != mMotion.end();)
+   {
+      if (!motion->second.mUpdated && ++motion->second.mMissed > mParams.mMaxCoastFrames)
+      {
+         mMotion.erase(motion++);
+      }
+      else
+      {
+         ++motion;
+      }
+   }
+}
+
+void TrackingPipeline::assignGreedy()
+{
+   // each base object keeps its cheapest connection, several base objects may pick the same current object
+   size_t first = 0;
+   while (first < mCandidatePairs.size())
+   {
+      size_t best = first;
+      size_t last = first;
+      for (; last < mCandidatePairs.size() && mCandidatePairs[last].mBase == mCandidatePairs[first].mBase; ++last)
+      {
+         if (mTracks[mCandidatePairs[last].mEdge].mCost < mTracks[mCandidatePairs[best].mEdge].mCost)
+         {
+            best = last;
+         }
+      }
+      mCandidatePairs[best].mKeep = true;
+      first = last;
+   }
+}
+
+void TrackingPipeline::assignGlobal(size_t currentCount)
+{
+   // split the gated pairs into connected components, base object i is node i and current object j is node
+   // base count + j, and solve each component on its own
+   size_t baseCount = mMatchRows.size();
+   mComponentParent.resize(baseCount + currentCount);
+   for (size_t node = 0; node < mComponentParent.size(); ++node)
+   {
+      mComponentParent[node] = static_cast<unsigned int>(node);
+   }
+   for (std::vector<CandidatePair>::const_iterator pair = mCandidatePairs.begin(); pair != mCandidatePairs.end(); ++pair)
+   {
+      unsigned int baseRoot = findComponent(pair->mBase);
+      unsigned int curRoot = findComponent(static_cast<unsigned int>(baseCount + pair->mCurrent));
+      if (baseRoot != curRoot)
+      {
+         mComponentParent[baseRoot] = curRoot;
+      }
+   }
+   std::map<unsigned int, std::vector<size_t> > components;
+   for (size_t pairIdx = 0; pairIdx < mCandidatePairs.size(); ++pairIdx)
+   {
+      components[findComponent(mCandidatePairs[pairIdx].mBase)].push_back(pairIdx);
+   }
+
+   const double forbidden = 1e9;
+   std::vector<double> costs;
+   std::vector<unsigned int> assignment;
+   for (std::map<unsigned int, std::vector<size_t> >::const_iterator component = components.begin();
+        component != components.end(); ++component)
+   {
+      const std::vector<size_t>& pairs = component->second;
+      if (pairs.size() == 1)
+      {
+         mCandidatePairs[pairs.front()].mKeep =
+            mTracks[mCandidatePairs[pairs.front()].mEdge].mCost < 2.0 * mParams.mUnassignedCost;
+         continue;
+      }
+      // local row and column numbers for the component's objects
+      std::map<unsigned int, unsigned int> rows;
+      std::map<unsigned int, unsigned int> cols;
+      for (std::vector<size_t>::const_iterator pairIdx = pairs.begin(); pairIdx != pairs.end(); ++pairIdx)
+      {
+         rows.insert(std::make_pair(mCandidatePairs[*pairIdx].mBase, static_cast<unsigned int>(rows.size())));
+         cols.insert(std::make_pair(mCandidatePairs[*pairIdx].mCurrent, static_cast<unsigned int>(cols.size())));
+      }
+      // augment the rows x cols problem with a dummy column per row (track death) and a dummy row per column
+      // (track birth) so every object may go unassigned at mUnassignedCost
+      unsigned int numRows = rows.size();
+      unsigned int numCols = cols.size();
+      unsigned int size = numRows + numCols;
+      costs.assign(size * size, forbidden);
+      for (std::vector<size_t>::const_iterator pairIdx = pairs.begin(); pairIdx != pairs.end(); ++pairIdx)
+      {
+         unsigned int row = rows[mCandidatePairs[*pairIdx].mBase];
+         unsigned int col = cols[mCandidatePairs[*pairIdx].mCurrent];
+         costs[row * size + col] = mTracks[mCandidatePairs[*pairIdx].mEdge].mCost;
+      }
+      for (unsigned int row = 0; row < numRows; ++row)
+      {
+         costs[row * size + numCols + row] = mParams.mUnassignedCost;
+      }
+      for (unsigned int col = 0; col < numCols; ++col)
+      {
+         costs[(numRows + col) * size + col] = mParams.mUnassignedCost;
+         for (unsigned int dummy = numCols; dummy < size; ++dummy)
+         {
+            costs[(numRows + col) * size + dummy] = 0.0;
+         }
+      }
+      TrackingUtils::solveAssignment(costs, size, assignment);
+      for (std::vector<size_t>::const_iterator pairIdx = pairs.begin(); pairIdx != pairs.end(); ++pairIdx)
+      {
+         unsigned int row = rows[mCandidatePairs[*pairIdx].mBase];
+         unsigned int col = cols[mCandidatePairs[*pairIdx].mCurrent];
+         mCandidatePairs[*pairIdx].mKeep = (assignment[row] == col);
+      }
+   }
+}
+
+unsigned int TrackingPipeline::findComponent(unsigned int node)
+{
+   while (mComponentParent[node] != node)
+   {
+      mComponentParent[node] = mComponentParent[mComponentParent[node]];
+      node = mComponentParent[node];
+   }
+   return node;
+}
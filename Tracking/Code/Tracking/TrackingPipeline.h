@@ -0,0 +1,420 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef TRACKINGPIPELINE_H__
+#define TRACKINGPIPELINE_H__
+
+#include "LocationType.h"
+#include "TrackingUtils.h"
+#include <boost/graph/graph_traits.hpp>
+#include <boost/graph/adjacency_list.hpp>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+class CBlobResult;
+
+// Define this to calculate connected components on the object results
+#define CONNECTED
+
+// Maximum number of corners to use when calculating optical flow.
+// Higher numbers may result in more accurate calculations but may also slow down calculations.
+// There's a point where increasing this number does nothing as there are only so many strong corners in a frame.
+#define MAX_CORNERS 500
+
+/**
+ * A copy of the tracked area of one frame.
+ *
+ * Snapshots are taken on the GUI thread so the pipeline never touches the data set.
+ */
+struct FrameSnapshot
+{
+   FrameSnapshot() : mFrameNum(-1), mWidth(0), mHeight(0), mDepth(IPL_DEPTH_8U), mOrigin(0, 0), mReset(false), mGeneration(0) {}
+
+   void swap(FrameSnapshot& other);
+
+   int mFrameNum;
+   int mWidth;
+   int mHeight;
+   int mDepth;                       // IPL_DEPTH_8U, IPL_DEPTH_16U, IPL_DEPTH_16S or IPL_DEPTH_32F
+   std::vector<unsigned char> mData; // mWidth x mHeight samples of mDepth, no row padding
+   Opticks::PixelLocation mOrigin;   // upper left pixel of the tracked area in the data set (active numbers)
+   bool mReset;                      // start over with this frame as the base frame
+   unsigned int mGeneration;         // incremented by the manager each time the tracked area changes
+};
+
+/**
+ * A detection which has left the live track graph.
+ */
+struct TrackPoint
+{
+   TrackPoint() : mTrackId(0), mFrameNum(-1), mCentroid(0, 0), mPixel(0, 0), mDispersion(0.0f), mGeneration(0) {}
+
+   unsigned int mTrackId;
+   int mFrameNum;
+   LocationType mCentroid; // pixel position in the tracked area of mFrameNum
+   LocationType mPixel;    // pixel position in the data set (active numbers)
+   float mDispersion;
+   unsigned int mGeneration; // generation of the frame the object was detected in
+};
+
+/**
+ * The results of one frame, published back to the GUI thread.
+ */
+struct TrackUpdate
+{
+   TrackUpdate() : mFrameNum(-1), mBaseFrameNum(-1), mRegistered(false), mGeneration(0) {}
+
+   void swap(TrackUpdate& other);
+
+   /**
+    * Reset the results, keeping the storage of the buffers.
+    */
+   void clear();
+
+   int mFrameNum;
+   int mBaseFrameNum;
+   bool mRegistered; // false when the frame was a reset or could not be registered to the base frame
+   unsigned int mGeneration;
+   std::vector<std::pair<LocationType, LocationType> > mFlowVectors;   // base corner to current corner
+   std::vector<std::pair<LocationType, LocationType> > mTrackSegments; // matched base object to current object
+   std::vector<unsigned char> mWarpedBase;     // the base frame warped to the current camera position, in the snapshot's depth
+   std::vector<unsigned char> mCurrentObjects; // labeled object masks, same geometry as the snapshot
+   std::vector<unsigned char> mBaseObjects;
+   std::deque<TrackPoint> mRetired; // detections which left the track window, from the pipeline's track history
+   std::string mError;
+};
+
+enum MotionModel
+{
+   MOTION_NONE,                 // gate on the previous position
+   MOTION_CONSTANT_VELOCITY,
+   MOTION_CONSTANT_ACCELERATION
+};
+
+/**
+ * Tunable tracking parameters.
+ */
+struct TrackingParameters
+{
+   TrackingParameters() :
+      mTrackWindow(30),
+      mHistorySize(1000000),
+      mGateRadius(150.0),
+      mGlobalAssignment(false),
+      mUnassignedCost(1000.0),
+      mMotionModel(MOTION_NONE),
+      mGateSigma(3.0),
+      mMeasurementNoise(2.0),
+      mProcessNoise(1.0),
+      mMaxCoastFrames(5),
+      mRansacMaxIterations(200),
+      mRansacConfidence(0.99),
+      mRansacGuided(false),
+      mObjectThreshold(15.0) {}
+
+   unsigned int mTrackWindow; // number of processed frames whose detections stay in the live track graph, at least 2
+   unsigned int mHistorySize; // maximum number of retired detections kept in the track history, 0 for no limit
+   double mGateRadius;        // maximum movement in pixels between frames, lower values shrink the association search space
+   bool mGlobalAssignment;    // solve the minimum total cost assignment instead of matching each base object greedily
+   double mUnassignedCost;    // cost of leaving an object unmatched in the global assignment
+   MotionModel mMotionModel;  // Kalman filter model used to predict each track's position
+   double mGateSigma;         // gate radius in standard deviations of the predicted position, capped at mGateRadius
+   double mMeasurementNoise;  // standard deviation of a detected centroid in pixels
+   double mProcessNoise;      // standard deviation of the unmodeled acceleration (or jerk) in pixels per frame^2 (^3)
+   unsigned int mMaxCoastFrames; // frames a filtered track may go undetected before it ends, less than mTrackWindow
+   int mRansacMaxIterations;  // registration iteration cap, fewer are used once the inlier ratio is known
+   double mRansacConfidence;  // probability of drawing an outlier free sample before registration stops early
+   bool mRansacGuided;        // rank the flow vectors by tracking error and use PROSAC style sampling with local optimization
+   double mObjectThreshold;   // object detection threshold in 8-bit levels, mapped through the display range of other depths
+};
+
+/**
+ * Kalman filter for the position of one track.
+ *
+ * The x and y axes are filtered independently with a constant velocity or constant acceleration model
+ * and a position measurement. Time is measured in frames.
+ */
+class MotionFilter
+{
+public:
+   MotionFilter();
+
+   /**
+    * Start the filter at rest.
+    *
+    * @param model
+    *        The motion model. MOTION_NONE is treated as constant velocity.
+    * @param position
+    *        The initial position.
+    * @param positionVar
+    *        The initial position variance.
+    * @param velocityVar
+    *        The initial velocity variance. Acceleration starts with the same variance.
+    */
+   void initialize(MotionModel model, LocationType position, double positionVar, double velocityVar);
+
+   /**
+    * Move the state into the next frame's coordinates.
+    *
+    * The covariance is not rotated so this assumes the frame to frame rotation and scale are small.
+    *
+    * @param pMap
+    *        The 2x3 affine map from the previous frame to the next frame.
+    */
+   void transform(const CvMat* pMap);
+
+   void predict(double dt, double processVar);
+   void update(LocationType position, double measurementVar);
+   LocationType getPosition() const;
+
+   /**
+    * Get the larger of the two axes' innovation variances.
+    */
+   double getInnovationVariance(double measurementVar) const;
+
+private:
+   unsigned int mOrder; // 2 for constant velocity, 3 for constant acceleration
+   double mState[2][3];
+   double mCov[2][3][3];
+};
+
+/**
+ * The frame to frame tracking algorithm.
+ *
+ * The base frame is registered to each new frame with optical flow and a RANSAC affine fit, the
+ * frames are differenced to find moving objects and the objects are matched to the previous frame's
+ * objects to extend the tracks.
+ *
+ * 8-bit frames are processed as they are. 16-bit and floating point frames are detected and measured in
+ * their own units with floating point working images. Only the optical flow stage sees them scaled to
+ * 8-bit, using a range taken from each frame's histogram. The base frame is rescaled along with the
+ * current frame when the range moves, so both frames always share a scale. The object threshold is given in
+ * 8-bit levels and mapped through the same range, and non-finite samples are left out of the range.
+ *
+ * The pipeline keeps all state between frames and has no GUI or data set dependencies so it may run on
+ * any one thread at a time.
+ *
+ * Each base object is connected to the current objects inside its gate. By default each base object keeps
+ * its cheapest connection. With TrackingParameters::mGlobalAssignment the connections are chosen to minimize
+ * the total cost, one to one, with each connected group of gated objects solved independently.
+ *
+ * With a TrackingParameters::mMotionModel each track carries a MotionFilter. The gate is centered on the
+ * filter's prediction and sized from its covariance, and a track which isn't detected keeps predicting
+ * for up to TrackingParameters::mMaxCoastFrames frames so it survives short occlusions.
+ *
+ * Only the detections from the last TrackingParameters::mTrackWindow frames are kept in the track graph.
+ * Older detections are retired to a flat track history so the per-frame cost stays constant on long feeds.
+ */
+class TrackingPipeline
+{
+public:
+   struct TrackVertexProps
+   {
+      TrackVertexProps() : mTrackId(0), mFrameNum(-1), mCentroidA(0,0), mCentroidB(0,0), mTexture(0.0), mDispersion(0.0) {}
+
+      unsigned int mTrackId;             // shared by every detection of an object, 0 until assigned
+      int mFrameNum;                     // frame number where this objects was found
+      Opticks::PixelLocation mCentroidA; // position when this is the "current" frame (pre-transform)
+      Opticks::PixelLocation mCentroidB; // position when this is the "base" frame (post-transform)
+      float mTexture;                    // grayscale texture
+      float mDispersion;                 // grayscale dispersion
+      // optional HSI sig goes here
+   };
+   struct TrackEdgeProps
+   {
+      TrackEdgeProps() : mVelocity(0,0), mVelDiff(0.0), mSpeedDiff(0.0), mDiffDispersion(0.0) {}
+
+      Opticks::Location<int, 2> mVelocity; // previous frame's centroid B to this frame's centroid A
+      float mVelDiff;                      // angular difference between this velocity vector and the previous location's  
+      float mSpeedDiff;                    // magnitude difference between this velocity vector and the previous location's  
+      float mDiffDispersion;               // difference in dispersion values
+      float mCost;                         // total "cost" of this track
+   };
+   // vertices are stored in a list so retiring old detections doesn't invalidate the live vertex descriptors
+   typedef boost::adjacency_list<boost::vecS, boost::listS, boost::bidirectionalS, TrackVertexProps, TrackEdgeProps> TrackGraph;
+   typedef boost::graph_traits<TrackGraph> TrackTraits;
+   typedef boost::graph_traits<TrackGraph>::vertex_descriptor TrackVertex;
+   typedef boost::graph_traits<TrackGraph>::edge_descriptor TrackEdge;
+
+   TrackingPipeline();
+   ~TrackingPipeline();
+
+   /**
+    * Process a frame.
+    *
+    * A reset frame becomes the new base frame. Any other frame is registered to the base frame, its
+    * objects are matched to the tracks and it becomes the base frame for the next call.
+    *
+    * @param frame
+    *        The frame. Its geometry must match the last reset frame.
+    * @param update
+    *        Set to the results. Its previous contents are cleared but its buffers are reused. OpenCV errors
+    *        and frames which can't be compared to the base frame are reported in mError.
+    */
+   void process(const FrameSnapshot& frame, TrackUpdate& update);
+
+   void setParameters(const TrackingParameters& params);
+   const TrackingParameters& getParameters() const;
+
+   const TrackGraph& getTracks() const;
+
+   /**
+    * Access the retired detections, oldest first.
+    */
+   const std::deque<TrackPoint>& getTrackHistory() const;
+
+   /**
+    * Move the retired detections to the end of a container.
+    *
+    * @param history
+    *        The retired detections are appended to this. The pipeline's history is left empty.
+    */
+   void takeTrackHistory(std::deque<TrackPoint>& history);
+
+   /**
+    * Retire every live detection to the track history.
+    */
+   void retireAll();
+
+   /**
+    * Get the number of processed frames which had to grow a per-frame buffer.
+    *
+    * This counts the update buffers and the object lists. It stops increasing once the frame size and
+    * the number of objects per frame have been seen at their largest, so a steady feed allocates nothing.
+    */
+   unsigned int getBufferGrowthCount() const;
+
+private:
+   TrackingPipeline(const TrackingPipeline&);
+   TrackingPipeline& operator=(const TrackingPipeline&);
+
+   /**
+    * Allocate the per-frame images for a frame geometry.
+    *
+    * The images are kept between frames and only reallocated when the geometry changes.
+    */
+   void allocateBuffers(int width, int height, int depth);
+   void initializeBaseFrame(const FrameSnapshot& frame);
+
+   /**
+    * Copy a snapshot into the working image for its depth.
+    */
+   void loadFrame(const FrameSnapshot& frame, IplImage* pFrame, IplImage* pWork);
+
+   /**
+    * Find the 8-bit display range of a working image from robust percentiles of its histogram.
+    */
+   void calculateRange(const IplImage* pWork, double& low, double& high);
+   void thresholdObjects(const IplImage* pFrame, IplImage* pMask);
+   void processFrame(const FrameSnapshot& frame, TrackUpdate& update);
+   void findCorners();
+   void updateTrackObjects(CBlobResult& blobs, IplImage* pFrame, bool current, std::vector<TrackVertex>& objects);
+   size_t getBufferCapacity(const TrackUpdate& update) const;
+   void matchTracks(const std::vector<TrackVertex>& curObjs, TrackUpdate& update);
+   void predictMotion(const CvMat* pMap);
+   void buildMatchRows();
+   void updateMotion(const std::vector<TrackVertex>& curObjs);
+   void assignGreedy();
+   void assignGlobal(size_t currentCount);
+   unsigned int findComponent(unsigned int node);
+   void retireFrames(size_t keep);
+
+   TrackingParameters mParams;
+   TrackGraph mTracks;
+   RecycledQueue<std::vector<TrackVertex> > mWindow; // live vertices, one entry per processed frame, oldest first
+   std::deque<TrackPoint> mHistory;
+   unsigned int mNextTrackId;
+
+   struct TrackMotion
+   {
+      MotionFilter mFilter;
+      TrackVertex mVertex;  // the track's last detection
+      LocationType mPrior;  // the filter position in the current frame before prediction
+      int mFrameNum;        // the frame the filter has been predicted to
+      unsigned int mMissed; // consecutive frames without a detection
+      bool mUpdated;
+   };
+   std::map<unsigned int, TrackMotion> mMotion; // keyed by track id
+
+   // association scratch space
+   struct MatchRow
+   {
+      TrackVertex mVertex;     // base object or the last detection of a coasting track
+      LocationType mReference; // position the velocity is measured from
+      LocationType mCenter;    // gate center
+      double mRadius;          // gate radius
+   };
+   struct CandidatePair
+   {
+      unsigned int mBase;    // index in mMatchRows
+      unsigned int mCurrent; // index in the current objects
+      TrackEdge mEdge;
+      bool mKeep;
+   };
+   SpatialGrid mCandidateGrid;
+   std::vector<LocationType> mCandidatePositions;
+   std::vector<unsigned int> mGatedCandidates;
+   std::vector<MatchRow> mMatchRows;
+   std::vector<CandidatePair> mCandidatePairs;
+   std::vector<unsigned int> mComponentParent; // union-find forest over the base and current objects
+
+   bool mCalcBaseObjects; // should the base objects be calculated or results from the previous iteration used?
+   std::vector<TrackVertex> mBaseObjects;
+   std::vector<TrackVertex> mCurObjects; // swapped with mBaseObjects at the end of each frame
+
+   // base frame information, passed to the next iteration
+   int mBaseFrameNum;
+   Opticks::PixelLocation mOrigin; // tracked area origin and generation of the last reset frame
+   unsigned int mGeneration;
+   IplImageResource mpBaseFrame;
+   IplImageResource mpBasePyramid;
+   bool mBasePyramidReady; // was the base pyramid built by the previous optical flow call?
+   std::vector<CvPoint2D32f> mBaseCorners;
+
+   // current frame buffers, swapped with the base frame buffers at the end of each frame
+   IplImageResource mpCurFrame;
+   IplImageResource mpCurPyramid;
+   std::vector<CvPoint2D32f> mCurCorners;
+
+   // floating point working images when the frames aren't 8-bit
+   int mDepth;
+   IplImageResource mpBaseWork;
+   IplImageResource mpCurWork;
+   IplImageResource mpXformWork;
+   IplImageResource mpThresholdWork;
+   double mRangeLow;  // range mapped to 0-255 in mpBaseFrame and mpCurFrame
+   double mRangeHigh;
+   std::vector<unsigned int> mHistogram;
+
+   // scratch buffers
+   IplImageResource mpEigImage;
+   IplImageResource mpTmpImage;
+   IplImageResource mpXform;
+   IplImageResource mpTemp;
+   IplImageResource mpRes;
+   IplImageResource mpRes2;
+   std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> > mCorrespondences;
+
+   // pass feature state to the next iteration
+   char mpFeaturesFound[MAX_CORNERS];
+   float mpFeatureErrors[MAX_CORNERS];
+
+   int mCurrentFrameNum;
+   int mCornerCount;
+   unsigned int mBufferGrowths;
+
+   // registration
+   AffineRansac mRansac;
+   std::vector<std::pair<float, int> > mRankedFeatures; // tracking error and corner index of each usable flow vector
+   CvMat* mpMapMatrix;
+};
+
+#endif
@@ -11,6 +11,9 @@
 #include "LocationType.h"
 #include "RasterData.h"
 #include "TrackingUtils.h"
+#include <algorithm>
+#include <limits>
+#include <math.h>
 #include <stdlib.h>
 #include <opencv/cv.h>
 
@@ -105,77 +108,89 @@ uint8_t calculateNeededLevels(uint32_t maxSubcubeSize,
    return 0xff; // Invalid return
 }
 
-CvMat* ransac_affine(std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr, int maxIter, float thresh, unsigned int numNeeded)
+CvMat* ransac_affine(const std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr, int maxIter, float thresh,
+                     unsigned int numNeeded, unsigned int seed)
 {
-   if (corr.empty())
+   AffineRansac ransac(seed);
+   ransac.setMaxIterations(maxIter);
+   ransac.setThreshold(thresh);
+   ransac.setMinInliers(numNeeded);
+   CvMat* pMap = cvCreateMat(2, 3, CV_32F);
+   if (!ransac.estimate(corr, pMap))
    {
-      return NULL;
+      cvReleaseMat(&pMap);
    }
-   thresh = thresh * thresh; // calculating sqrt for each test is expensive, so we square the check value to change from RMS to MSE
-   unsigned int bestCount = 0;
-   CvMat* pBest = NULL;
-   CvMat* pTest = cvCreateMat(2, 3, CV_32F);
-   CvMat* pVer = cvCreateMat(3, 1, CV_32F);
-   CvMat* pVerRes = cvCreateMat(2, 1, CV_32F);
-   pVer->data.fl[2] = 1.0;
-   for (int it = 0; it < maxIter; ++it)
-   {
-      // build mss
-      int pMss[3];
-      pMss[0] = rand() % corr.size();
-      do
-      {
-         pMss[1] = rand() % corr.size();
-      }
-      while (pMss[1] == pMss[0]);
-      do
-      {
-         pMss[2] = rand() % corr.size();
-      }
-      while (pMss[2] == pMss[0] || pMss[2] == pMss[1]);
-      CvPoint2D32f pSrc[3] = {corr[pMss[0]].first, corr[pMss[1]].first, corr[pMss[2]].first};
-      CvPoint2D32f pDst[3] = {corr[pMss[0]].second, corr[pMss[1]].second, corr[pMss[2]].second};
-
-      cvGetAffineTransform(pSrc, pDst, pTest);
+   return pMap;
+}
 
-      // test the mss
-      unsigned int fitCount = 0;
-      for (unsigned int j = 0; j < corr.size(); ++j)
+void solveAssignment(const std::vector<double>& costs, unsigned int size, std::vector<unsigned int>& assignment)
+{
+   // 1 based so column 0 can act as the root of each augmenting path
+   std::vector<double> rowPotential(size + 1, 0.0);
+   std::vector<double> colPotential(size + 1, 0.0);
+   std::vector<unsigned int> colRow(size + 1, 0); // row assigned to each column, 0 if none
+   std::vector<unsigned int> prevCol(size + 1, 0);
+   std::vector<double> minSlack(size + 1);
+   std::vector<char> used(size + 1);
+   for (unsigned int row = 1; row <= size; ++row)
+   {
+      colRow[0] = row;
+      unsigned int col0 = 0;
+      std::fill(minSlack.begin(), minSlack.end(), std::numeric_limits<double>::max());
+      std::fill(used.begin(), used.end(), 0);
+      do
       {
-         if (j == pMss[0] || j == pMss[1] || j == pMss[2])
+         used[col0] = 1;
+         unsigned int row0 = colRow[col0];
+         unsigned int col1 = 0;
+         double delta = std::numeric_limits<double>::max();
+         for (unsigned int col = 1; col <= size; ++col)
          {
-            continue;
+            if (used[col])
+            {
+               continue;
+            }
+            double slack = costs[(row0 - 1) * size + (col - 1)] - rowPotential[row0] - colPotential[col];
+            if (slack < minSlack[col])
+            {
+               minSlack[col] = slack;
+               prevCol[col] = col0;
+            }
+            if (minSlack[col] < delta)
+            {
+               delta = minSlack[col];
+               col1 = col;
+            }
          }
-         pVer->data.fl[0] = corr[j].first.x;
-         pVer->data.fl[1] = corr[j].first.y;
-         cvGEMM(pTest, pVer, 1.0, NULL, 0.0, pVerRes);
-         float tmpX = pVerRes->data.fl[0] - corr[j].second.x;
-         float tmpY = pVerRes->data.fl[1] - corr[j].second.y;
-         float mse = (tmpX * tmpX + tmpY * tmpY) / 2.0f;
-         if (mse < thresh)
+         for (unsigned int col = 0; col <= size; ++col)
          {
-            // fits the affine transform
-            fitCount++;
+            if (used[col])
+            {
+               rowPotential[colRow[col]] += delta;
+               colPotential[col] -= delta;
+            }
+            else
+            {
+               minSlack[col] -= delta;
+            }
          }
+         col0 = col1;
       }
-      if (fitCount >= numNeeded && fitCount > bestCount)
+      while (colRow[col0] != 0);
+      // augment along the path
+      do
       {
-         if (pBest == NULL)
-         {
-            pBest = pTest;
-            pTest = cvCreateMat(2, 3, CV_32F);
-         }
-         else
-         {
-            std::swap(pBest, pTest);
-         }
-         bestCount = fitCount;
+         unsigned int col1 = prevCol[col0];
+         colRow[col0] = colRow[col1];
+         col0 = col1;
       }
+      while (col0 != 0);
+   }
+   assignment.resize(size);
+   for (unsigned int col = 1; col <= size; ++col)
+   {
+      assignment[colRow[col] - 1] = col - 1;
    }
-   cvReleaseMat(&pTest);
-   cvReleaseMat(&pVer);
-   cvReleaseMat(&pVerRes);
-   return pBest;
 }
 }
 
@@ -187,7 +202,7 @@ IplImageResource::IplImageResource(IplImage* pImage) : mpImage(pImage), mShallow
 {
 }
 
-IplImageResource::IplImageResource(const IplImageResource& other)
+IplImageResource::IplImageResource(const IplImageResource& other) : mpImage(NULL), mShallow(false)
 {
    reset(const_cast<IplImage*>(other.get()));
    if (other.isShallow())
@@ -270,6 +285,11 @@ IplImage& IplImageResource::operator*()
 
 IplImageResource& IplImageResource::operator=(const IplImageResource& other)
 {
+   if (&other == this)
+   {
+      return *this;
+   }
+   reset(NULL); // don't leak an image we own
    mShallow = other.mShallow;
    mpImage = other.mpImage;
    const_cast<IplImageResource&>(other).mShallow = true;
@@ -277,6 +297,422 @@ IplImageResource& IplImageResource::operator=(const IplImageResource& other)
    return *this;
 }
 
+void IplImageResource::swap(IplImageResource& other)
+{
+   std::swap(mpImage, other.mpImage);
+   std::swap(mShallow, other.mShallow);
+}
+
+SpatialGrid::SpatialGrid() : mOrigin(0.0, 0.0), mCellSize(1.0), mColumns(0), mRows(0)
+{
+}
+
+void SpatialGrid::build(const std::vector<LocationType>& points, double cellSize)
+{
+   mPoints = points;
+   mCellSize = std::max(cellSize, 1.0);
+   mColumns = 0;
+   mRows = 0;
+   mCellStart.clear();
+   mCellPoints.clear();
+   if (mPoints.empty())
+   {
+      return;
+   }
+
+   LocationType minPt = mPoints.front();
+   LocationType maxPt = mPoints.front();
+   for (std::vector<LocationType>::const_iterator pt = mPoints.begin(); pt != mPoints.end(); ++pt)
+   {
+      minPt.mX = std::min(minPt.mX, pt->mX);
+      minPt.mY = std::min(minPt.mY, pt->mY);
+      maxPt.mX = std::max(maxPt.mX, pt->mX);
+      maxPt.mY = std::max(maxPt.mY, pt->mY);
+   }
+   mOrigin = minPt;
+
+   // grow the cells if a sparse point set would need more cells than points
+   double maxCells = 4.0 * mPoints.size() + 16.0;
+   while (((maxPt.mX - minPt.mX) / mCellSize + 1.0) * ((maxPt.mY - minPt.mY) / mCellSize + 1.0) > maxCells)
+   {
+      mCellSize *= 2.0;
+   }
+   mColumns = static_cast<int>((maxPt.mX - minPt.mX) / mCellSize) + 1;
+   mRows = static_cast<int>((maxPt.mY - minPt.mY) / mCellSize) + 1;
+
+   // counting sort the points into the cells
+   std::vector<unsigned int>& cells = mPointCells;
+   cells.resize(mPoints.size());
+   mCellStart.assign(mColumns * mRows + 1, 0);
+   for (size_t idx = 0; idx < mPoints.size(); ++idx)
+   {
+      int col = static_cast<int>((mPoints[idx].mX - mOrigin.mX) / mCellSize);
+      int row = static_cast<int>((mPoints[idx].mY - mOrigin.mY) / mCellSize);
+      cells[idx] = row * mColumns + col;
+      mCellStart[cells[idx] + 1]++;
+   }
+   for (size_t cell = 1; cell < mCellStart.size(); ++cell)
+   {
+      mCellStart[cell] += mCellStart[cell - 1];
+   }
+   mCellPoints.resize(mPoints.size());
+   std::vector<unsigned int>& next = mCellNext;
+   next.assign(mCellStart.begin(), mCellStart.end() - 1);
+   for (size_t idx = 0; idx < mPoints.size(); ++idx)
+   {
+      mCellPoints[next[cells[idx]]++] = static_cast<unsigned int>(idx);
+   }
+}
+
+void SpatialGrid::findWithin(LocationType center, double radius, std::vector<unsigned int>& indices) const
+{
+   indices.clear();
+   if (mPoints.empty() || radius <= 0.0)
+   {
+      return;
+   }
+   int minCol = std::max(0, static_cast<int>(floor((center.mX - radius - mOrigin.mX) / mCellSize)));
+   int maxCol = std::min(mColumns - 1, static_cast<int>(floor((center.mX + radius - mOrigin.mX) / mCellSize)));
+   int minRow = std::max(0, static_cast<int>(floor((center.mY - radius - mOrigin.mY) / mCellSize)));
+   int maxRow = std::min(mRows - 1, static_cast<int>(floor((center.mY + radius - mOrigin.mY) / mCellSize)));
+   double radiusSqr = radius * radius;
+   for (int row = minRow; row <= maxRow; ++row)
+   {
+      for (int col = minCol; col <= maxCol; ++col)
+      {
+         int cell = row * mColumns + col;
+         for (unsigned int entry = mCellStart[cell]; entry < mCellStart[cell + 1]; ++entry)
+         {
+            const LocationType& pt = mPoints[mCellPoints[entry]];
+            double dx = pt.mX - center.mX;
+            double dy = pt.mY - center.mY;
+            if (dx * dx + dy * dy < radiusSqr)
+            {
+               indices.push_back(mCellPoints[entry]);
+            }
+         }
+      }
+   }
+   std::sort(indices.begin(), indices.end());
+}
+
+namespace
+{
+// solve a 3x3 linear system with Cramer's rule, false if it is singular
+bool solve3(const double A[3][3], const double b[3], double* pX)
+{
+   double det = A[0][0] * (A[1][1] * A[2][2] - A[1][2] * A[2][1])
+              - A[0][1] * (A[1][0] * A[2][2] - A[1][2] * A[2][0])
+              + A[0][2] * (A[1][0] * A[2][1] - A[1][1] * A[2][0]);
+   if (fabs(det) < 1e-9)
+   {
+      return false;
+   }
+   for (int col = 0; col < 3; ++col)
+   {
+      double M[3][3];
+      for (int row = 0; row < 3; ++row)
+      {
+         for (int k = 0; k < 3; ++k)
+         {
+            M[row][k] = (k == col) ? b[row] : A[row][k];
+         }
+      }
+      pX[col] = (M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+               - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+               + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0])) / det;
+   }
+   return true;
+}
+}
+
+AffineRansac::AffineRansac(unsigned int seed) :
+      mState(1),
+      mMode(STANDARD),
+      mMaxIter(200),
+      mThreshold(5.0f),
+      mNumNeeded(5),
+      mConfidence(0.99),
+      mInlierCount(0),
+      mIterations(0)
+{
+   this->seed(seed);
+}
+
+void AffineRansac::seed(unsigned int seed)
+{
+   mState = seed * 2654435761U + 0x9E3779B9U;
+   if (mState == 0)
+   {
+      mState = 1;
+   }
+}
+
+void AffineRansac::setMode(Mode mode)
+{
+   mMode = mode;
+}
+
+void AffineRansac::setMaxIterations(int maxIter)
+{
+   mMaxIter = maxIter;
+}
+
+void AffineRansac::setThreshold(float thresh)
+{
+   mThreshold = thresh;
+}
+
+void AffineRansac::setMinInliers(unsigned int numNeeded)
+{
+   mNumNeeded = numNeeded;
+}
+
+void AffineRansac::setConfidence(double confidence)
+{
+   mConfidence = confidence;
+}
+
+unsigned int AffineRansac::getInlierCount() const
+{
+   return mInlierCount;
+}
+
+int AffineRansac::getIterationCount() const
+{
+   return mIterations;
+}
+
+unsigned int AffineRansac::random(unsigned int limit)
+{
+   // xorshift32
+   mState ^= mState << 13;
+   mState ^= mState >> 17;
+   mState ^= mState << 5;
+   return (limit == 0) ? 0 : mState % limit;
+}
+
+unsigned int AffineRansac::score(const double* pModel)
+{
+   // the model is x' = m0 x + m1 y + m2, y' = m3 x + m4 y + m5
+   // compare the mean squared residual with the squared threshold so no sqrt is needed
+   float m0 = static_cast<float>(pModel[0]);
+   float m1 = static_cast<float>(pModel[1]);
+   float m2 = static_cast<float>(pModel[2]);
+   float m3 = static_cast<float>(pModel[3]);
+   float m4 = static_cast<float>(pModel[4]);
+   float m5 = static_cast<float>(pModel[5]);
+   float threshSqr = mThreshold * mThreshold;
+   size_t count = mSrcX.size();
+   const float* pSrcX = &mSrcX.front();
+   const float* pSrcY = &mSrcY.front();
+   const float* pDstX = &mDstX.front();
+   const float* pDstY = &mDstY.front();
+   float* pError = &mError.front();
+   for (size_t idx = 0; idx < count; ++idx)
+   {
+      float dx = m0 * pSrcX[idx] + m1 * pSrcY[idx] + m2 - pDstX[idx];
+      float dy = m3 * pSrcX[idx] + m4 * pSrcY[idx] + m5 - pDstY[idx];
+      pError[idx] = (dx * dx + dy * dy) * 0.5f;
+   }
+   unsigned int inliers = 0;
+   for (size_t idx = 0; idx < count; ++idx)
+   {
+      inliers += (pError[idx] < threshSqr) ? 1 : 0;
+   }
+   return inliers;
+}
+
+bool AffineRansac::fitInliers(double* pModel)
+{
+   // least squares fit to the inliers marked in mError by the last call to score()
+   float threshSqr = mThreshold * mThreshold;
+   double AtA[3][3] = { {0.0} };
+   double Atx[3] = {0.0, 0.0, 0.0};
+   double Aty[3] = {0.0, 0.0, 0.0};
+   for (size_t idx = 0; idx < mSrcX.size(); ++idx)
+   {
+      if (mError[idx] >= threshSqr)
+      {
+         continue;
+      }
+      double row[3] = {mSrcX[idx], mSrcY[idx], 1.0};
+      for (int i = 0; i < 3; ++i)
+      {
+         for (int j = 0; j < 3; ++j)
+         {
+            AtA[i][j] += row[i] * row[j];
+         }
+         Atx[i] += row[i] * mDstX[idx];
+         Aty[i] += row[i] * mDstY[idx];
+      }
+   }
+   return solve3(AtA, Atx, pModel) && solve3(AtA, Aty, pModel + 3);
+}
+
+bool AffineRansac::guidedDone(unsigned int pool, unsigned int bestCount) const
+{
+   // the sampling pool must be large enough that its inlier ratio means something
+   if (bestCount < mNumNeeded + 3 || pool < std::min<size_t>(mSrcX.size(), 2 * (mNumNeeded + 3)))
+   {
+      return false;
+   }
+   // stop once an all-inlier sample should have been drawn from the pool
+   double inlierRatio = static_cast<double>(mBestPrefix[pool]) / pool;
+   double noGoodSample = 1.0 - inlierRatio * inlierRatio * inlierRatio;
+   if (noGoodSample <= 0.0)
+   {
+      return true;
+   }
+   return noGoodSample < 1.0 && mIterations + 1 >= log(1.0 - mConfidence) / log(noGoodSample);
+}
+
+bool AffineRansac::estimate(const std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr, CvMat* pMap)
+{
+   mInlierCount = 0;
+   mIterations = 0;
+   unsigned int count = corr.size();
+   if (count < 3 || pMap == NULL)
+   {
+      return false;
+   }
+   mSrcX.resize(count);
+   mSrcY.resize(count);
+   mDstX.resize(count);
+   mDstY.resize(count);
+   mError.resize(count);
+   for (unsigned int idx = 0; idx < count; ++idx)
+   {
+      mSrcX[idx] = corr[idx].first.x;
+      mSrcY[idx] = corr[idx].first.y;
+      mDstX[idx] = corr[idx].second.x;
+      mDstY[idx] = corr[idx].second.y;
+   }
+
+   double best[6];
+   unsigned int bestCount = 0;
+   int neededIter = mMaxIter;
+   int growIter = std::max(1, mMaxIter / 2);
+   for (mIterations = 0; mIterations < neededIter; ++mIterations)
+   {
+      // build mss, guided mode draws from the best ranked correspondences first
+      unsigned int pool = count;
+      if (mMode == GUIDED)
+      {
+         pool = std::min(count, 3 + static_cast<unsigned int>(static_cast<double>(count - 3) * mIterations / growIter));
+      }
+      unsigned int pMss[3];
+      pMss[0] = random(pool);
+      do
+      {
+         pMss[1] = random(pool);
+      }
+      while (pMss[1] == pMss[0]);
+      do
+      {
+         pMss[2] = random(pool);
+      }
+      while (pMss[2] == pMss[0] || pMss[2] == pMss[1]);
+
+      double A[3][3];
+      double bx[3];
+      double by[3];
+      for (int i = 0; i < 3; ++i)
+      {
+         A[i][0] = mSrcX[pMss[i]];
+         A[i][1] = mSrcY[pMss[i]];
+         A[i][2] = 1.0;
+         bx[i] = mDstX[pMss[i]];
+         by[i] = mDstY[pMss[i]];
+      }
+      double model[6];
+      if (!solve3(A, bx, model) || !solve3(A, by, model + 3))
+      {
+         continue; // collinear sample
+      }
+
+      // test the mss
+      unsigned int fitCount = score(model);
+      if (fitCount <= bestCount)
+      {
+         if (mMode == GUIDED && guidedDone(pool, bestCount))
+         {
+            ++mIterations;
+            break;
+         }
+         continue;
+      }
+      if (mMode == GUIDED)
+      {
+         // local optimization, refit to the inliers while the support doesn't shrink
+         for (int refine = 0; refine < 3; ++refine)
+         {
+            double refined[6];
+            if (!fitInliers(refined))
+            {
+               break;
+            }
+            unsigned int refinedCount = score(refined);
+            if (refinedCount < fitCount)
+            {
+               score(model); // restore the inlier marks
+               break;
+            }
+            std::copy(refined, refined + 6, model);
+            bool grew = (refinedCount > fitCount);
+            fitCount = refinedCount;
+            if (!grew)
+            {
+               break;
+            }
+         }
+         // inlier counts over each leading subset for the stopping test
+         mBestPrefix.resize(count + 1);
+         mBestPrefix[0] = 0;
+         float threshSqr = mThreshold * mThreshold;
+         for (unsigned int idx = 0; idx < count; ++idx)
+         {
+            mBestPrefix[idx + 1] = mBestPrefix[idx] + ((mError[idx] < threshSqr) ? 1 : 0);
+         }
+      }
+      std::copy(model, model + 6, best);
+      bestCount = fitCount;
+
+      if (mMode == GUIDED && guidedDone(pool, bestCount))
+      {
+         ++mIterations;
+         break;
+      }
+
+      // stop once an all-inlier sample should have been drawn
+      double inlierRatio = static_cast<double>(bestCount) / count;
+      double noGoodSample = 1.0 - inlierRatio * inlierRatio * inlierRatio;
+      if (noGoodSample <= 0.0)
+      {
+         neededIter = mIterations + 1;
+      }
+      else if (noGoodSample < 1.0)
+      {
+         double adaptive = log(1.0 - mConfidence) / log(noGoodSample);
+         if (adaptive < neededIter)
+         {
+            neededIter = std::max(mIterations + 1, static_cast<int>(ceil(adaptive)));
+         }
+      }
+   }
+
+   mInlierCount = bestCount;
+   if (bestCount < mNumNeeded + 3)
+   {
+      return false;
+   }
+   for (int i = 0; i < 6; ++i)
+   {
+      cvmSet(pMap, i / 3, i % 3, best[i]);
+   }
+   return true;
+}
+
 dataptr::dataptr(DataElement* pElement, DataPointerArgs args)
 {
    int own(0);
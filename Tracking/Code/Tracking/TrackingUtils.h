@@ -15,6 +15,7 @@
 #include "RasterData.h"
 
 #include <opencv/cv.h>
+#include <vector>
 #if defined(WIN_API)
 #include <boost/cstdint.hpp>
 using boost::uint8_t;
@@ -85,8 +86,30 @@ uint8_t calculateNeededLevels(uint32_t maxSubcubeSize, Opticks::PixelLocation ma
 
 /**
  * Determines the affine transform between a set of correspondances using RANSAC.
+ *
+ * This is a convenience wrapper around AffineRansac in standard mode with a 0.99 confidence.
+ *
+ * @param seed
+ *        The random number seed. The same correspondences and seed always give the same transform.
+ * @return A new 2x3 matrix which the caller must release, or NULL if no transform had enough support.
  */
-CvMat* ransac_affine(std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr, int maxIter, float thresh, unsigned int numNeeded);
+CvMat* ransac_affine(const std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr, int maxIter, float thresh,
+                     unsigned int numNeeded, unsigned int seed = 0);
+
+/**
+ * Solve a square linear assignment problem.
+ *
+ * Uses the shortest augmenting path method of Jonker and Volgenant with dual potentials, O(n^3).
+ * Forbidden pairs should be given a large finite cost and the problem must have a finite solution.
+ *
+ * @param costs
+ *        The row major size x size cost matrix.
+ * @param size
+ *        The number of rows and columns.
+ * @param assignment
+ *        Set to the column assigned to each row.
+ */
+void solveAssignment(const std::vector<double>& costs, unsigned int size, std::vector<unsigned int>& assignment);
 }
 
 /**
@@ -145,6 +168,112 @@ private:
    T* mpData;
 };
 
+/**
+ * FIFO queue which keeps the storage of removed elements for reuse.
+ *
+ * Elements move in and out with their swap() member, so a queue of buffers stops allocating once it
+ * has held its largest number of elements at their largest size. Removed elements stay behind as
+ * spare slots whose contents are stale.
+ */
+template<typename T>
+class RecycledQueue
+{
+public:
+   RecycledQueue() : mCount(0) {}
+
+   size_t size() const
+   {
+      return mCount;
+   }
+
+   bool empty() const
+   {
+      return mCount == 0;
+   }
+
+   /**
+    * Get the number of queued and spare slots.
+    */
+   size_t getSlotCount() const
+   {
+      return mSlots.size();
+   }
+
+   /**
+    * Access a slot. The queued elements come first, oldest first, followed by the spares.
+    */
+   T& operator[](size_t idx)
+   {
+      return mSlots[idx];
+   }
+
+   const T& operator[](size_t idx) const
+   {
+      return mSlots[idx];
+   }
+
+   /**
+    * Append a slot to the back of the queue.
+    *
+    * @return The slot. It holds a spare element's storage and stale contents.
+    */
+   T& pushSlot()
+   {
+      if (mCount == mSlots.size())
+      {
+         mSlots.push_back(T());
+      }
+      return mSlots[mCount++];
+   }
+
+   /**
+    * Swap an element onto the back of the queue.
+    *
+    * @param element
+    *        The element. It is left holding a spare element's storage and stale contents.
+    */
+   void push(T& element)
+   {
+      pushSlot().swap(element);
+   }
+
+   /**
+    * Swap the oldest element out of the queue.
+    *
+    * @param element
+    *        Set to the oldest element. Its previous storage is kept as a spare.
+    */
+   void pop(T& element)
+   {
+      element.swap(mSlots[0]);
+      erase(0);
+   }
+
+   /**
+    * Remove an element, keeping its storage as a spare.
+    */
+   void erase(size_t idx)
+   {
+      for (; idx + 1 < mCount; ++idx)
+      {
+         mSlots[idx].swap(mSlots[idx + 1]);
+      }
+      --mCount;
+   }
+
+   /**
+    * Remove every element, keeping their storage as spares.
+    */
+   void clear()
+   {
+      mCount = 0;
+   }
+
+private:
+   std::vector<T> mSlots; // the first mCount are queued, the rest are spares
+   size_t mCount;
+};
+
 /**
  * Resource to manage an OpenCV IplImage.
  *
@@ -168,12 +297,146 @@ public:
    operator IplImage*();
    IplImage& operator*();
    IplImageResource& operator=(const IplImageResource& other);
+   void swap(IplImageResource& other);
 
 private:
    IplImage* mpImage;
    bool mShallow;
 };
 
+/**
+ * Uniform grid index over a set of points.
+ *
+ * The points are bucketed into square cells so a radius query only tests the points in the cells
+ * which overlap the query circle. Building the index is linear in the number of points and the
+ * storage is reused between builds.
+ */
+class SpatialGrid
+{
+public:
+   SpatialGrid();
+
+   /**
+    * Index a set of points.
+    *
+    * @param points
+    *        The points. The index refers to them by position in this vector.
+    * @param cellSize
+    *        The cell edge length. Queries are cheapest when this is close to the query radius.
+    */
+   void build(const std::vector<LocationType>& points, double cellSize);
+
+   /**
+    * Find the points strictly within a radius of a location.
+    *
+    * @param center
+    *        The query location.
+    * @param radius
+    *        The query radius.
+    * @param indices
+    *        Set to the indices of the matching points in ascending order.
+    */
+   void findWithin(LocationType center, double radius, std::vector<unsigned int>& indices) const;
+
+private:
+   std::vector<LocationType> mPoints;
+   std::vector<unsigned int> mCellStart; // offset of each cell's first entry in mCellPoints, plus one trailing entry
+   std::vector<unsigned int> mCellPoints;
+   std::vector<unsigned int> mPointCells; // build scratch space
+   std::vector<unsigned int> mCellNext;
+   LocationType mOrigin;
+   double mCellSize;
+   int mColumns;
+   int mRows;
+};
+
+/**
+ * Robust affine transform estimation with RANSAC.
+ *
+ * Each instance has its own random number generator so results depend only on the seed and the input.
+ * The number of iterations adapts to the best inlier ratio found so far and stops once a better model is
+ * unlikely at the requested confidence. Each hypothesis is scored against all the correspondences in one
+ * pass over packed coordinate arrays.
+ *
+ * In guided mode the correspondences must be ordered best first. Hypotheses are drawn from a leading
+ * subset which grows to the whole set over the first half of the iteration budget (as in PROSAC), and each
+ * new best hypothesis is refined with a least squares fit to its inliers (as in LO-RANSAC). This finds a
+ * good model in far fewer iterations when most correspondences are outliers.
+ */
+class AffineRansac
+{
+public:
+   enum Mode
+   {
+      STANDARD,
+      GUIDED
+   };
+
+   AffineRansac(unsigned int seed = 0);
+
+   void seed(unsigned int seed);
+   void setMode(Mode mode);
+   void setMaxIterations(int maxIter);
+
+   /**
+    * Set the inlier threshold.
+    *
+    * @param thresh
+    *        The largest RMS of the x and y residuals of an inlier, in pixels.
+    */
+   void setThreshold(float thresh);
+
+   /**
+    * Set the support needed to accept a model.
+    *
+    * @param numNeeded
+    *        The number of inliers needed in addition to the three sample points.
+    */
+   void setMinInliers(unsigned int numNeeded);
+
+   /**
+    * Set the probability that an all-inlier sample has been drawn before stopping early.
+    */
+   void setConfidence(double confidence);
+
+   /**
+    * Estimate the transform from the first points to the second points.
+    *
+    * @param corr
+    *        The correspondences, best first in guided mode.
+    * @param pMap
+    *        A 2x3 matrix which is set to the transform on success.
+    * @return True if a transform had enough support.
+    */
+   bool estimate(const std::vector<std::pair<CvPoint2D32f, CvPoint2D32f> >& corr, CvMat* pMap);
+
+   unsigned int getInlierCount() const;
+   int getIterationCount() const;
+
+private:
+   unsigned int random(unsigned int limit);
+   unsigned int score(const double* pModel);
+   bool fitInliers(double* pModel);
+   bool guidedDone(unsigned int pool, unsigned int bestCount) const;
+
+   unsigned int mState;
+   Mode mMode;
+   int mMaxIter;
+   float mThreshold;
+   unsigned int mNumNeeded;
+   double mConfidence;
+   unsigned int mInlierCount;
+   int mIterations;
+
+   // packed correspondences and residuals, kept between calls
+   std::vector<float> mSrcX;
+   std::vector<float> mSrcY;
+   std::vector<float> mDstX;
+   std::vector<float> mDstY;
+   std::vector<float> mError;
+   std::vector<unsigned int> mBestPrefix; // inliers of the best model among the first n correspondences
+};
+
 class dataptr
 {
 public:
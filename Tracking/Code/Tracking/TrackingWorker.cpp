@@ -0,0 +1,187 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#include "TrackingWorker.h"
+#include <QtCore/QMutexLocker>
+#include <algorithm>
+
+TrackingWorker::TrackingWorker(QObject* pParent) :
+      QThread(pParent),
+      mQueueSize(2),
+      mOffline(false),
+      mStopping(false),
+      mDroppedFrames(0),
+      mParamsChanged(false)
+{
+}
+
+TrackingWorker::~TrackingWorker()
+{
+   stop();
+}
+
+void TrackingWorker::setQueueSize(unsigned int size)
+{
+   QMutexLocker lock(&mMutex);
+   mQueueSize = std::max(1U, size);
+   mFrameTaken.wakeAll();
+}
+
+void TrackingWorker::setOffline(bool offline)
+{
+   QMutexLocker lock(&mMutex);
+   mOffline = offline;
+   mFrameTaken.wakeAll();
+}
+
+void TrackingWorker::setParameters(const TrackingParameters& params)
+{
+   QMutexLocker lock(&mMutex);
+   mParams = params;
+   mParamsChanged = true;
+}
+
+bool TrackingWorker::submit(FrameSnapshot& frame)
+{
+   QMutexLocker lock(&mMutex);
+   if (mStopping)
+   {
+      return false;
+   }
+   bool dropped = false;
+   if (frame.mReset && !mOffline && !mFrames.empty())
+   {
+      mDroppedFrames += mFrames.size();
+      mFrames.clear();
+      dropped = true;
+   }
+   while (mFrames.size() >= mQueueSize && !mStopping)
+   {
+      if (mOffline)
+      {
+         mFrameTaken.wait(&mMutex);
+         continue;
+      }
+      // keep a queued reset since the frames after it need its base frame
+      size_t oldest = mFrames[0].mReset ? 1 : 0;
+      if (oldest == mFrames.size())
+      {
+         break; // only the reset is queued so let the queue grow by one
+      }
+      mFrames.erase(oldest);
+      mDroppedFrames++;
+      dropped = true;
+   }
+   mFrames.push(frame);
+   mFrameQueued.wakeOne();
+   return !dropped;
+}
+
+bool TrackingWorker::takeUpdate(TrackUpdate& update)
+{
+   QMutexLocker lock(&mMutex);
+   if (mUpdates.empty())
+   {
+      return false;
+   }
+   mUpdates.pop(update);
+   return true;
+}
+
+void TrackingWorker::clear(std::deque<TrackPoint>& retired)
+{
+   QMutexLocker lock(&mMutex);
+   mFrames.clear();
+   for (size_t idx = 0; idx < mUpdates.size(); ++idx)
+   {
+      retired.insert(retired.end(), mUpdates[idx].mRetired.begin(), mUpdates[idx].mRetired.end());
+   }
+   mUpdates.clear();
+   mFrameTaken.wakeAll();
+}
+
+void TrackingWorker::stop()
+{
+   {
+      QMutexLocker lock(&mMutex);
+      mStopping = true;
+      mFrameQueued.wakeAll();
+      mFrameTaken.wakeAll();
+   }
+   wait();
+   QMutexLocker lock(&mMutex);
+   mFrames.clear();
+   mStopping = false;
+}
+
+void TrackingWorker::finish(std::deque<TrackPoint>& retired)
+{
+   stop();
+   clear(retired);
+   // the thread has stopped so the pipeline may be used here
+   mPipeline.retireAll();
+   mPipeline.takeTrackHistory(retired);
+}
+
+unsigned int TrackingWorker::getDroppedFrameCount() const
+{
+   QMutexLocker lock(&mMutex);
+   return mDroppedFrames;
+}
+
+void TrackingWorker::run()
+{
+   // kept across frames so their storage is swapped through the queues instead of reallocated
+   FrameSnapshot frame;
+   TrackUpdate update;
+   for (;;)
+   {
+      bool paramsChanged = false;
+      TrackingParameters params;
+      {
+         QMutexLocker lock(&mMutex);
+         while (mFrames.empty() && !mStopping)
+         {
+            mFrameQueued.wait(&mMutex);
+         }
+         if (mStopping)
+         {
+            return;
+         }
+         mFrames.pop(frame);
+         mFrameTaken.wakeAll();
+         paramsChanged = mParamsChanged;
+         params = mParams;
+         mParamsChanged = false;
+      }
+
+      if (paramsChanged)
+      {
+         mPipeline.setParameters(params);
+      }
+      mPipeline.process(frame, update);
+      mPipeline.takeTrackHistory(update.mRetired);
+
+      {
+         QMutexLocker lock(&mMutex);
+         if (!mOffline)
+         {
+            // the retired detections aren't repeated in later updates so carry them forward
+            for (size_t idx = mUpdates.size(); idx > 0; --idx)
+            {
+               const std::deque<TrackPoint>& old = mUpdates[idx - 1].mRetired;
+               update.mRetired.insert(update.mRetired.begin(), old.begin(), old.end());
+            }
+            mUpdates.clear();
+         }
+         mUpdates.push(update);
+      }
+      emit updateReady();
+   }
+}
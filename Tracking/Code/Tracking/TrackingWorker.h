@@ -0,0 +1,122 @@
+/*
+ * The information in this file is
+ * Copyright(c) 2010 Trevor R.H. Clarke
+ * and is subject to the terms and conditions of the
+ * GNU Lesser General Public License Version 2.1
+ * The license text is available from   
+ * http://www.gnu.org/licenses/lgpl.html
+ */
+
+#ifndef TRACKINGWORKER_H__
+#define TRACKINGWORKER_H__
+
+#include "TrackingPipeline.h"
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+#include <deque>
+
+/**
+ * Runs a TrackingPipeline on a dedicated thread.
+ *
+ * Frames are passed in through a bounded queue and the results are passed back through a second
+ * queue with the updateReady() signal. The queue policy depends on the mode:
+ *
+ * In live mode a full queue discards its oldest frame so tracking keeps up with playback. The next
+ * processed frame is registered to the last processed frame, so a dropped frame only widens the gap
+ * between the frames being compared. A reset frame discards every queued frame since they belong to the
+ * old base frame. Only the latest update is kept since each update redraws the whole track state. The
+ * detections retired by discarded updates are moved to the kept update.
+ *
+ * In offline mode submit() blocks until there is room, every frame is processed in order and every
+ * update is kept, so a sequence gives the same results regardless of timing.
+ *
+ * Frames and updates are swapped through recycled queues, so once the queues and buffers have reached their
+ * largest sizes the snapshots and updates are passed back and forth without allocating.
+ */
+class TrackingWorker : public QThread
+{
+   Q_OBJECT
+
+public:
+   TrackingWorker(QObject* pParent = NULL);
+   virtual ~TrackingWorker();
+
+   void setQueueSize(unsigned int size);
+   void setOffline(bool offline);
+
+   /**
+    * Set the pipeline parameters.
+    *
+    * The parameters are applied before the next frame is processed.
+    */
+   void setParameters(const TrackingParameters& params);
+
+   /**
+    * Queue a frame.
+    *
+    * @param frame
+    *        The frame. Its contents are taken and it is left holding a recycled frame's storage, so reusing
+    *        it for the next snapshot avoids an allocation.
+    * @return False if a queued frame was discarded to make room.
+    */
+   bool submit(FrameSnapshot& frame);
+
+   /**
+    * Take the oldest update.
+    *
+    * @param update
+    *        Set to the update. Its previous storage is recycled for later updates.
+    * @return False if there are no updates.
+    */
+   bool takeUpdate(TrackUpdate& update);
+
+   /**
+    * Discard every queued frame and update.
+    *
+    * @param retired
+    *        The detections retired by the discarded updates are appended to this since no later update
+    *        repeats them.
+    */
+   void clear(std::deque<TrackPoint>& retired);
+
+   /**
+    * Stop the thread and wait for it to finish the current frame.
+    */
+   void stop();
+
+   /**
+    * Stop the thread, retire every live detection and hand back every detection which hasn't been taken.
+    *
+    * The queued updates are discarded. The thread is restarted with start().
+    *
+    * @param retired
+    *        The detections of the queued updates and then the pipeline's live detections are appended to this.
+    */
+   void finish(std::deque<TrackPoint>& retired);
+
+   unsigned int getDroppedFrameCount() const;
+
+signals:
+   void updateReady();
+
+protected:
+   virtual void run();
+
+private:
+   mutable QMutex mMutex;
+   QWaitCondition mFrameQueued;
+   QWaitCondition mFrameTaken;
+   RecycledQueue<FrameSnapshot> mFrames;
+   RecycledQueue<TrackUpdate> mUpdates;
+   unsigned int mQueueSize;
+   bool mOffline;
+   bool mStopping;
+   unsigned int mDroppedFrames;
+   TrackingParameters mParams;
+   bool mParamsChanged;
+
+   TrackingPipeline mPipeline; // only used by the worker thread
+};
+
+#endif